@@ -0,0 +1,41 @@
+
+# A headless tool that analyzes lots of positions with a UCI engine.
+
+QT       += core
+QT       -= gui
+
+TARGET = gkchess-analyze
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+TOP_DIR = ../../..
+
+DESTDIR = $$TOP_DIR/bin
+DEFINES += GUTIL_CORE_QT_ADAPTERS
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG(debug, debug|release) {
+    #message(Preparing debug build)
+    DEFINES += DEBUG
+}
+else {
+    #message(Preparing release build)
+}
+
+INCLUDEPATH += $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/lib \
+    -L$$TOP_DIR/gutil/lib \
+    -lGUtil \
+    -lGUtilQt \
+    -lGKChess
+
+
+SOURCES += main.cpp \
+    positionreader.cpp \
+    analyzer.cpp
+
+HEADERS += \
+    positionreader.h \
+    analyzer.h
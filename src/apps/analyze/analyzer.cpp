@@ -0,0 +1,259 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "analyzer.h"
+#include "gkchess_board.h"
+#include "gkchess_enginesettings.h"
+#include <gutil/exception.h>
+#include <QCoreApplication>
+#include <QEventLoop>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+
+/** How many jobs per engine we keep queued in the pool, so no engine waits for work. */
+#define JOBS_PER_ENGINE 2
+
+#define CSV_HEADER "index,fen,bestmove,ponder,score_cp,score_mate,bound,depth,seldepth,nodes,nps,time_ms,pv"
+
+
+Analyzer::Analyzer(const Options &o, EngineSettings *settings)
+    :m_options(o),
+      m_settings(settings),
+      m_output(o.OutputFile),
+      m_firstIndex(0),
+      m_nextIndex(0),
+      m_failures(0)
+{}
+
+int Analyzer::_count_finished_positions(qint64 &complete_size)
+{
+    complete_size = 0;
+    QFile f(m_options.OutputFile);
+    if(!f.open(QFile::ReadOnly))
+        return 0;
+
+    // Only count complete lines, in case we were interrupted in the middle of one
+    int ret = 0;
+    while(!f.atEnd()){
+        QByteArray line = f.readLine();
+        if(!line.endsWith('\n'))
+            break;
+        complete_size = f.pos();
+        if(!line.trimmed().isEmpty())
+            ++ret;
+    }
+    if(CSV == m_options.Format && 0 < ret)
+        --ret;
+    return ret;
+}
+
+int Analyzer::Run()
+{
+    PositionReader reader(m_options.InputFile);
+
+    if(m_options.Resume){
+        qint64 complete_size;
+        m_firstIndex = reader.Skip(_count_finished_positions(complete_size));
+
+        // Drop the partial line we were interrupted in, so we don't append to it
+        if(0 < m_firstIndex && !QFile::resize(m_options.OutputFile, complete_size))
+            throw Exception<>(String::Format("Unable to truncate %s", m_options.OutputFile.toUtf8().constData()));
+    }
+    m_nextIndex = m_firstIndex;
+
+    if(!m_output.open(0 < m_firstIndex ? QFile::Append : QFile::WriteOnly | QFile::Truncate))
+        throw Exception<>(String::Format("Unable to open %s", m_options.OutputFile.toUtf8().constData()));
+    if(CSV == m_options.Format && 0 == m_firstIndex){
+        m_output.write(CSV_HEADER "\n");
+        m_output.flush();
+    }
+
+    EnginePool pool(m_options.Engine, m_settings, m_options.Jobs);
+    connect(&pool, SIGNAL(JobFinished(const GKChess::EnginePool::Result &)),
+            this, SLOT(_job_finished(const GKChess::EnginePool::Result &)));
+
+    // Keep the pool fed until we run out of positions, then wait for the stragglers
+    const int max_pending = JOBS_PER_ENGINE * pool.GetSize();
+    int next_index = m_firstIndex;
+    bool more = true;
+    AnalysisPosition p;
+    while(true)
+    {
+        while(more && pool.GetPendingJobCount() < max_pending)
+        {
+            if(!(more = reader.Next(p)))
+                break;
+
+            // Job ids start at 1 and go up with every job
+            m_opcodes.insert(next_index++, p.Opcodes);
+            pool.AddJob(p.FEN, m_options.Params);
+        }
+
+        if(!more && 0 == pool.GetPendingJobCount())
+            break;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return m_failures;
+}
+
+void Analyzer::_job_finished(const EnginePool::Result &r)
+{
+    int indx = m_firstIndex + r.JobId - 1;
+    if(!r.Success)
+        ++m_failures;
+
+    m_finished.insert(indx, _format_result(r, m_opcodes.take(indx)));
+
+    // Write everything we can in order
+    while(!m_finished.isEmpty() && m_finished.firstKey() == m_nextIndex){
+        m_output.write(m_finished.take(m_nextIndex));
+        ++m_nextIndex;
+    }
+    m_output.flush();
+}
+
+
+// Makes the move on the board and returns it in standard algebraic notation,
+//  or returns an empty string if the move is not valid
+static QByteArray __do_move(Board &b, const GenericMove &m)
+{
+    MoveData md = b.GenerateMoveData(m);
+    if(md.IsNull() || Board::ValidMove != b.Move(md))
+        return QByteArray();
+    return md.PGNData.ToString().ConstData();
+}
+
+QByteArray Analyzer::_format_result(const EnginePool::Result &r,
+                                    const QList<QPair<QByteArray, QByteArray> > &opcodes) const
+{
+    IEngine::SearchInfo const &info = r.Info;
+    QByteArray ret;
+
+    if(CSV == m_options.Format)
+    {
+        ret.append(QByteArray::number(m_firstIndex + r.JobId - 1)).append(',');
+        ret.append(r.Position).append(',');
+        if(r.Success)
+        {
+            ret.append(r.BestMove.ToString().ConstData()).append(',');
+            ret.append(r.Ponder.ToString().ConstData()).append(',');
+            if(info.Has(IEngine::SearchInfo::HasScore) && !info.ScoreIsMate)
+                ret.append(QByteArray::number(info.Score));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasScore) && info.ScoreIsMate)
+                ret.append(QByteArray::number(info.Score));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasScore)){
+                switch(info.ScoreBound){
+                case IEngine::SearchInfo::LowerBound: ret.append("lower"); break;
+                case IEngine::SearchInfo::UpperBound: ret.append("upper"); break;
+                default: ret.append("exact"); break;
+                }
+            }
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasDepth))
+                ret.append(QByteArray::number(info.Depth));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasSelDepth))
+                ret.append(QByteArray::number(info.SelDepth));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasNodes))
+                ret.append(QByteArray::number(info.Nodes));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasNPS))
+                ret.append(QByteArray::number(info.NPS));
+            ret.append(',');
+            if(info.Has(IEngine::SearchInfo::HasTime))
+                ret.append(QByteArray::number(info.Time));
+            ret.append(',');
+            for(int i = 0; i < info.PVLength; ++i){
+                if(0 < i)
+                    ret.append(' ');
+                ret.append(info.PVMove(i).ToString().ConstData());
+            }
+        }
+        else
+        {
+            ret.append(",,,,,,,,,,");
+        }
+    }
+    else
+    {
+        // EPD has only the first four fields of the FEN
+        int fields = 0, i = 0;
+        for(; i < r.Position.length(); ++i){
+            if(' ' == r.Position[i] && 4 == ++fields)
+                break;
+        }
+        ret.append(r.Position.left(i));
+
+        QList<QByteArray> written;
+        if(r.Success)
+        {
+            Board b;
+            b.FromFEN(r.Position.constData());
+            QByteArray bm = __do_move(b, r.BestMove);
+            if(!bm.isEmpty()){
+                ret.append(" bm ").append(bm).append(';');
+                written.append("bm");
+            }
+
+            if(info.Has(IEngine::SearchInfo::HasScore)){
+                QByteArray op = info.ScoreIsMate ? "dm" : "ce";
+                ret.append(' ').append(op).append(' ').append(QByteArray::number(info.Score)).append(';');
+                written.append(op);
+            }
+            if(info.Has(IEngine::SearchInfo::HasDepth)){
+                ret.append(" acd ").append(QByteArray::number(info.Depth)).append(';');
+                written.append("acd");
+            }
+            if(info.Has(IEngine::SearchInfo::HasNodes)){
+                ret.append(" acn ").append(QByteArray::number(info.Nodes)).append(';');
+                written.append("acn");
+            }
+            if(info.Has(IEngine::SearchInfo::HasTime)){
+                ret.append(" acs ").append(QByteArray::number(info.Time / 1000)).append(';');
+                written.append("acs");
+            }
+
+            // The PV is in standard algebraic notation, so we have to play it out
+            b.FromFEN(r.Position.constData());
+            QByteArray pv;
+            for(int j = 0; j < info.PVLength; ++j){
+                QByteArray san = __do_move(b, info.PVMove(j));
+                if(san.isEmpty())
+                    break;
+                if(0 < j)
+                    pv.append(' ');
+                pv.append(san);
+            }
+            if(!pv.isEmpty()){
+                ret.append(" pv ").append(pv).append(';');
+                written.append("pv");
+            }
+        }
+
+        for(auto const &op : opcodes){
+            if(written.contains(op.first))
+                continue;
+            ret.append(' ').append(op.first);
+            if(!op.second.isEmpty())
+                ret.append(' ').append(op.second);
+            ret.append(';');
+        }
+    }
+
+    ret.append('\n');
+    return ret;
+}
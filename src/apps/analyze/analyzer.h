@@ -0,0 +1,110 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "positionreader.h"
+#include "gkchess_enginepool.h"
+#include <QVariantMap>
+#include <QFile>
+#include <QMap>
+
+namespace GKChess{
+class EngineSettings;
+}
+
+
+/** Analyzes all the positions in a file with a pool of engines, and writes the results
+ *  in the same order as the input.
+ *
+ *  The output is flushed after every position, so if a run is interrupted you can resume
+ *  it later and it will continue after the last position that was written.
+*/
+class Analyzer :
+        public QObject
+{
+    Q_OBJECT
+public:
+
+    enum OutputFormatEnum
+    {
+        /** The position with the results as EPD opcodes (bm, ce, dm, acd, acn, acs, pv).
+         *  Any other opcodes from the input are kept.
+        */
+        EPD,
+
+        /** One row per position, with a header. */
+        CSV
+    };
+
+    struct Options
+    {
+        /** The name of an engine from the engine settings. */
+        QString Engine;
+
+        QString InputFile;
+        QString OutputFile;
+        OutputFormatEnum Format;
+        GKChess::IEngine::ThinkParams Params;
+
+        /** The number of engines to run, or 0 for one per core. */
+        int Jobs;
+
+        /** If true we continue where the output file leaves off, otherwise we overwrite it. */
+        bool Resume;
+
+        Options() :Format(EPD), Jobs(0), Resume(false) {}
+    };
+
+    Analyzer(const Options &, GKChess::EngineSettings *);
+
+    /** Analyzes all the positions and returns how many of them failed.
+     *  Throws an exception if something goes wrong before the analysis starts.
+    */
+    int Run();
+
+
+private slots:
+
+    void _job_finished(const GKChess::EnginePool::Result &);
+
+
+private:
+
+    Options m_options;
+    GKChess::EngineSettings *m_settings;
+    QFile m_output;
+
+    // The index of the first position we analyze, which is not 0 if we resumed
+    int m_firstIndex;
+
+    // The next position to be written to the output
+    int m_nextIndex;
+    int m_failures;
+
+    // The input opcodes for the positions that are being analyzed, by index
+    QMap<int, QList<QPair<QByteArray, QByteArray> > > m_opcodes;
+
+    // Results that came back before the ones ahead of them, by index
+    QMap<int, QByteArray> m_finished;
+
+    int _count_finished_positions(qint64 &complete_size);
+    QByteArray _format_result(const GKChess::EnginePool::Result &,
+                              const QList<QPair<QByteArray, QByteArray> > &opcodes) const;
+
+};
+
+
+#endif // ANALYZER_H
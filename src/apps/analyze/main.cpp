@@ -0,0 +1,132 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "analyzer.h"
+#include "gkchess_enginesettings.h"
+#include <gutil/consolelogger.h>
+#include <gutil/exception.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <cstdio>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+
+#define APPLICATION_NAME "gkchess-analyze"
+#define APPLICATION_VERSION "0.0.0"
+
+/** If no search limit is given, we search this many milliseconds per position. */
+#define DEFAULT_MOVETIME 1000
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Initialize these settings before setting the application name, so they are shared between apps
+    EngineSettings engine_settings;
+
+    app.setApplicationName(APPLICATION_NAME);
+    app.setApplicationVersion(APPLICATION_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Analyzes every position in an EPD, FEN or PGN file with a UCI engine.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("input", "The positions to analyze (.epd, .fen or .pgn).");
+    parser.addPositionalArgument("output", "Where to write the results (.epd or .csv).");
+
+    QCommandLineOption engine_opt(QStringList() << "e" << "engine",
+                                  "The name of a configured engine, or the path to an engine executable.",
+                                  "engine");
+    QCommandLineOption option_opt(QStringList() << "o" << "option",
+                                  "Sets an engine option, i.e. Hash=256.  Can be given more than once.",
+                                  "name=value");
+    QCommandLineOption depth_opt(QStringList() << "d" << "depth", "Search to the given depth.", "plies");
+    QCommandLineOption movetime_opt(QStringList() << "t" << "movetime", "Search for this long per position.", "ms");
+    QCommandLineOption nodes_opt(QStringList() << "n" << "nodes", "Search this many nodes per position.", "nodes");
+    QCommandLineOption jobs_opt(QStringList() << "j" << "jobs", "The number of engines to run (default: one per core).", "count");
+    QCommandLineOption format_opt(QStringList() << "f" << "format", "The output format (epd or csv).  By default it comes from the output file.", "format");
+    QCommandLineOption resume_opt(QStringList() << "r" << "resume", "Continue after the last position in the output file.");
+    parser.addOption(engine_opt);
+    parser.addOption(option_opt);
+    parser.addOption(depth_opt);
+    parser.addOption(movetime_opt);
+    parser.addOption(nodes_opt);
+    parser.addOption(jobs_opt);
+    parser.addOption(format_opt);
+    parser.addOption(resume_opt);
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if(2 != args.length() || !parser.isSet(engine_opt)){
+        fputs(parser.helpText().toUtf8().constData(), stderr);
+        return -1;
+    }
+
+    Analyzer::Options o;
+    o.InputFile = args[0];
+    o.OutputFile = args[1];
+    o.Resume = parser.isSet(resume_opt);
+    o.Jobs = parser.value(jobs_opt).toInt();
+
+    QString format = parser.isSet(format_opt) ? parser.value(format_opt) : QFileInfo(o.OutputFile).suffix();
+    o.Format = 0 == format.compare("csv", ::Qt::CaseInsensitive) ? Analyzer::CSV : Analyzer::EPD;
+
+    o.Params.SearchTime = 0;
+    if(parser.isSet(depth_opt))
+        o.Params.Depth = parser.value(depth_opt).toInt();
+    if(parser.isSet(nodes_opt))
+        o.Params.Nodes = parser.value(nodes_opt).toInt();
+    if(parser.isSet(movetime_opt))
+        o.Params.SearchTime = parser.value(movetime_opt).toInt();
+    if(0 >= o.Params.Depth && 0 >= o.Params.Nodes && 0 >= o.Params.SearchTime)
+        o.Params.SearchTime = DEFAULT_MOVETIME;
+
+    // An engine given by path is added to the settings for this run only (we don't commit)
+    o.Engine = parser.value(engine_opt);
+    QFileInfo engine_file(o.Engine);
+    if(!engine_settings.GetEngineList().contains(o.Engine) && engine_file.isFile()){
+        o.Engine = QString("%1 (%2)").arg(engine_file.baseName()).arg(APPLICATION_NAME);
+        engine_settings.SetEnginePath(o.Engine, engine_file.absoluteFilePath());
+    }
+
+    for(QString const &opt : parser.values(option_opt)){
+        int indx = opt.indexOf('=');
+        if(-1 == indx){
+            fprintf(stderr, "Invalid engine option: %s\n", opt.toUtf8().constData());
+            return -1;
+        }
+        engine_settings.SetOptionForEngine(o.Engine, opt.left(indx), opt.mid(indx + 1));
+    }
+
+    int failures = 0;
+    try
+    {
+        failures = Analyzer(o, &engine_settings).Run();
+    }
+    catch(const Exception<> &ex)
+    {
+        ConsoleLogger().LogException(ex);
+        engine_settings.RejectChanges();
+        return -1;
+    }
+
+    engine_settings.RejectChanges();
+    if(0 < failures){
+        fprintf(stderr, "%d positions could not be analyzed\n", failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "positionreader.h"
+#include "gkchess_board.h"
+#include <gutil/exception.h>
+#include <QFileInfo>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+
+
+PositionReader::PositionReader(const QString &filename)
+    :m_file(filename),
+      m_pgn(0 == QFileInfo(filename).suffix().compare("pgn", ::Qt::CaseInsensitive)),
+      m_gameIndex(0),
+      m_positionIndex(0)
+{
+    if(m_pgn)
+        m_games = PGN_Parser::ParseFile(filename.toUtf8().constData());
+    else if(!m_file.open(QFile::ReadOnly))
+        throw Exception<>(String::Format("Unable to open %s", filename.toUtf8().constData()));
+}
+
+bool PositionReader::Next(AnalysisPosition &p)
+{
+    p.Opcodes.clear();
+    if(m_pgn)
+        return _next_pgn_position(p.FEN);
+
+    while(!m_file.atEnd())
+    {
+        if(ParseLine(m_file.readLine(), p))
+            return true;
+    }
+    return false;
+}
+
+int PositionReader::Skip(int count)
+{
+    AnalysisPosition p;
+    int ret = 0;
+    while(ret < count && Next(p))
+        ++ret;
+    return ret;
+}
+
+// Returns true if the string is a non-negative integer
+static bool __is_number(const QByteArray &s)
+{
+    if(s.isEmpty())
+        return false;
+    for(char c : s){
+        if(c < '0' || '9' < c)
+            return false;
+    }
+    return true;
+}
+
+bool PositionReader::ParseLine(const QByteArray &line, AnalysisPosition &p)
+{
+    QByteArray l = line.trimmed();
+    if(l.isEmpty() || l.startsWith('#'))
+        return false;
+
+    // Find the first six fields, and where each one ends
+    QList<QByteArray> fields;
+    QList<int> ends;
+    int i = 0;
+    while(fields.length() < 6 && i < l.length())
+    {
+        int end = i;
+        while(end < l.length() && ' ' != l[end] && '\t' != l[end])
+            ++end;
+        fields.append(l.mid(i, end - i));
+        ends.append(end);
+
+        i = end;
+        while(i < l.length() && (' ' == l[i] || '\t' == l[i]))
+            ++i;
+    }
+    if(fields.length() < 4)
+        return false;
+
+    // The first four fields are the same for FEN and EPD, but EPD doesn't have the
+    //  clocks so we start them fresh
+    int field_count = 4;
+    if(6 == fields.length() && __is_number(fields[4]) && __is_number(fields[5]))
+        field_count = 6;
+
+    p.FEN = fields[0];
+    for(int j = 1; j < field_count; ++j)
+        p.FEN.append(' ').append(fields[j]);
+    if(4 == field_count)
+        p.FEN.append(" 0 1");
+    int opcodes_start = ends[field_count - 1];
+
+    // Split the opcodes on semicolons, but not the ones in quotes
+    QByteArray op;
+    bool quoted = false;
+    for(int j = opcodes_start; j <= l.length(); ++j)
+    {
+        char c = j < l.length() ? l[j] : ';';
+        if('"' == c)
+            quoted = !quoted;
+
+        if(';' == c && !quoted)
+        {
+            op = op.trimmed();
+            if(!op.isEmpty()){
+                int space = op.indexOf(' ');
+                if(-1 == space)
+                    p.Opcodes.append(qMakePair(op, QByteArray()));
+                else
+                    p.Opcodes.append(qMakePair(op.left(space), op.mid(space + 1).trimmed()));
+            }
+            op.clear();
+        }
+        else
+            op.append(c);
+    }
+    return true;
+}
+
+bool PositionReader::_next_pgn_position(QByteArray &fen)
+{
+    while(m_positionIndex >= m_gamePositions.length())
+    {
+        if(m_gameIndex >= m_games.length())
+            return false;
+
+        // Play through the next game and remember every position
+        PGN_GameData const &gd = m_games[m_gameIndex++];
+        m_gamePositions.clear();
+        m_positionIndex = 0;
+        try
+        {
+            Board b;
+            if(gd.Tags.contains("setup") && gd.Tags["setup"] == "1" && gd.Tags.contains("fen"))
+                b.FromFEN(gd.Tags["fen"]);
+            else
+                b.SetupNewGame(Board::SetupStandardChess);
+
+            for(PGN_MoveData const &pmd : gd.Moves)
+            {
+                m_gamePositions.append(b.ToFEN().ConstData());
+                if(Board::ValidMove != b.Move(b.GenerateMoveData(pmd)))
+                    break;
+            }
+            m_gamePositions.append(b.ToFEN().ConstData());
+        }
+        catch(...)
+        {
+            // If a game has bad moves we use the positions up to that point
+        }
+    }
+
+    fen = m_gamePositions[m_positionIndex++];
+    return true;
+}
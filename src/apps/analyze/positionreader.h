@@ -0,0 +1,77 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef POSITIONREADER_H
+#define POSITIONREADER_H
+
+#include "gkchess_pgn_parser.h"
+#include <QFile>
+#include <QList>
+#include <QPair>
+
+
+/** One position to analyze. */
+struct AnalysisPosition
+{
+    /** The position in FEN notation. */
+    QByteArray FEN;
+
+    /** The opcodes that came with the position if it was read from EPD, as
+     *  (opcode, operands) pairs.
+    */
+    QList<QPair<QByteArray, QByteArray> > Opcodes;
+};
+
+
+/** Reads positions from a file one at a time.
+ *
+ *  A file with the .pgn extension is parsed as PGN, and we give you the position before
+ *  every move of every game, and the final position of each game.  Any other file is read
+ *  one position per line, either as FEN or EPD.  Empty lines and lines starting with '#'
+ *  are skipped.
+*/
+class PositionReader
+{
+public:
+
+    /** Opens the file, or throws an exception if it can't. */
+    explicit PositionReader(const QString &filename);
+
+    /** Reads the next position, or returns false if there are no more. */
+    bool Next(AnalysisPosition &);
+
+    /** Skips the given number of positions, and returns how many were skipped. */
+    int Skip(int count);
+
+    /** Parses a line of FEN or EPD, or returns false if it's not a position. */
+    static bool ParseLine(const QByteArray &line, AnalysisPosition &);
+
+
+private:
+
+    QFile m_file;
+
+    // Only used for PGN files
+    bool m_pgn;
+    QList<GKChess::PGN_GameData> m_games;
+    int m_gameIndex;
+    QList<QByteArray> m_gamePositions;
+    int m_positionIndex;
+
+    bool _next_pgn_position(QByteArray &fen);
+
+};
+
+
+#endif // POSITIONREADER_H
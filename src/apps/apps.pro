@@ -2,7 +2,9 @@
 TEMPLATE = subdirs
 
 SUBDIRS += \
-    studio
+    studio \
+    analyze \
+    match
 
 CONFIG += ordered
 
@@ -0,0 +1,202 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "reporter.h"
+#include "gkchess_enginesettings.h"
+#include <gutil/consolelogger.h>
+#include <gutil/exception.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <cstdio>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+
+#define APPLICATION_NAME "gkchess-match"
+#define APPLICATION_VERSION "0.0.0"
+
+
+/** Returns the name of the engine in the settings.  An engine given by path is added
+ *  to the settings for this run only (we don't commit).
+*/
+static QString __engine_name(EngineSettings &settings, const QString &engine)
+{
+    QFileInfo engine_file(engine);
+    if(settings.GetEngineList().contains(engine) || !engine_file.isFile())
+        return engine;
+
+    QString ret = QString("%1 (%2)").arg(engine_file.baseName()).arg(APPLICATION_NAME);
+    settings.SetEnginePath(ret, engine_file.absoluteFilePath());
+    return ret;
+}
+
+// Parses a time control like "10+0.1" (in seconds) into milliseconds
+static bool __parse_time_control(const QString &tc, int &time, int &inc)
+{
+    QStringList parts = tc.split('+');
+    bool ok1 = true, ok2 = true;
+    time = (int)(parts[0].toDouble(&ok1) * 1000);
+    inc = 1 < parts.length() ? (int)(parts[1].toDouble(&ok2) * 1000) : 0;
+    return ok1 && ok2 && parts.length() <= 2;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // Initialize these settings before setting the application name, so they are shared between apps
+    EngineSettings engine_settings;
+
+    app.setApplicationName(APPLICATION_NAME);
+    app.setApplicationVersion(APPLICATION_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Plays a match between two UCI engines.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("engine1", "The name of a configured engine, or the path to an engine executable.");
+    parser.addPositionalArgument("engine2", "The engine to play against.  All results are from engine1's point of view.");
+
+    QCommandLineOption games_opt(QStringList() << "g" << "games", "The number of games to play (default: 2).", "count");
+    QCommandLineOption concurrency_opt(QStringList() << "c" << "concurrency", "The number of games to play at once (default: one per two cores).", "count");
+    QCommandLineOption tc_opt(QStringList() << "tc", "The time control in seconds, i.e. 10+0.1 (default).  Use 0 for no clock.", "time+inc");
+    QCommandLineOption movetime_opt(QStringList() << "t" << "movetime", "Search for this long per move, instead of using a clock.", "ms");
+    QCommandLineOption depth_opt(QStringList() << "d" << "depth", "Search to the given depth, instead of using a clock.", "plies");
+    QCommandLineOption nodes_opt(QStringList() << "n" << "nodes", "Search this many nodes per move, instead of using a clock.", "nodes");
+    QCommandLineOption margin_opt(QStringList() << "margin", "How long an engine may overrun its time before it loses (default: 100).", "ms");
+    QCommandLineOption ponder_opt(QStringList() << "ponder", "Let the engines think on their opponent's time.");
+    QCommandLineOption book_opt(QStringList() << "b" << "book", "A Polyglot book to take the openings from.", "file");
+    QCommandLineOption book_depth_opt(QStringList() << "book-depth", "How many plies to take from the book (default: 8).", "plies");
+    QCommandLineOption openings_opt(QStringList() << "openings", "A file with one EPD or FEN opening per line.", "file");
+    QCommandLineOption no_repeat_opt(QStringList() << "no-repeat", "Don't play every opening twice with the colors reversed.");
+    QCommandLineOption max_plies_opt(QStringList() << "max-plies", "Adjudicate games that last this many plies as a draw.", "plies");
+    QCommandLineOption syzygy_opt(QStringList() << "syzygy-path", "The directories of Syzygy tablebases for --syzygy-adjudicate.", "dirs");
+    QCommandLineOption syzygy_adjudicate_opt(QStringList() << "syzygy-adjudicate", "End games as soon as the tablebases know the result (off by default).");
+    QCommandLineOption sprt_opt(QStringList() << "sprt", "Stop as soon as the SPRT accepts a hypothesis, i.e. 0,5 for elo0 and elo1.", "elo0,elo1");
+    QCommandLineOption alpha_opt(QStringList() << "alpha", "The SPRT false positive rate (default: 0.05).", "alpha");
+    QCommandLineOption beta_opt(QStringList() << "beta", "The SPRT false negative rate (default: 0.05).", "beta");
+    QCommandLineOption pgn_opt(QStringList() << "p" << "pgn", "Write the games to this PGN file.", "file");
+    QCommandLineOption event_opt(QStringList() << "event", "The event tag for the PGN.", "name");
+    parser.addOption(games_opt);
+    parser.addOption(concurrency_opt);
+    parser.addOption(tc_opt);
+    parser.addOption(movetime_opt);
+    parser.addOption(depth_opt);
+    parser.addOption(nodes_opt);
+    parser.addOption(margin_opt);
+    parser.addOption(ponder_opt);
+    parser.addOption(book_opt);
+    parser.addOption(book_depth_opt);
+    parser.addOption(openings_opt);
+    parser.addOption(no_repeat_opt);
+    parser.addOption(max_plies_opt);
+    parser.addOption(syzygy_opt);
+    parser.addOption(syzygy_adjudicate_opt);
+    parser.addOption(sprt_opt);
+    parser.addOption(alpha_opt);
+    parser.addOption(beta_opt);
+    parser.addOption(pgn_opt);
+    parser.addOption(event_opt);
+    parser.process(app);
+
+    QStringList args = parser.positionalArguments();
+    if(2 != args.length()){
+        fputs(parser.helpText().toUtf8().constData(), stderr);
+        return -1;
+    }
+
+    MatchRunner::Settings s;
+    s.Engines[0] = __engine_name(engine_settings, args[0]);
+    s.Engines[1] = __engine_name(engine_settings, args[1]);
+    if(parser.isSet(games_opt))
+        s.Games = parser.value(games_opt).toInt();
+    s.Concurrency = parser.value(concurrency_opt).toInt();
+
+    // Any other search limit means there is no clock, unless one is given explicitly
+    if(parser.isSet(movetime_opt) || parser.isSet(depth_opt) || parser.isSet(nodes_opt))
+        s.Time = s.Increment = 0;
+    if(parser.isSet(tc_opt) && !__parse_time_control(parser.value(tc_opt), s.Time, s.Increment)){
+        fprintf(stderr, "Invalid time control: %s\n", parser.value(tc_opt).toUtf8().constData());
+        return -1;
+    }
+    s.MoveTime = parser.value(movetime_opt).toInt();
+    s.Depth = parser.value(depth_opt).toInt();
+    s.Nodes = parser.value(nodes_opt).toInt();
+    if(parser.isSet(margin_opt))
+        s.TimeMargin = parser.value(margin_opt).toInt();
+
+    s.Ponder = parser.isSet(ponder_opt);
+
+    s.BookFile = parser.value(book_opt);
+    if(parser.isSet(book_depth_opt))
+        s.BookDepth = parser.value(book_depth_opt).toInt();
+    s.OpeningsFile = parser.value(openings_opt);
+    s.RepeatOpenings = !parser.isSet(no_repeat_opt);
+    s.MaxPlies = parser.value(max_plies_opt).toInt();
+    s.SyzygyPath = parser.value(syzygy_opt);
+    s.SyzygyAdjudication = parser.isSet(syzygy_adjudicate_opt);
+
+    if(parser.isSet(sprt_opt)){
+        QStringList elos = parser.value(sprt_opt).split(',');
+        bool ok1 = false, ok2 = false;
+        if(2 == elos.length()){
+            s.Elo0 = elos[0].toDouble(&ok1);
+            s.Elo1 = elos[1].toDouble(&ok2);
+        }
+        if(!ok1 || !ok2){
+            fprintf(stderr, "Invalid SPRT bounds: %s\n", parser.value(sprt_opt).toUtf8().constData());
+            return -1;
+        }
+        s.SPRT = true;
+    }
+    if(parser.isSet(alpha_opt))
+        s.Alpha = parser.value(alpha_opt).toDouble();
+    if(parser.isSet(beta_opt))
+        s.Beta = parser.value(beta_opt).toDouble();
+
+    s.PGNFile = parser.value(pgn_opt);
+    if(parser.isSet(event_opt))
+        s.Event = parser.value(event_opt);
+
+    int ret = 0;
+    try
+    {
+        MatchRunner runner(s, &engine_settings);
+        Reporter reporter(runner);
+        QObject::connect(&runner, SIGNAL(NotifyFinished()), &app, SLOT(quit()));
+
+        runner.Start();
+        if(runner.IsRunning())
+            app.exec();
+
+        printf("Finished %d games\n", runner.GetStatistics().GetGameCount());
+        reporter.PrintStandings();
+        if(s.SPRT){
+            double llr = runner.GetLLR();
+            if(llr <= runner.GetLowerBound())
+                printf("H0 accepted\n");
+            else if(runner.GetUpperBound() <= llr)
+                printf("H1 accepted\n");
+        }
+    }
+    catch(const Exception<> &ex)
+    {
+        ConsoleLogger().LogException(ex);
+        ret = -1;
+    }
+
+    engine_settings.RejectChanges();
+    return ret;
+}
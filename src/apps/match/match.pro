@@ -0,0 +1,39 @@
+
+# A headless tool that plays matches between two UCI engines.
+
+QT       += core
+QT       -= gui
+
+TARGET = gkchess-match
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+TOP_DIR = ../../..
+
+DESTDIR = $$TOP_DIR/bin
+DEFINES += GUTIL_CORE_QT_ADAPTERS
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG(debug, debug|release) {
+    #message(Preparing debug build)
+    DEFINES += DEBUG
+}
+else {
+    #message(Preparing release build)
+}
+
+INCLUDEPATH += $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/lib \
+    -L$$TOP_DIR/gutil/lib \
+    -lGUtil \
+    -lGUtilQt \
+    -lGKChess
+
+
+SOURCES += main.cpp \
+    reporter.cpp
+
+HEADERS += \
+    reporter.h
@@ -0,0 +1,48 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "reporter.h"
+#include <cstdio>
+USING_NAMESPACE_GKCHESS;
+
+
+Reporter::Reporter(MatchRunner &runner, QObject *parent)
+    :QObject(parent),
+      m_runner(runner)
+{
+    connect(&runner, SIGNAL(GameFinished(const GKChess::MatchRunner::GameResult &)),
+            this, SLOT(GameFinished(const GKChess::MatchRunner::GameResult &)));
+}
+
+void Reporter::GameFinished(const MatchRunner::GameResult &r)
+{
+    printf("Game %d: %s vs %s: %s {%s}\n",
+           r.Number,
+           r.White.toUtf8().constData(),
+           r.Black.toUtf8().constData(),
+           r.Result.toUtf8().constData(),
+           r.Reason.toUtf8().constData());
+    PrintStandings();
+}
+
+void Reporter::PrintStandings() const
+{
+    MatchStatistics const &s = m_runner.GetStatistics();
+    printf("Score: %d - %d - %d  [%.3f]  Elo: %.1f +/- %.1f  LLR: %.2f (%.2f, %.2f)\n",
+           s.GetWins(), s.GetLosses(), s.GetDraws(),
+           s.GetScore(),
+           s.GetElo(), s.GetEloError(),
+           m_runner.GetLLR(), m_runner.GetLowerBound(), m_runner.GetUpperBound());
+    fflush(stdout);
+}
@@ -0,0 +1,40 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef REPORTER_H
+#define REPORTER_H
+
+#include "gkchess_matchrunner.h"
+
+/** Prints the progress of a match to the console. */
+class Reporter :
+        public QObject
+{
+    Q_OBJECT
+    GKChess::MatchRunner &m_runner;
+public:
+
+    explicit Reporter(GKChess::MatchRunner &, QObject *parent = 0);
+
+    /** Prints the standings so far. */
+    void PrintStandings() const;
+
+
+public slots:
+
+    void GameFinished(const GKChess::MatchRunner::GameResult &);
+
+};
+
+#endif // REPORTER_H
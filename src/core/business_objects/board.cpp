@@ -1171,12 +1171,32 @@ Board::MoveValidationEnum Board::ValidateMove(const Square &s, const Square &d,
     return ValidMove;
 }
 
-QList<Square const *> Board::GetValidMovesForSquare(const Square &) const
+QList<Square const *> Board::GetValidMovesForSquare(const Square &s) const
 {
     QList<Square const *> ret;
+    for(int i = 0; i < ColumnCount(); ++i){
+        for(int j = 0; j < RowCount(); ++j){
+            Square const &d = SquareAt(i, j);
+            if(ValidMove == ValidateMove(s, d))
+                ret.append(&d);
+        }
+    }
     return ret;
 }
 
+bool Board::_has_valid_moves() const
+{
+    for(Square const *s : FindPieces(Piece(Piece::NoPiece, GetWhoseTurn()))){
+        for(int i = 0; i < ColumnCount(); ++i){
+            for(int j = 0; j < RowCount(); ++j){
+                if(ValidMove == ValidateMove(*s, SquareAt(i, j)))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
 static Square const *__get_source_square(const Board &b,
                                          char piece_moved,
                                          Square const &dest,
@@ -1477,6 +1497,66 @@ MoveData Board::GenerateMoveData(const PGN_MoveData &m) const
     return ret;
 }
 
+/** Chooses the piece that was given with a generic move. */
+class __generic_move_promotion :
+        public IPlayerResponse
+{
+    Piece::PieceTypeEnum m_type;
+public:
+    __generic_move_promotion(char c)
+        :m_type(Piece::GetTypeFromPGN(QChar(c).toUpper().toLatin1())) {}
+    virtual Piece ChoosePromotedPiece(Piece::AllegienceEnum a){ return Piece(m_type, a); }
+};
+
+MoveData Board::GenerateMoveData(const GenericMove &m, bool pgn_data) const
+{
+    if(ColumnCount() <= m.SourceCol || RowCount() <= m.SourceRow ||
+            ColumnCount() <= m.DestCol || RowCount() <= m.DestRow)
+        return MoveData();
+
+    Square const &s = SquareAt(m.SourceCol, m.SourceRow);
+    int dest_col = m.DestCol;
+
+    // We represent a castle as the king moving onto its rook
+    Piece const &p = s.GetPiece();
+    if(Piece::King == p.GetType() && m.SourceRow == m.DestRow && 2 == Abs(dest_col - m.SourceCol))
+    {
+        int castle_col;
+        if(dest_col > m.SourceCol)
+            castle_col = Piece::White == p.GetAllegience() ? GetCastleWhiteH() : GetCastleBlackH();
+        else
+            castle_col = Piece::White == p.GetAllegience() ? GetCastleWhiteA() : GetCastleBlackA();
+        if(-1 != castle_col)
+            dest_col = castle_col;
+    }
+
+    Square const &d = SquareAt(dest_col, m.DestRow);
+    if(0 == m.PromotedPiece)
+        return GenerateMoveData(s, d, 0, pgn_data);
+
+    __generic_move_promotion pr(m.PromotedPiece);
+    return GenerateMoveData(s, d, &pr, pgn_data);
+}
+
+GenericMove Board::GenerateGenericMove(const MoveData &md) const
+{
+    if(md.IsNull())
+        return GenericMove();
+
+    // We represent a castle as the king moving onto its rook, but engines want it
+    //  to move two squares
+    int dest_col = md.Destination.GetColumn();
+    if(MoveData::CastleHSide == md.CastleType)
+        dest_col = ColumnCount() - 2;
+    else if(MoveData::CastleASide == md.CastleType)
+        dest_col = 2;
+
+    char promoted = md.PiecePromoted.IsNull() ? 0 : tolower(md.PiecePromoted.ToFEN());
+    return GenericMove(md.Source.GetColumn(), md.Source.GetRow(),
+                       dest_col, md.Destination.GetRow(),
+                       promoted);
+}
+
 MoveData Board::GenerateMoveData(const Square &s,
                                  const Square &d,
                                  IPlayerResponse *uf,
@@ -1778,10 +1858,42 @@ bool Board::IsInCheck(Piece::AllegienceEnum a) const
     return ret;
 }
 
-bool Board::IsInCheckMate(Piece::AllegienceEnum) const
+bool Board::IsInCheckMate(Piece::AllegienceEnum a) const
 {
-    /** \todo Implement this */
-    return false;
+    // You can only be checkmated when it's your turn
+    return a == GetWhoseTurn() && IsInCheck(a) && !_has_valid_moves();
+}
+
+bool Board::IsStalemate() const
+{
+    return !IsInCheck(GetWhoseTurn()) && !_has_valid_moves();
+}
+
+bool Board::IsInsufficientMaterial() const
+{
+    int minor_pieces = 0;
+    int bishop_colors = 0;
+    bool knights = false;
+    for(Square const *s : FindPieces(Piece(Piece::NoPiece, Piece::AnyAllegience)))
+    {
+        switch(s->GetPiece().GetType())
+        {
+        case Piece::King:
+            break;
+        case Piece::Bishop:
+            bishop_colors |= 1 << ((s->GetColumn() + s->GetRow()) & 0x1);
+            ++minor_pieces;
+            break;
+        case Piece::Knight:
+            knights = true;
+            ++minor_pieces;
+            break;
+        default:
+            // Any pawn, rook or queen can mate
+            return false;
+        }
+    }
+    return minor_pieces <= 1 || (!knights && 3 != bishop_colors);
 }
 
 
@@ -1858,7 +1970,13 @@ void ObservableBoard::FromFEN(const String &s)
 void ObservableBoard::move_p(const MoveData &md)
 {
     emit NotifyPieceAboutToBeMoved(md);
-    Board::move_p(md);
+    try{
+        Board::move_p(md);
+    } catch(...) {
+        // The move may have been half made, so the observers have to look at the whole board
+        emit NotifyBoardReset();
+        throw;
+    }
     emit NotifyPieceMoved(md);
 }
 
@@ -19,6 +19,7 @@ limitations under the License.*/
 #include <gutil/string.h>
 #include "gkchess_piece.h"
 #include "gkchess_board_movedata.h"
+#include "gkchess_movedata.h"
 #include "gkchess_pgn_parser.h"
 
 // Even though we don't need this to compile the header, we include it anyways for completeness of this
@@ -263,6 +264,21 @@ public:
     /** Creates a MoveData object from a PGN MoveData object. */
     virtual MoveData GenerateMoveData(const PGN_MoveData &) const;
 
+    /** Creates a MoveData object from a move in the engine's notation.  A castle may be given
+     *  either as the king moving two squares, or as the king moving onto its own rook
+     *  (like in Chess960 and Polyglot books).  The promoted piece comes from the move.
+     *
+     *  \note Like the other overloads, this does not validate the move.
+     *  \returns A null move data if the move is off the board
+    */
+    MoveData GenerateMoveData(const GenericMove &, bool include_pgn_data = true) const;
+
+    /** Creates a move in the engine's notation from a MoveData object.  Castles are given
+     *  as the king moving two squares, which is what engines expect in standard chess.
+     *  \returns A null move if the move data is null
+    */
+    GenericMove GenerateGenericMove(const MoveData &) const;
+
     /** Validates the move.
         \param ignore_checks If true, the function allows moves that leave
         the moving piece's king in check.  This is false by default.
@@ -289,6 +305,15 @@ public:
     /** Returns true if the given allegience's king is in checkmate. */
     bool IsInCheckMate(Piece::AllegienceEnum) const;
 
+    /** Returns true if the side to move is not in check, but has no valid moves. */
+    bool IsStalemate() const;
+
+    /** Returns true if neither side has enough material to checkmate, which is the
+     *  case with only kings and either a single minor piece or bishops all on the
+     *  same color of square.
+    */
+    bool IsInsufficientMaterial() const;
+
 
     /** \name Game State
      *  This section describes the getters and setters of the game state variables
@@ -360,6 +385,7 @@ private:
     void _copy_construct(const Board &o);
     void _copy_board(const Board &o);
     void _update_gamestate(const MoveData &);
+    bool _has_valid_moves() const;
 
 
     /** Causes the board to update the threat counts for all squares. */
@@ -400,7 +426,9 @@ signals:
     void NotifySquareUpdated(const GKChess::Square &);
 
 
-    /** This signal is emitted whenever a piece is about to be moved with the Move() function. */
+    /** This signal is emitted whenever a piece is about to be moved with the Move() function.
+     *  It is followed by NotifyPieceMoved, or by NotifyBoardReset if the move fails.
+    */
     void NotifyPieceAboutToBeMoved(const GKChess::MoveData &);
 
     /** This signal is emitted whenever a piece is moved with the Move() function. */
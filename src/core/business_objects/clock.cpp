@@ -15,41 +15,142 @@ limitations under the License.*/
 #include "clock.h"
 #include <gkchess_common.h>
 #include <gutil/exception.h>
+#include <QElapsedTimer>
+#include <QTimer>
 USING_NAMESPACE_GUTIL;
 
+namespace{
+
+struct d_t
+{
+    qint64 remaining[2];
+    int delay[2];
+
+    // How much of the delay is left for the running clock
+    qint64 delay_left;
+
+    // The index of the running clock, or 0 if none is running
+    int running;
+    QElapsedTimer timer;
+    QTimer timeout;
+
+    d_t() :delay_left(0), running(0)
+    {
+        remaining[0] = remaining[1] = 0;
+        delay[0] = delay[1] = 0;
+        timeout.setSingleShot(true);
+    }
+};
+
+}
+
 NAMESPACE_GKCHESS;
 
 
 Clock::Clock(QObject *p)
     :AbstractClock(p)
-{}
+{
+    G_D_INIT();
+    G_D;
+    connect(&d->timeout, SIGNAL(timeout()), this, SLOT(_check_time()));
+}
+
+Clock::~Clock()
+{
+    G_D_UNINIT();
+}
 
-Clock::~Clock(){}
+void Clock::_charge_running_clock()
+{
+    G_D;
+    if(0 == d->running)
+        return;
+
+    // Only the time after the delay counts
+    int i = d->running - 1;
+    qint64 elapsed = d->timer.restart() - d->delay_left;
+    d->delay_left = 0 < elapsed ? 0 : -elapsed;
+    if(0 < elapsed)
+        d->remaining[i] = 0 < d->remaining[i] - elapsed ? d->remaining[i] - elapsed : 0;
+}
 
-void Clock::InitClock(ClockIndex, int, int)
+void Clock::_schedule_timeout()
 {
-    throw NotImplementedException<>();
+    G_D;
+    d->timeout.stop();
+    if(0 != d->running){
+        d->timeout.start(d->remaining[d->running - 1] + d->delay_left);
+    }
 }
 
-void Clock::PushClock(ClockIndex)
+void Clock::InitClock(ClockIndex indx, int time_in_minutes, int delay_in_secs)
 {
-    throw NotImplementedException<>();
+    G_D;
+    Pause();
+    d->remaining[indx - 1] = (qint64)time_in_minutes * 60000;
+    d->delay[indx - 1] = delay_in_secs * 1000;
 }
 
-void Clock::AdjustClock(ClockIndex, int)
+void Clock::PushClock(ClockIndex indx)
 {
-    throw NotImplementedException<>();
+    G_D;
+    _charge_running_clock();
+    d->running = One == indx ? Two : One;
+    d->delay_left = d->delay[d->running - 1];
+    d->timer.restart();
+    _schedule_timeout();
+}
+
+void Clock::AdjustClock(ClockIndex indx, int milliseconds)
+{
+    G_D;
+    _charge_running_clock();
+    d->remaining[indx - 1] += milliseconds;
+    if(d->remaining[indx - 1] < 0)
+        d->remaining[indx - 1] = 0;
+    _schedule_timeout();
 }
 
 void Clock::Pause()
 {
-    throw NotImplementedException<>();
+    G_D;
+    _charge_running_clock();
+    d->running = 0;
+    d->timeout.stop();
 }
 
-QTime Clock::GetRemainingTime(ClockIndex)
+int Clock::GetRemainingMilliseconds(ClockIndex indx)
 {
-    throw NotImplementedException<>();
-    return QTime();
+    G_D;
+    qint64 ret = d->remaining[indx - 1];
+    if(indx == d->running){
+        qint64 elapsed = d->timer.elapsed() - d->delay_left;
+        if(0 < elapsed)
+            ret = 0 < ret - elapsed ? ret - elapsed : 0;
+    }
+    return ret;
+}
+
+QTime Clock::GetRemainingTime(ClockIndex indx)
+{
+    return QTime(0, 0).addMSecs(GetRemainingMilliseconds(indx));
+}
+
+void Clock::_check_time()
+{
+    G_D;
+    if(0 == d->running)
+        return;
+
+    ClockIndex indx = (ClockIndex)d->running;
+    if(0 == GetRemainingMilliseconds(indx))
+        emit TimeIsUp(indx);
+    else
+    {
+        // The timer fired a little early
+        _charge_running_clock();
+        _schedule_timeout();
+    }
 }
 
 
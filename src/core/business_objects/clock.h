@@ -20,11 +20,16 @@ limitations under the License.*/
 namespace GKChess{
 
 
-/** Describes a chess clock. */
+/** A chess clock that measures time with a monotonic timer, to the millisecond.
+ *
+ *  The delay is a simple delay: every time a clock starts, it waits that long before it
+ *  counts down.  A clock never goes below zero; when it gets there TimeIsUp is emitted.
+*/
 class Clock :
         public AbstractClock
 {
     Q_OBJECT
+    void *d;
 public:
 
     Clock(QObject * = 0);
@@ -41,6 +46,21 @@ public:
     virtual QTime GetRemainingTime(ClockIndex);
     /** \} */
 
+
+    /** Returns the remaining time on the clock in milliseconds. */
+    int GetRemainingMilliseconds(ClockIndex);
+
+
+private slots:
+
+    void _check_time();
+
+
+private:
+
+    void _charge_running_clock();
+    void _schedule_timeout();
+
 };
 
 
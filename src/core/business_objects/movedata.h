@@ -17,7 +17,9 @@ limitations under the License.*/
 
 #include <gkchess_common.h>
 #include <gutil/exception.h>
+#include <gutil/string.h>
 #include <cstring>
+#include <cctype>
 
 NAMESPACE_GKCHESS;
 
@@ -72,6 +74,44 @@ struct GenericMove
           DestCol(dest_col), DestRow(dest_row),
           PromotedPiece(promoted_piece)
     {}
+
+    /** Formats the move in the engine's notation (i.e. e2e4 or a7a8q).  A null move
+     *  gives an empty string.
+    */
+    GUtil::String ToString() const{
+        if(IsNull())
+            return GUtil::String();
+        char str[6] = { (char)('a' + SourceCol), (char)('1' + SourceRow),
+                        (char)('a' + DestCol), (char)('1' + DestRow),
+                        (char)(PromotedPiece ? tolower(PromotedPiece) : 0), 0 };
+        return str;
+    }
+
+    /** Packs the move into 16 bits, in the same layout as a Polyglot book move: the dest col,
+     *  dest row, source col and source row take 3 bits each, followed by the promoted piece
+     *  (0 = none, 1 = knight, 2 = bishop, 3 = rook, 4 = queen).
+    */
+    GUINT16 Pack() const{
+        GUINT16 promoted = 0;
+        switch(PromotedPiece){
+        case 'n': case 'N': promoted = 1; break;
+        case 'b': case 'B': promoted = 2; break;
+        case 'r': case 'R': promoted = 3; break;
+        case 'q': case 'Q': promoted = 4; break;
+        default: break;
+        }
+        return (0x7 & DestCol) | (0x7 & DestRow) << 3 |
+                (0x7 & SourceCol) << 6 | (0x7 & SourceRow) << 9 |
+                promoted << 12;
+    }
+
+    /** Unpacks a move that was packed with Pack(). */
+    static GenericMove Unpack(GUINT16 m){
+        static const char promoted[] = {0, 'n', 'b', 'r', 'q', 0, 0, 0};
+        return GenericMove(0x7 & (m >> 6), 0x7 & (m >> 9),
+                           0x7 & m, 0x7 & (m >> 3),
+                           promoted[0x7 & (m >> 12)]);
+    }
 };
 
 
@@ -84,17 +124,20 @@ struct BookMove :
     */
     float Weight;
 
+    /** The weight exactly as it is stored in the book, before it was converted to a percentage. */
+    GUINT32 RawWeight;
+
     /** The 32-bit application-dependent "learn" value.  If you don't know what this is you can
      *  safely ignore it.
     */
     GUINT32 Learn;
 
     BookMove()
-        :Weight(0), Learn(0) {}
+        :Weight(0), RawWeight(0), Learn(0) {}
 
-    BookMove(float weight, GUINT32 learn, const GenericMove &generic_move)
+    BookMove(float weight, GUINT32 learn, const GenericMove &generic_move, GUINT32 raw_weight = 0)
         :GenericMove(generic_move),
-          Weight(weight), Learn(learn)
+          Weight(weight), RawWeight(raw_weight), Learn(learn)
     {}
 };
 
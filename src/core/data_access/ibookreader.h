@@ -18,12 +18,18 @@ limitations under the License.*/
 #include "gkchess_movedata.h"
 #include <gutil/string.h>
 #include <QObject>
+#include <QVector>
 
 namespace GKChess
 {
 
 
-/** An interface to access an opening book. */
+/** An interface to access an opening book.
+ *
+ *  Implementations must be reentrant, so separate readers can be used from separate threads.
+ *  Additionally LookupMoves() must be safe to call from several threads at once on the same
+ *  open book, as long as nobody opens, closes or validates it at the same time.
+*/
 class IBookReader
 {
 public:
@@ -31,6 +37,25 @@ public:
     class IValidationProgressObserver;
 
 
+    /** Statistics about the entries of a book, gathered during validation.
+     *  None of these make a book invalid, but they usually point to a badly built book.
+    */
+    struct ValidationSummary
+    {
+        /** The number of entries in the book. */
+        GUINT64 EntryCount;
+
+        /** The number of moves that appear more than once for the same position. */
+        GUINT64 DuplicateMoves;
+
+        /** The number of moves with zero weight. */
+        GUINT64 ZeroWeightMoves;
+
+        ValidationSummary()
+            :EntryCount(0), DuplicateMoves(0), ZeroWeightMoves(0) {}
+    };
+
+
     /** Opens a book with the given file name. If a book was already open, it will be closed
      *  and the new one will be opened.
      *
@@ -46,22 +71,39 @@ public:
 
     /** Validates the book. This may be a time-expensive operation, so you can provide a callback function
      *  to track its progress.
-     *  Throws an exception if validation fails
+     *  Throws an exception if validation fails, otherwise returns some statistics about the book.
     */
-    virtual void ValidateBook(IValidationProgressObserver * = 0) = 0;
+    virtual ValidationSummary ValidateBook(IValidationProgressObserver * = 0) = 0;
 
     /** Looks up the given position in the book, and returns all the moves it found.
      *  If the position was not in the database, an empty vector is returned.
     */
     virtual QList<BookMove> LookupMoves(const char *fen) = 0;
 
+    /** Returns the key that identifies the given position in the book, for use with
+     *  LookupMovesBatch().  Returns 0 if the FEN is invalid.
+    */
+    virtual GUINT64 ComputeKey(const char *fen) const = 0;
+
+    /** Looks up many positions at once, given by their keys from ComputeKey().
+     *  The result has one list of moves per key, in the same order as the keys, and the
+     *  lists for positions that are not in the book are empty.
+     *
+     *  Use this instead of LookupMoves() when you have a lot of positions, like a whole game
+     *  or repertoire, because the implementation can visit the book in a single pass.
+     *  Throws an exception on failure.
+    */
+    virtual QVector<QList<BookMove> > LookupMovesBatch(const QVector<GUINT64> &keys) = 0;
+
     /** Closes the book, or does nothing if it's already closed. */
     virtual void CloseBook() = 0;
 
     virtual ~IBookReader(){}
 
 
-    /** Used to catch progress updates during book validation. */
+    /** Used to catch progress updates during book validation.  Updates are delivered
+     *  on the thread that called ValidateBook().
+    */
     class IValidationProgressObserver
     {
     public:
@@ -17,8 +17,11 @@ limitations under the License.*/
 
 #include "gkchess_movedata.h"
 #include <QObject>
+#include <QFuture>
 #include <QStringList>
 #include <QMap>
+#include <QtAlgorithms>
+#include <cstring>
 
 namespace GKChess
 {
@@ -116,7 +119,105 @@ public:
 
         void clear(){ Name.clear(); Author.clear(); OptionNames.clear(); Options.clear(); }
 
-        ~EngineInfo();
+        ~EngineInfo(){ qDeleteAll(Options); }
+    };
+
+    /** The search information from an engine's "info" line.  Only the fields whose flags
+     *  are set in Fields were given by the engine.
+     *
+     *  This is a plain value type with no heap allocations, so it is cheap to copy around
+     *  and pass through queued signals.
+    */
+    struct SearchInfo
+    {
+        /** Flags that say which fields were given. */
+        enum FieldEnum
+        {
+            HasDepth =      0x0001,
+            HasSelDepth =   0x0002,
+            HasMultiPV =    0x0004,
+            HasScore =      0x0008,
+            HasNodes =      0x0010,
+            HasNPS =        0x0020,
+            HasHashFull =   0x0040,
+            HasTBHits =     0x0080,
+            HasTime =       0x0100,
+            HasPV =         0x0200
+        };
+        int Fields;
+
+        int Depth;
+        int SelDepth;
+
+        /** Which line of the MultiPV search this is for, starting with 1. */
+        int MultiPV;
+
+        /** If true then the score is the number of moves to mate (negative if the engine is
+         *  getting mated), otherwise it's in centipawns.
+        */
+        bool ScoreIsMate;
+        int Score;
+
+        /** If the score is only a bound, this says which one. */
+        enum BoundEnum
+        {
+            ExactScore,
+            LowerBound,
+            UpperBound
+        }
+        ScoreBound;
+
+        GUINT64 Nodes;
+        GUINT64 NPS;
+
+        /** How full the hash table is, in permill. */
+        int HashFull;
+        GUINT64 TBHits;
+
+        /** The search time in milliseconds. */
+        GUINT64 Time;
+
+        /** The maximum number of moves we keep from the principal variation. */
+        enum{ MaxPVLength = 64 };
+
+        /** The principal variation, as moves packed with GenericMove::Pack(). */
+        GUINT16 PV[MaxPVLength];
+        int PVLength;
+
+        /** Copies the fields that are set in the other info into this one. */
+        void Merge(const SearchInfo &o){
+            if(o.Has(HasDepth))     Depth = o.Depth;
+            if(o.Has(HasSelDepth))  SelDepth = o.SelDepth;
+            if(o.Has(HasMultiPV))   MultiPV = o.MultiPV;
+            if(o.Has(HasScore)){
+                ScoreIsMate = o.ScoreIsMate;
+                Score = o.Score;
+                ScoreBound = o.ScoreBound;
+            }
+            if(o.Has(HasNodes))     Nodes = o.Nodes;
+            if(o.Has(HasNPS))       NPS = o.NPS;
+            if(o.Has(HasHashFull))  HashFull = o.HashFull;
+            if(o.Has(HasTBHits))    TBHits = o.TBHits;
+            if(o.Has(HasTime))      Time = o.Time;
+            if(o.Has(HasPV)){
+                memcpy(PV, o.PV, o.PVLength * sizeof(GUINT16));
+                PVLength = o.PVLength;
+            }
+            Fields |= o.Fields;
+        }
+
+        /** Returns true if the field was given by the engine. */
+        bool Has(FieldEnum f) const{ return Fields & f; }
+
+        /** Returns the move of the principal variation at the given index. */
+        GenericMove PVMove(int i) const{ return GenericMove::Unpack(PV[i]); }
+
+        SearchInfo()
+            :Fields(0), Depth(0), SelDepth(0), MultiPV(1),
+              ScoreIsMate(false), Score(0), ScoreBound(ExactScore),
+              Nodes(0), NPS(0), HashFull(0), TBHits(0), Time(0),
+              PVLength(0)
+        {}
     };
 
     IEngine(QObject *parent = 0) : QObject(parent) {}
@@ -130,6 +231,12 @@ public:
     /** Starts the engine at the given path with the given arguments.  */
     virtual void StartEngine(const QString &path_to_engine, const QStringList &args = QStringList()) = 0;
 
+    /** Starts the engine without blocking.  The future gives true when the engine is
+     *  started and ready, or false if it failed.  You can issue commands right away;
+     *  they will be sent in order once the engine is ready.
+    */
+    virtual QFuture<bool> StartEngineAsync(const QString &path_to_engine, const QStringList &args = QStringList()) = 0;
+
     /** Returns true if the engine has been started. */
     virtual bool IsEngineStarted() const = 0;
 
@@ -148,17 +255,32 @@ public:
     virtual void NewGame() = 0;
 
     /** Issues the "isready" command and waits for the "readyok" response.
-     *  Use this to synchronize your state with the engine.
+     *  Use this to synchronize your state with the engine.  This blocks without processing
+     *  events, so from the GUI thread prefer WaitForReadyAsync().
      *  \param timeout_ms The function will return after this many milliseconds if the engine is not ready.
      *  \returns true if the engine is ready, false otherwise.
     */
     virtual bool WaitForReady(int timeout_ms = -1) = 0;
 
+    /** Issues the "isready" command without blocking.  The future gives true when the
+     *  "readyok" response arrives, or false if the engine stopped first.
+    */
+    virtual QFuture<bool> WaitForReadyAsync() = 0;
+
     /** Sets the position for the engine to work on.
      *  This can be "startpos moves e2e4 e7e5 ..." or a FEN string
     */
     virtual void SetPosition(const char *) = 0;
 
+    /** Sets the position as a game, which is the starting position (a FEN or "startpos")
+     *  and the moves played from it.
+     *
+     *  If the game has the same starting position as the last game the engine was given then
+     *  it is treated as the same game, so the engine keeps its hash table, and only the moves
+     *  that changed have to be formatted.  Otherwise the engine is told about a new game.
+    */
+    virtual void SetGamePosition(const char *start, const QList<GenericMove> &moves) = 0;
+
 
     /** Parameters for the "go" command in UCI. */
     struct ThinkParams
@@ -196,6 +318,17 @@ public:
         /** Constrains the engine to consider only these moves. An empty list means unconstrained. */
         QList<GenericMove> SearchMoves;
 
+        /** If true the engine searches in ponder mode, which means it's thinking on the
+         *  opponent's time.  The search isn't limited until you call PonderHit().
+        */
+        bool Ponder;
+
+        /** The number of best lines the engine should find, which you get as search info
+         *  with different MultiPV values.  1 is a normal search.  It is limited to what
+         *  the engine supports.
+        */
+        int MultiPV;
+
         ThinkParams()
             :SearchTime(-1),
               WhiteTime(-1),
@@ -205,7 +338,9 @@ public:
               MovesToGo(0),
               Depth(0),
               Nodes(0),
-              Mate(0)
+              Mate(0),
+              Ponder(false),
+              MultiPV(1)
         {}
     };
 
@@ -216,6 +351,18 @@ public:
     */
     virtual void StartThinking(const ThinkParams & = ThinkParams()) = 0;
 
+    /** Sets how many times per second search info is delivered.
+     *
+     *  If it's 0 (the default) then SearchInfoReceived is emitted for every info line.
+     *  Otherwise the info is merged into the latest info for each MultiPV line, and only
+     *  the lines that changed are emitted, at most this many times per second.  Any pending
+     *  info is always delivered before the best move.
+    */
+    virtual void SetSearchInfoRate(int per_second) = 0;
+
+    /** Returns how many times per second search info is delivered, or 0 for every line. */
+    virtual int GetSearchInfoRate() const = 0;
+
     /** Returns true if the engine is currently thinking. */
     virtual bool IsThinking() const = 0;
 
@@ -224,6 +371,107 @@ public:
     */
     virtual void StopThinking() = 0;
 
+    /** Returns the latest search info for each line of the current search, or the last
+     *  one if it finished, ordered by MultiPV.  Each line has every field the engine has
+     *  given for it so far, not just the ones from its last info.
+    */
+    virtual QList<SearchInfo> GetSearchLines() const = 0;
+
+    /** Measurements of the communication with the engine, which tell you whether time is
+     *  spent in the engine, the pipe or our own event loop.  All times are in microseconds
+     *  from a monotonic clock, and the counts include the handshake.
+    */
+    struct Statistics
+    {
+        /** How long it took from sending "uci" until the engine said "readyok". */
+        GUINT64 HandshakeTime;
+
+        /** The round trips from "isready" to "readyok". */
+        int ReadyCount;
+        GUINT64 ReadyTimeTotal;
+        GUINT64 ReadyTimeMax;
+
+        /** The time from "go" to the first info line, for all searches. */
+        int SearchCount;
+        GUINT64 FirstInfoTimeTotal;
+        GUINT64 FirstInfoTimeMax;
+
+        /** The time from "go" to the best move, for searches that weren't infinite or pondering. */
+        int TimedSearchCount;
+        GUINT64 BestMoveTimeTotal;
+        GUINT64 BestMoveTimeMax;
+
+        /** How far past the requested movetime the best move came, for searches with a movetime. */
+        int MoveTimeSearchCount;
+        GUINT64 MoveTimeOverrunTotal;
+        GUINT64 MoveTimeOverrunMax;
+
+        /** How long our commands waited before they were written to the engine. */
+        GUINT64 SendDelayTotal;
+        GUINT64 SendDelayMax;
+
+        /** How long lines from the engine waited before we processed them, which is the
+         *  latency of the event loop.
+        */
+        GUINT64 ReceiveDelayTotal;
+        GUINT64 ReceiveDelayMax;
+
+        GUINT64 LinesSent;
+        GUINT64 BytesSent;
+        GUINT64 LinesReceived;
+        GUINT64 BytesReceived;
+
+        /** How long the statistics have been collected. */
+        GUINT64 ElapsedTime;
+
+        /** Returns the rate of engine output. */
+        double GetLinesPerSecond() const{ return 0 == ElapsedTime ? 0 : LinesReceived * 1e6 / ElapsedTime; }
+        double GetBytesPerSecond() const{ return 0 == ElapsedTime ? 0 : BytesReceived * 1e6 / ElapsedTime; }
+
+        Statistics()
+            :HandshakeTime(0),
+              ReadyCount(0),
+              ReadyTimeTotal(0),
+              ReadyTimeMax(0),
+              SearchCount(0),
+              FirstInfoTimeTotal(0),
+              FirstInfoTimeMax(0),
+              TimedSearchCount(0),
+              BestMoveTimeTotal(0),
+              BestMoveTimeMax(0),
+              MoveTimeSearchCount(0),
+              MoveTimeOverrunTotal(0),
+              MoveTimeOverrunMax(0),
+              SendDelayTotal(0),
+              SendDelayMax(0),
+              ReceiveDelayTotal(0),
+              ReceiveDelayMax(0),
+              LinesSent(0),
+              BytesSent(0),
+              LinesReceived(0),
+              BytesReceived(0),
+              ElapsedTime(0)
+        {}
+    };
+
+    /** Returns the statistics since the engine was started or they were reset. */
+    virtual Statistics GetStatistics() const = 0;
+
+    /** Starts collecting statistics again. */
+    virtual void ResetStatistics() = 0;
+
+    /** Writes every line that goes to and from the engine to a CSV file, with the
+     *  times it passed through each stage.  An empty filename stops the trace.
+     *  Engines that don't talk through a protocol may ignore this.
+    */
+    virtual void SetTraceFile(const QString &) = 0;
+
+    /** Tells a pondering engine that the opponent played the move it was pondering on,
+     *  so it switches to a normal search with the limits it was given.
+     *  Does nothing if the engine is not thinking.
+    */
+    virtual void PonderHit() = 0;
+
 
 signals:
 
@@ -235,6 +483,11 @@ signals:
     */
     void MessageReceived(const QByteArray &);
 
+    /** This signal is emitted for every "info" line from the engine that has search
+     *  information in it, already parsed so you don't have to parse the text yourself.
+    */
+    void SearchInfoReceived(const GKChess::IEngine::SearchInfo &);
+
     /** This signal is emitted whenever a 'bestmove' is received from the engine.
      *  \param move The move text
      *  \param ponder The move that the engine would like to ponder
@@ -251,5 +504,6 @@ signals:
 
 
 Q_DECLARE_INTERFACE(GKChess::IEngine, "GKChess.IEngine")
+Q_DECLARE_METATYPE(GKChess::IEngine::SearchInfo)
 
 #endif // GKCHESS_IENGINE_H
@@ -0,0 +1,66 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "listener.h"
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QTimer>
+USING_NAMESPACE_GKCHESS;
+
+
+Listener::Listener(IEngine &engine, QObject *parent)
+    :QObject(parent),
+      InfoCount(0),
+      BestMoveCount(0),
+      CrashCount(0)
+{
+    connect(&engine, SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)),
+            this, SLOT(_search_info_received(const GKChess::IEngine::SearchInfo &)));
+    connect(&engine, SIGNAL(BestMove(const GenericMove &, const GenericMove &)),
+            this, SLOT(_best_move_received(const GenericMove &, const GenericMove &)));
+    connect(&engine, SIGNAL(NotifyEngineCrashed()), this, SLOT(_engine_crashed()));
+}
+
+bool Listener::WaitFor(const int &counter, int target, int timeout_ms)
+{
+    QElapsedTimer t;
+    t.start();
+    while(counter < target && t.elapsed() < timeout_ms)
+    {
+        QEventLoop loop;
+        connect(this, SIGNAL(NotifyChanged()), &loop, SLOT(quit()));
+        QTimer::singleShot(timeout_ms - t.elapsed(), &loop, SLOT(quit()));
+        loop.exec();
+    }
+    return target <= counter;
+}
+
+void Listener::_search_info_received(const IEngine::SearchInfo &)
+{
+    ++InfoCount;
+    emit NotifyChanged();
+}
+
+void Listener::_best_move_received(const GenericMove &m, const GenericMove &)
+{
+    LastBestMove = m;
+    ++BestMoveCount;
+    emit NotifyChanged();
+}
+
+void Listener::_engine_crashed()
+{
+    ++CrashCount;
+    emit NotifyChanged();
+}
@@ -0,0 +1,56 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include "gkchess_iengine.h"
+
+// The engine's signals spell it without the namespace, so our slots must too
+typedef GKChess::GenericMove GenericMove;
+
+/** Counts the signals from an engine, and lets you wait for them in an event loop. */
+class Listener :
+        public QObject
+{
+    Q_OBJECT
+public:
+
+    int InfoCount;
+    int BestMoveCount;
+    int CrashCount;
+    GenericMove LastBestMove;
+
+    explicit Listener(GKChess::IEngine &, QObject *parent = 0);
+
+    /** Runs the event loop until the counter reaches the target, or the timeout expires.
+     *  Returns true if the counter reached the target.
+    */
+    bool WaitFor(const int &counter, int target, int timeout_ms);
+
+
+signals:
+
+    void NotifyChanged();
+
+
+private slots:
+
+    void _search_info_received(const GKChess::IEngine::SearchInfo &);
+    void _best_move_received(const GenericMove &, const GenericMove &);
+    void _engine_crashed();
+
+};
+
+#endif // LISTENER_H
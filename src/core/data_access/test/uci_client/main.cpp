@@ -12,23 +12,191 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.*/
 
-#include "gkchess_uci_client.h"
+/** Drives the UCI client against the mock engine, to test it and measure how fast it
+ *  parses engine output, how much latency it adds and how it recovers from a crash.
+ *
+ *  Usage: uci_client [path_to_mock_engine]
+ *  It returns nonzero if any of the tests fail.
+*/
+
+#include "listener.h"
+#include <gutil/pluginutils.h>
+#include <gutil/consolelogger.h>
+#include <gutil/exception.h>
 #include <QCoreApplication>
-#include "gutil_consolelogger.h"
-#include "gkchess_globals.h"
-#include "gutil_thread.h"
-USING_NAMESPACE_GKCHESS;
+#include <QPluginLoader>
+#include <QElapsedTimer>
+#include <cstdio>
 USING_NAMESPACE_GUTIL;
-USING_NAMESPACE_GUTIL1(QT);
+USING_NAMESPACE_GUTIL1(Qt);
+USING_NAMESPACE_GKCHESS;
+
+#define READY_ROUND_TRIPS   1000
+#define LATENCY_SEARCHES    200
+#define LATENCY_MOVETIME    5
+#define THROUGHPUT_LINES    200000
+
+#define TIMEOUT             10000
+
+
+static bool __check(bool condition, const char *what)
+{
+    if(!condition)
+        printf("FAILED: %s\n", what);
+    return condition;
+}
+
+static double __avg_ms(GUINT64 total_us, int count)
+{
+    return 0 == count ? 0 : total_us / 1000.0 / count;
+}
+
+static void __print_delays(const IEngine::Statistics &s)
+{
+    printf("  send delay:     %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.SendDelayTotal, s.LinesSent), s.SendDelayMax / 1000.0);
+    printf("  receive delay:  %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.ReceiveDelayTotal, s.LinesReceived), s.ReceiveDelayMax / 1000.0);
+}
+
+// Runs one search to completion and checks the best move
+static bool __search(IEngine &e, Listener &l, const IEngine::ThinkParams &p)
+{
+    int target = l.BestMoveCount + 1;
+    e.SetPosition("startpos");
+    e.StartThinking(p);
+    return __check(l.WaitFor(l.BestMoveCount, target, TIMEOUT), "search timed out") &&
+            __check(GenericMove("e2e4").Pack() == l.LastBestMove.Pack(), "wrong best move");
+}
+
+
+static bool __test_handshake(IEngine &e)
+{
+    printf("Handshake and isready round trips (%d):\n", READY_ROUND_TRIPS);
+    IEngine::Statistics const hs = e.GetStatistics();
+    printf("  handshake:      %8.3f ms\n", hs.HandshakeTime / 1000.0);
+
+    bool ret = __check(e.GetEngineInfo().Name == "Mock UCI Engine", "wrong engine name") &&
+            __check(4 == e.GetEngineInfo().OptionNames.length(), "wrong number of options");
+
+    e.ResetStatistics();
+    for(int i = 0; ret && i < READY_ROUND_TRIPS; ++i)
+        ret = __check(e.WaitForReady(TIMEOUT), "isready timed out");
+
+    IEngine::Statistics const s = e.GetStatistics();
+    printf("  round trip:     %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.ReadyTimeTotal, s.ReadyCount), s.ReadyTimeMax / 1000.0);
+    __print_delays(s);
+    return ret && __check(READY_ROUND_TRIPS == s.ReadyCount, "missed readyok");
+}
+
+static bool __test_latency(IEngine &e, Listener &l)
+{
+    printf("Search latency (%d searches of %d ms):\n", LATENCY_SEARCHES, LATENCY_MOVETIME);
+    IEngine::ThinkParams p;
+    p.SearchTime = LATENCY_MOVETIME;
+
+    bool ret = true;
+    e.ResetStatistics();
+    for(int i = 0; ret && i < LATENCY_SEARCHES; ++i)
+        ret = __search(e, l, p);
+
+    IEngine::Statistics const s = e.GetStatistics();
+    printf("  first info:     %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.FirstInfoTimeTotal, s.SearchCount), s.FirstInfoTimeMax / 1000.0);
+    printf("  best move:      %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.BestMoveTimeTotal, s.TimedSearchCount), s.BestMoveTimeMax / 1000.0);
+    printf("  overrun:        %8.3f ms avg, %8.3f ms max\n",
+           __avg_ms(s.MoveTimeOverrunTotal, s.MoveTimeSearchCount), s.MoveTimeOverrunMax / 1000.0);
+    __print_delays(s);
+    return ret && __check(LATENCY_SEARCHES == s.MoveTimeSearchCount, "missed searches");
+}
+
+static bool __test_throughput(IEngine &e, Listener &l)
+{
+    printf("Info parsing throughput (%d lines):\n", THROUGHPUT_LINES);
+
+    // Deliver every line, so we measure the parser and not the rate limiter
+    e.SetSearchInfoRate(0);
+    e.ResetStatistics();
+    l.InfoCount = 0;
+
+    QElapsedTimer t;
+    t.start();
+    IEngine::ThinkParams p;
+    p.SearchTime = 0;
+    bool ret = __search(e, l, p);
+    qint64 elapsed = t.nsecsElapsed() / 1000;
+
+    IEngine::Statistics const s = e.GetStatistics();
+    printf("  wall time:      %8.3f ms\n", elapsed / 1000.0);
+    printf("  throughput:     %8.0f lines/s, %8.2f MB/s\n",
+           0 == elapsed ? 0 : l.InfoCount * 1e6 / elapsed,
+           0 == elapsed ? 0 : s.BytesReceived / (double)elapsed);
+    __print_delays(s);
+    return ret && __check(THROUGHPUT_LINES == l.InfoCount, "lost info lines");
+}
+
+static bool __test_crash_recovery(IEngine &e, Listener &l)
+{
+    printf("Crash recovery:\n");
+    IEngine::ThinkParams p;
+    p.SearchTime = LATENCY_MOVETIME;
+
+    // The engine crashes on its second search, then the client should restart it
+    e.SetOption("Hash", 32);
+    bool ret = __search(e, l, p);
+    if(ret)
+    {
+        e.SetPosition("startpos");
+        e.StartThinking(p);
+        ret = __check(l.WaitFor(l.CrashCount, 1, TIMEOUT), "crash not detected");
+    }
+
+    QElapsedTimer t;
+    t.start();
+    ret = ret && __check(e.IsEngineStarted(), "engine not restarted") &&
+            __check(e.WaitForReady(TIMEOUT), "restarted engine not ready");
+    printf("  restart:        %8.3f ms\n", t.nsecsElapsed() / 1e6);
+
+    return ret &&
+            __check(!e.IsThinking(), "still thinking after the crash") &&
+            __check(e.GetEngineInfo().Name == "Mock UCI Engine", "wrong engine name after the restart") &&
+            __search(e, l, p);
+}
+
 
 int main(int argc, char *argv[])
 {
-//    QCoreApplication a(argc, argv);
-    SmartPointer<UCI_Client> cli;
+    QCoreApplication app(argc, argv);
+    QString path = 1 < argc ? QString(argv[1]) :
+                              app.applicationDirPath() + "/mock_uci_engine";
 
+    QPluginLoader pl;
+    bool ok = true;
     try
     {
-         cli = new UCI_Client("/usr/games/stockfish");
+        IEngine *plugin = PluginUtils::LoadPlugin<IEngine>(pl, "uciEnginePlugin");
+
+        // Each test gets its own engine, because they run the mock with different scripts
+        QScopedPointer<IEngine> e(plugin->Create());
+        Listener l(*e);
+        e->StartEngine(path, QStringList() << "--info-count" << "3");
+        ok = __test_handshake(*e) && ok;
+        ok = __test_latency(*e, l) && ok;
+        e->StopEngine();
+
+        e.reset(plugin->Create());
+        Listener l2(*e);
+        e->StartEngine(path, QStringList() << "--info-count" << QString::number(THROUGHPUT_LINES));
+        ok = __test_throughput(*e, l2) && ok;
+        e->StopEngine();
+
+        e.reset(plugin->Create());
+        Listener l3(*e);
+        e->StartEngine(path, QStringList() << "--info-count" << "10" << "--crash-after" << "1");
+        ok = __test_crash_recovery(*e, l3) && ok;
+        e->StopEngine();
     }
     catch(const Exception<> &ex)
     {
@@ -36,62 +204,6 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-    Console::WriteLine("Engine info:");
-    Console::WriteLine(String::Format("Name: %s", cli->GetEngineInfo().Name.toUtf8().constData()));
-    Console::WriteLine(String::Format("Author: %s", cli->GetEngineInfo().Author.toUtf8().constData()));
-    Console::WriteLine();
-
-    for(typename Map<QString, UCI_Client::Option_t *>::const_iterator iter = cli->GetEngineInfo().Options.begin();
-        iter != cli->GetEngineInfo().Options.end();
-        ++iter)
-    {
-        switch(iter->Value()->GetType())
-        {
-        case UCI_Client::Option_t::Spin:
-        {
-            UCI_Client::SpinOption *opt = dynamic_cast<UCI_Client::SpinOption *>(iter->Value());
-            Console::WriteLine(String::Format("Spin option '%s': min,max,default=%d,%d,%d",
-                                              opt->Name.toUtf8().constData(),
-                                              opt->Min,
-                                              opt->Max,
-                                              opt->Default));
-        }
-            break;
-        case UCI_Client::Option_t::Check:
-        {
-            UCI_Client::CheckOption *opt = dynamic_cast<UCI_Client::CheckOption *>(iter->Value());
-            Console::WriteLine(String::Format("Check option '%s': default=%d",
-                                              opt->Name.toUtf8().constData(),
-                                              opt->Default));
-        }
-            break;
-        case UCI_Client::Option_t::String:
-        {
-            UCI_Client::StringOption *opt = dynamic_cast<UCI_Client::StringOption *>(iter->Value());
-            Console::WriteLine(String::Format("String option '%s': default=%s",
-                                              opt->Name.toUtf8().constData(),
-                                              opt->Default.toUtf8().constData()));
-        }
-            break;
-        case UCI_Client::Option_t::Button:
-        {
-            UCI_Client::ButtonOption *opt = dynamic_cast<UCI_Client::ButtonOption *>(iter->Value());
-            Console::WriteLine(String::Format("Button option '%s'",
-                                              opt->Name.toUtf8().constData()));
-        }
-            break;
-        }
-    }
-    
-    // Now see if we can make it think:
-    cli->SetPosition("startpos");
-    
-    UCI_Client::GoParams parms;
-    cli->Go(parms);
-    Thread::sleep(5);
-    cli->Stop();
-    
-    return 0;
-
-//    return a.exec();
+    printf(ok ? "All tests passed\n" : "Some tests failed\n");
+    return ok ? 0 : 1;
 }
@@ -4,8 +4,14 @@
 #
 #-------------------------------------------------
 
+# Tests and benchmarks the UCI client against the mock engine, which is
+#  built next to the plugin in the bin directory.
+
 TOP_DIR = ../../../../..
 
+DESTDIR = $$TOP_DIR/bin
+QMAKE_CXXFLAGS += -std=c++11
+
 INCLUDEPATH += $$TOP_DIR/include $$TOP_DIR/gutil/include
 LIBS += \
     -L$$TOP_DIR/gutil/lib \
@@ -25,4 +31,8 @@ CONFIG   -= app_bundle
 TEMPLATE = app
 
 
-SOURCES += main.cpp
+SOURCES += main.cpp \
+    listener.cpp
+
+HEADERS += \
+    listener.h
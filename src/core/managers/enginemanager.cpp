@@ -34,7 +34,7 @@ struct d_t
 NAMESPACE_GKCHESS;
 
 
-EngineManager::EngineManager(const QString &engine_name, EngineSettings *settings)
+EngineManager::EngineManager(const QString &engine_name, EngineSettings *settings, bool wait_for_start)
 {
     G_D_INIT();
     G_D;
@@ -46,9 +46,15 @@ EngineManager::EngineManager(const QString &engine_name, EngineSettings *setting
     d->engine_settings = settings;
 
     // Load the plugin and start the engine
-    d->engine = PluginUtils::LoadPlugin<IEngine>(d->pluginloader, "uciEnginePlugin")->Create();
-    d->engine->StartEngine(settings->GetEnginePath(engine_name));
-
+    QString path = settings->GetEnginePath(engine_name);
+    char const *plugin = GKCHESS_NATIVE_ENGINE_PATH == path ? "nativeEnginePlugin" : "uciEnginePlugin";
+    d->engine = PluginUtils::LoadPlugin<IEngine>(d->pluginloader, plugin)->Create();
+    if(wait_for_start)
+        d->engine->StartEngine(path);
+    else
+        d->engine->StartEngineAsync(path);
+
+    // The engine receives these in order after it starts
     ApplySettings();
 }
 
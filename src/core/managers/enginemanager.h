@@ -30,8 +30,12 @@ class EngineManager
     void *d;
 public:
 
-    /** Initializes the engine, or throws an exception if something goes wrong. */
-    EngineManager(const QString &engine_name, EngineSettings *);
+    /** Initializes the engine, or throws an exception if something goes wrong.
+     *  \param wait_for_start If false, the engine is started in the background and this
+     *  returns right away, so a failure to start is not reported here.  You can still
+     *  use the engine immediately.
+    */
+    EngineManager(const QString &engine_name, EngineSettings *, bool wait_for_start = true);
     ~EngineManager();
 
     /** Returns the name of the engine that was passed to the constructor. */
@@ -0,0 +1,283 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "enginepool.h"
+#include "enginemanager.h"
+#include "gkchess_enginesettings.h"
+#include <gkchess_common.h>
+#include <gutil/exception.h>
+#include <QThread>
+#include <QQueue>
+#include <QFutureWatcher>
+USING_NAMESPACE_GUTIL;
+
+namespace{
+
+struct job_t
+{
+    GUINT64 Id;
+    QByteArray Position;
+    GKChess::IEngine::ThinkParams Params;
+    bool NewGame;
+};
+
+struct worker_t
+{
+    GKChess::EngineManager *Manager;
+    QFutureWatcher<bool> *Ready;
+
+    // True if the engine failed to start, so we don't give it any work
+    bool Dead;
+
+    bool Busy;
+    GKChess::EnginePool::Result Current;
+
+    worker_t() :Manager(0), Ready(0), Dead(false), Busy(false) {}
+};
+
+struct d_t
+{
+    QString engine_name;
+    QVector<worker_t> workers;
+    QQueue<job_t> jobs;
+    GUINT64 next_id;
+    int busy_count;
+
+    d_t() :next_id(1), busy_count(0) {}
+};
+
+}
+
+NAMESPACE_GKCHESS;
+
+
+// Returns true if the search ends on its own, otherwise a job would never finish
+static bool __is_limited(const IEngine::ThinkParams &p)
+{
+    return !p.Ponder && -1 != p.SearchTime &&
+            (0 < p.SearchTime || 0 < p.Depth || 0 < p.Nodes || 0 < p.Mate ||
+             0 <= p.WhiteTime || 0 <= p.BlackTime);
+}
+
+
+EnginePool::EnginePool(const QString &engine_name, EngineSettings *settings, int size, QObject *parent)
+    :QObject(parent)
+{
+    G_D_INIT();
+    G_D;
+
+    if(!settings->GetEngineList().contains(engine_name))
+        throw Exception<>("Unrecognized Engine");
+
+    if(0 >= size)
+        size = QThread::idealThreadCount();
+    if(0 >= size)
+        size = 1;
+
+    d->engine_name = engine_name;
+    d->workers.resize(size);
+    for(worker_t &w : d->workers)
+    {
+        // The engines start in the background, and get their settings applied in order
+        w.Manager = new EngineManager(engine_name, settings, false);
+
+        IEngine *e = &w.Manager->GetEngine();
+        connect(e, SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)),
+                this, SLOT(_search_info_received(const GKChess::IEngine::SearchInfo &)));
+        connect(e, SIGNAL(BestMove(const GenericMove &, const GenericMove &)),
+                this, SLOT(_best_move_received(const GenericMove &, const GenericMove &)));
+        connect(e, SIGNAL(NotifyEngineCrashed()), this, SLOT(_engine_crashed()));
+
+        // Find out if the engine fails to start
+        w.Ready = new QFutureWatcher<bool>(this);
+        connect(w.Ready, SIGNAL(finished()), this, SLOT(_engine_ready()));
+        w.Ready->setFuture(e->WaitForReadyAsync());
+    }
+}
+
+EnginePool::~EnginePool()
+{
+    G_D;
+    for(worker_t &w : d->workers)
+        delete w.Manager;
+    G_D_UNINIT();
+}
+
+QString EnginePool::GetEngineName() const
+{
+    G_D;
+    return d->engine_name;
+}
+
+int EnginePool::GetSize() const
+{
+    G_D;
+    return d->workers.size();
+}
+
+GUINT64 EnginePool::AddJob(const QByteArray &position, const IEngine::ThinkParams &params, bool new_game)
+{
+    G_D;
+    if(!__is_limited(params))
+        throw Exception<>("The search must have a limit");
+
+    job_t j;
+    j.Id = d->next_id++;
+    j.Position = position;
+    j.Params = params;
+    j.NewGame = new_game;
+    d->jobs.enqueue(j);
+
+    _dispatch(false);
+    return j.Id;
+}
+
+int EnginePool::GetPendingJobCount() const
+{
+    G_D;
+    return d->jobs.size() + d->busy_count;
+}
+
+void EnginePool::Clear()
+{
+    G_D;
+    d->jobs.clear();
+    for(worker_t &w : d->workers){
+        if(w.Busy)
+            w.Manager->GetEngine().StopThinking();
+    }
+}
+
+void EnginePool::_dispatch(bool job_finished)
+{
+    G_D;
+    bool all_dead = true;
+    for(int i = 0; i < d->workers.size(); ++i)
+    {
+        worker_t &w = d->workers[i];
+        if(w.Dead)
+            continue;
+        all_dead = false;
+
+        if(w.Busy || d->jobs.isEmpty())
+            continue;
+
+        job_t j = d->jobs.dequeue();
+        w.Busy = true;
+        w.Current = Result();
+        w.Current.JobId = j.Id;
+        w.Current.Position = j.Position;
+        ++d->busy_count;
+
+        // The engine queues these up, so none of them block
+        IEngine &e = w.Manager->GetEngine();
+        if(j.NewGame)
+            e.NewGame();
+        e.SetPosition(j.Position.constData());
+        e.StartThinking(j.Params);
+    }
+
+    // If no engine could start then nobody will ever do the jobs, so fail them
+    if(all_dead)
+    {
+        while(!d->jobs.isEmpty()){
+            Result r;
+            r.JobId = d->jobs.head().Id;
+            r.Position = d->jobs.head().Position;
+            d->jobs.dequeue();
+            emit JobFinished(r);
+            job_finished = true;
+        }
+    }
+
+    if(job_finished && 0 == GetPendingJobCount())
+        emit NotifyIdle();
+}
+
+void EnginePool::_finish_job(int indx, bool success)
+{
+    G_D;
+    worker_t &w = d->workers[indx];
+    if(!w.Busy)
+        return;
+
+    Result r = w.Current;
+    r.Success = success;
+    w.Busy = false;
+    --d->busy_count;
+
+    emit JobFinished(r);
+    _dispatch(true);
+}
+
+static int __find_worker(QVector<worker_t> const &workers, QObject *engine)
+{
+    for(int i = 0; i < workers.size(); ++i){
+        if(&workers[i].Manager->GetEngine() == engine || workers[i].Ready == engine)
+            return i;
+    }
+    return -1;
+}
+
+void EnginePool::_search_info_received(const IEngine::SearchInfo &info)
+{
+    G_D;
+    int indx = __find_worker(d->workers, sender());
+    if(-1 == indx || !d->workers[indx].Busy || 1 != info.MultiPV)
+        return;
+    d->workers[indx].Current.Info.Merge(info);
+}
+
+void EnginePool::_best_move_received(const GenericMove &move, const GenericMove &ponder)
+{
+    G_D;
+    int indx = __find_worker(d->workers, sender());
+    if(-1 == indx)
+        return;
+
+    worker_t &w = d->workers[indx];
+    w.Current.BestMove = move;
+    w.Current.Ponder = ponder;
+    _finish_job(indx, true);
+}
+
+void EnginePool::_engine_crashed()
+{
+    G_D;
+    // The engine restarts itself, so we only have to report the job it was doing
+    int indx = __find_worker(d->workers, sender());
+    if(-1 != indx)
+        _finish_job(indx, false);
+}
+
+void EnginePool::_engine_ready()
+{
+    G_D;
+    int indx = __find_worker(d->workers, sender());
+    if(-1 == indx)
+        return;
+
+    worker_t &w = d->workers[indx];
+    if(!w.Ready->result())
+    {
+        w.Dead = true;
+        if(w.Busy)
+            _finish_job(indx, false);
+        else
+            _dispatch(false);
+    }
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,131 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_ENGINEPOOL_H
+#define GKCHESS_ENGINEPOOL_H
+
+#include "gkchess_iengine.h"
+#include <QObject>
+
+namespace GKChess{
+
+
+class EngineSettings;
+
+
+/** Keeps several running instances of the same engine, and hands out positions from a
+ *  work queue to whichever instance is free.
+ *
+ *  Use this to analyze lots of positions at once.  Each engine runs in its own process,
+ *  so with one engine per core every core does useful work.  The engine settings are
+ *  applied once, when the engines are started.
+ *
+ *  All functions must be called from the thread that owns the pool.
+*/
+class EnginePool :
+        public QObject
+{
+    Q_OBJECT
+    void *d;
+public:
+
+    /** The outcome of one job. */
+    struct Result
+    {
+        /** The id that was returned by AddJob(). */
+        GUINT64 JobId;
+
+        /** The position that was analyzed. */
+        QByteArray Position;
+
+        GenericMove BestMove;
+        GenericMove Ponder;
+
+        /** The latest search info for the main line, with all fields merged together. */
+        IEngine::SearchInfo Info;
+
+        /** False if the engine crashed during the search, in which case the other
+         *  members are not valid.
+        */
+        bool Success;
+
+        Result() :JobId(0), Success(false) {}
+    };
+
+    /** Starts the given number of instances of the engine.  If the size is 0 we start
+     *  one for every core.
+     *
+     *  This returns right away while the engines start in the background.  Jobs that
+     *  you add in the meantime wait in the queue.  Throws an exception if the engine
+     *  is not known.
+    */
+    EnginePool(const QString &engine_name, EngineSettings *, int size = 0, QObject *parent = 0);
+    ~EnginePool();
+
+    /** Returns the name of the engine that was passed to the constructor. */
+    QString GetEngineName() const;
+
+    /** Returns the number of engine instances. */
+    int GetSize() const;
+
+    /** Queues a position for analysis, and returns an id for the job.  Ids are given
+     *  in increasing order, starting with 1.
+     *  \param position A FEN string or "startpos moves ..."
+     *  \param params The search limits.  The search must end on its own, so it throws
+     *  an exception if they don't limit it, like an infinite search time or pondering.
+     *  \param new_game If true, the engine is told that the position is from a new game.
+    */
+    GUINT64 AddJob(const QByteArray &position,
+                   const IEngine::ThinkParams &params,
+                   bool new_game = true);
+
+    /** Returns the number of jobs that are queued or running. */
+    int GetPendingJobCount() const;
+
+    /** Removes all the queued jobs.  Running jobs are stopped, and they report a result
+     *  with whatever the engine found so far.
+    */
+    void Clear();
+
+
+signals:
+
+    /** Emitted whenever a job is done. */
+    void JobFinished(const GKChess::EnginePool::Result &);
+
+    /** Emitted when the last pending job is done.  Connect to this to find out
+     *  when all the work is finished.
+    */
+    void NotifyIdle();
+
+
+private slots:
+
+    void _search_info_received(const GKChess::IEngine::SearchInfo &);
+    void _best_move_received(const GenericMove &, const GenericMove &);
+    void _engine_crashed();
+    void _engine_ready();
+
+
+private:
+
+    void _dispatch(bool job_finished);
+    void _finish_job(int worker, bool success);
+
+};
+
+
+}
+
+#endif // GKCHESS_ENGINEPOOL_H
@@ -0,0 +1,240 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "enginesession.h"
+#include <gkchess_common.h>
+USING_NAMESPACE_GUTIL;
+
+namespace{
+
+enum StateEnum
+{
+    Idle,
+    Searching,
+    Pondering,
+
+    // We stopped a search and are waiting for its best move, which we throw away
+    Discarding
+};
+
+struct position_t
+{
+    QByteArray Start;
+    QList<GKChess::GenericMove> Moves;
+};
+
+struct d_t
+{
+    GKChess::IEngine *engine;
+    StateEnum state;
+
+    // The position of the last real search and its result
+    position_t position;
+    GKChess::GenericMove best;
+    GKChess::GenericMove ponder;
+
+    // The position we're pondering on, with our move and the reply we expect
+    position_t ponder_position;
+
+    // The search to start once we're done discarding
+    bool has_pending;
+    position_t pending;
+    GKChess::IEngine::ThinkParams pending_params;
+
+    int ponder_hits;
+    int ponder_misses;
+
+    d_t()
+        :engine(0), state(Idle), has_pending(false), ponder_hits(0), ponder_misses(0)
+    {}
+};
+
+}
+
+NAMESPACE_GKCHESS;
+
+
+static bool __same_moves(const QList<GenericMove> &a, const QList<GenericMove> &b)
+{
+    if(a.length() != b.length())
+        return false;
+    for(int i = 0; i < a.length(); ++i){
+        if(a[i].Pack() != b[i].Pack())
+            return false;
+    }
+    return true;
+}
+
+
+EngineSession::EngineSession(IEngine &engine, QObject *parent)
+    :QObject(parent)
+{
+    G_D_INIT();
+    G_D;
+    d->engine = &engine;
+    connect(&engine, SIGNAL(BestMove(const GenericMove &, const GenericMove &)),
+            this, SLOT(_best_move_received(const GenericMove &, const GenericMove &)));
+    connect(&engine, SIGNAL(NotifyEngineCrashed()), this, SLOT(_engine_crashed()));
+}
+
+EngineSession::~EngineSession()
+{
+    G_D_UNINIT();
+}
+
+IEngine &EngineSession::GetEngine() const
+{
+    G_D;
+    return *d->engine;
+}
+
+void EngineSession::Go(const char *start, const QList<GenericMove> &moves, const IEngine::ThinkParams &p)
+{
+    G_D;
+    switch(d->state)
+    {
+    case Pondering:
+        if(d->ponder_position.Start == start && __same_moves(d->ponder_position.Moves, moves))
+        {
+            // The search we have going is the one we want
+            d->engine->PonderHit();
+            d->position = d->ponder_position;
+            d->state = Searching;
+            ++d->ponder_hits;
+            return;
+        }
+        ++d->ponder_misses;
+        // Fall through
+    case Searching:
+        d->engine->StopThinking();
+        d->state = Discarding;
+        // Fall through
+    case Discarding:
+        // We start the search when the stopped one is out of the way
+        d->pending.Start = start;
+        d->pending.Moves = moves;
+        d->pending_params = p;
+        d->has_pending = true;
+        break;
+    case Idle:
+        _start(start, moves, p);
+        break;
+    default: break;
+    }
+}
+
+bool EngineSession::Ponder(const IEngine::ThinkParams &p)
+{
+    G_D;
+    if(Idle != d->state || d->best.IsNull() || d->ponder.IsNull())
+        return false;
+
+    d->ponder_position = d->position;
+    d->ponder_position.Moves.append(d->best);
+    d->ponder_position.Moves.append(d->ponder);
+
+    IEngine::ThinkParams pp = p;
+    pp.Ponder = true;
+    d->engine->SetGamePosition(d->ponder_position.Start.constData(), d->ponder_position.Moves);
+    d->engine->StartThinking(pp);
+    d->state = Pondering;
+    return true;
+}
+
+void EngineSession::Stop()
+{
+    G_D;
+    d->has_pending = false;
+    if(Searching == d->state || Pondering == d->state){
+        d->engine->StopThinking();
+        d->state = Discarding;
+    }
+}
+
+bool EngineSession::IsBusy() const
+{
+    G_D;
+    return Idle != d->state;
+}
+
+bool EngineSession::IsPondering() const
+{
+    G_D;
+    return Pondering == d->state;
+}
+
+int EngineSession::GetPonderHitCount() const
+{
+    G_D;
+    return d->ponder_hits;
+}
+
+int EngineSession::GetPonderMissCount() const
+{
+    G_D;
+    return d->ponder_misses;
+}
+
+void EngineSession::_start(const QByteArray &start, const QList<GenericMove> &moves, const IEngine::ThinkParams &p)
+{
+    G_D;
+    d->position.Start = start;
+    d->position.Moves = moves;
+    d->best = d->ponder = GenericMove();
+    d->engine->SetGamePosition(start.constData(), moves);
+    d->engine->StartThinking(p);
+    d->state = Searching;
+}
+
+void EngineSession::_best_move_received(const GenericMove &move, const GenericMove &ponder)
+{
+    G_D;
+    switch(d->state)
+    {
+    case Searching:
+        d->state = Idle;
+        d->best = move;
+        d->ponder = ponder;
+        emit BestMove(move, ponder);
+        break;
+    case Pondering:
+        // Engines shouldn't stop pondering on their own, but if one does we can't use it
+        d->state = Idle;
+        d->best = d->ponder = GenericMove();
+        emit NotifyIdle();
+        break;
+    case Discarding:
+        d->state = Idle;
+        if(d->has_pending){
+            d->has_pending = false;
+            _start(d->pending.Start, d->pending.Moves, d->pending_params);
+        }
+        else
+            emit NotifyIdle();
+        break;
+    default: break;
+    }
+}
+
+void EngineSession::_engine_crashed()
+{
+    G_D;
+    // The engine restarts itself and won't answer anything we sent the old one
+    d->state = Idle;
+    d->has_pending = false;
+    d->best = d->ponder = GenericMove();
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,101 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_ENGINESESSION_H
+#define GKCHESS_ENGINESESSION_H
+
+#include "gkchess_iengine.h"
+#include <QObject>
+
+namespace GKChess{
+
+
+/** Plays a game with an engine, and takes care of pondering.
+ *
+ *  You give it every position where it's the engine's turn with Go().  After it moves you
+ *  can call Ponder() so the engine thinks on the opponent's time about the reply it expects.
+ *  When the next position comes, it's a ponder hit if the opponent played that reply, and
+ *  the engine just keeps searching.  Otherwise it's a ponder miss, and the ponder search is
+ *  stopped and its result thrown away before the real search starts.
+ *
+ *  Only the results of real searches come out of the BestMove() signal.  Whenever the engine
+ *  has nothing to do after a stopped search, NotifyIdle() is emitted.
+*/
+class EngineSession :
+        public QObject
+{
+    Q_OBJECT
+    void *d;
+public:
+
+    /** The engine must outlive the session, and should not be used by anything else. */
+    explicit EngineSession(IEngine &, QObject *parent = 0);
+    ~EngineSession();
+
+    /** Returns the engine. */
+    IEngine &GetEngine() const;
+
+    /** Tells the engine to find a move in the position, which is given as a game like
+     *  IEngine::SetGamePosition().  If the engine is still thinking about something else
+     *  then that search is stopped and thrown away first.
+    */
+    void Go(const char *start, const QList<GenericMove> &moves, const IEngine::ThinkParams &);
+
+    /** Tells the engine to ponder on the reply it expects to its last move.  The params are
+     *  the limits for the search if the ponder hits.
+     *  \returns False if the engine didn't suggest a reply, or it's busy.
+    */
+    bool Ponder(const IEngine::ThinkParams &);
+
+    /** Stops any search and throws away its result.  NotifyIdle() is emitted when the
+     *  engine has stopped.
+    */
+    void Stop();
+
+    /** Returns true if the engine is searching or pondering. */
+    bool IsBusy() const;
+
+    /** Returns true if the engine is pondering. */
+    bool IsPondering() const;
+
+    /** Returns the number of ponder hits and misses so far. */
+    int GetPonderHitCount() const;
+    int GetPonderMissCount() const;
+
+
+signals:
+
+    /** The result of a search that was started by Go(). */
+    void BestMove(const GenericMove &move, const GenericMove &ponder);
+
+    /** Emitted when a search was stopped and there is nothing more to do. */
+    void NotifyIdle();
+
+
+private slots:
+
+    void _best_move_received(const GenericMove &, const GenericMove &);
+    void _engine_crashed();
+
+
+private:
+
+    void _start(const QByteArray &start, const QList<GenericMove> &, const IEngine::ThinkParams &);
+
+};
+
+
+}
+
+#endif // GKCHESS_ENGINESESSION_H
@@ -1,5 +1,11 @@
 HEADERS += \
-    managers/enginemanager.h
+    managers/enginemanager.h \
+    managers/enginepool.h \
+    managers/matchrunner.h \
+    managers/enginesession.h
 
 SOURCES += \
-    managers/enginemanager.cpp
+    managers/enginemanager.cpp \
+    managers/enginepool.cpp \
+    managers/matchrunner.cpp \
+    managers/enginesession.cpp
@@ -0,0 +1,765 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "matchrunner.h"
+#include "enginemanager.h"
+#include "enginesession.h"
+#include "gkchess_iengine.h"
+#include "gkchess_ibookreader.h"
+#include "gkchess_bookreadercache.h"
+#include "gkchess_enginesettings.h"
+#include "gkchess_board.h"
+#include "gkchess_clock.h"
+#include "gkchess_tablebases.h"
+#include <gkchess_common.h>
+#include <gutil/pluginutils.h>
+#include <gutil/exception.h>
+#include <QPluginLoader>
+#include <QThread>
+#include <QTimer>
+#include <QFile>
+#include <QDate>
+#include <QMap>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GUTIL1(Qt);
+
+#define STARTPOS_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+/** The width we wrap the PGN move text to. */
+#define PGN_LINE_WIDTH 80
+
+namespace{
+
+enum WinnerEnum
+{
+    Draw = -1,
+    WhiteWins = 0,
+    BlackWins = 1
+};
+
+struct game_t
+{
+    // Engines by engine index, not by color
+    GKChess::EngineManager *Engines[2];
+    GKChess::EngineSession *Sessions[2];
+    GKChess::Clock *Clock;
+    QTimer *Grace;
+
+    bool Running;
+    int Number;
+
+    // The index of the engine playing white
+    int White;
+
+    // The index of the engine that is thinking about a move, or -1
+    int Thinking;
+
+    // Engines we told to stop, which we're waiting for
+    bool Stopping[2];
+
+    GKChess::Board Board;
+    QByteArray StartFEN;
+
+    // The moves so far, which the engines get as a continuation of the game
+    QList<GKChess::GenericMove> Moves;
+    QByteArray MoveText;
+    QMap<QByteArray, int> Positions;
+    int Plies;
+
+    game_t()
+        :Clock(0), Grace(0), Running(false), Number(0), White(0), Thinking(-1), Plies(0)
+    {
+        Engines[0] = Engines[1] = 0;
+        Sessions[0] = Sessions[1] = 0;
+        Stopping[0] = Stopping[1] = false;
+    }
+};
+
+struct opening_t
+{
+    QByteArray FEN;
+    QList<GKChess::GenericMove> Moves;
+};
+
+struct d_t
+{
+    GKChess::MatchRunner::Settings settings;
+    GKChess::EngineSettings *engine_settings;
+    QVector<game_t *> games;
+
+    // The openings, which either come from a file or a book
+    QList<QByteArray> openings;
+    QPluginLoader pluginloader;
+    GKChess::IBookReader *book;
+    GKChess::BookReaderCache *book_cache;
+
+    // Each opening is used for consecutive games, so we only keep the latest one
+    opening_t opening;
+    int opening_index;
+
+    int next_game;
+    bool stopping;
+    GKChess::MatchStatistics stats;
+    QFile pgn;
+
+    // The games share the tablebases, which are only read
+    GKChess::Tablebases tablebases;
+
+    d_t()
+        :engine_settings(0), book(0), book_cache(0), opening_index(-1),
+          next_game(1), stopping(false)
+    {}
+};
+
+}
+
+NAMESPACE_GKCHESS;
+
+
+MatchRunner::MatchRunner(const Settings &s, EngineSettings *engine_settings, QObject *parent)
+    :QObject(parent)
+{
+    if(0 >= s.Time && 0 >= s.MoveTime && 0 >= s.Depth && 0 >= s.Nodes)
+        throw Exception<>("The search needs a limit");
+
+    G_D_INIT();
+    G_D;
+    d->settings = s;
+    d->engine_settings = engine_settings;
+    if(s.SyzygyAdjudication && 0 == d->tablebases.Open(s.SyzygyPath)){
+        G_D_UNINIT();
+        throw Exception<>("No tablebases found in the Syzygy path");
+    }
+
+    int concurrency = s.Concurrency;
+    if(0 >= concurrency)
+        concurrency = QThread::idealThreadCount() / 2;
+    concurrency = qMax(1, qMin(concurrency, s.Games));
+
+    try
+    {
+        for(int i = 0; i < concurrency; ++i)
+        {
+            game_t *g = new game_t;
+            d->games.append(g);
+            for(int e = 0; e < 2; ++e)
+            {
+                g->Engines[e] = new EngineManager(s.Engines[e], engine_settings);
+
+                IEngine *engine = &g->Engines[e]->GetEngine();
+                g->Sessions[e] = new EngineSession(*engine);
+                connect(g->Sessions[e], SIGNAL(BestMove(const GenericMove &, const GenericMove &)),
+                        this, SLOT(_best_move_received(const GenericMove &, const GenericMove &)));
+                connect(g->Sessions[e], SIGNAL(NotifyIdle()), this, SLOT(_engine_idle()));
+                connect(engine, SIGNAL(NotifyEngineCrashed()), this, SLOT(_engine_crashed()));
+            }
+
+            g->Clock = new Clock(this);
+            connect(g->Clock, SIGNAL(TimeIsUp(int)), this, SLOT(_time_is_up()));
+
+            g->Grace = new QTimer(this);
+            g->Grace->setSingleShot(true);
+            connect(g->Grace, SIGNAL(timeout()), this, SLOT(_grace_expired()));
+        }
+    }
+    catch(...)
+    {
+        for(game_t *g : d->games){
+            for(int e = 0; e < 2; ++e){
+                delete g->Sessions[e];
+                delete g->Engines[e];
+            }
+            delete g;
+        }
+        G_D_UNINIT();
+        throw;
+    }
+}
+
+MatchRunner::~MatchRunner()
+{
+    G_D;
+    for(game_t *g : d->games){
+        for(int e = 0; e < 2; ++e){
+            delete g->Sessions[e];
+            delete g->Engines[e];
+        }
+        delete g;
+    }
+
+    delete d->book_cache;
+    if(d->book)
+        d->book->CloseBook();
+    G_D_UNINIT();
+}
+
+// Returns the FEN of an opening line from a file, or an empty string if it's not a position
+static QByteArray __parse_opening(const QByteArray &line)
+{
+    QByteArray l = line.trimmed();
+    if(l.isEmpty() || l.startsWith('#'))
+        return QByteArray();
+
+    QList<QByteArray> fields = l.simplified().split(' ');
+    if(fields.length() < 4)
+        return QByteArray();
+
+    // EPD doesn't have the clocks, so we start them fresh
+    bool ok1 = false, ok2 = false;
+    if(6 <= fields.length()){
+        fields[4].toInt(&ok1);
+        fields[5].toInt(&ok2);
+    }
+
+    QByteArray ret = fields[0];
+    for(int i = 1; i < (ok1 && ok2 ? 6 : 4); ++i)
+        ret.append(' ').append(fields[i]);
+    if(!ok1 || !ok2)
+        ret.append(" 0 1");
+    return ret;
+}
+
+void MatchRunner::Start()
+{
+    G_D;
+    if(!d->settings.OpeningsFile.isEmpty())
+    {
+        QFile f(d->settings.OpeningsFile);
+        if(!f.open(QFile::ReadOnly))
+            throw Exception<>("Unable to open the openings file");
+        while(!f.atEnd()){
+            QByteArray fen = __parse_opening(f.readLine());
+            if(!fen.isEmpty())
+                d->openings.append(fen);
+        }
+        if(d->openings.isEmpty())
+            throw Exception<>("There are no positions in the openings file");
+    }
+    else if(!d->settings.BookFile.isEmpty())
+    {
+        d->book = PluginUtils::LoadPlugin<IBookReader>(d->pluginloader, "polyglotReaderPlugin");
+        d->book->OpenBook(d->settings.BookFile.toUtf8().constData());
+        d->book_cache = new BookReaderCache(*d->book);
+    }
+
+    if(!d->settings.PGNFile.isEmpty())
+    {
+        d->pgn.setFileName(d->settings.PGNFile);
+        if(!d->pgn.open(QFile::WriteOnly | QFile::Truncate))
+            throw Exception<>("Unable to open the PGN file");
+    }
+
+    for(int i = 0; i < d->games.size(); ++i)
+        _start_next_game(i);
+}
+
+void MatchRunner::Stop()
+{
+    G_D;
+    d->stopping = true;
+}
+
+bool MatchRunner::IsRunning() const
+{
+    G_D;
+    for(game_t *g : d->games){
+        if(g->Running || g->Stopping[0] || g->Stopping[1])
+            return true;
+    }
+    return false;
+}
+
+MatchStatistics const &MatchRunner::GetStatistics() const
+{
+    G_D;
+    return d->stats;
+}
+
+double MatchRunner::GetLowerBound() const
+{
+    G_D;
+    return MatchStatistics::GetLowerBound(d->settings.Alpha, d->settings.Beta);
+}
+
+double MatchRunner::GetUpperBound() const
+{
+    G_D;
+    return MatchStatistics::GetUpperBound(d->settings.Alpha, d->settings.Beta);
+}
+
+double MatchRunner::GetLLR() const
+{
+    G_D;
+    return d->stats.GetLLR(d->settings.Elo0, d->settings.Elo1);
+}
+
+// True if the side to move can actually capture en passant
+static bool __can_capture_en_passant(const Board &b)
+{
+    Square const *ep = b.GetEnPassantSquare();
+    if(!ep)
+        return false;
+
+    // The capturing pawn stands next to the pawn that just moved
+    int row = ep->GetRow() + (Piece::White == b.GetWhoseTurn() ? -1 : 1);
+    if(0 > row || b.RowCount() <= row)
+        return false;
+    for(int col = ep->GetColumn() - 1; col <= ep->GetColumn() + 1; col += 2)
+    {
+        if(0 > col || b.ColumnCount() <= col)
+            continue;
+
+        Square const &s = b.SquareAt(col, row);
+        if(Piece::Pawn == s.GetPiece().GetType() &&
+                b.GetWhoseTurn() == s.GetPiece().GetAllegience() &&
+                Board::ValidMove == b.ValidateMove(s, *ep))
+            return true;
+    }
+    return false;
+}
+
+// The part of the FEN that matters for repetitions.  The en passant square is set after
+//  every double push, but it only makes a different position if the capture is legal.
+static QByteArray __position_key(const Board &b)
+{
+    QList<QByteArray> fields = QByteArray(b.ToFEN().ConstData()).split(' ');
+    while(4 < fields.length())
+        fields.removeLast();
+    if(4 == fields.length() && !__can_capture_en_passant(b))
+        fields[3] = "-";
+
+    QByteArray ret;
+    for(QByteArray const &f : fields)
+        ret.append(f).append(' ');
+    return ret;
+}
+
+// Validates and plays the move, and records it.  Returns false if the move was illegal.
+static bool __play_move(game_t &g, const GenericMove &m)
+{
+    MoveData md = g.Board.GenerateMoveData(m);
+    if(md.IsNull() || Board::ValidMove != g.Board.Move(md))
+        return false;
+
+    if(Piece::White == md.PieceMoved.GetAllegience())
+        g.MoveText.append(QByteArray::number(md.PGNData.MoveNumber)).append(". ");
+    else if(g.MoveText.isEmpty())
+        g.MoveText.append(QByteArray::number(md.PGNData.MoveNumber)).append("... ");
+    g.MoveText.append(md.PGNData.ToString().ConstData()).append(' ');
+
+    // Book moves castle onto the rook, so we normalize them for the engines
+    g.Moves.append(g.Board.GenerateGenericMove(md));
+    g.Positions[__position_key(g.Board)] += 1;
+    ++g.Plies;
+    return true;
+}
+
+static opening_t __make_opening(d_t *d, int indx)
+{
+    opening_t ret;
+    if(!d->openings.isEmpty())
+    {
+        ret.FEN = d->openings[indx % d->openings.length()];
+    }
+    else
+    {
+        ret.FEN = STARTPOS_FEN;
+        if(d->book_cache)
+        {
+            // Play random book moves until we leave the book
+            Board b;
+            b.FromFEN(ret.FEN.constData());
+            for(int i = 0; i < d->settings.BookDepth; ++i)
+            {
+                BookMove m;
+                if(!d->book_cache->PickMove(b.ToFEN().ConstData(), m))
+                    break;
+
+                MoveData md = b.GenerateMoveData(m, false);
+                if(md.IsNull() || Board::ValidMove != b.Move(md))
+                    break;
+                ret.Moves.append(m);
+            }
+        }
+    }
+    return ret;
+}
+
+void MatchRunner::_start_next_game(int slot)
+{
+    G_D;
+    if(!d->stopping && d->next_game <= d->settings.Games)
+        _start_game(slot);
+    else if(!IsRunning())
+        emit NotifyFinished();
+}
+
+void MatchRunner::_start_game(int slot)
+{
+    G_D;
+    game_t &g = *d->games[slot];
+    g.Number = d->next_game++;
+    g.White = (g.Number - 1) % 2;
+
+    int opening_index = d->settings.RepeatOpenings ? (g.Number - 1) / 2 : g.Number - 1;
+    if(opening_index != d->opening_index){
+        d->opening = __make_opening(d, opening_index);
+        d->opening_index = opening_index;
+    }
+
+    g.Board.FromFEN(d->opening.FEN.constData());
+    g.StartFEN = d->opening.FEN;
+    g.Moves.clear();
+    g.MoveText.clear();
+    g.Positions.clear();
+    g.Positions[__position_key(g.Board)] = 1;
+    g.Plies = 0;
+    g.Thinking = -1;
+    g.Running = true;
+    for(GenericMove const &m : d->opening.Moves)
+        __play_move(g, m);
+
+    // The engines get their commands in order, so we don't have to wait for them
+    for(EngineManager *e : g.Engines)
+        e->GetEngine().NewGame();
+
+    if(0 < d->settings.Time){
+        g.Clock->InitClock(AbstractClock::One, 0);
+        g.Clock->InitClock(AbstractClock::Two, 0);
+        g.Clock->AdjustClock(AbstractClock::One, d->settings.Time);
+        g.Clock->AdjustClock(AbstractClock::Two, d->settings.Time);
+    }
+
+    _request_move(slot);
+}
+
+// Returns the search limits as they are right now
+static IEngine::ThinkParams __think_params(const MatchRunner::Settings &s, game_t &g)
+{
+    IEngine::ThinkParams p;
+    p.SearchTime = 0;
+    if(0 < s.Time)
+    {
+        p.WhiteTime = g.Clock->GetRemainingMilliseconds(AbstractClock::One);
+        p.BlackTime = g.Clock->GetRemainingMilliseconds(AbstractClock::Two);
+        p.WhiteIncrement = p.BlackIncrement = s.Increment;
+    }
+    else
+    {
+        p.SearchTime = s.MoveTime;
+        p.Depth = s.Depth;
+        p.Nodes = s.Nodes;
+    }
+    return p;
+}
+
+void MatchRunner::_request_move(int slot)
+{
+    G_D;
+    game_t &g = *d->games[slot];
+    Settings const &s = d->settings;
+    bool white = Piece::White == g.Board.GetWhoseTurn();
+    int e = white ? g.White : 1 - g.White;
+
+    IEngine::ThinkParams p = __think_params(s, g);
+    if(0 < s.Time){
+        // Pushing the other side's clock starts ours
+        g.Clock->PushClock(white ? AbstractClock::Two : AbstractClock::One);
+    }
+    else if(0 < s.MoveTime){
+        g.Grace->start(s.MoveTime + s.TimeMargin);
+    }
+
+    // The engines were given a new game when it started, so they keep their hash
+    //  tables for the rest of it.  If the engine was pondering on this position
+    //  it just keeps going.
+    g.Thinking = e;
+    g.Sessions[e]->Go(g.StartFEN == STARTPOS_FEN ? "startpos" : g.StartFEN.constData(), g.Moves, p);
+}
+
+static int __find_game(QVector<game_t *> const &games, QObject *sender, int *engine = 0)
+{
+    for(int i = 0; i < games.size(); ++i)
+    {
+        game_t *g = games[i];
+        if(g->Clock == sender || g->Grace == sender)
+            return i;
+        for(int e = 0; e < 2; ++e){
+            if(&g->Engines[e]->GetEngine() == sender || g->Sessions[e] == sender){
+                if(engine)
+                    *engine = e;
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+// Finds out who wins the game with perfect play, if the tablebases know.  The win has to
+//  come before the fifty move rule, which we can tell from the distance to zero.
+static bool __probe_tablebases(const Tablebases &tb, const Board &b, int &winner)
+{
+    Tablebases::Position pos;
+    Tablebases::WDLEnum wdl;
+    if(0 == tb.GetMaxPieces() || !Tablebases::Position::FromBoard(b, pos) || !tb.ProbeWDL(pos, wdl))
+        return false;
+
+    winner = Draw;
+    if(Tablebases::Win == wdl || Tablebases::Loss == wdl)
+    {
+        // The distance may be a ply too long, so we play on if it's that close
+        int dtz;
+        if(!tb.ProbeDTZ(pos, dtz))
+            return false;
+        int plies = qAbs(dtz) + b.GetHalfMoveClock();
+        if(99 < plies && plies <= 101)
+            return false;
+        if(plies <= 99)
+            winner = (Tablebases::Win == wdl) == (Piece::White == b.GetWhoseTurn()) ? WhiteWins : BlackWins;
+    }
+    return true;
+}
+
+void MatchRunner::_best_move_received(const GenericMove &move, const GenericMove &)
+{
+    G_D;
+    int e;
+    int slot = __find_game(d->games, sender(), &e);
+    if(-1 == slot)
+        return;
+
+    game_t &g = *d->games[slot];
+    if(!g.Running || g.Thinking != e)
+        return;
+
+    g.Thinking = -1;
+    g.Grace->stop();
+
+    bool white = Piece::White == g.Board.GetWhoseTurn();
+    QString color = white ? "White" : "Black";
+    if(0 < d->settings.Time){
+        g.Clock->Pause();
+        g.Clock->AdjustClock(white ? AbstractClock::One : AbstractClock::Two, d->settings.Increment);
+    }
+
+    if(!__play_move(g, move)){
+        _end_game(slot, white ? BlackWins : WhiteWins, color + " makes an illegal move");
+        return;
+    }
+
+    // Adjudicate the game
+    Board const &b = g.Board;
+    int tb_winner;
+    if(b.IsInCheckMate(b.GetWhoseTurn()))
+        _end_game(slot, white ? WhiteWins : BlackWins, color + " mates");
+    else if(b.IsStalemate())
+        _end_game(slot, Draw, "Stalemate");
+    else if(b.IsInsufficientMaterial())
+        _end_game(slot, Draw, "Insufficient material");
+    else if(100 <= b.GetHalfMoveClock())
+        _end_game(slot, Draw, "Fifty move rule");
+    else if(3 <= g.Positions.value(__position_key(b)))
+        _end_game(slot, Draw, "Threefold repetition");
+    else if(__probe_tablebases(d->tablebases, b, tb_winner))
+        _end_game(slot, tb_winner, Draw == tb_winner ? QString("Tablebase draw") :
+                                   QString(WhiteWins == tb_winner ? "White" : "Black") + " wins by the tablebases");
+    else if(0 < d->settings.MaxPlies && d->settings.MaxPlies <= g.Plies)
+        _end_game(slot, Draw, "Adjudication");
+    else
+    {
+        _request_move(slot);
+
+        // Now that the opponent's thinking, this engine can ponder on its reply
+        if(d->settings.Ponder)
+            g.Sessions[e]->Ponder(__think_params(d->settings, g));
+    }
+}
+
+void MatchRunner::_engine_idle()
+{
+    G_D;
+    int e;
+    int slot = __find_game(d->games, sender(), &e);
+    if(-1 == slot)
+        return;
+
+    // An engine we stopped after the game ended is out of the way
+    game_t &g = *d->games[slot];
+    if(g.Stopping[e]){
+        g.Stopping[e] = false;
+        if(!g.Running && !g.Stopping[1 - e])
+            _start_next_game(slot);
+    }
+}
+
+void MatchRunner::_time_is_up()
+{
+    G_D;
+    int slot = __find_game(d->games, sender());
+    if(-1 == slot || !d->games[slot]->Running)
+        return;
+
+    // We give the engine a little more time before it loses
+    d->games[slot]->Grace->start(d->settings.TimeMargin);
+}
+
+void MatchRunner::_grace_expired()
+{
+    G_D;
+    int slot = __find_game(d->games, sender());
+    if(-1 == slot)
+        return;
+
+    game_t &g = *d->games[slot];
+    if(!g.Running || -1 == g.Thinking)
+        return;
+
+    bool white = g.Thinking == g.White;
+    _end_game(slot, white ? BlackWins : WhiteWins, QString(white ? "White" : "Black") + " loses on time");
+}
+
+void MatchRunner::_engine_crashed()
+{
+    G_D;
+    int e;
+    int slot = __find_game(d->games, sender(), &e);
+    if(-1 == slot)
+        return;
+
+    // The engine restarts itself, so it won't answer any stop we sent it
+    game_t &g = *d->games[slot];
+    if(g.Thinking == e)
+        g.Thinking = -1;
+    if(g.Stopping[e])
+    {
+        g.Stopping[e] = false;
+        if(!g.Running && !g.Stopping[1 - e])
+            _start_next_game(slot);
+    }
+    else if(g.Running)
+    {
+        bool white = e == g.White;
+        _end_game(slot, white ? BlackWins : WhiteWins, QString(white ? "White" : "Black") + "'s engine crashed");
+    }
+}
+
+void MatchRunner::_end_game(int slot, int winner, const QString &reason)
+{
+    G_D;
+    game_t &g = *d->games[slot];
+    g.Running = false;
+    g.Clock->Pause();
+    g.Grace->stop();
+
+    // If an engine is still thinking or pondering, we have to wait until it stops
+    //  before the next game
+    g.Thinking = -1;
+    for(int e = 0; e < 2; ++e){
+        if(g.Sessions[e]->IsBusy()){
+            g.Sessions[e]->Stop();
+            g.Stopping[e] = true;
+        }
+    }
+
+    GameResult r;
+    r.Number = g.Number;
+    r.White = d->settings.Engines[g.White];
+    r.Black = d->settings.Engines[1 - g.White];
+    r.Reason = reason;
+    r.Plies = g.Plies;
+    switch(winner)
+    {
+    case WhiteWins:
+        r.Result = "1-0";
+        0 == g.White ? d->stats.AddWin() : d->stats.AddLoss();
+        break;
+    case BlackWins:
+        r.Result = "0-1";
+        1 == g.White ? d->stats.AddWin() : d->stats.AddLoss();
+        break;
+    default:
+        r.Result = "1/2-1/2";
+        d->stats.AddDraw();
+        break;
+    }
+
+    _write_pgn(slot, r);
+    emit GameFinished(r);
+
+    if(d->settings.SPRT){
+        double llr = GetLLR();
+        if(llr <= GetLowerBound() || GetUpperBound() <= llr)
+            d->stopping = true;
+    }
+
+    if(!g.Stopping[0] && !g.Stopping[1])
+        _start_next_game(slot);
+}
+
+void MatchRunner::_write_pgn(int slot, const GameResult &r)
+{
+    G_D;
+    if(!d->pgn.isOpen())
+        return;
+
+    game_t &g = *d->games[slot];
+    QString tags;
+    tags.append(QString("[Event \"%1\"]\n").arg(d->settings.Event));
+    tags.append("[Site \"?\"]\n");
+    tags.append(QString("[Date \"%1\"]\n").arg(QDate::currentDate().toString("yyyy.MM.dd")));
+    tags.append(QString("[Round \"%1\"]\n").arg(r.Number));
+    tags.append(QString("[White \"%1\"]\n").arg(r.White));
+    tags.append(QString("[Black \"%1\"]\n").arg(r.Black));
+    tags.append(QString("[Result \"%1\"]\n").arg(r.Result));
+    if(g.StartFEN != STARTPOS_FEN){
+        tags.append("[SetUp \"1\"]\n");
+        tags.append(QString("[FEN \"%1\"]\n").arg(QString::fromLatin1(g.StartFEN)));
+    }
+    if(0 < d->settings.Time){
+        tags.append(QString("[TimeControl \"%1+%2\"]\n")
+                    .arg(d->settings.Time / 1000.0)
+                    .arg(d->settings.Increment / 1000.0));
+    }
+    tags.append(QString("[PlyCount \"%1\"]\n\n").arg(r.Plies));
+
+    QByteArray out = tags.toUtf8();
+
+    // Wrap the move text
+    QList<QByteArray> tokens = g.MoveText.split(' ');
+    tokens.append("{" + r.Reason.toUtf8() + "}");
+    tokens.append(r.Result.toUtf8());
+    int line_length = 0;
+    for(QByteArray const &t : tokens)
+    {
+        if(t.isEmpty())
+            continue;
+        if(0 < line_length && PGN_LINE_WIDTH < line_length + 1 + t.length()){
+            out.append('\n');
+            line_length = 0;
+        }
+        else if(0 < line_length){
+            out.append(' ');
+            ++line_length;
+        }
+        out.append(t);
+        line_length += t.length();
+    }
+    out.append("\n\n");
+
+    d->pgn.write(out);
+    d->pgn.flush();
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,199 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_MATCHRUNNER_H
+#define GKCHESS_MATCHRUNNER_H
+
+#include "gkchess_matchstatistics.h"
+#include "gkchess_movedata.h"
+#include <QObject>
+#include <QStringList>
+
+namespace GKChess{
+
+
+class EngineSettings;
+
+
+/** Plays a match between two configured engines, with several games at a time.
+ *
+ *  Openings come from a Polyglot book or an EPD/FEN file, and every opening is played
+ *  twice with the colors reversed unless you say otherwise.  Games are adjudicated by the
+ *  board (checkmate, stalemate, insufficient material, fifty moves and threefold
+ *  repetition), and an engine loses if it runs out of time, makes an illegal move or
+ *  crashes.  The games are written to a PGN file as they finish.
+ *
+ *  Each concurrent game has its own pair of engines, which are reused from game to game.
+*/
+class MatchRunner :
+        public QObject
+{
+    Q_OBJECT
+    void *d;
+public:
+
+    struct Settings
+    {
+        /** The names of the two engines in the engine settings.  All results are from
+         *  the first engine's point of view.
+        */
+        QString Engines[2];
+
+        /** The number of games to play. */
+        int Games;
+
+        /** The number of games to play at once, or 0 for one per two cores. */
+        int Concurrency;
+
+        /** The time control, in milliseconds.  If the time is 0 then there is no clock,
+         *  and the search is limited by MoveTime, Depth and Nodes.
+        */
+        int Time;
+        int Increment;
+
+        int MoveTime;
+        int Depth;
+        int Nodes;
+
+        /** How long past its time an engine may take before it loses on time. */
+        int TimeMargin;
+
+        /** If true the engines think on their opponent's time. */
+        bool Ponder;
+
+        /** A Polyglot book to take openings from, and how many plies to take. */
+        QString BookFile;
+        int BookDepth;
+
+        /** A file with one EPD or FEN opening position per line.  This is used
+         *  instead of the book if it's given.
+        */
+        QString OpeningsFile;
+
+        /** If true, every opening is played twice with the colors reversed. */
+        bool RepeatOpenings;
+
+        /** Games that go on this many plies are adjudicated as a draw.  0 means no limit. */
+        int MaxPlies;
+
+        /** Directories of Syzygy tablebases, separated like in the PATH variable.  If
+         *  SyzygyAdjudication is true, a game ends as soon as the tablebases know how
+         *  it ends.  It's off by default until the prober has been checked against
+         *  real files with the tablebases test.
+        */
+        QString SyzygyPath;
+        bool SyzygyAdjudication;
+
+        /** If true the match stops as soon as the SPRT accepts one of the hypotheses. */
+        bool SPRT;
+        double Elo0, Elo1;
+        double Alpha, Beta;
+
+        /** Where to write the games.  If empty the games are not written. */
+        QString PGNFile;
+
+        /** The event tag for the PGN. */
+        QString Event;
+
+        Settings()
+            :Games(2), Concurrency(0),
+              Time(10000), Increment(100), MoveTime(0), Depth(0), Nodes(0), TimeMargin(100),
+              Ponder(false),
+              BookDepth(8), RepeatOpenings(true), MaxPlies(0), SyzygyAdjudication(false),
+              SPRT(false), Elo0(0), Elo1(5), Alpha(0.05), Beta(0.05),
+              Event("GKChess Match")
+        {}
+    };
+
+    /** The outcome of a game. */
+    struct GameResult
+    {
+        /** The number of the game, starting with 1. */
+        int Number;
+
+        QString White;
+        QString Black;
+
+        /** The result in PGN notation (1-0, 0-1 or 1/2-1/2). */
+        QString Result;
+
+        /** Why the game ended, i.e. "White mates" or "Black loses on time". */
+        QString Reason;
+
+        /** The number of plies played, including the opening. */
+        int Plies;
+
+        GameResult() :Number(0), Plies(0) {}
+    };
+
+    /** Starts the engines, or throws an exception if something goes wrong. */
+    MatchRunner(const Settings &, EngineSettings *, QObject *parent = 0);
+    ~MatchRunner();
+
+    /** Starts playing games.  This returns right away, and NotifyFinished() is emitted
+     *  when the match is over.  Throws an exception if the openings can't be loaded.
+    */
+    void Start();
+
+    /** Tells the match to stop.  No new games are started, but the ones that are
+     *  running are played to the end.
+    */
+    void Stop();
+
+    /** Returns true if there are games being played. */
+    bool IsRunning() const;
+
+    /** Returns the results so far. */
+    MatchStatistics const &GetStatistics() const;
+
+    /** Returns the SPRT bounds, based on the alpha and beta in the settings. */
+    double GetLowerBound() const;
+    double GetUpperBound() const;
+
+    /** Returns the SPRT log-likelihood ratio so far. */
+    double GetLLR() const;
+
+
+signals:
+
+    /** Emitted whenever a game is finished. */
+    void GameFinished(const GKChess::MatchRunner::GameResult &);
+
+    /** Emitted when the last game is finished. */
+    void NotifyFinished();
+
+
+private slots:
+
+    void _best_move_received(const GenericMove &, const GenericMove &);
+    void _engine_idle();
+    void _engine_crashed();
+    void _time_is_up();
+    void _grace_expired();
+
+
+private:
+
+    void _start_game(int slot);
+    void _request_move(int slot);
+    void _end_game(int slot, int winner, const QString &reason);
+    void _start_next_game(int slot);
+    void _write_pgn(int slot, const GameResult &);
+
+};
+
+
+}
+
+#endif // GKCHESS_MATCHRUNNER_H
@@ -0,0 +1,431 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "analysiscache.h"
+#include <gkchess_common.h>
+#include <gutil/exception.h>
+#include <QDataStream>
+#include <QStringList>
+#include <cstring>
+USING_NAMESPACE_GUTIL;
+
+/** Identifies an analysis cache file, followed by the format version. */
+#define FILE_MAGIC "GKAC"
+#define FILE_VERSION 1
+#define FILE_HEADER_SIZE 8
+
+/** We don't bother compacting files with fewer dead records than this. */
+#define COMPACT_THRESHOLD 1024
+
+/** Engines usually report a little less time than they were given, so a time limited
+ *  search counts as finished if it got this close (in percent).
+*/
+#define TIME_TOLERANCE 90
+
+NAMESPACE_GKCHESS;
+
+
+// Combines the two keys into the one we index by.  Collisions are possible, so we
+//  keep both keys with the entry and check them.
+static GUINT64 __combine_keys(GUINT64 position_key, GUINT64 engine_key)
+{
+    return position_key ^ (engine_key * 0x9E3779B97F4A7C15ULL);
+}
+
+// 64 bit FNV-1a
+static GUINT64 __hash_bytes(GUINT64 h, const QByteArray &ba)
+{
+    for(char c : ba){
+        h ^= (GUINT8)c;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static void __write_entry(QDataStream &s, GUINT64 position_key, GUINT64 engine_key, const AnalysisCache::Entry &e)
+{
+    IEngine::SearchInfo const &i = e.Info;
+    s << (quint64)position_key << (quint64)engine_key
+      << (quint16)e.BestMove.Pack() << (quint16)e.Ponder.Pack()
+      << (qint32)i.Fields << (qint32)i.Depth << (qint32)i.SelDepth << (qint32)i.MultiPV
+      << (quint8)i.ScoreIsMate << (qint32)i.Score << (qint32)i.ScoreBound
+      << (quint64)i.Nodes << (quint64)i.NPS << (qint32)i.HashFull
+      << (quint64)i.TBHits << (quint64)i.Time
+      << (qint32)i.PVLength;
+    for(int j = 0; j < i.PVLength; ++j)
+        s << (quint16)i.PV[j];
+}
+
+static bool __read_entry(QDataStream &s, GUINT64 &position_key, GUINT64 &engine_key, AnalysisCache::Entry &e)
+{
+    quint64 pk, ek, nodes, nps, tbhits, time;
+    quint16 best, ponder;
+    quint8 mate;
+    qint32 fields, depth, seldepth, multipv, score, bound, hashfull, pvlength;
+    s >> pk >> ek >> best >> ponder
+      >> fields >> depth >> seldepth >> multipv
+      >> mate >> score >> bound
+      >> nodes >> nps >> hashfull
+      >> tbhits >> time
+      >> pvlength;
+    if(QDataStream::Ok != s.status() || pvlength < 0 || IEngine::SearchInfo::MaxPVLength < pvlength)
+        return false;
+
+    IEngine::SearchInfo &i = e.Info;
+    for(int j = 0; j < pvlength; ++j){
+        quint16 m;
+        s >> m;
+        i.PV[j] = m;
+    }
+    if(QDataStream::Ok != s.status())
+        return false;
+
+    position_key = pk;
+    engine_key = ek;
+    e.BestMove = GenericMove::Unpack(best);
+    e.Ponder = GenericMove::Unpack(ponder);
+    i.Fields = fields;
+    i.Depth = depth;
+    i.SelDepth = seldepth;
+    i.MultiPV = multipv;
+    i.ScoreIsMate = mate;
+    i.Score = score;
+    i.ScoreBound = (IEngine::SearchInfo::BoundEnum)bound;
+    i.Nodes = nodes;
+    i.NPS = nps;
+    i.HashFull = hashfull;
+    i.TBHits = tbhits;
+    i.Time = time;
+    i.PVLength = pvlength;
+    return true;
+}
+
+
+bool AnalysisCache::Entry::Satisfies(const IEngine::ThinkParams &p) const
+{
+    // We only keep the main line, so we can't serve a search for more lines
+    if(BestMove.IsNull() || 1 < p.MultiPV)
+        return false;
+
+    if(0 < p.Depth && p.Depth <= Info.Depth)
+        return true;
+    if(0 < p.Nodes && (GUINT64)p.Nodes <= Info.Nodes)
+        return true;
+    if(0 < p.SearchTime && (GUINT64)p.SearchTime * TIME_TOLERANCE / 100 <= Info.Time)
+        return true;
+    if(0 < p.Mate && Info.ScoreIsMate && 0 < Info.Score && Info.Score <= p.Mate)
+        return true;
+    return false;
+}
+
+
+AnalysisCache::AnalysisCache(int capacity)
+    :m_cache(qMax(1, capacity)),
+      m_deadRecords(0),
+      m_hits(0),
+      m_misses(0)
+{}
+
+AnalysisCache::~AnalysisCache()
+{
+    Close();
+}
+
+GUINT64 AnalysisCache::ComputeEngineKey(const QString &engine_path, const QVariantMap &options)
+{
+    GUINT64 ret = __hash_bytes(0xCBF29CE484222325ULL, engine_path.toUtf8());
+
+    // The map is sorted by key, so the hash doesn't depend on the order options were set
+    for(auto iter = options.begin(); iter != options.end(); ++iter){
+        ret = __hash_bytes(ret, QByteArray(1, '\0'));
+        ret = __hash_bytes(ret, iter.key().toUtf8());
+        ret = __hash_bytes(ret, QByteArray(1, '='));
+        ret = __hash_bytes(ret, iter.value().toString().toUtf8());
+    }
+    return ret;
+}
+
+void AnalysisCache::Open(const QString &filename)
+{
+    QMutexLocker lkr(&m_lock);
+    if(m_file.isOpen())
+        m_file.close();
+    m_index.clear();
+    m_deadRecords = 0;
+
+    m_file.setFileName(filename);
+    if(!m_file.open(QFile::ReadWrite))
+        throw Exception<>(QString("Unable to open %1: %2").arg(filename).arg(m_file.errorString()).toUtf8().constData());
+
+    if(0 == m_file.size())
+    {
+        QDataStream s(&m_file);
+        s.writeRawData(FILE_MAGIC, 4);
+        s << (quint32)FILE_VERSION;
+        m_file.flush();
+    }
+    else
+    {
+        char magic[4];
+        quint32 version = 0;
+        QDataStream s(&m_file);
+        if(4 == s.readRawData(magic, 4))
+            s >> version;
+        if(0 != memcmp(magic, FILE_MAGIC, 4) || FILE_VERSION != version)
+        {
+            m_file.close();
+            throw Exception<>(QString("%1 is not an analysis cache").arg(filename).toUtf8().constData());
+        }
+        _load_index();
+    }
+
+    if(COMPACT_THRESHOLD < m_deadRecords && m_index.size() < m_deadRecords){
+        lkr.unlock();
+        Compact();
+    }
+}
+
+bool AnalysisCache::IsOpen() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_file.isOpen();
+}
+
+void AnalysisCache::Close()
+{
+    QMutexLocker lkr(&m_lock);
+    m_file.close();
+    m_index.clear();
+    m_deadRecords = 0;
+}
+
+void AnalysisCache::Compact()
+{
+    QMutexLocker lkr(&m_lock);
+    if(!m_file.isOpen())
+        return;
+
+    QString filename = m_file.fileName();
+    QFile tmp(filename + ".tmp");
+    if(!tmp.open(QFile::WriteOnly | QFile::Truncate))
+        throw Exception<>(QString("Unable to compact %1: %2").arg(filename).arg(tmp.errorString()).toUtf8().constData());
+
+    QDataStream ts(&tmp);
+    ts.writeRawData(FILE_MAGIC, 4);
+    ts << (quint32)FILE_VERSION;
+
+    // Copy the live records as they are
+    QHash<GUINT64, FileEntry> new_index;
+    for(auto iter = m_index.begin(); iter != m_index.end(); ++iter){
+        quint32 len;
+        m_file.seek(iter->Offset);
+        QDataStream s(&m_file);
+        s >> len;
+        QByteArray record = m_file.read(len);
+        if(QDataStream::Ok != s.status() || record.length() != (int)len)
+            continue;
+
+        FileEntry fe = { tmp.pos(), iter->Depth };
+        ts << len;
+        ts.writeRawData(record.constData(), record.length());
+        new_index.insert(iter.key(), fe);
+    }
+    tmp.close();
+    m_file.close();
+
+    if(!QFile::remove(filename) || !tmp.rename(filename))
+        throw Exception<>(QString("Unable to replace %1 with the compacted file").arg(filename).toUtf8().constData());
+
+    m_file.setFileName(filename);
+    if(!m_file.open(QFile::ReadWrite))
+        throw Exception<>(QString("Unable to open %1: %2").arg(filename).arg(m_file.errorString()).toUtf8().constData());
+    m_index = new_index;
+    m_deadRecords = 0;
+}
+
+void AnalysisCache::_load_index()
+{
+    QDataStream s(&m_file);
+    qint64 offset = FILE_HEADER_SIZE;
+    m_file.seek(offset);
+    while(!m_file.atEnd())
+    {
+        quint32 len;
+        s >> len;
+        QByteArray record = m_file.read(len);
+
+        CachedEntry e;
+        QDataStream rs(record);
+        if(QDataStream::Ok != s.status() || record.length() != (int)len ||
+                !__read_entry(rs, e.PositionKey, e.EngineKey, e.Data))
+        {
+            // The last record was only partly written, so drop it
+            m_file.resize(offset);
+            break;
+        }
+
+        GUINT64 key = __combine_keys(e.PositionKey, e.EngineKey);
+        FileEntry fe = { offset, e.Data.Info.Depth };
+        auto iter = m_index.find(key);
+        if(iter == m_index.end())
+            m_index.insert(key, fe);
+        else{
+            ++m_deadRecords;
+            if(iter->Depth <= fe.Depth)
+                *iter = fe;
+        }
+        offset = m_file.pos();
+    }
+}
+
+bool AnalysisCache::_read_record(qint64 offset, CachedEntry &e)
+{
+    quint32 len;
+    m_file.seek(offset);
+    QDataStream s(&m_file);
+    s >> len;
+    QByteArray record = m_file.read(len);
+    QDataStream rs(record);
+    return QDataStream::Ok == s.status() && record.length() == (int)len &&
+            __read_entry(rs, e.PositionKey, e.EngineKey, e.Data);
+}
+
+void AnalysisCache::_append_record(const CachedEntry &e)
+{
+    QByteArray record;
+    {
+        QDataStream rs(&record, QIODevice::WriteOnly);
+        __write_entry(rs, e.PositionKey, e.EngineKey, e.Data);
+    }
+
+    qint64 offset = m_file.size();
+    m_file.seek(offset);
+    QDataStream s(&m_file);
+    s << (quint32)record.length();
+    s.writeRawData(record.constData(), record.length());
+
+    // Flush every record, so we lose as little as possible if we crash
+    m_file.flush();
+
+    GUINT64 key = __combine_keys(e.PositionKey, e.EngineKey);
+    if(m_index.contains(key))
+        ++m_deadRecords;
+    FileEntry fe = { offset, e.Data.Info.Depth };
+    m_index.insert(key, fe);
+}
+
+int AnalysisCache::GetCapacity() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_cache.maxCost();
+}
+
+void AnalysisCache::SetCapacity(int c)
+{
+    QMutexLocker lkr(&m_lock);
+    m_cache.setMaxCost(qMax(1, c));
+}
+
+GUINT64 AnalysisCache::GetHitCount() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_hits;
+}
+
+GUINT64 AnalysisCache::GetMissCount() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_misses;
+}
+
+void AnalysisCache::Clear()
+{
+    QMutexLocker lkr(&m_lock);
+    m_cache.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+AnalysisCache::CachedEntry *AnalysisCache::_get_entry(GUINT64 position_key, GUINT64 engine_key)
+{
+    GUINT64 key = __combine_keys(position_key, engine_key);
+    CachedEntry *ret = m_cache.object(key);
+    if(NULL == ret && m_file.isOpen())
+    {
+        auto iter = m_index.find(key);
+        if(iter != m_index.end()){
+            ret = new CachedEntry;
+            if(_read_record(iter->Offset, *ret)){
+                // The capacity is at least 1, so the insert never fails
+                m_cache.insert(key, ret);
+            }
+            else{
+                delete ret;
+                ret = NULL;
+            }
+        }
+    }
+
+    if(ret && (ret->PositionKey != position_key || ret->EngineKey != engine_key))
+        ret = NULL;
+    return ret;
+}
+
+bool AnalysisCache::Lookup(GUINT64 position_key, GUINT64 engine_key, Entry &e)
+{
+    QMutexLocker lkr(&m_lock);
+    CachedEntry *ce = _get_entry(position_key, engine_key);
+    if(NULL == ce){
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    e = ce->Data;
+    return true;
+}
+
+bool AnalysisCache::Lookup(GUINT64 position_key, GUINT64 engine_key, const IEngine::ThinkParams &p, Entry &e)
+{
+    QMutexLocker lkr(&m_lock);
+    CachedEntry *ce = _get_entry(position_key, engine_key);
+    if(NULL == ce || !ce->Data.Satisfies(p)){
+        ++m_misses;
+        return false;
+    }
+    ++m_hits;
+    e = ce->Data;
+    return true;
+}
+
+void AnalysisCache::Store(GUINT64 position_key, GUINT64 engine_key, const Entry &e)
+{
+    if(e.BestMove.IsNull())
+        return;
+
+    QMutexLocker lkr(&m_lock);
+    CachedEntry *existing = _get_entry(position_key, engine_key);
+    if(existing && e.Info.Depth < existing->Data.Info.Depth)
+        return;
+
+    CachedEntry *ce = new CachedEntry;
+    ce->PositionKey = position_key;
+    ce->EngineKey = engine_key;
+    ce->Data = e;
+    if(m_file.isOpen())
+        _append_record(*ce);
+    m_cache.insert(__combine_keys(position_key, engine_key), ce);
+}
+
+
+END_NAMESPACE_GKCHESS;
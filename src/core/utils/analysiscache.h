@@ -0,0 +1,150 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_ANALYSISCACHE_H
+#define GKCHESS_ANALYSISCACHE_H
+
+#include "gkchess_iengine.h"
+#include <QCache>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+#include <QVariantMap>
+
+namespace GKChess
+{
+
+
+/** Remembers the results of engine searches, so a position doesn't have to be searched
+ *  again when you come back to it.
+ *
+ *  Results are keyed by the Zobrist hash of the position and a hash of the engine and
+ *  its options, and only the deepest result for each key is kept.  The most recently used
+ *  results are held in a bounded LRU cache in memory.  If a file is opened then every
+ *  result is also appended to it, so the cache survives between sessions; the file is a
+ *  log that only keeps an index of the latest record for each key in memory, and it is
+ *  compacted when it's opened if most of its records have been superseded.
+*/
+class AnalysisCache
+{
+public:
+
+    /** The result of a search. */
+    struct Entry
+    {
+        /** The last info the engine gave for the first line. */
+        IEngine::SearchInfo Info;
+
+        GenericMove BestMove;
+        GenericMove Ponder;
+
+        /** Returns true if this result is as good as what a search with the given limits
+         *  would give, which is the case if it reached any one of the limits.  Infinite
+         *  and MultiPV searches are never satisfied.
+        */
+        bool Satisfies(const IEngine::ThinkParams &) const;
+    };
+
+    /** \param capacity The maximum number of results to keep in memory */
+    explicit AnalysisCache(int capacity = 4096);
+    ~AnalysisCache();
+
+    /** Returns a hash that identifies the engine and its options.  Results from one
+     *  engine are never served for another.
+    */
+    static GUINT64 ComputeEngineKey(const QString &engine_path, const QVariantMap &options);
+
+    /** Opens (or creates) the file to keep the results in.  Throws an exception if it
+     *  can't be opened.
+    */
+    void Open(const QString &filename);
+
+    /** Returns true if a file is open. */
+    bool IsOpen() const;
+
+    /** Closes the file.  The results in memory are kept. */
+    void Close();
+
+    /** Rewrites the file so it only has the latest result for each key. */
+    void Compact();
+
+    /** Returns the maximum number of results that are kept in memory. */
+    int GetCapacity() const;
+
+    /** Sets the maximum number of results to keep in memory (at least 1). */
+    void SetCapacity(int);
+
+    /** Returns the number of lookups that found a result. */
+    GUINT64 GetHitCount() const;
+
+    /** Returns the number of lookups that didn't. */
+    GUINT64 GetMissCount() const;
+
+    /** Forgets the results in memory and resets the hit and miss counters.  The file
+     *  is not touched.
+    */
+    void Clear();
+
+    /** Looks up the result for the position.
+     *  \returns False if there is no result
+    */
+    bool Lookup(GUINT64 position_key, GUINT64 engine_key, Entry &);
+
+    /** Looks up the result for the position, but only if it satisfies the search limits.
+     *  \returns False if there is no result, or it's not good enough
+    */
+    bool Lookup(GUINT64 position_key, GUINT64 engine_key, const IEngine::ThinkParams &, Entry &);
+
+    /** Remembers the result for the position, unless a deeper one is already known. */
+    void Store(GUINT64 position_key, GUINT64 engine_key, const Entry &);
+
+
+private:
+
+    struct CachedEntry
+    {
+        GUINT64 PositionKey;
+        GUINT64 EngineKey;
+        Entry Data;
+    };
+
+    /** Where the latest record for a key is in the file. */
+    struct FileEntry
+    {
+        qint64 Offset;
+        int Depth;
+    };
+
+    QCache<GUINT64, CachedEntry> m_cache;
+    QHash<GUINT64, FileEntry> m_index;
+    QFile m_file;
+    int m_deadRecords;
+    GUINT64 m_hits;
+    GUINT64 m_misses;
+    mutable QMutex m_lock;
+
+    // Returns the cached entry, reading it from the file if necessary.  The lock must be
+    //  held, and the result is only valid until the lock is released.
+    CachedEntry *_get_entry(GUINT64 position_key, GUINT64 engine_key);
+
+    void _load_index();
+    bool _read_record(qint64 offset, CachedEntry &);
+    void _append_record(const CachedEntry &);
+
+};
+
+
+}
+
+#endif // GKCHESS_ANALYSISCACHE_H
@@ -0,0 +1,99 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "bookmoveselector.h"
+#include <gutil/rng.h>
+USING_NAMESPACE_GUTIL;
+
+NAMESPACE_GKCHESS;
+
+
+BookMoveSelector::BookMoveSelector(const QList<BookMove> &moves)
+    :m_threshold(moves.size()),
+      m_alias(moves.size()),
+      m_totalWeight(0)
+{
+    const int n = moves.size();
+    if(0 == n)
+        return;
+
+    for(BookMove const &m : moves)
+        m_totalWeight += m.RawWeight;
+
+    const bool uniform = 0 == m_totalWeight;
+    if(uniform)
+        m_totalWeight = n;
+
+    // Every column of the table holds m_totalWeight units, which is the average weight
+    //  scaled by n, so we scale every weight by n to stay in integers
+    QVector<GUINT64> scaled(n);
+    QVector<int> small, large;
+    for(int i = 0; i < n; ++i){
+        scaled[i] = (uniform ? 1 : moves[i].RawWeight) * (GUINT64)n;
+        if(scaled[i] < m_totalWeight)
+            small.append(i);
+        else
+            large.append(i);
+    }
+
+    // Fill each small column with the rest of a large one
+    while(!small.isEmpty() && !large.isEmpty())
+    {
+        int s = small.takeLast();
+        int l = large.takeLast();
+        m_threshold[s] = scaled[s];
+        m_alias[s] = l;
+
+        scaled[l] = scaled[l] + scaled[s] - m_totalWeight;
+        if(scaled[l] < m_totalWeight)
+            small.append(l);
+        else
+            large.append(l);
+    }
+
+    // Whatever is left is exactly full, because the arithmetic is exact
+    for(int i : large){
+        m_threshold[i] = m_totalWeight;
+        m_alias[i] = i;
+    }
+    for(int i : small){
+        m_threshold[i] = m_totalWeight;
+        m_alias[i] = i;
+    }
+}
+
+int BookMoveSelector::SelectIndex(GUINT64 random) const
+{
+    const int n = m_alias.size();
+    if(0 == n)
+        return -1;
+
+    int col = random % n;
+    GUINT64 r = (random / n) % m_totalWeight;
+    return r < m_threshold[col] ? col : m_alias[col];
+}
+
+int BookMoveSelector::SelectIndex() const
+{
+    return SelectIndex(GenerateRandomNumber());
+}
+
+GUINT64 BookMoveSelector::GenerateRandomNumber()
+{
+    return ((GUINT64)GlobalRNG()->U_Discrete(0, 0x7FFFFFFF) << 31) |
+            (GUINT64)GlobalRNG()->U_Discrete(0, 0x7FFFFFFF);
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,70 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_BOOKMOVESELECTOR_H
+#define GKCHESS_BOOKMOVESELECTOR_H
+
+#include "gkchess_movedata.h"
+#include <QList>
+#include <QVector>
+
+namespace GKChess
+{
+
+
+/** Picks random moves from a list of book moves, in proportion to their weights.
+ *
+ *  This uses Vose's alias method on the raw integer weights: building the table is linear
+ *  in the number of moves, and after that every pick costs one random number and one
+ *  table lookup, with no rounding error.
+*/
+class BookMoveSelector
+{
+    QVector<GUINT64> m_threshold;
+    QVector<int> m_alias;
+    GUINT64 m_totalWeight;
+public:
+
+    /** Constructs an empty selector. */
+    BookMoveSelector() :m_totalWeight(0) {}
+
+    /** Builds the table from the moves' raw weights.  If all the weights are zero
+     *  then every move is equally likely.
+    */
+    explicit BookMoveSelector(const QList<BookMove> &);
+
+    /** Returns the number of moves to choose from. */
+    int Count() const{ return m_alias.size(); }
+
+    /** Returns the index of a move, chosen with the given uniformly distributed random number.
+     *  Returns -1 if there are no moves.
+    */
+    int SelectIndex(GUINT64 random) const;
+
+    /** Returns the index of a move, chosen with the global random number generator.
+     *  Returns -1 if there are no moves.
+    */
+    int SelectIndex() const;
+
+    /** Returns a 62-bit random number from the global random number generator, suitable
+     *  for SelectIndex().
+    */
+    static GUINT64 GenerateRandomNumber();
+
+};
+
+
+}
+
+#endif // GKCHESS_BOOKMOVESELECTOR_H
@@ -0,0 +1,176 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "bookreadercache.h"
+#include <gkchess_common.h>
+USING_NAMESPACE_GUTIL;
+
+NAMESPACE_GKCHESS;
+
+
+BookReaderCache::BookReaderCache(IBookReader &b, int capacity)
+    :m_book(b),
+      m_cache(qMax(1, capacity)),
+      m_hits(0),
+      m_misses(0)
+{}
+
+int BookReaderCache::GetCapacity() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_cache.maxCost();
+}
+
+void BookReaderCache::SetCapacity(int c)
+{
+    QMutexLocker lkr(&m_lock);
+    m_cache.setMaxCost(qMax(1, c));
+}
+
+GUINT64 BookReaderCache::GetHitCount() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_hits;
+}
+
+GUINT64 BookReaderCache::GetMissCount() const
+{
+    QMutexLocker lkr(&m_lock);
+    return m_misses;
+}
+
+void BookReaderCache::Clear()
+{
+    QMutexLocker lkr(&m_lock);
+    m_cache.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void BookReaderCache::OpenBook(const char *filename)
+{
+    Clear();
+    m_book.OpenBook(filename);
+}
+
+bool BookReaderCache::IsBookOpen() const
+{
+    return m_book.IsBookOpen();
+}
+
+const char *BookReaderCache::GetBookFilename() const
+{
+    return m_book.GetBookFilename();
+}
+
+IBookReader::ValidationSummary BookReaderCache::ValidateBook(IValidationProgressObserver *ob)
+{
+    return m_book.ValidateBook(ob);
+}
+
+void BookReaderCache::CloseBook()
+{
+    Clear();
+    m_book.CloseBook();
+}
+
+GUINT64 BookReaderCache::ComputeKey(const char *fen) const
+{
+    return m_book.ComputeKey(fen);
+}
+
+BookReaderCache::CachedPosition *BookReaderCache::_get_position(QMutexLocker &lkr, const char *fen)
+{
+    GUINT64 key = m_book.ComputeKey(fen);
+    CachedPosition *ret = m_cache.object(key);
+    if(ret){
+        ++m_hits;
+        return ret;
+    }
+    ++m_misses;
+
+    // Don't hold the lock while we go to the book, so other threads can still hit the cache
+    lkr.unlock();
+    QList<BookMove> moves = m_book.LookupMoves(fen);
+    lkr.relock();
+
+    // The capacity is at least 1, so the insert never fails
+    ret = new CachedPosition(moves);
+    m_cache.insert(key, ret);
+    return ret;
+}
+
+QList<BookMove> BookReaderCache::LookupMoves(const char *fen)
+{
+    QMutexLocker lkr(&m_lock);
+    return _get_position(lkr, fen)->Moves;
+}
+
+bool BookReaderCache::PickMove(const char *fen, BookMove &ret, GUINT64 random)
+{
+    QMutexLocker lkr(&m_lock);
+    CachedPosition *p = _get_position(lkr, fen);
+    if(p->Moves.isEmpty())
+        return false;
+
+    if(!p->SelectorBuilt){
+        p->Selector = BookMoveSelector(p->Moves);
+        p->SelectorBuilt = true;
+    }
+    ret = p->Moves[p->Selector.SelectIndex(random)];
+    return true;
+}
+
+bool BookReaderCache::PickMove(const char *fen, BookMove &ret)
+{
+    return PickMove(fen, ret, BookMoveSelector::GenerateRandomNumber());
+}
+
+QVector<QList<BookMove> > BookReaderCache::LookupMovesBatch(const QVector<GUINT64> &keys)
+{
+    QVector<QList<BookMove> > ret(keys.size());
+    QVector<GUINT64> missed_keys;
+    QVector<int> missed_indexes;
+    {
+        QMutexLocker lkr(&m_lock);
+        for(int i = 0; i < keys.size(); ++i){
+            CachedPosition const *cached = m_cache.object(keys[i]);
+            if(cached){
+                ++m_hits;
+                ret[i] = cached->Moves;
+            }
+            else{
+                ++m_misses;
+                missed_keys.append(keys[i]);
+                missed_indexes.append(i);
+            }
+        }
+    }
+
+    if(0 < missed_keys.size())
+    {
+        // Look up all the misses in one pass through the book
+        QVector<QList<BookMove> > found = m_book.LookupMovesBatch(missed_keys);
+
+        QMutexLocker lkr(&m_lock);
+        for(int i = 0; i < found.size(); ++i){
+            ret[missed_indexes[i]] = found[i];
+            m_cache.insert(missed_keys[i], new CachedPosition(found[i]));
+        }
+    }
+    return ret;
+}
+
+
+END_NAMESPACE_GKCHESS;
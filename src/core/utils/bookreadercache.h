@@ -0,0 +1,119 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_BOOKREADERCACHE_H
+#define GKCHESS_BOOKREADERCACHE_H
+
+#include "gkchess_ibookreader.h"
+#include "gkchess_bookmoveselector.h"
+#include <QCache>
+#include <QMutex>
+
+namespace GKChess
+{
+
+
+/** Puts a bounded LRU cache of looked-up positions in front of another book reader.
+ *
+ *  Positions are cached by the book's key for them, which for Polyglot books is the
+ *  Zobrist hash of the position, so transpositions share one cache entry.
+ *  The cache is cleared whenever a book is opened or closed.
+ *
+ *  It can also pick weighted random moves for a position, which is how you vary the
+ *  openings of automated games.  The selection table for a position is built the first
+ *  time you pick from it and cached with its moves, so later picks are O(1).
+ *
+ *  This is itself a book reader, so you can use it anywhere you would use the real one.
+*/
+class BookReaderCache :
+        public IBookReader
+{
+    struct CachedPosition
+    {
+        QList<BookMove> Moves;
+        BookMoveSelector Selector;
+        bool SelectorBuilt;
+        explicit CachedPosition(const QList<BookMove> &moves) :Moves(moves), SelectorBuilt(false) {}
+    };
+
+    IBookReader &m_book;
+    QCache<GUINT64, CachedPosition> m_cache;
+    GUINT64 m_hits;
+    GUINT64 m_misses;
+    mutable QMutex m_lock;
+public:
+
+    /** Wraps the given book reader, which must outlive this object.
+     *  \param capacity The maximum number of positions to remember
+    */
+    explicit BookReaderCache(IBookReader &, int capacity = 4096);
+
+    /** Returns the book reader behind the cache. */
+    IBookReader &GetBookReader() const{ return m_book; }
+
+    /** Returns the maximum number of positions that are remembered. */
+    int GetCapacity() const;
+
+    /** Sets the maximum number of positions to remember (at least 1).  If the cache has
+     *  more than that, the least recently used ones are dropped.
+    */
+    void SetCapacity(int);
+
+    /** Returns the number of lookups that were served from the cache. */
+    GUINT64 GetHitCount() const;
+
+    /** Returns the number of lookups that had to go to the book. */
+    GUINT64 GetMissCount() const;
+
+    /** Forgets all cached positions and resets the hit and miss counters. */
+    void Clear();
+
+    /** Picks a random move for the position, in proportion to the raw weights of its moves.
+     *  \param random A uniformly distributed random number
+     *  \returns False if the position is not in the book
+    */
+    bool PickMove(const char *fen, BookMove &, GUINT64 random);
+
+    /** Picks a random move for the position using the global random number generator.
+     *  \returns False if the position is not in the book
+    */
+    bool PickMove(const char *fen, BookMove &);
+
+
+    /** \name IBookReader interface
+     *  \{
+    */
+    void OpenBook(const char *);
+    bool IsBookOpen() const;
+    const char *GetBookFilename() const;
+    ValidationSummary ValidateBook(IValidationProgressObserver * = 0);
+    QList<BookMove> LookupMoves(const char *fen);
+    GUINT64 ComputeKey(const char *fen) const;
+    QVector<QList<BookMove> > LookupMovesBatch(const QVector<GUINT64> &keys);
+    void CloseBook();
+    /** \} */
+
+
+private:
+
+    // Returns the cached position, looking it up in the book if necessary.  The lock
+    //  must be held, and the result is only valid until the lock is released.
+    CachedPosition *_get_position(QMutexLocker &, const char *fen);
+
+};
+
+
+}
+
+#endif // GKCHESS_BOOKREADERCACHE_H
@@ -22,6 +22,10 @@ namespace GKChess
 {
 
 
+/** Give an engine this path to use the built-in native engine instead of an executable. */
+#define GKCHESS_NATIVE_ENGINE_PATH "native:"
+
+
 /** A class to encapsulate global storage of our engine settings. */
 class EngineSettings :
         public QObject
@@ -41,7 +45,7 @@ public:
     /** Removes the engine from the list. */
     void RemoveEngine(const QString &name);
 
-    /** Returns the path to the engine executable. */
+    /** Returns the path to the engine executable, or GKCHESS_NATIVE_ENGINE_PATH. */
     QString GetEnginePath(const QString &name);
 
     /** Sets the path to the engine executable. */
@@ -0,0 +1,93 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "matchstatistics.h"
+#include <gkchess_common.h>
+#include <cmath>
+
+/** The number of standard deviations for a 95% confidence interval. */
+#define Z_95 1.959963985
+
+NAMESPACE_GKCHESS;
+
+
+double MatchStatistics::GetScore() const
+{
+    int n = GetGameCount();
+    if(0 == n)
+        return 0.5;
+    return (m_wins + 0.5 * m_draws) / n;
+}
+
+double MatchStatistics::ScoreToElo(double score)
+{
+    if(score <= 0.0 || 1.0 <= score)
+        return 0.0 < score ? INFINITY : -INFINITY;
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double MatchStatistics::EloToScore(double elo)
+{
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+double MatchStatistics::GetElo() const
+{
+    return ScoreToElo(GetScore());
+}
+
+double MatchStatistics::GetEloError() const
+{
+    int n = GetGameCount();
+    if(0 == n)
+        return 0.0;
+
+    // The variance of the score of a single game
+    double score = GetScore();
+    double var = ((double)m_wins * (1.0 - score) * (1.0 - score) +
+                  (double)m_draws * (0.5 - score) * (0.5 - score) +
+                  (double)m_losses * score * score) / n;
+    double dev = Z_95 * std::sqrt(var / n);
+    return (ScoreToElo(score + dev) - ScoreToElo(score - dev)) / 2.0;
+}
+
+double MatchStatistics::GetLLR(double elo0, double elo1) const
+{
+    if(0 == m_wins || 0 == m_losses || 0 == m_draws)
+        return 0.0;
+
+    int n = GetGameCount();
+    double w = (double)m_wins / n;
+    double d = (double)m_draws / n;
+    double score = w + d / 2.0;
+    double var = w + d / 4.0 - score * score;
+    double var_s = var / n;
+
+    double s0 = EloToScore(elo0);
+    double s1 = EloToScore(elo1);
+    return (s1 - s0) * (2.0 * score - s0 - s1) / (2.0 * var_s);
+}
+
+double MatchStatistics::GetLowerBound(double alpha, double beta)
+{
+    return std::log(beta / (1.0 - alpha));
+}
+
+double MatchStatistics::GetUpperBound(double alpha, double beta)
+{
+    return std::log((1.0 - beta) / alpha);
+}
+
+
+END_NAMESPACE_GKCHESS;
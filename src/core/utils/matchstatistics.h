@@ -0,0 +1,82 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_MATCHSTATISTICS_H
+#define GKCHESS_MATCHSTATISTICS_H
+
+namespace GKChess
+{
+
+
+/** Keeps the results of a match between two players and estimates the Elo difference
+ *  between them.  All results are from the first player's point of view.
+ *
+ *  It also computes the log-likelihood ratio of a sequential probability ratio test
+ *  (SPRT), which lets you stop a match as soon as the results are conclusive.  We use the
+ *  trinomial model with logistic Elo, so draws are taken into account.
+*/
+class MatchStatistics
+{
+    int m_wins;
+    int m_losses;
+    int m_draws;
+public:
+
+    MatchStatistics() :m_wins(0), m_losses(0), m_draws(0) {}
+
+    void AddWin(){ ++m_wins; }
+    void AddLoss(){ ++m_losses; }
+    void AddDraw(){ ++m_draws; }
+
+    int GetWins() const{ return m_wins; }
+    int GetLosses() const{ return m_losses; }
+    int GetDraws() const{ return m_draws; }
+    int GetGameCount() const{ return m_wins + m_losses + m_draws; }
+
+    /** Returns the score as a fraction between 0 and 1, where a draw counts as half a win. */
+    double GetScore() const;
+
+    /** Returns the estimated Elo difference. */
+    double GetElo() const;
+
+    /** Returns the margin of the Elo difference at 95% confidence. */
+    double GetEloError() const;
+
+    /** Returns the log-likelihood ratio of the hypothesis that the Elo difference is elo1
+     *  over the hypothesis that it is elo0.  It is 0 until there is at least one win,
+     *  loss and draw.
+    */
+    double GetLLR(double elo0, double elo1) const;
+
+    /** Returns the bound below which the SPRT accepts elo0.
+     *  \param alpha The probability of accepting elo1 when elo0 is true
+     *  \param beta The probability of accepting elo0 when elo1 is true
+    */
+    static double GetLowerBound(double alpha, double beta);
+
+    /** Returns the bound above which the SPRT accepts elo1. */
+    static double GetUpperBound(double alpha, double beta);
+
+    /** Converts an expected score to an Elo difference. */
+    static double ScoreToElo(double score);
+
+    /** Converts an Elo difference to an expected score. */
+    static double EloToScore(double elo);
+
+};
+
+
+}
+
+#endif // GKCHESS_MATCHSTATISTICS_H
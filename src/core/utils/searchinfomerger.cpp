@@ -0,0 +1,81 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "searchinfomerger.h"
+#include <gkchess_common.h>
+
+NAMESPACE_GKCHESS;
+
+
+SearchInfoMerger::SearchInfoMerger(QObject *parent)
+    :QObject(parent),
+      m_rate(0)
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(Flush()));
+}
+
+void SearchInfoMerger::SetRate(int per_second)
+{
+    if(per_second < 0)
+        per_second = 0;
+    else if(1000 < per_second)
+        per_second = 1000;
+
+    // Deliver whatever was pending at the old rate
+    Flush();
+    m_rate = per_second;
+}
+
+void SearchInfoMerger::Add(const IEngine::SearchInfo &info)
+{
+    IEngine::SearchInfo &latest = m_latest[info.MultiPV];
+    latest.Merge(info);
+    if(0 == m_rate)
+        emit SearchInfoReady(info);
+    else
+    {
+        // Deliver the merged info for its line on the next tick
+        m_pending.insert(info.MultiPV, latest);
+        if(!m_timer.isActive())
+            m_timer.start(1000 / m_rate);
+    }
+}
+
+void SearchInfoMerger::ClearPending()
+{
+    m_timer.stop();
+    m_pending.clear();
+}
+
+void SearchInfoMerger::Clear()
+{
+    ClearPending();
+    m_latest.clear();
+}
+
+void SearchInfoMerger::Flush()
+{
+    m_timer.stop();
+    if(m_pending.isEmpty())
+        return;
+
+    QMap<int, IEngine::SearchInfo> pending;
+    pending.swap(m_pending);
+    for(IEngine::SearchInfo const &info : pending)
+        emit SearchInfoReady(info);
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,88 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_SEARCHINFOMERGER_H
+#define GKCHESS_SEARCHINFOMERGER_H
+
+#include "gkchess_iengine.h"
+#include <QTimer>
+#include <QMap>
+
+namespace GKChess
+{
+
+
+/** Keeps the latest search info for each MultiPV line of a search, and delivers it at
+ *  the rate that was set with IEngine::SetSearchInfoRate().
+ *
+ *  Engines give it every info they get and forward its SearchInfoReady signal as their
+ *  own SearchInfoReceived.  At a rate of 0 every info is delivered as it comes, otherwise
+ *  it's merged into the latest info for its line and the lines that changed are delivered
+ *  on the next tick of a timer.
+*/
+class SearchInfoMerger :
+        public QObject
+{
+    Q_OBJECT
+public:
+
+    explicit SearchInfoMerger(QObject * = 0);
+
+    /** Sets how many times per second info is delivered, between 0 and 1000.
+     *  Anything that was pending at the old rate is delivered first.
+    */
+    void SetRate(int per_second);
+
+    /** Returns how many times per second info is delivered, or 0 for every info. */
+    int GetRate() const{ return m_rate; }
+
+    /** Merges the info into the latest info for its line, and delivers it. */
+    void Add(const IEngine::SearchInfo &);
+
+    /** Returns the latest info for each line, in order of MultiPV. */
+    QList<IEngine::SearchInfo> GetLines() const{ return m_latest.values(); }
+
+    /** Drops the info that hasn't been delivered yet. */
+    void ClearPending();
+
+    /** Forgets everything, like before a new search. */
+    void Clear();
+
+
+public slots:
+
+    /** Delivers the pending info right away.  Call this before the best move, so
+     *  the final info always comes before it.
+    */
+    void Flush();
+
+
+signals:
+
+    void SearchInfoReady(const GKChess::IEngine::SearchInfo &);
+
+
+private:
+
+    int m_rate;
+    QTimer m_timer;
+    QMap<int, IEngine::SearchInfo> m_pending;
+    QMap<int, IEngine::SearchInfo> m_latest;
+
+};
+
+
+}
+
+#endif // GKCHESS_SEARCHINFOMERGER_H
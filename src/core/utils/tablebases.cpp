@@ -0,0 +1,1638 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "tablebases.h"
+#include "gkchess_board.h"
+#include <gkchess_common.h>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QStringList>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/** The most pieces a Syzygy table can have. */
+#define TB_PIECES 7
+
+/** The most moves a chess position can have is 218. */
+#define MAX_MOVES 256
+
+/** How the directories are separated, like in the PATH variable. */
+#if defined(Q_OS_WIN)
+#define PATH_SEPARATOR ';'
+#else
+#define PATH_SEPARATOR ':'
+#endif
+
+// The piece types, the same as in GKChess::Piece
+#define KING    0
+#define QUEEN   1
+#define ROOK    2
+#define BISHOP  3
+#define KNIGHT  4
+#define PAWN    5
+
+#define WHITE   0
+#define BLACK   1
+
+typedef GUINT64 bb_t;
+typedef GKChess::Tablebases::Position position_t;
+
+
+/** \file
+ *
+ *  The layout of a table file, as far as we need it:
+ *
+ *  The file starts with four magic bytes and a byte of flags: bit 0 is set if a
+ *  win/draw/loss file has a table for each side to move, and bit 1 if there are pawns.
+ *  The values are split into segments, one for each side to move, and if there are
+ *  pawns one for each file a-d of the leading pawn.
+ *
+ *  Next come the pieces, for each leading pawn file.  The first byte says in which
+ *  order the groups of pieces make up the index (the low nibble for white to move and
+ *  the high one for black), and if both sides have pawns a second byte does the same
+ *  for the other color's pawns.  Then there is a byte for each piece with its code in
+ *  each nibble, in the order the squares are indexed.  That's padded to an even offset.
+ *
+ *  Then there's a header for each segment that describes how it's compressed, and for
+ *  distance to zero files the maps from the stored values to distances.  After that
+ *  come the sparse indexes and the block lengths of every segment, and then the
+ *  compressed blocks of every segment, each starting on a 64 byte boundary.
+ *
+ *  The values are compressed with a canonical Huffman code, where each symbol stands
+ *  for a run of values: either one value, or the values of two other symbols one after
+ *  the other.
+*/
+
+
+namespace{
+
+/** The first four bytes of the files. */
+GUINT8 const wdl_magic[4] = { 0x71, 0xE8, 0x23, 0x5D };
+GUINT8 const dtz_magic[4] = { 0xD7, 0x66, 0x0C, 0xA5 };
+
+/** The flags at the start of each segment. */
+enum SegmentFlagsEnum
+{
+    // Distance to zero segments only have one side to move, and this is set if it's black
+    BlackToMoveFlag = 1,
+
+    // The distances are looked up in a map, which has 16 bit values if it's wide
+    MappedFlag = 2,
+
+    // The distances for wins or losses are in plies rather than moves
+    WinPliesFlag = 4,
+    LossPliesFlag = 8,
+
+    WideFlag = 16,
+
+    // Every position in the segment has the same value, so there is no data
+    SingleValueFlag = 128
+};
+
+/** What a lookup found out, besides the value. */
+enum LookupEnum
+{
+    LookupFailed,
+    LookupOk,
+
+    // The distance to zero file only has the other side to move
+    LookupOtherSide,
+
+    // The best move captures or moves a pawn, which the distance to zero file doesn't know
+    LookupZeroing
+};
+
+enum DirectionEnum
+{
+    North, East, NorthEast, NorthWest,
+    South, West, SouthEast, SouthWest,
+
+    DirectionCount
+};
+
+
+/** The attacks for the move generator, and how the squares are numbered when we
+ *  compute where a position is in a table.
+*/
+struct geometry_t
+{
+    bb_t Knight[64];
+    bb_t King[64];
+    bb_t Pawn[2][64];
+    bb_t Rays[DirectionCount][64];
+
+    // Choose[k][n] is the number of ways to choose k squares out of n
+    GUINT64 Choose[TB_PIECES + 1][65];
+
+    // The a1-d1-d4 triangle numbered from 0 to 9, the squares below the diagonal
+    //  first, and -1 outside of it
+    int Triangle[64];
+
+    // The 28 squares below the a1-h8 diagonal, numbered from 0, and -1 elsewhere
+    int Below[64];
+
+    // The placements of two kings that don't touch, with the first one in the triangle
+    //  (by its number) and the second one not above the diagonal if the first is on
+    //  it.  The 462 of them are numbered with the ones that have both kings on the
+    //  diagonal last, and the rest are -1.
+    int Kings[10][64];
+
+    // The squares a2-h7 numbered from 47 down: the a and h files from the bottom up,
+    //  then the b and g files, and so on.  The leading pawn is the one with the highest
+    //  number, which is the one nearest the edge and the lowest on its file.
+    int PawnCode[64];
+
+    // For each number of leading pawns, where the placements with the leading pawn on
+    //  the square start, and how many there are for the leading pawn on each file a-d
+    GUINT64 LeadStart[6][64];
+    GUINT64 LeadSize[6][4];
+
+    geometry_t();
+};
+
+/** The values for one side to move, and with pawns one file of the leading pawn. */
+struct segment_t
+{
+    int Flags;
+
+    // The value of every position, if the segment has a single value
+    int SingleValue;
+
+    // The piece codes in the order the squares are indexed, with the first side white
+    int Pieces[TB_PIECES];
+
+    // The pieces are indexed in groups: the leading group first, then the other
+    //  color's pawns if both sides have them, and then runs of the same piece.  The
+    //  lengths end with a 0, and each group's index is multiplied by its multiplier.
+    int GroupLength[TB_PIECES + 1];
+    GUINT64 Multiplier[TB_PIECES + 1];
+
+    // The number of positions in the segment
+    GUINT64 Size;
+
+    // The compressed data is in blocks of a fixed size, each with a variable number
+    //  of values.  The sparse index tells us in which block the middle of every span
+    //  of positions is, and from there we walk the block lengths to find ours.
+    GUINT64 BlockBytes;
+    GUINT64 IndexSpan;
+    GUINT64 IndexCount;
+    GUINT64 LengthCount;
+    GUINT32 BlockCount;
+    GUINT8 const *Index;
+    GUINT8 const *Lengths;
+    GUINT8 const *Blocks;
+
+    // The code lengths, the first symbol of each length and where each length's codes
+    //  start, left aligned in 64 bits
+    int MinCodeLength;
+    int MaxCodeLength;
+    GUINT8 const *FirstSymbol;
+    QVector<GUINT64> CodeStart;
+
+    // Each symbol is three bytes that hold two 12 bit numbers: a value and 0xFFF, or
+    //  two symbols that it expands to.  Runs holds how many values each one stands for,
+    //  minus one.
+    int SymbolCount;
+    GUINT8 const *Symbols;
+    QVector<GUINT8> Runs;
+
+    // Where the distance to zero maps for each result start
+    int MapStart[4];
+
+    segment_t()
+        :Flags(0), SingleValue(0), Size(0),
+          BlockBytes(0), IndexSpan(0), IndexCount(0), LengthCount(0), BlockCount(0),
+          Index(0), Lengths(0), Blocks(0),
+          MinCodeLength(0), MaxCodeLength(0), FirstSymbol(0),
+          SymbolCount(0), Symbols(0)
+    {
+        memset(Pieces, 0, sizeof(Pieces));
+        memset(GroupLength, 0, sizeof(GroupLength));
+        memset(Multiplier, 0, sizeof(Multiplier));
+        memset(MapStart, 0, sizeof(MapStart));
+    }
+};
+
+/** A table file, which is mapped the first time it's probed. */
+struct table_t
+{
+    QString Filename;
+    bool IsDTZ;
+
+    // The material keys with the first side's pieces white, and with them black
+    GUINT64 Key;
+    GUINT64 MirrorKey;
+
+    int PieceCount;
+    bool HasPawns;
+
+    // True if a side has exactly one of some piece besides the king, which makes the
+    //  leading group three pieces instead of the two kings
+    bool HasUniquePiece;
+
+    // The pawns of the leading color, which is the one with fewer pawns but some, and
+    //  the pawns of the other color
+    int LeadPawns;
+    int OtherPawns;
+
+    QMutex Lock;
+
+    // 0 if we haven't tried to map the file yet, 1 if it's ready and -1 if it failed
+    QAtomicInt State;
+    QFile File;
+    GUINT8 const *Data;
+    GUINT8 const *End;
+    GUINT8 const *DTZMap;
+
+    int Sides;
+    int Files;
+    segment_t Segments[2][4];
+
+    table_t(const QString &filename, bool dtz)
+        :Filename(filename), IsDTZ(dtz), Key(0), MirrorKey(0), PieceCount(0),
+          HasPawns(false), HasUniquePiece(false), LeadPawns(0), OtherPawns(0),
+          File(filename), Data(0), End(0), DTZMap(0), Sides(0), Files(0)
+    {}
+};
+
+struct d_t
+{
+    QString paths;
+    int max_pieces;
+
+    // The tables by material key.  Every table is there twice, once for each color
+    //  having the first side's pieces.
+    QHash<GUINT64, table_t *> wdl;
+    QHash<GUINT64, table_t *> dtz;
+    QVector<table_t *> tables;
+
+    d_t() :max_pieces(0) {}
+};
+
+/** A move for resolving captures, which is all we need to know about it. */
+struct move_t
+{
+    int From;
+    int To;
+    int PromotedType;
+    bool Capture;
+    bool EnPassant;
+    bool Zeroing;
+};
+
+}
+
+
+static int __popcount(bb_t b)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt64(b);
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+static int __lsb(bb_t b)
+{
+#if defined(_MSC_VER)
+    unsigned long ret;
+    _BitScanForward64(&ret, b);
+    return (int)ret;
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+static int __msb(bb_t b)
+{
+#if defined(_MSC_VER)
+    unsigned long ret;
+    _BitScanReverse64(&ret, b);
+    return (int)ret;
+#else
+    return 63 ^ __builtin_clzll(b);
+#endif
+}
+
+static int __pop_lsb(bb_t &b)
+{
+    int ret = __lsb(b);
+    b &= b - 1;
+    return ret;
+}
+
+static bb_t __bit(int sq){ return (bb_t)1 << sq; }
+static int __col(int sq){ return sq & 7; }
+static int __row(int sq){ return sq >> 3; }
+static int __sign(int x){ return (0 < x) - (x < 0); }
+
+// How far the square is above the a1-h8 diagonal, or negative if it's below
+static int __off_diagonal(int sq){ return __row(sq) - __col(sq); }
+
+// Reflects the square in the a1-h8 diagonal
+static int __transpose(int sq){ return 8 * __col(sq) + __row(sq); }
+
+// The table files are little endian, except the compressed data which is big endian
+static GUINT32 __read_le16(GUINT8 const *p){ return p[0] | (GUINT32)p[1] << 8; }
+static GUINT32 __read_le32(GUINT8 const *p){ return p[0] | (GUINT32)p[1] << 8 | (GUINT32)p[2] << 16 | (GUINT32)p[3] << 24; }
+
+// The piece codes in the files are 1 to 6 for white's pawn to king, and 9 to 14 for black's
+static int __code_color(int code){ return code >> 3; }
+static int __code_type(int code){ return 6 - (code & 7); }
+
+
+geometry_t::geometry_t()
+{
+    memset(Knight, 0, sizeof(Knight));
+    memset(King, 0, sizeof(King));
+    memset(Pawn, 0, sizeof(Pawn));
+    memset(Rays, 0, sizeof(Rays));
+    memset(Choose, 0, sizeof(Choose));
+    memset(LeadStart, 0, sizeof(LeadStart));
+    memset(LeadSize, 0, sizeof(LeadSize));
+    for(int sq = 0; sq < 64; ++sq){
+        Triangle[sq] = Below[sq] = PawnCode[sq] = -1;
+        for(int i = 0; i < 10; ++i)
+            Kings[i][sq] = -1;
+    }
+
+    int const knight[8][2] = { {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2} };
+    int const dirs[DirectionCount][2] = { {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {0, -1}, {-1, 0}, {1, -1}, {-1, -1} };
+    for(int sq = 0; sq < 64; ++sq)
+    {
+        int const c = __col(sq), r = __row(sq);
+        for(int i = 0; i < 8; ++i){
+            int nc = c + knight[i][0], nr = r + knight[i][1];
+            if(0 <= nc && nc < 8 && 0 <= nr && nr < 8)
+                Knight[sq] |= __bit(8 * nr + nc);
+        }
+        for(int d = 0; d < DirectionCount; ++d){
+            int nc = c + dirs[d][0], nr = r + dirs[d][1];
+            if(0 <= nc && nc < 8 && 0 <= nr && nr < 8)
+                King[sq] |= __bit(8 * nr + nc);
+            for(; 0 <= nc && nc < 8 && 0 <= nr && nr < 8; nc += dirs[d][0], nr += dirs[d][1])
+                Rays[d][sq] |= __bit(8 * nr + nc);
+        }
+        for(int dc = -1; dc <= 1; dc += 2){
+            if(0 <= c + dc && c + dc < 8){
+                if(r < 7) Pawn[WHITE][sq] |= __bit(sq + 8 + dc);
+                if(0 < r) Pawn[BLACK][sq] |= __bit(sq - 8 + dc);
+            }
+        }
+    }
+
+    // Pascal's triangle
+    for(int n = 0; n <= 64; ++n){
+        Choose[0][n] = 1;
+        for(int k = 1; k <= TB_PIECES && k <= n; ++k)
+            Choose[k][n] = Choose[k - 1][n - 1] + Choose[k][n - 1];
+    }
+
+    // b1, c1, d1, c2, d2, d3, then a1, b2, c3, d4
+    int const triangle[10] = { 1, 2, 3, 10, 11, 19, 0, 9, 18, 27 };
+    for(int i = 0; i < 10; ++i)
+        Triangle[triangle[i]] = i;
+
+    int below = 0;
+    for(int sq = 0; sq < 64; ++sq){
+        if(__off_diagonal(sq) < 0)
+            Below[sq] = below++;
+    }
+
+    int next = 0;
+    for(int pass = 0; pass < 2; ++pass){
+        for(int i = 0; i < 10; ++i){
+            int const k1 = triangle[i];
+            for(int k2 = 0; k2 < 64; ++k2){
+                if((King[k1] | __bit(k1)) & __bit(k2))
+                    continue;
+                bool const k1_diagonal = 0 == __off_diagonal(k1);
+                if(k1_diagonal && 0 < __off_diagonal(k2))
+                    continue;
+
+                // The first pass numbers all but the ones with both on the diagonal
+                if((0 == pass) != (k1_diagonal && 0 == __off_diagonal(k2)))
+                    Kings[i][k2] = next++;
+            }
+        }
+    }
+
+    for(int f = 0; f < 4; ++f){
+        for(int r = 1; r <= 6; ++r){
+            int const code = 47 - 2 * (6 * f + r - 1);
+            PawnCode[8 * r + f] = code;
+            PawnCode[8 * r + (7 - f)] = code - 1;
+        }
+    }
+
+    // Any other leading pawns have lower numbers than the leading one, so with it on a
+    //  square there are as many placements as ways to choose them from those numbers
+    for(int lead = 1; lead <= 5; ++lead){
+        for(int f = 0; f < 4; ++f){
+            GUINT64 start = 0;
+            for(int r = 1; r <= 6; ++r){
+                LeadStart[lead][8 * r + f] = start;
+                start += Choose[lead - 1][PawnCode[8 * r + f]];
+            }
+            LeadSize[lead][f] = start;
+        }
+    }
+}
+
+static geometry_t const &__geometry()
+{
+    static geometry_t geometry;
+    return geometry;
+}
+
+
+/** \name Move generation
+ *  Just enough to resolve captures.  Positions with castling rights aren't probed, so
+ *  we don't generate castles.
+ *  \{
+*/
+
+static bb_t __color_bits(const position_t &p, int color)
+{
+    bb_t ret = 0;
+    for(int type = KING; type <= PAWN; ++type)
+        ret |= p.Pieces[color][type];
+    return ret;
+}
+
+static int __piece_type(const position_t &p, int color, int sq)
+{
+    for(int type = KING; type <= PAWN; ++type){
+        if(p.Pieces[color][type] & __bit(sq))
+            return type;
+    }
+    return -1;
+}
+
+static bb_t __slide(const geometry_t &t, int sq, bb_t occupied, int dir)
+{
+    bb_t ray = t.Rays[dir][sq];
+    bb_t blockers = ray & occupied;
+    if(blockers)
+        ray ^= t.Rays[dir][dir < South ? __lsb(blockers) : __msb(blockers)];
+    return ray;
+}
+
+static bb_t __bishop_attacks(const geometry_t &t, int sq, bb_t occupied)
+{
+    return __slide(t, sq, occupied, NorthEast) | __slide(t, sq, occupied, NorthWest) |
+            __slide(t, sq, occupied, SouthEast) | __slide(t, sq, occupied, SouthWest);
+}
+
+static bb_t __rook_attacks(const geometry_t &t, int sq, bb_t occupied)
+{
+    return __slide(t, sq, occupied, North) | __slide(t, sq, occupied, East) |
+            __slide(t, sq, occupied, South) | __slide(t, sq, occupied, West);
+}
+
+static bool __is_attacked(const geometry_t &t, const position_t &p, int sq, int by)
+{
+    bb_t const *b = p.Pieces[by];
+    bb_t const occupied = __color_bits(p, WHITE) | __color_bits(p, BLACK);
+    return (t.Knight[sq] & b[KNIGHT]) ||
+            (t.King[sq] & b[KING]) ||
+            (t.Pawn[by ^ 1][sq] & b[PAWN]) ||
+            (__bishop_attacks(t, sq, occupied) & (b[BISHOP] | b[QUEEN])) ||
+            (__rook_attacks(t, sq, occupied) & (b[ROOK] | b[QUEEN]));
+}
+
+static bool __in_check(const geometry_t &t, const position_t &p)
+{
+    return 0 != p.Pieces[p.Turn][KING] && __is_attacked(t, p, __lsb(p.Pieces[p.Turn][KING]), p.Turn ^ 1);
+}
+
+static void __make(position_t &p, const move_t &m)
+{
+    int const us = p.Turn, them = us ^ 1;
+    int const type = __piece_type(p, us, m.From);
+    if(m.EnPassant)
+        p.Pieces[them][PAWN] &= ~__bit(m.To + (WHITE == us ? -8 : 8));
+    else if(m.Capture){
+        for(int t = KING; t <= PAWN; ++t)
+            p.Pieces[them][t] &= ~__bit(m.To);
+    }
+
+    p.Pieces[us][type] &= ~__bit(m.From);
+    p.Pieces[us][-1 == m.PromotedType ? type : m.PromotedType] |= __bit(m.To);
+
+    p.EnPassant = PAWN == type && 16 == abs(m.To - m.From) ? (m.From + m.To) / 2 : -1;
+    p.HalfMoveClock = m.Zeroing ? 0 : p.HalfMoveClock + 1;
+    p.Turn = them;
+}
+
+static void __add_move(move_t *list, int &count, int from, int to, int promoted, bool capture, bool ep, bool pawn)
+{
+    move_t &m = list[count++];
+    m.From = from;
+    m.To = to;
+    m.PromotedType = promoted;
+    m.Capture = capture;
+    m.EnPassant = ep;
+    m.Zeroing = capture || pawn;
+}
+
+// Adds the pawn move, or all four promotions if it gets to the last row
+static void __add_pawn_move(move_t *list, int &count, int from, int to, bool capture)
+{
+    if(0 == __row(to) || 7 == __row(to)){
+        for(int type = QUEEN; type <= KNIGHT; ++type)
+            __add_move(list, count, from, to, type, capture, false, true);
+    }
+    else
+        __add_move(list, count, from, to, -1, capture, false, true);
+}
+
+// Generates the legal moves into the list and returns how many there are
+static int __generate(const geometry_t &t, const position_t &p, move_t *list)
+{
+    int const us = p.Turn, them = us ^ 1;
+    bb_t const own = __color_bits(p, us);
+    bb_t const theirs = __color_bits(p, them);
+    bb_t const occupied = own | theirs;
+
+    move_t pseudo[MAX_MOVES];
+    int count = 0;
+    for(int type = KING; type <= PAWN; ++type)
+    {
+        for(bb_t b = p.Pieces[us][type]; b;)
+        {
+            int const from = __pop_lsb(b);
+            bb_t targets;
+            switch(type)
+            {
+            case KING:
+                targets = t.King[from];
+                break;
+            case QUEEN:
+                targets = __bishop_attacks(t, from, occupied) | __rook_attacks(t, from, occupied);
+                break;
+            case ROOK:
+                targets = __rook_attacks(t, from, occupied);
+                break;
+            case BISHOP:
+                targets = __bishop_attacks(t, from, occupied);
+                break;
+            case KNIGHT:
+                targets = t.Knight[from];
+                break;
+            default:
+            {
+                int const forward = WHITE == us ? 8 : -8;
+                int const to = from + forward;
+                if(0 <= to && to < 64 && 0 == (occupied & __bit(to))){
+                    __add_pawn_move(pseudo, count, from, to, false);
+                    int const start_row = WHITE == us ? 1 : 6;
+                    if(start_row == __row(from) && 0 == (occupied & __bit(to + forward)))
+                        __add_move(pseudo, count, from, to + forward, -1, false, false, true);
+                }
+                for(bb_t c = t.Pawn[us][from] & theirs; c;)
+                    __add_pawn_move(pseudo, count, from, __pop_lsb(c), true);
+                if(-1 != p.EnPassant && (t.Pawn[us][from] & __bit(p.EnPassant)))
+                    __add_move(pseudo, count, from, p.EnPassant, -1, true, true, true);
+                targets = 0;
+            }
+                break;
+            }
+
+            for(targets &= ~own; targets;){
+                int const to = __pop_lsb(targets);
+                __add_move(pseudo, count, from, to, -1, 0 != (theirs & __bit(to)), false, false);
+            }
+        }
+    }
+
+    // Only keep the moves that don't leave the king in check
+    int ret = 0;
+    for(int i = 0; i < count; ++i){
+        position_t child(p);
+        __make(child, pseudo[i]);
+        child.Turn = us;
+        if(!__in_check(t, child))
+            list[ret++] = pseudo[i];
+    }
+    return ret;
+}
+
+/** \} */
+
+/** \name Reading the files
+ *  \{
+*/
+
+static GUINT64 __material_key(const int counts[2][6], bool swap_colors)
+{
+    GUINT64 ret = 0;
+    for(int c = WHITE; c <= BLACK; ++c){
+        for(int type = KING; type <= PAWN; ++type)
+            ret |= (GUINT64)counts[swap_colors ? c ^ 1 : c][type] << (4 * (6 * c + type));
+    }
+    return ret;
+}
+
+static void __count_pieces(const position_t &p, int counts[2][6])
+{
+    for(int c = WHITE; c <= BLACK; ++c){
+        for(int type = KING; type <= PAWN; ++type)
+            counts[c][type] = __popcount(p.Pieces[c][type]);
+    }
+}
+
+// Reads the piece counts from a table name like KQvKR, with the first side as white
+static bool __parse_name(const QString &name, int counts[2][6])
+{
+    memset(counts, 0, 2 * 6 * sizeof(int));
+    char const *letters = "KQRBNP";
+    int side = 0;
+    for(QChar qc : name){
+        char c = qc.toLatin1();
+        if('v' == c){
+            if(1 == side)
+                return false;
+            side = 1;
+            continue;
+        }
+        char const *p = 0 == c ? 0 : strchr(letters, c);
+        if(!p)
+            return false;
+        ++counts[side][p - letters];
+    }
+    return 1 == side && 1 == counts[WHITE][KING] && 1 == counts[BLACK][KING];
+}
+
+static table_t *__new_table(const QString &filename, bool dtz, const int counts[2][6])
+{
+    table_t *ret = new table_t(filename, dtz);
+    ret->Key = __material_key(counts, false);
+    ret->MirrorKey = __material_key(counts, true);
+    for(int c = WHITE; c <= BLACK; ++c){
+        for(int type = KING; type <= PAWN; ++type){
+            ret->PieceCount += counts[c][type];
+            if(KING != type && 1 == counts[c][type])
+                ret->HasUniquePiece = true;
+        }
+    }
+    ret->HasPawns = 0 < counts[WHITE][PAWN] + counts[BLACK][PAWN];
+    if(ret->HasPawns){
+        int const white = counts[WHITE][PAWN], black = counts[BLACK][PAWN];
+        bool const white_leads = 0 == black || (0 < white && white <= black);
+        ret->LeadPawns = white_leads ? white : black;
+        ret->OtherPawns = white_leads ? black : white;
+    }
+    return ret;
+}
+
+// Splits the segment's pieces into groups, and works out what each group's index is
+//  multiplied by.  The groups are combined in the order the file gives: the leading
+//  group goes in at position lead_order, the other pawns at pawn_order, and the rest
+//  of the groups fill in the other positions in turn.
+static void __init_groups(const table_t &t, segment_t &s, int lead_order, int pawn_order, int file)
+{
+    geometry_t const &g = __geometry();
+    int groups = 0;
+    int count = t.HasPawns ? t.LeadPawns : t.HasUniquePiece ? 3 : 2;
+    s.GroupLength[groups++] = count;
+    bool const pawn_group = t.HasPawns && 0 < t.OtherPawns;
+    if(pawn_group){
+        s.GroupLength[groups++] = t.OtherPawns;
+        count += t.OtherPawns;
+    }
+    while(count < t.PieceCount){
+        int length = 1;
+        while(count + length < t.PieceCount && s.Pieces[count + length] == s.Pieces[count])
+            ++length;
+        s.GroupLength[groups++] = length;
+        count += length;
+    }
+    s.GroupLength[groups] = 0;
+
+    // The squares left for the pieces after the pawns
+    int free = 64 - s.GroupLength[0] - (pawn_group ? s.GroupLength[1] : 0);
+    int next = pawn_group ? 2 : 1;
+    GUINT64 multiplier = 1;
+    for(int k = 0; next < groups || k == lead_order || k == pawn_order; ++k)
+    {
+        if(k == lead_order){
+            s.Multiplier[0] = multiplier;
+            if(t.HasPawns)
+                multiplier *= g.LeadSize[s.GroupLength[0]][file];
+            else
+                multiplier *= t.HasUniquePiece ? 31332 : 462;
+        }
+        else if(k == pawn_order){
+            // The other pawns can be anywhere the leading ones aren't, except the first
+            //  and last rows
+            s.Multiplier[1] = multiplier;
+            multiplier *= g.Choose[s.GroupLength[1]][48 - s.GroupLength[0]];
+        }
+        else{
+            s.Multiplier[next] = multiplier;
+            multiplier *= g.Choose[s.GroupLength[next]][free];
+            free -= s.GroupLength[next++];
+        }
+    }
+    s.Size = multiplier;
+}
+
+// Works out how many values each symbol stands for, from the symbols it expands to
+static bool __init_run(segment_t &s, int sym, QVector<char> &visited)
+{
+    if(visited[sym])
+        return 2 == visited[sym];
+    visited[sym] = 1;
+
+    GUINT8 const *p = s.Symbols + 3 * sym;
+    int const left = p[0] | (p[1] & 0xF) << 8;
+    int const right = p[1] >> 4 | p[2] << 4;
+    if(0xFFF == right)
+        s.Runs[sym] = 0;
+    else
+    {
+        // A symbol that expands to itself would never end
+        if(s.SymbolCount <= left || s.SymbolCount <= right ||
+                !__init_run(s, left, visited) || !__init_run(s, right, visited))
+            return false;
+        s.Runs[sym] = s.Runs[left] + s.Runs[right] + 1;
+    }
+    visited[sym] = 2;
+    return true;
+}
+
+// Reads the segment's header, and returns where the next one starts or null if it's
+//  not valid
+static GUINT8 const *__init_segment(segment_t &s, GUINT8 const *p, GUINT8 const *end)
+{
+    if(end - p < 2)
+        return 0;
+    s.Flags = p[0];
+    if(s.Flags & SingleValueFlag){
+        s.SingleValue = p[1];
+        return p + 2;
+    }
+
+    if(end - p < 10)
+        return 0;
+    s.BlockBytes = (GUINT64)1 << p[1];
+    s.IndexSpan = (GUINT64)1 << p[2];
+    s.IndexCount = (s.Size + s.IndexSpan - 1) / s.IndexSpan;
+    s.BlockCount = __read_le32(p + 4);
+    s.LengthCount = (GUINT64)s.BlockCount + p[3];
+    s.MaxCodeLength = p[8];
+    s.MinCodeLength = p[9];
+    p += 10;
+
+    // We always have more than 32 bits of the block to decode the next code from
+    if(s.MinCodeLength < 1 || 32 < s.MaxCodeLength || s.MaxCodeLength < s.MinCodeLength)
+        return 0;
+
+    // The codes of each length count up from where the longer ones left off, halved,
+    //  and the longest start at 0.  The first symbol of each length tells us how many
+    //  codes the longer length has.
+    int const lengths = s.MaxCodeLength - s.MinCodeLength + 1;
+    if(end - p < 2 * lengths + 2)
+        return 0;
+    s.FirstSymbol = p;
+    p += 2 * lengths;
+    s.CodeStart.fill(0, lengths);
+    for(int i = lengths - 2; 0 <= i; --i){
+        GUINT64 const longer = __read_le16(s.FirstSymbol + 2 * i) - __read_le16(s.FirstSymbol + 2 * (i + 1));
+        s.CodeStart[i] = (s.CodeStart[i + 1] + longer) / 2;
+    }
+    for(int i = 0; i < lengths; ++i)
+        s.CodeStart[i] <<= 64 - (s.MinCodeLength + i);
+
+    s.SymbolCount = __read_le16(p);
+    p += 2;
+    if(end - p < 3 * s.SymbolCount + 1)
+        return 0;
+    s.Symbols = p;
+    p += 3 * s.SymbolCount + (s.SymbolCount & 1);
+
+    s.Runs.fill(0, s.SymbolCount);
+    QVector<char> visited(s.SymbolCount, 0);
+    for(int i = 0; i < s.SymbolCount; ++i){
+        if(!__init_run(s, i, visited))
+            return 0;
+    }
+    return p;
+}
+
+// Reads where the maps from the stored values to distances start.  Returns where the
+//  next part of the file starts, or null if it's not valid.
+static GUINT8 const *__init_dtz_maps(table_t &t, GUINT8 const *p)
+{
+    t.DTZMap = p;
+    for(int file = 0; file < t.Files; ++file)
+    {
+        segment_t &s = t.Segments[0][file];
+        if(0 == (s.Flags & MappedFlag))
+            continue;
+
+        // There's a map for losses, wins, blessed losses and cursed wins, each of which
+        //  starts with its length
+        bool const wide = s.Flags & WideFlag;
+        if(wide)
+            p += (p - t.Data) & 1;
+        for(int i = 0; i < 4; ++i){
+            if(t.End - p < 2)
+                return 0;
+            s.MapStart[i] = p - t.DTZMap + (wide ? 2 : 1);
+            p += wide ? 2 + 2 * __read_le16(p) : 1 + p[0];
+        }
+    }
+    p += (p - t.Data) & 1;
+    return p <= t.End ? p : 0;
+}
+
+// Finds the segments in the mapped file.  Returns false if it doesn't match the table.
+static bool __init_table(table_t &t)
+{
+    GUINT8 const *p = t.Data;
+    if(t.End - p < 6 || 0 != memcmp(p, t.IsDTZ ? dtz_magic : wdl_magic, 4))
+        return false;
+    if(t.HasPawns != (0 != (p[4] & 2)))
+        return false;
+    t.Sides = !t.IsDTZ && (p[4] & 1) ? 2 : 1;
+    t.Files = t.HasPawns ? 4 : 1;
+    p += 5;
+
+    bool const pawn_group = t.HasPawns && 0 < t.OtherPawns;
+    for(int file = 0; file < t.Files; ++file)
+    {
+        if(t.End - p < (pawn_group ? 2 : 1) + t.PieceCount)
+            return false;
+        int const lead_order[2] = { p[0] & 0xF, p[0] >> 4 };
+        int const pawn_order[2] = { pawn_group ? p[1] & 0xF : 0xF, pawn_group ? p[1] >> 4 : 0xF };
+        p += pawn_group ? 2 : 1;
+        for(int i = 0; i < t.PieceCount; ++i, ++p){
+            for(int side = 0; side < t.Sides; ++side){
+                int const code = side ? p[0] >> 4 : p[0] & 0xF;
+                if(__code_type(code) < KING || PAWN < __code_type(code))
+                    return false;
+                t.Segments[side][file].Pieces[i] = code;
+            }
+        }
+        for(int side = 0; side < t.Sides; ++side)
+            __init_groups(t, t.Segments[side][file], lead_order[side], pawn_order[side], file);
+    }
+    p += (p - t.Data) & 1;
+
+    for(int file = 0; file < t.Files; ++file){
+        for(int side = 0; side < t.Sides; ++side){
+            if(0 == (p = __init_segment(t.Segments[side][file], p, t.End)))
+                return false;
+        }
+    }
+
+    if(t.IsDTZ && 0 == (p = __init_dtz_maps(t, p)))
+        return false;
+
+    for(int file = 0; file < t.Files; ++file){
+        for(int side = 0; side < t.Sides; ++side){
+            segment_t &s = t.Segments[side][file];
+            s.Index = p;
+            p += 6 * s.IndexCount;
+        }
+    }
+    for(int file = 0; file < t.Files; ++file){
+        for(int side = 0; side < t.Sides; ++side){
+            segment_t &s = t.Segments[side][file];
+            s.Lengths = p;
+            p += 2 * s.LengthCount;
+        }
+    }
+    if(t.End < p)
+        return false;
+
+    for(int file = 0; file < t.Files; ++file){
+        for(int side = 0; side < t.Sides; ++side){
+            segment_t &s = t.Segments[side][file];
+            if(0 == s.BlockCount)
+                continue;
+            p += (64 - (p - t.Data) % 64) % 64;
+            s.Blocks = p;
+            p += s.BlockCount * s.BlockBytes;
+            if(t.End < p)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Maps the file the first time it's probed.  Returns false if it can't be read.
+static bool __map_table(table_t &t)
+{
+    int state = t.State.loadAcquire();
+    if(0 == state)
+    {
+        QMutexLocker lock(&t.Lock);
+        state = t.State.loadAcquire();
+        if(0 == state)
+        {
+            state = -1;
+            if(t.File.open(QFile::ReadOnly) && 0 < t.File.size()){
+                t.Data = t.File.map(0, t.File.size());
+                t.End = t.Data + t.File.size();
+                if(t.Data && __init_table(t))
+                    state = 1;
+            }
+            if(-1 == state)
+                t.File.close();
+            t.State.storeRelease(state);
+        }
+    }
+    return 1 == state;
+}
+
+/** \} */
+
+
+/** \name Looking up positions
+ *  \{
+*/
+
+// Finds the value at the index in the segment.  Returns false if the data is corrupt.
+static bool __decode(const segment_t &s, GUINT64 index, int &value)
+{
+    if(s.Flags & SingleValueFlag){
+        value = s.SingleValue;
+        return true;
+    }
+    if(s.Size <= index)
+        return false;
+
+    // Start from the middle of the index's span, and walk the block lengths (which are
+    //  one less than the number of values in the block) to the block we want
+    GUINT8 const *entry = s.Index + 6 * (index / s.IndexSpan);
+    qint64 block = __read_le32(entry);
+    qint64 offset = (qint64)__read_le16(entry + 4) +
+            (qint64)(index % s.IndexSpan) - (qint64)(s.IndexSpan / 2);
+    while(offset < 0){
+        if(--block < 0)
+            return false;
+        offset += __read_le16(s.Lengths + 2 * block) + 1;
+    }
+    while(true){
+        if((qint64)s.BlockCount <= block)
+            return false;
+        qint64 const length = __read_le16(s.Lengths + 2 * block) + 1;
+        if(offset < length)
+            break;
+        offset -= length;
+        ++block;
+    }
+
+    // Read the codes until we get to the symbol that has our value in it.  The window
+    //  has the next bits of the block at the top, and we keep more than 32 of them.
+    GUINT8 const *p = s.Blocks + block * s.BlockBytes;
+    GUINT8 const *const block_end = p + s.BlockBytes;
+    GUINT64 window = 0;
+    int bits = 0;
+    while(bits < 64){
+        window |= (GUINT64)(p < block_end ? *p++ : 0) << (56 - bits);
+        bits += 8;
+    }
+
+    int const lengths = s.CodeStart.size();
+    int sym;
+    while(true)
+    {
+        int i = 0;
+        while(i < lengths - 1 && window < s.CodeStart[i])
+            ++i;
+        int const length = s.MinCodeLength + i;
+        sym = __read_le16(s.FirstSymbol + 2 * i) + (int)((window - s.CodeStart[i]) >> (64 - length));
+        if(s.SymbolCount <= sym)
+            return false;
+        if(offset <= s.Runs[sym])
+            break;
+        offset -= s.Runs[sym] + 1;
+
+        window <<= length;
+        bits -= length;
+        while(bits <= 56){
+            window |= (GUINT64)(p < block_end ? *p++ : 0) << (56 - bits);
+            bits += 8;
+        }
+    }
+
+    // Go down the symbol's expansion to our value
+    while(0 < s.Runs[sym]){
+        GUINT8 const *q = s.Symbols + 3 * sym;
+        int const left = q[0] | (q[1] & 0xF) << 8;
+        if(offset <= s.Runs[left])
+            sym = left;
+        else{
+            offset -= s.Runs[left] + 1;
+            sym = q[1] >> 4 | q[2] << 4;
+        }
+    }
+    value = s.Symbols[3 * sym] | (s.Symbols[3 * sym + 1] & 0xF) << 8;
+    return true;
+}
+
+// Sorts a few squares, by their pawn numbers if there's a geometry
+static void __sort_squares(int *sq, int count, const geometry_t *pawns = 0)
+{
+    for(int i = 1; i < count; ++i){
+        for(int j = i; 0 < j; --j){
+            int const a = pawns ? pawns->PawnCode[sq[j - 1]] : sq[j - 1];
+            int const b = pawns ? pawns->PawnCode[sq[j]] : sq[j];
+            if(a <= b)
+                break;
+            int const tmp = sq[j];
+            sq[j] = sq[j - 1];
+            sq[j - 1] = tmp;
+        }
+    }
+}
+
+// Computes where the position is in the segment, from the squares of the pieces in the
+//  order the segment lists them.  The squares are changed by the symmetries.
+static GUINT64 __position_index(const table_t &t, const segment_t &s, int *sq)
+{
+    geometry_t const &g = __geometry();
+    int const n = t.PieceCount;
+    int const lead = s.GroupLength[0];
+    GUINT64 ret;
+
+    // Positions are the same mirrored left to right, so the first piece is on the a-d
+    //  files.  Without pawns they're also the same mirrored top to bottom and in the
+    //  diagonal, so it's in the a1-d1-d4 triangle.
+    if(3 < __col(sq[0])){
+        for(int i = 0; i < n; ++i)
+            sq[i] ^= 7;
+    }
+
+    if(t.HasPawns)
+    {
+        __sort_squares(sq + 1, lead - 1, &g);
+        ret = g.LeadStart[lead][sq[0]];
+        for(int i = 1; i < lead; ++i)
+            ret += g.Choose[i][g.PawnCode[sq[i]]];
+    }
+    else
+    {
+        if(3 < __row(sq[0])){
+            for(int i = 0; i < n; ++i)
+                sq[i] ^= 56;
+        }
+
+        // The first of the leading pieces that's off the diagonal goes below it
+        for(int i = 0; i < lead; ++i){
+            int const off = __off_diagonal(sq[i]);
+            if(0 == off)
+                continue;
+            if(0 < off){
+                for(int j = 0; j < n; ++j)
+                    sq[j] = __transpose(sq[j]);
+            }
+            break;
+        }
+
+        if(2 == lead)
+            ret = g.Kings[g.Triangle[sq[0]]][sq[1]];
+        else
+        {
+            // The later pieces skip the squares of the earlier ones.  Each case
+            //  depends on which is the first piece off the diagonal.
+            int const sq1 = sq[1] - (sq[0] < sq[1]);
+            int const sq2 = sq[2] - (sq[0] < sq[2]) - (sq[1] < sq[2]);
+            int const row1 = __row(sq[1]) - (sq[0] < sq[1]);
+            int const row2 = __row(sq[2]) - (sq[0] < sq[2]) - (sq[1] < sq[2]);
+            if(__off_diagonal(sq[0]))
+                ret = (GUINT64)g.Triangle[sq[0]] * 63 * 62 + sq1 * 62 + sq2;
+            else if(__off_diagonal(sq[1]))
+                ret = 6 * 63 * 62 + (GUINT64)__row(sq[0]) * 28 * 62 + g.Below[sq[1]] * 62 + sq2;
+            else if(__off_diagonal(sq[2]))
+                ret = 6 * 63 * 62 + 4 * 28 * 62 + (GUINT64)__row(sq[0]) * 7 * 28 + row1 * 28 + g.Below[sq[2]];
+            else
+                ret = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 + (GUINT64)__row(sq[0]) * 7 * 6 + row1 * 6 + row2;
+        }
+    }
+    ret *= s.Multiplier[0];
+
+    // Each of the other groups is a combination of squares, numbered without the
+    //  squares of the groups before it
+    int done = lead;
+    for(int group = 1; 0 < s.GroupLength[group]; ++group)
+    {
+        int const length = s.GroupLength[group];
+        int *const squares = sq + done;
+        __sort_squares(squares, length);
+
+        // The other color's pawns can't be on the first row
+        int const skip = 1 == group && t.HasPawns && 0 < t.OtherPawns ? 8 : 0;
+        GUINT64 combination = 0;
+        for(int i = 0; i < length; ++i){
+            int taken = 0;
+            for(int j = 0; j < done; ++j)
+                taken += sq[j] < squares[i];
+            combination += g.Choose[i + 1][squares[i] - taken - skip];
+        }
+        ret += combination * s.Multiplier[group];
+        done += length;
+    }
+    return ret;
+}
+
+// Converts a value from a distance to zero file to plies, given the result
+static int __dtz_plies(const table_t &t, const segment_t &s, int value, int wdl)
+{
+    if(s.Flags & MappedFlag){
+        // The maps are in the order win, loss, cursed win, blessed loss
+        static int const map[5] = { 1, 3, 0, 2, 0 };
+        int const at = s.MapStart[map[wdl + 2]];
+        value = (s.Flags & WideFlag) ? (int)__read_le16(t.DTZMap + at + 2 * value) : t.DTZMap[at + value];
+    }
+
+    // The fifty move rule has already come into play for cursed wins and blessed
+    //  losses, so they're always in moves
+    bool const plies = (2 == wdl && (s.Flags & WinPliesFlag)) || (-2 == wdl && (s.Flags & LossPliesFlag));
+    return (plies ? value : 2 * value) + 1;
+}
+
+// Looks the position up in its file.  For a distance to zero the result must be given.
+static int __lookup(const d_t *dd, const position_t &pos, bool dtz, int wdl, int &state)
+{
+    int counts[2][6];
+    __count_pieces(pos, counts);
+    GUINT64 const key = __material_key(counts, false);
+
+    // Bare kings are a draw, and don't have a file
+    if(2 == __popcount(__color_bits(pos, WHITE) | __color_bits(pos, BLACK))){
+        state = LookupOk;
+        return 0;
+    }
+
+    table_t *t = (dtz ? dd->dtz : dd->wdl).value(key, 0);
+    if(!t || !__map_table(*t)){
+        state = LookupFailed;
+        return 0;
+    }
+
+    // The file has the first side as white.  If we have that side's pieces as black, or
+    //  it's symmetric and black is to move, we look up the position with the colors
+    //  swapped and the board upside down.
+    int const flip = key != t->Key || (t->Key == t->MirrorKey && BLACK == pos.Turn) ? 1 : 0;
+    int const side = pos.Turn ^ flip;
+    int const flip_squares = flip ? 56 : 0;
+
+    // The leading pawn decides which segment we need
+    int file = 0;
+    if(t->HasPawns){
+        int const code = t->Segments[0][0].Pieces[0];
+        geometry_t const &g = __geometry();
+        int best = -1;
+        for(bb_t b = pos.Pieces[__code_color(code) ^ flip][__code_type(code)]; b;){
+            int const sq = __pop_lsb(b) ^ flip_squares;
+            if(best < g.PawnCode[sq]){
+                best = g.PawnCode[sq];
+                file = qMin(__col(sq), 7 - __col(sq));
+            }
+        }
+    }
+
+    segment_t const *s;
+    if(dtz){
+        s = &t->Segments[0][file];
+        if((s->Flags & BlackToMoveFlag) != side && (t->Key != t->MirrorKey || t->HasPawns)){
+            state = LookupOtherSide;
+            return 0;
+        }
+    }
+    else if(side < t->Sides)
+        s = &t->Segments[side][file];
+    else{
+        state = LookupFailed;
+        return 0;
+    }
+
+    // Put the squares in the order the segment lists the pieces, with the leading pawn
+    //  first
+    int sq[TB_PIECES];
+    bb_t used = 0;
+    for(int i = 0; i < t->PieceCount; ++i){
+        int const code = s->Pieces[i];
+        bb_t const b = pos.Pieces[__code_color(code) ^ flip][__code_type(code)] & ~used;
+        if(0 == b){
+            state = LookupFailed;
+            return 0;
+        }
+        used |= __bit(__lsb(b));
+        sq[i] = __lsb(b) ^ flip_squares;
+    }
+    if(t->HasPawns){
+        geometry_t const &g = __geometry();
+        for(int i = 1; i < s->GroupLength[0]; ++i){
+            if(g.PawnCode[sq[0]] < g.PawnCode[sq[i]]){
+                int const tmp = sq[0];
+                sq[0] = sq[i];
+                sq[i] = tmp;
+            }
+        }
+    }
+
+    int value;
+    if(!__decode(*s, __position_index(*t, *s, sq), value)){
+        state = LookupFailed;
+        return 0;
+    }
+    state = LookupOk;
+    return dtz ? __dtz_plies(*t, *s, value, wdl) : value - 2;
+}
+
+// Finds the result of the position.  The files don't know about en passant, and where
+//  capturing is best they may have any value, so we try the captures ourselves, and
+//  the pawn moves too if we're asked to find out if a zeroing move is best.
+static int __resolve(const d_t *dd, const position_t &pos, bool pawn_moves, int &state)
+{
+    geometry_t const &g = __geometry();
+    move_t moves[MAX_MOVES];
+    int const count = __generate(g, pos, moves);
+    int best = -2;
+    int tried = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        if(!moves[i].Capture && !(pawn_moves && moves[i].Zeroing))
+            continue;
+        ++tried;
+
+        position_t child(pos);
+        __make(child, moves[i]);
+        int const value = -__resolve(dd, child, false, state);
+        if(LookupFailed == state)
+            return 0;
+        if(best < value){
+            best = value;
+            if(2 == value){
+                state = LookupZeroing;
+                return value;
+            }
+        }
+    }
+
+    // If we tried every move we already know the answer
+    bool const all = 0 < tried && tried == count;
+    int value = best;
+    if(!all){
+        value = __lookup(dd, pos, false, 0, state);
+        if(LookupFailed == state)
+            return 0;
+    }
+    if(value <= best){
+        state = 0 < best || all ? LookupZeroing : LookupOk;
+        return best;
+    }
+    state = LookupOk;
+    return value;
+}
+
+// The distance to zero of a position whose best move is a capture or pawn move
+static int __zeroing_dtz(int wdl)
+{
+    switch(wdl)
+    {
+    case 2:     return 1;
+    case 1:     return 101;
+    case -1:    return -101;
+    case -2:    return -1;
+    default:    return 0;
+    }
+}
+
+static bool __is_mate(const position_t &pos)
+{
+    geometry_t const &g = __geometry();
+    move_t moves[MAX_MOVES];
+    return __in_check(g, pos) && 0 == __generate(g, pos, moves);
+}
+
+static int __dtz(const d_t *dd, const position_t &pos, int &state)
+{
+    state = LookupOk;
+    int const wdl = __resolve(dd, pos, true, state);
+    if(LookupFailed == state || 0 == wdl)
+        return 0;
+    if(LookupZeroing == state)
+        return __zeroing_dtz(wdl);
+
+    // The files may have anything for mated positions
+    if(-2 == wdl && __is_mate(pos))
+        return -1;
+
+    int ret = __lookup(dd, pos, true, wdl, state);
+    if(LookupFailed == state)
+        return 0;
+    if(LookupOtherSide != state)
+        return __sign(wdl) * (ret + (1 == abs(wdl) ? 100 : 0));
+
+    // The file only has the other side to move, so we look at every move.  The side
+    //  that wins wants the shortest way to zero, and the side that loses the longest.
+    geometry_t const &g = __geometry();
+    move_t moves[MAX_MOVES];
+    int const count = __generate(g, pos, moves);
+    ret = INT_MAX;
+    for(int i = 0; i < count; ++i)
+    {
+        position_t child(pos);
+        __make(child, moves[i]);
+
+        // Mating is as good as zeroing, otherwise it's one ply more than theirs
+        int dtz;
+        if(moves[i].Zeroing)
+            dtz = -__zeroing_dtz(__resolve(dd, child, false, state));
+        else if(__is_mate(child))
+            dtz = 1;
+        else{
+            dtz = -__dtz(dd, child, state);
+            dtz += __sign(dtz);
+        }
+        if(LookupFailed == state)
+            return 0;
+        if(__sign(dtz) == __sign(wdl) && dtz < ret)
+            ret = dtz;
+    }
+    state = LookupOk;
+    return INT_MAX == ret ? -1 : ret;
+}
+
+// Returns true if we have the tables for the number of pieces
+static bool __can_probe(const d_t *dd, const position_t &pos)
+{
+    int count = 0;
+    for(int c = WHITE; c <= BLACK; ++c){
+        if(1 != __popcount(pos.Pieces[c][KING]))
+            return false;
+        count += __popcount(__color_bits(pos, c));
+    }
+    return count <= dd->max_pieces;
+}
+
+/** \} */
+
+
+NAMESPACE_GKCHESS;
+
+
+Tablebases::Position::Position()
+    :Turn(0), EnPassant(-1), HalfMoveClock(0)
+{
+    memset(Pieces, 0, sizeof(Pieces));
+}
+
+bool Tablebases::Position::FromBoard(const Board &b, Position &ret)
+{
+    if(8 != b.ColumnCount() || 8 != b.RowCount())
+        return false;
+    if(-1 != b.GetCastleWhiteA() || -1 != b.GetCastleWhiteH() ||
+            -1 != b.GetCastleBlackA() || -1 != b.GetCastleBlackH())
+        return false;
+
+    ret = Position();
+    for(int c = 0; c < 8; ++c){
+        for(int r = 0; r < 8; ++r){
+            Piece const &p = b.SquareAt(c, r).GetPiece();
+            if(!p.IsNull())
+                ret.Pieces[p.GetAllegience()][p.GetType()] |= __bit(8 * r + c);
+        }
+    }
+    ret.Turn = Piece::White == b.GetWhoseTurn() ? WHITE : BLACK;
+    Square const *ep = b.GetEnPassantSquare();
+    ret.EnPassant = ep ? 8 * ep->GetRow() + ep->GetColumn() : -1;
+    ret.HalfMoveClock = b.GetHalfMoveClock();
+    return true;
+}
+
+
+Tablebases::Tablebases()
+{
+    G_D_INIT();
+}
+
+Tablebases::~Tablebases()
+{
+    Close();
+    G_D_UNINIT();
+}
+
+int Tablebases::Open(const QString &paths)
+{
+    G_D;
+    Close();
+    d->paths = paths;
+
+    int ret = 0;
+    for(QString const &path : paths.split(PATH_SEPARATOR, QString::SkipEmptyParts))
+    {
+        QDir dir(path);
+        QStringList const files = dir.entryList(QStringList() << "*.rtbw" << "*.rtbz", QDir::Files, QDir::Name);
+        for(QString const &filename : files)
+        {
+            QFileInfo fi(filename);
+            bool const dtz = 0 == fi.suffix().compare("rtbz", ::Qt::CaseInsensitive);
+            int counts[2][6];
+            if(!__parse_name(fi.completeBaseName(), counts))
+                continue;
+
+            // If a table is in more than one directory, the first one wins
+            QHash<GUINT64, table_t *> &hash = dtz ? d->dtz : d->wdl;
+            GUINT64 const key = __material_key(counts, false);
+            if(hash.contains(key))
+                continue;
+
+            table_t *t = __new_table(dir.filePath(filename), dtz, counts);
+            if(TB_PIECES < t->PieceCount){
+                delete t;
+                continue;
+            }
+            d->tables.append(t);
+            hash.insert(t->Key, t);
+            hash.insert(t->MirrorKey, t);
+            if(!dtz){
+                d->max_pieces = qMax(d->max_pieces, t->PieceCount);
+                ++ret;
+            }
+        }
+    }
+    return ret;
+}
+
+void Tablebases::Close()
+{
+    G_D;
+    qDeleteAll(d->tables);
+    d->tables.clear();
+    d->wdl.clear();
+    d->dtz.clear();
+    d->paths.clear();
+    d->max_pieces = 0;
+}
+
+QString Tablebases::GetPaths() const
+{
+    G_D;
+    return d->paths;
+}
+
+int Tablebases::GetMaxPieces() const
+{
+    G_D;
+    return d->max_pieces;
+}
+
+bool Tablebases::ProbeWDL(const Position &pos, WDLEnum &ret) const
+{
+    G_D;
+    if(!__can_probe(d, pos))
+        return false;
+
+    int state = LookupOk;
+    int wdl = __resolve(d, pos, false, state);
+    if(LookupFailed == state)
+        return false;
+    ret = (WDLEnum)wdl;
+    return true;
+}
+
+bool Tablebases::ProbeWDL(const Board &b, WDLEnum &ret) const
+{
+    Position pos;
+    return Position::FromBoard(b, pos) && ProbeWDL(pos, ret);
+}
+
+bool Tablebases::ProbeDTZ(const Position &pos, int &ret) const
+{
+    G_D;
+    if(!__can_probe(d, pos))
+        return false;
+
+    int state;
+    int dtz = __dtz(d, pos, state);
+    if(LookupFailed == state)
+        return false;
+    ret = dtz;
+    return true;
+}
+
+bool Tablebases::ProbeDTZ(const Board &b, int &ret) const
+{
+    Position pos;
+    return Position::FromBoard(b, pos) && ProbeDTZ(pos, ret);
+}
+
+bool Tablebases::ProbeMoves(const Position &pos, QVector<MoveResult> &ret) const
+{
+    G_D;
+    ret.clear();
+    if(!__can_probe(d, pos))
+        return false;
+
+    geometry_t const &t = __geometry();
+    move_t moves[MAX_MOVES];
+    int const count = __generate(t, pos, moves);
+    for(int i = 0; i < count; ++i)
+    {
+        position_t child(pos);
+        __make(child, moves[i]);
+
+        int state = LookupOk;
+        int const wdl = -__resolve(d, child, false, state);
+        if(LookupFailed == state)
+            return false;
+
+        // After a zeroing move the DTZ only depends on the result, otherwise it's one
+        //  more than the opponent's.  Mating is as good as zeroing.
+        int dtz;
+        if(0 == child.HalfMoveClock)
+            dtz = __zeroing_dtz(wdl);
+        else if(__is_mate(child))
+            dtz = 1;
+        else{
+            dtz = -__dtz(d, child, state);
+            if(LookupFailed == state)
+                return false;
+            dtz += __sign(dtz);
+        }
+
+        MoveResult mr;
+        mr.Source = moves[i].From;
+        mr.Dest = moves[i].To;
+        mr.PromotedType = moves[i].PromotedType;
+        mr.WDL = (WDLEnum)wdl;
+        mr.DTZ = dtz;
+        ret.append(mr);
+    }
+    return true;
+}
+
+// Higher is better: wins we can get before the fifty move rule, fastest first, then the
+//  ones we can't, then draws, then the losses the fifty move rule saves us from, and
+//  then the slowest losses
+static int __rank(int dtz, int halfmove_clock)
+{
+    if(0 < dtz)
+        return dtz + halfmove_clock <= 99 ? 3000 - dtz : 2000 - qMin(dtz, 999);
+    if(dtz < 0)
+        return 100 < -dtz + halfmove_clock ? -1000 - qMax(dtz, -999) : -2000 - qMax(dtz, -999);
+    return 0;
+}
+
+QVector<Tablebases::MoveResult> Tablebases::BestMoves(const Position &pos, const QVector<MoveResult> &moves)
+{
+    QVector<MoveResult> ret;
+    int best = INT_MIN;
+    for(MoveResult const &m : moves){
+        int const rank = __rank(m.DTZ, pos.HalfMoveClock);
+        if(best < rank){
+            best = rank;
+            ret.clear();
+        }
+        if(best == rank)
+            ret.append(m);
+    }
+    return ret;
+}
+
+QString Tablebases::ToString(WDLEnum wdl, int dtz)
+{
+    QString ret;
+    switch(wdl)
+    {
+    case Win:           ret = "Win"; break;
+    case CursedWin:     ret = "Cursed win"; break;
+    case Draw:          ret = "Draw"; break;
+    case BlessedLoss:   ret = "Blessed loss"; break;
+    case Loss:          ret = "Loss"; break;
+    }
+    if(0 != dtz)
+        ret.append(QString(", %1 plies to zero").arg(abs(dtz)));
+    return ret;
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,165 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_TABLEBASES_H
+#define GKCHESS_TABLEBASES_H
+
+#include <gkchess_common.h>
+#include <QString>
+#include <QVector>
+
+NAMESPACE_GKCHESS;
+
+class Board;
+
+
+/** Probes Syzygy endgame tablebases from local files.
+ *
+ *  The win/draw/loss tables (.rtbw) tell you the result of a position with perfect
+ *  play, and the distance to zero tables (.rtbz) tell you how many plies it takes to
+ *  get to the next capture or pawn move, which is what you need to win it under the
+ *  fifty move rule.  The files are memory-mapped the first time a table is probed, so
+ *  opening a directory with thousands of them is quick, and the operating system
+ *  shares and pages in the data.
+ *
+ *  Probing is reentrant: once the tablebases are opened, any number of threads can
+ *  probe at once.  Don't open or close them while somebody is probing.
+ *
+ *  Positions with castling rights are never in the tablebases.
+*/
+class Tablebases
+{
+public:
+
+    /** The result with perfect play, from the point of view of the side to move.  A
+     *  cursed win would be a win if it weren't for the fifty move rule, and a blessed
+     *  loss is the other side of it.
+    */
+    enum WDLEnum
+    {
+        Loss = -2,
+        BlessedLoss = -1,
+        Draw = 0,
+        CursedWin = 1,
+        Win = 2
+    };
+
+    /** A position, in the form we probe.  The squares are 8 * row + col, and the
+     *  colors and piece types are the same as in Piece.
+    */
+    struct Position
+    {
+        /** The squares of the pieces of each color and type, one bit per square. */
+        GUINT64 Pieces[2][6];
+
+        /** The color to move. */
+        int Turn;
+
+        /** The square a pawn can capture en passant, or -1. */
+        int EnPassant;
+
+        int HalfMoveClock;
+
+        Position();
+
+        /** Returns false if the board can't be probed: it's not 8x8 or it has castling
+         *  rights.
+        */
+        static bool FromBoard(const Board &, Position &);
+    };
+
+    /** The result of one move from the position you probed. */
+    struct MoveResult
+    {
+        int Source;
+        int Dest;
+
+        /** The piece type a pawn promotes to, or -1. */
+        int PromotedType;
+
+        /** The result of the move, from the point of view of the side that makes it. */
+        WDLEnum WDL;
+
+        /** The distance to zero after the move, counting the move, in plies.  It's
+         *  positive if the move wins, negative if it loses and 0 if it draws.
+        */
+        int DTZ;
+    };
+
+
+    Tablebases();
+    ~Tablebases();
+
+    /** Finds the tables in the directories, which are separated like in the PATH
+     *  environment variable.  Any tables that were open are closed first.
+     *  \returns The number of win/draw/loss tables found
+    */
+    int Open(const QString &paths);
+
+    /** Forgets all the tables. */
+    void Close();
+
+    /** Returns the directories the tables came from. */
+    QString GetPaths() const;
+
+    /** The most pieces, kings included, of any table we have.  Positions with more
+     *  pieces can't be probed.  It's 0 if no tables are open.
+    */
+    int GetMaxPieces() const;
+
+    /** Finds the result of the position with perfect play, assuming the halfmove clock
+     *  is 0.  Returns false if we don't have the tables for the position, or one it can
+     *  capture into.
+    */
+    bool ProbeWDL(const Position &, WDLEnum &) const;
+    bool ProbeWDL(const Board &, WDLEnum &) const;
+
+    /** Finds the distance to zero of the position in plies: how long it takes the
+     *  winning side to capture or move a pawn and keep the win.  Positive if the side to
+     *  move wins and negative if it loses, and 0 for a draw.  Its size may be off by one
+     *  ply, but a win never turns into a draw because of that.
+     *
+     *  Returns false if we don't have the tables for the position.
+    */
+    bool ProbeDTZ(const Position &, int &) const;
+    bool ProbeDTZ(const Board &, int &) const;
+
+    /** Finds the result of every legal move, for choosing a move at the root of a
+     *  search.  Returns false if we don't have the tables for all of them.
+    */
+    bool ProbeMoves(const Position &, QVector<MoveResult> &) const;
+
+    /** Picks the moves that keep the best result we can get, taking the fifty move rule
+     *  into account with the halfmove clock: the fastest wins, or the draws, or the
+     *  slowest losses.
+    */
+    static QVector<MoveResult> BestMoves(const Position &, const QVector<MoveResult> &);
+
+    /** Returns a short description of the result, like "Win, 12 plies to zero". */
+    static QString ToString(WDLEnum, int dtz = 0);
+
+
+private:
+
+    void *d;
+
+    Tablebases(const Tablebases &);
+    Tablebases &operator = (const Tablebases &);
+
+};
+
+
+END_NAMESPACE_GKCHESS;
+
+#endif // GKCHESS_TABLEBASES_H
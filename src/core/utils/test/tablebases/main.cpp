@@ -0,0 +1,168 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "gutil_console.h"
+#include "gutil_consolelogger.h"
+#include "gutil_strings.h"
+#include "gkchess_board.h"
+#include "gkchess_tablebases.h"
+#include <QFile>
+#include <QTextStream>
+#include <cstdlib>
+#include <cstring>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+
+static String __square(int sq)
+{
+    return String::Format("%c%c", 'a' + (sq & 7), '1' + (sq >> 3));
+}
+
+static void _probe(const Tablebases &tb, const String &fen)
+{
+    Board b;
+    b.FromFEN(fen);
+    Console::WriteLine(String::Format("\n%s", fen.ConstData()));
+
+    Tablebases::Position pos;
+    if(!Tablebases::Position::FromBoard(b, pos)){
+        Console::WriteLine("Positions with castling rights aren't in the tablebases");
+        return;
+    }
+
+    Tablebases::WDLEnum wdl;
+    int dtz;
+    if(!tb.ProbeWDL(pos, wdl) || !tb.ProbeDTZ(pos, dtz)){
+        Console::WriteLine("Not in the tablebases");
+        return;
+    }
+    Console::WriteLine(String::Format("WDL %d, DTZ %d: %s", (int)wdl, dtz,
+                                      Tablebases::ToString(wdl, dtz).toUtf8().constData()));
+
+    // Show every move, and mark the ones we'd play
+    QVector<Tablebases::MoveResult> moves;
+    if(!tb.ProbeMoves(pos, moves)){
+        Console::WriteLine("Some of the moves aren't in the tablebases");
+        return;
+    }
+    QVector<Tablebases::MoveResult> best = Tablebases::BestMoves(pos, moves);
+    for(Tablebases::MoveResult const &m : moves)
+    {
+        bool is_best = false;
+        for(Tablebases::MoveResult const &bm : best)
+            is_best = is_best || (bm.Source == m.Source && bm.Dest == m.Dest && bm.PromotedType == m.PromotedType);
+
+        Console::WriteLine(String::Format("%s %s%s%s\tWDL %2d\tDTZ %4d",
+                                          is_best ? "*" : " ",
+                                          __square(m.Source).ConstData(),
+                                          __square(m.Dest).ConstData(),
+                                          -1 == m.PromotedType ? "" : String::Format("%c", "kqrbnp"[m.PromotedType]).ConstData(),
+                                          (int)m.WDL, m.DTZ));
+    }
+}
+
+// Checks one line of the file of known results, which looks like "<FEN> ; <WDL> ; <DTZ>".
+//  Returns false if the tablebases don't give that result.
+static bool _check(const Tablebases &tb, const QString &line)
+{
+    QStringList const fields = line.split(';');
+    if(3 != fields.length())
+        throw Exception<>(QString("Bad line: %1").arg(line).toUtf8().constData());
+
+    QString const fen = fields[0].trimmed();
+    int const expected_wdl = fields[1].trimmed().toInt();
+    int const expected_dtz = fields[2].trimmed().toInt();
+
+    Board b;
+    b.FromFEN(fen.toUtf8().constData());
+
+    Tablebases::Position pos;
+    Tablebases::WDLEnum wdl;
+    int dtz;
+    QVector<Tablebases::MoveResult> moves;
+    if(!Tablebases::Position::FromBoard(b, pos) ||
+            !tb.ProbeWDL(pos, wdl) || !tb.ProbeDTZ(pos, dtz) || !tb.ProbeMoves(pos, moves)){
+        Console::WriteLine(String::Format("FAIL %s: not in the tablebases", fen.toUtf8().constData()));
+        return false;
+    }
+
+    // The files may keep distances in moves rather than plies, so the distance to zero
+    //  can be off by a ply
+    bool ok = expected_wdl == (int)wdl &&
+            (0 < expected_dtz) == (0 < dtz) && (expected_dtz < 0) == (dtz < 0) &&
+            abs(expected_dtz - dtz) <= 1;
+
+    // The best move has to keep the result
+    QVector<Tablebases::MoveResult> const best = Tablebases::BestMoves(pos, moves);
+    if(!best.isEmpty() && best[0].WDL != wdl)
+        ok = false;
+
+    Console::WriteLine(String::Format("%s %s: WDL %d, DTZ %d, expected WDL %d, DTZ %d",
+                                      ok ? "ok  " : "FAIL",
+                                      fen.toUtf8().constData(),
+                                      (int)wdl, dtz, expected_wdl, expected_dtz));
+    return ok;
+}
+
+// Checks every position in the file against the tablebases, and returns how many failed
+static int _check_file(const Tablebases &tb, const QString &filename)
+{
+    QFile f(filename);
+    if(!f.open(QFile::ReadOnly))
+        throw Exception<>(QString("Unable to open %1: %2").arg(filename).arg(f.errorString()).toUtf8().constData());
+
+    int failed = 0, total = 0;
+    QTextStream ts(&f);
+    while(!ts.atEnd())
+    {
+        QString const line = ts.readLine().trimmed();
+        if(line.isEmpty() || line.startsWith('#'))
+            continue;
+        ++total;
+        if(!_check(tb, line))
+            ++failed;
+    }
+    Console::WriteLine(String::Format("\n%d of %d positions failed", failed, total));
+    return failed;
+}
+
+int main(int argc, char *argv[])
+{
+    bool const check = 1 < argc && 0 == strcmp(argv[1], "--check");
+    if(check ? argc != 4 : argc < 3){
+        Console::WriteLine("Usage: tablebases <directories> <FEN>...");
+        Console::WriteLine("       tablebases --check <directories> <file of known results>");
+        return -1;
+    }
+
+    try
+    {
+        Tablebases tb;
+        int count = tb.Open(argv[check ? 2 : 1]);
+        Console::WriteLine(String::Format("Found %d tables with up to %d pieces", count, tb.GetMaxPieces()));
+
+        if(check)
+            return 0 == _check_file(tb, argv[3]) ? 0 : 1;
+
+        for(int i = 2; i < argc; ++i)
+            _probe(tb, argv[i]);
+    }
+    catch(const Exception<> &ex)
+    {
+        ConsoleLogger().LogException(ex);
+        return -1;
+    }
+
+    return 0;
+}
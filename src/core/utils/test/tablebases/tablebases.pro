@@ -0,0 +1,27 @@
+#-------------------------------------------------
+#
+# Probes Syzygy tablebases from the command line
+#
+#-------------------------------------------------
+
+TOP_DIR = ../../../../..
+
+INCLUDEPATH += $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/gutil/lib \
+    -L$$TOP_DIR/lib \
+    -lGUtil \
+    -lGKChess
+
+QT       += core
+
+QT       -= gui
+
+TARGET = tablebases
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp
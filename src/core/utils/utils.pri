@@ -2,9 +2,23 @@
 HEADERS += \
     utils/chess960.h \
     utils/pgn_parser.h \
-    utils/enginesettings.h
+    utils/enginesettings.h \
+    utils/bookreadercache.h \
+    utils/bookmoveselector.h \
+    utils/matchstatistics.h \
+    utils/zobrist.h \
+    utils/analysiscache.h \
+    utils/tablebases.h \
+    utils/searchinfomerger.h
     
 SOURCES += \
     utils/chess960.cpp \
     utils/pgn_parser.cpp \
-    utils/enginesettings.cpp
\ No newline at end of file
+    utils/enginesettings.cpp \
+    utils/bookreadercache.cpp \
+    utils/bookmoveselector.cpp \
+    utils/matchstatistics.cpp \
+    utils/zobrist.cpp \
+    utils/analysiscache.cpp \
+    utils/tablebases.cpp \
+    utils/searchinfomerger.cpp
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "zobrist.h"
+#include "gkchess_board.h"
+#include <gutil/exception.h>
+USING_NAMESPACE_GUTIL;
+
+/** The seed for the random keys.  Don't change it or the saved hashes become invalid. */
+#define ZOBRIST_SEED 0x9E3779B97F4A7C15ULL
+
+namespace{
+
+struct keys_t
+{
+    GUINT64 Keys[GKChess::Zobrist::KeyCount];
+
+    keys_t(){
+        // splitmix64, which is good enough for hashing and trivial to reproduce
+        GUINT64 state = ZOBRIST_SEED;
+        for(int i = 0; i < GKChess::Zobrist::KeyCount; ++i){
+            GUINT64 z = (state += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            Keys[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+}
+
+static keys_t const &__keys()
+{
+    static keys_t keys;
+    return keys;
+}
+
+NAMESPACE_GKCHESS;
+
+
+// True if the side to move has a pawn next to the one that just moved two squares, so it
+//  might capture en passant.  Otherwise the en passant square doesn't change anything,
+//  and the position should hash the same as it would without it.
+static bool __can_capture_en_passant(const Board &b, const Square &ep)
+{
+    Piece::AllegienceEnum const turn = b.GetWhoseTurn();
+    int const r = ep.GetRow() + (Piece::White == turn ? -1 : 1);
+    if(0 > r || r >= b.RowCount())
+        return false;
+    for(int c = ep.GetColumn() - 1; c <= ep.GetColumn() + 1; c += 2){
+        if(0 > c || c >= b.ColumnCount())
+            continue;
+        Piece const &p = b.SquareAt(c, r).GetPiece();
+        if(!p.IsNull() && Piece::Pawn == p.GetType() && turn == p.GetAllegience())
+            return true;
+    }
+    return false;
+}
+
+GUINT64 Zobrist::Hash(const Board &b)
+{
+    if(8 < b.ColumnCount() || 8 < b.RowCount())
+        throw Exception<>("Zobrist hashing is only supported on boards up to 8x8");
+
+    GUINT64 const *keys = GetKeys();
+    GUINT64 ret = 0;
+    for(int c = 0; c < b.ColumnCount(); ++c){
+        for(int r = 0; r < b.RowCount(); ++r){
+            Piece const &p = b.SquareAt(c, r).GetPiece();
+            if(p.IsNull())
+                continue;
+            int kind = 6 * p.GetAllegience() + p.GetType();
+            ret ^= keys[PieceKeys + 64 * kind + 8 * r + c];
+        }
+    }
+
+    if(Piece::Black == b.GetWhoseTurn())
+        ret ^= keys[TurnKey];
+
+    int const castles[] = { b.GetCastleWhiteA(), b.GetCastleWhiteH(),
+                            b.GetCastleBlackA(), b.GetCastleBlackH() };
+    for(int i = 0; i < 4; ++i){
+        if(-1 != castles[i])
+            ret ^= keys[CastleKeys + 8 * i + castles[i]];
+    }
+
+    Square const *ep = b.GetEnPassantSquare();
+    if(ep && __can_capture_en_passant(b, *ep))
+        ret ^= keys[EnPassantKeys + ep->GetColumn()];
+    return ret;
+}
+
+GUINT64 Zobrist::PawnHash(const Board &b)
+{
+    if(8 < b.ColumnCount() || 8 < b.RowCount())
+        throw Exception<>("Zobrist hashing is only supported on boards up to 8x8");
+
+    GUINT64 const *keys = GetKeys();
+    GUINT64 ret = 0;
+    for(int c = 0; c < b.ColumnCount(); ++c){
+        for(int r = 0; r < b.RowCount(); ++r){
+            Piece const &p = b.SquareAt(c, r).GetPiece();
+            if(p.IsNull() || Piece::Pawn != p.GetType())
+                continue;
+            int kind = 6 * p.GetAllegience() + p.GetType();
+            ret ^= keys[PieceKeys + 64 * kind + 8 * r + c];
+        }
+    }
+    return ret;
+}
+
+GUINT64 const *Zobrist::GetKeys()
+{
+    return __keys().Keys;
+}
+
+
+END_NAMESPACE_GKCHESS;
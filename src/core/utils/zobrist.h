@@ -0,0 +1,70 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_ZOBRIST_H
+#define GKCHESS_ZOBRIST_H
+
+#include <gkchess_common.h>
+
+NAMESPACE_GKCHESS;
+
+class Board;
+
+
+/** Static class that computes Zobrist hashes of board positions.
+ *
+ *  The random keys come from a fixed seed, so a position hashes to the same value
+ *  from run to run and the hashes can be saved to disk.  The hash covers the pieces,
+ *  whose turn it is, the castling columns (so Chess960 works) and the en passant
+ *  square, but not the move clocks.  The en passant square only counts if a pawn of
+ *  the side to move is next to the pawn that moved, the same as in the native engine.
+*/
+class Zobrist
+{
+public:
+
+    /** Returns the hash of the position.  Only boards up to 8x8 are supported. */
+    static GUINT64 Hash(const Board &);
+
+    /** Returns the hash of just the pawns, made from the same keys as Hash().  Positions
+     *  with the same pawns have the same pawn structure, so you can use it to cache
+     *  anything that only depends on the pawns.
+    */
+    static GUINT64 PawnHash(const Board &);
+
+    /** The layout of the table of keys: 12 piece kinds by 64 squares, then the side to
+     *  move, 4 castling rights by 8 columns and 8 en passant columns.  The piece kind is
+     *  6 * allegience + type and the square is 8 * row + col.  The castling rights are
+     *  white's A and H sides, then black's.
+    */
+    enum KeyLayoutEnum
+    {
+        PieceKeys = 0,
+        TurnKey = PieceKeys + 12 * 64,
+        CastleKeys = TurnKey + 1,
+        EnPassantKeys = CastleKeys + 4 * 8,
+        KeyCount = EnPassantKeys + 8
+    };
+
+    /** Returns the table of keys, so you can keep a hash up to date as the pieces move
+     *  instead of computing it from scratch.
+    */
+    static GUINT64 const *GetKeys();
+
+};
+
+
+END_NAMESPACE_GKCHESS;
+
+#endif // GKCHESS_ZOBRIST_H
@@ -16,9 +16,14 @@ limitations under the License.*/
 #include <gutil/macros.h>
 
 #include "pg_utils/pg_utils.h"
+#include <QFileInfo>
+#include <QMutex>
 #include <QtPlugin>
 USING_NAMESPACE_GUTIL;
 
+/** By default only books bigger than this get a key index. */
+#define DEFAULT_INDEX_THRESHOLD (16 * 1024 * 1024)
+
 
 namespace{
 
@@ -26,8 +31,19 @@ struct d_t
 {
     void *file;
     String filename;
-
-    d_t() :file(0){}
+    GKChess::PolyglotBookReader::AccessModeEnum access_mode;
+    GKChess::PolyglotBookReader::AccessModeEnum open_access_mode;
+    GUINT64 index_threshold;
+
+    // Streamed lookups share the file position, so they have to take turns
+    QMutex stream_lock;
+
+    d_t()
+        :file(0),
+          access_mode(GKChess::PolyglotBookReader::MemoryMappedAccess),
+          open_access_mode(GKChess::PolyglotBookReader::StreamedAccess),
+          index_threshold(DEFAULT_INDEX_THRESHOLD)
+    {}
 };
 
 }
@@ -54,38 +70,68 @@ void PolyglotBookReader::OpenBook(const char *b)
     if(d->file)
         CloseBook();
 
-    if(!(d->file = pg_open_file(b, 0)))
+    d->open_access_mode = d->access_mode;
+    if(MemoryMappedAccess == d->access_mode)
+    {
+        int mode = PG_OPEN_MMAP;
+        if(0 < d->index_threshold && d->index_threshold <= (GUINT64)QFileInfo(b).size())
+            mode |= PG_OPEN_INDEX;
+
+        // If we can't map the file we still try to stream it below
+        if(!(d->file = pg_open_file(b, mode)))
+            d->open_access_mode = StreamedAccess;
+    }
+
+    if(!d->file && !(d->file = pg_open_file(b, 0)))
         throw Exception<>(String::Format("Unable to open file: %s\n%s", b, pg_error_string()));
 
     d->filename = b;
 }
 
-bool PolyglotBookReader::IsBookOpen() const
+void PolyglotBookReader::SetAccessMode(AccessModeEnum m)
 {
     G_D;
-    return d->file;
+    d->access_mode = m;
 }
 
-static IBookReader::IValidationProgressObserver *__validation_observer(0);
+PolyglotBookReader::AccessModeEnum PolyglotBookReader::GetAccessMode() const
+{
+    G_D;
+    return d->file ? d->open_access_mode : d->access_mode;
+}
 
-static void __validation_progress_cb(int p)
+void PolyglotBookReader::SetIndexThreshold(GUINT64 bytes)
 {
-    if(__validation_observer)
-        __validation_observer->OnValidationProgressUpdate(p);
+    G_D;
+    d->index_threshold = bytes;
 }
 
-void PolyglotBookReader::ValidateBook(IValidationProgressObserver *ob)
+bool PolyglotBookReader::IsBookOpen() const
 {
     G_D;
-    GASSERT(0 == __validation_observer);
+    return d->file;
+}
 
-    __validation_observer = ob;
-    int res = pg_validate_file(d->file, &__validation_progress_cb);
-    __validation_observer = 0;
+static void __validation_progress_cb(int p, void *observer)
+{
+    static_cast<IBookReader::IValidationProgressObserver *>(observer)->OnValidationProgressUpdate(p);
+}
+
+IBookReader::ValidationSummary PolyglotBookReader::ValidateBook(IValidationProgressObserver *ob)
+{
+    G_D;
+    pg_validation_report_t report;
+    int res = pg_validate_file(d->file, ob ? &__validation_progress_cb : 0, ob, &report);
 
     if(0 != res){
-        throw Exception<>(String::Format("Invalid Polyglot book: %s", pg_error_string()));
+        throw Exception<>(String::Format("Invalid Polyglot book: %s", pg_file_error_string(d->file)));
     }
+
+    ValidationSummary ret;
+    ret.EntryCount = report.entry_count;
+    ret.DuplicateMoves = report.duplicate_count;
+    ret.ZeroWeightMoves = report.zero_weight_count;
+    return ret;
 }
 
 const char *PolyglotBookReader::GetBookFilename() const
@@ -106,7 +152,24 @@ void PolyglotBookReader::CloseBook()
 }
 
 
-#define MAX_MOVES 50
+static void __append_moves(QList<BookMove> &l, pg_move_t const *moves, unsigned int len)
+{
+    // The book numbers the promoted pieces, but a generic move names them with a letter
+    static char const promoted[] = { 0, 'n', 'b', 'r', 'q', 0, 0, 0 };
+    for(unsigned int i = 0; i < len; ++i)
+    {
+        l.append(BookMove(moves[i].weight, moves[i].learn,
+                          GenericMove(moves[i].source_col, moves[i].source_row,
+                                      moves[i].dest_col, moves[i].dest_row,
+                                      promoted[0x7 & moves[i].promoted_piece]),
+                          moves[i].raw_weight));
+    }
+}
+
+GUINT64 PolyglotBookReader::ComputeKey(const char *fen) const
+{
+    return pg_compute_key(fen);
+}
 
 QList<BookMove> PolyglotBookReader::LookupMoves(const char *fen)
 {
@@ -114,16 +177,34 @@ QList<BookMove> PolyglotBookReader::LookupMoves(const char *fen)
     QList<BookMove> ret;
     if(d->file)
     {
-        pg_move_t moves[MAX_MOVES];
-        unsigned int len = pg_lookup_moves(d->file, pg_compute_key(fen), moves, MAX_MOVES);
-
-        for(unsigned int i = 0; i < len; ++i)
-        {
-            ret.append(BookMove(moves[i].weight, moves[i].learn,
-                                  GenericMove(moves[i].source_col, moves[i].source_row,
-                                              moves[i].dest_col, moves[i].dest_row,
-                                              moves[i].promoted_piece)));
-        }
+        // Memory-mapped books can be searched from any number of threads at once
+        QMutexLocker lkr(MemoryMappedAccess == d->open_access_mode ? 0 : &d->stream_lock);
+
+        unsigned int len;
+        pg_move_t *moves = pg_lookup_all_moves(d->file, pg_compute_key(fen), &len);
+        if(!moves && pg_error_string())
+            throw Exception<>(String::Format("Lookup failed: %s", pg_error_string()));
+        __append_moves(ret, moves, len);
+        pg_cleanup_moves(moves);
+    }
+    return ret;
+}
+
+static void __batch_moves_found(unsigned int key_index, pg_move_t const *moves, unsigned int len, void *results)
+{
+    __append_moves((*static_cast<QVector<QList<BookMove> > *>(results))[key_index], moves, len);
+}
+
+QVector<QList<BookMove> > PolyglotBookReader::LookupMovesBatch(const QVector<GUINT64> &keys)
+{
+    G_D;
+    QVector<QList<BookMove> > ret(keys.size());
+    if(d->file && 0 < keys.size())
+    {
+        QMutexLocker lkr(MemoryMappedAccess == d->open_access_mode ? 0 : &d->stream_lock);
+
+        if(0 != pg_lookup_moves_batch(d->file, reinterpret_cast<uint64 const *>(keys.constData()), keys.size(), &__batch_moves_found, &ret))
+            throw Exception<>(String::Format("Batch lookup failed: %s", pg_error_string()));
     }
     return ret;
 }
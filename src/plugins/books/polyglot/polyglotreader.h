@@ -33,17 +33,44 @@ class PolyglotBookReader :
     void *d;
 public:
 
+    /** Describes how the book file is accessed. */
+    enum AccessModeEnum
+    {
+        /** Every lookup seeks and reads through the file system. */
+        StreamedAccess,
+
+        /** The whole book is mapped into memory and searched directly, so lookups
+         *  make no system calls.  This is the default.
+        */
+        MemoryMappedAccess
+    };
+
     PolyglotBookReader(QObject * = 0);
     ~PolyglotBookReader();
 
+    /** Sets the access mode that will be used the next time a book is opened.
+     *  If a book cannot be memory mapped we fall back to streamed access.
+    */
+    void SetAccessMode(AccessModeEnum);
+
+    /** Returns the access mode of the open book, or the one that will be used
+     *  for the next book if none is open.
+    */
+    AccessModeEnum GetAccessMode() const;
+
+    /** Memory-mapped books of at least this many bytes get a sparse key index
+     *  (one key per 4KB page) built when they are opened.  Pass 0 to never build it.
+    */
+    void SetIndexThreshold(GUINT64 bytes);
+
     void OpenBook(const char *);
     bool IsBookOpen() const;
     const char *GetBookFilename() const;
     void CloseBook();
+    GUINT64 ComputeKey(const char *fen) const;
     QList<BookMove> LookupMoves(const char *fen);
-
-    /** \note You can only observe the progress for one validation globally at a time. */
-    void ValidateBook(IValidationProgressObserver *);
+    QVector<QList<BookMove> > LookupMovesBatch(const QVector<GUINT64> &keys);
+    ValidationSummary ValidateBook(IValidationProgressObserver *);
 
 };
 
@@ -2,6 +2,8 @@
 TEMPLATE = subdirs
 
 SUBDIRS += \
-    uci
+    uci \
+    native \
+    mock_uci_engine
 
 CONFIG += ordered
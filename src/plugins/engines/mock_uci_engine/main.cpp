@@ -0,0 +1,296 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+/** A mock UCI engine.  It doesn't look at the position, it answers every search with
+ *  the same info lines and best move, so the output is the same on every run.
+ *
+ *  Usage: mock_uci_engine [options]
+ *    --info-count N    The number of info lines in every search (default: 10)
+ *    --info-rate N     The info lines per second, or 0 for as fast as possible (default: 0)
+ *    --bestmove M      The best move (default: e2e4)
+ *    --ponder M        The ponder move, or "none" (default: e7e5)
+ *    --crash-after N   Exit abruptly in the middle of the search after N searches
+ *    --script FILE     Print the lines of this file for every search, instead of the
+ *                       generated info lines.  A "bestmove" line in it ends the search.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+namespace{
+
+struct settings_t
+{
+    int info_count = 10;
+    int info_rate = 0;
+    string bestmove = "e2e4";
+    string ponder = "e7e5";
+    int crash_after = -1;
+    vector<string> script;
+};
+
+struct search_t
+{
+    int movetime = 0;
+    bool infinite = false;
+    bool ponder = false;
+};
+
+settings_t settings;
+int search_count = 0;
+
+mutex output_lock;
+
+// Protects the search state below
+mutex search_lock;
+condition_variable search_changed;
+bool searching = false;
+bool stop_requested = false;
+bool ponderhit = false;
+thread search_thread;
+
+}
+
+
+static void __write(const string &line)
+{
+    lock_guard<mutex> l(output_lock);
+    fwrite(line.data(), 1, line.size(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+static string __info_line(int i)
+{
+    // Everything the client parses, so it gets a realistic load
+    int depth = i + 1;
+    ostringstream ss;
+    ss << "info depth " << depth
+       << " seldepth " << depth + 2
+       << " multipv 1"
+       << " score cp " << (depth * 7) % 50 - 20
+       << " nodes " << depth * 1000
+       << " nps 1000000"
+       << " hashfull " << depth % 1000
+       << " tbhits 0"
+       << " time " << depth
+       << " pv e2e4 e7e5 g1f3 b8c6 f1b5 a7a6";
+    return ss.str();
+}
+
+static string __bestmove_line()
+{
+    string ret = "bestmove " + settings.bestmove;
+    if(settings.ponder != "none")
+        ret += " ponder " + settings.ponder;
+    return ret;
+}
+
+static bool __stopped()
+{
+    lock_guard<mutex> l(search_lock);
+    return stop_requested;
+}
+
+static void __search(search_t s)
+{
+    Clock::time_point start = Clock::now();
+    ++search_count;
+
+    string bestmove = __bestmove_line();
+    int count = settings.script.empty() ? settings.info_count : (int)settings.script.size();
+    bool crash = 0 <= settings.crash_after && settings.crash_after < search_count;
+    for(int i = 0; i < count && !__stopped(); ++i)
+    {
+        if(crash && i == count / 2)
+        {
+            // Die without a word, like a real engine that segfaults
+            fflush(stdout);
+            _Exit(3);
+        }
+
+        if(settings.script.empty())
+            __write(__info_line(i));
+        else if(0 == settings.script[i].compare(0, 8, "bestmove"))
+        {
+            bestmove = settings.script[i];
+            break;
+        }
+        else
+            __write(settings.script[i]);
+
+        if(0 < settings.info_rate)
+            this_thread::sleep_until(start + chrono::microseconds((i + 1) * 1000000LL / settings.info_rate));
+    }
+    if(crash)
+        _Exit(3);
+
+    // Infinite and pondering searches only end when we're told, otherwise we use the movetime
+    {
+        unique_lock<mutex> l(search_lock);
+        Clock::time_point deadline = start + chrono::milliseconds(s.movetime);
+        while(!stop_requested)
+        {
+            if(s.infinite || (s.ponder && !ponderhit))
+                search_changed.wait(l);
+            else if(Clock::now() < deadline)
+                search_changed.wait_until(l, deadline);
+            else
+                break;
+        }
+        searching = false;
+    }
+    __write(bestmove);
+}
+
+static void __stop_search()
+{
+    if(!search_thread.joinable())
+        return;
+    {
+        lock_guard<mutex> l(search_lock);
+        stop_requested = true;
+    }
+    search_changed.notify_all();
+    search_thread.join();
+}
+
+static void __go(istringstream &args)
+{
+    // Like a real engine, we ignore "go" while we're already searching
+    {
+        lock_guard<mutex> l(search_lock);
+        if(searching)
+            return;
+    }
+    __stop_search();
+
+    search_t s;
+    string token;
+    while(args >> token)
+    {
+        if(token == "movetime")
+            args >> s.movetime;
+        else if(token == "infinite")
+            s.infinite = true;
+        else if(token == "ponder")
+            s.ponder = true;
+    }
+
+    searching = true;
+    stop_requested = false;
+    ponderhit = false;
+    search_thread = thread(__search, s);
+}
+
+static bool __parse_args(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if(i + 1 == argc)
+            return false;
+
+        const char *val = argv[++i];
+        if(arg == "--info-count")
+            settings.info_count = atoi(val);
+        else if(arg == "--info-rate")
+            settings.info_rate = atoi(val);
+        else if(arg == "--bestmove")
+            settings.bestmove = val;
+        else if(arg == "--ponder")
+            settings.ponder = val;
+        else if(arg == "--crash-after")
+            settings.crash_after = atoi(val);
+        else if(arg == "--script")
+        {
+            ifstream f(val);
+            if(!f)
+                return false;
+
+            string line;
+            while(getline(f, line))
+                if(!line.empty())
+                    settings.script.push_back(line);
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if(!__parse_args(argc, argv))
+    {
+        fprintf(stderr, "Usage: %s [--info-count N] [--info-rate N] [--bestmove M] [--ponder M]"
+                        " [--crash-after N] [--script FILE]\n", argv[0]);
+        return 1;
+    }
+
+    string line;
+    while(getline(cin, line))
+    {
+        istringstream ss(line);
+        string cmd;
+        ss >> cmd;
+
+        if(cmd == "uci")
+        {
+            __write("id name Mock UCI Engine");
+            __write("id author George Karagoulis");
+            __write("option name Hash type spin default 16 min 1 max 1024");
+            __write("option name Threads type spin default 1 min 1 max 64");
+            __write("option name Ponder type check default false");
+            __write("option name Clear Hash type button");
+            __write("uciok");
+        }
+        else if(cmd == "isready")
+            __write("readyok");
+        else if(cmd == "go")
+            __go(ss);
+        else if(cmd == "stop")
+            __stop_search();
+        else if(cmd == "ponderhit")
+        {
+            {
+                lock_guard<mutex> l(search_lock);
+                ponderhit = true;
+            }
+            search_changed.notify_all();
+        }
+        else if(cmd == "quit")
+            break;
+
+        // We don't look at the position or options, so everything else is ignored
+    }
+
+    __stop_search();
+    return 0;
+}
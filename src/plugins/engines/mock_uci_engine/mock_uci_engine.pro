@@ -0,0 +1,27 @@
+
+# A tiny deterministic UCI engine that we use to test and benchmark the UCI client.
+#  It doesn't play chess, it just answers the protocol with scripted output.
+
+QT       -= core gui
+CONFIG   -= qt
+
+TARGET = mock_uci_engine
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+TOP_DIR = ../../../..
+
+DESTDIR = $$TOP_DIR/bin
+QMAKE_CXXFLAGS += -std=c++11
+LIBS += -lpthread
+
+CONFIG(debug, debug|release) {
+    #message(Preparing debug build)
+    DEFINES += DEBUG
+}
+else {
+    #message(Preparing release build)
+}
+
+SOURCES += main.cpp
@@ -0,0 +1,89 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "bitboard.h"
+#include <cstring>
+#include <cstdlib>
+
+NAMESPACE_GKCHESS1(Native);
+
+
+Attacks::tables_t const Attacks::m_tables;
+
+// Returns the set of squares that are the given steps away from the square and on the board
+static Bitboard __steps(int sq, const int (*steps)[2], int count)
+{
+    Bitboard ret = 0;
+    for(int i = 0; i < count; ++i){
+        int c = Column(sq) + steps[i][0];
+        int r = Row(sq) + steps[i][1];
+        if(0 <= c && c < 8 && 0 <= r && r < 8)
+            ret |= SquareBit(MakeSquare(c, r));
+    }
+    return ret;
+}
+
+Attacks::tables_t::tables_t()
+{
+    static const int knight_steps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2},
+                                           {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    static const int king_steps[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1},
+                                         {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+    static const int white_pawn_steps[2][2] = {{-1, 1}, {1, 1}};
+    static const int black_pawn_steps[2][2] = {{-1, -1}, {1, -1}};
+
+    // In the same order as DirectionEnum
+    static const int directions[DirectionCount][2] = {{0, 1}, {1, 0}, {1, 1}, {-1, 1},
+                                                      {0, -1}, {-1, 0}, {1, -1}, {-1, -1}};
+
+    memset(this, 0, sizeof(tables_t));
+    for(int sq = 0; sq < 64; ++sq)
+    {
+        Knight[sq] = __steps(sq, knight_steps, 8);
+        King[sq] = __steps(sq, king_steps, 8);
+        Pawn[0][sq] = __steps(sq, white_pawn_steps, 2);
+        Pawn[1][sq] = __steps(sq, black_pawn_steps, 2);
+
+        for(int d = 0; d < DirectionCount; ++d)
+        {
+            Bitboard ray = 0;
+            int c = Column(sq) + directions[d][0];
+            int r = Row(sq) + directions[d][1];
+            for(; 0 <= c && c < 8 && 0 <= r && r < 8; c += directions[d][0], r += directions[d][1])
+            {
+                // Everything we passed on the way is between us and this square
+                Between[sq][MakeSquare(c, r)] = ray;
+                ray |= SquareBit(MakeSquare(c, r));
+            }
+            Rays[d][sq] = ray;
+        }
+    }
+
+    for(int c = 0; c < 8; ++c)
+        File[c] = (Bitboard)0x0101010101010101ULL << c;
+    for(int c = 0; c < 8; ++c)
+        AdjacentFiles[c] = (0 < c ? File[c - 1] : 0) | (c < 7 ? File[c + 1] : 0);
+
+    for(int sq = 0; sq < 64; ++sq)
+    {
+        Bitboard files = File[Column(sq)] | AdjacentFiles[Column(sq)];
+        for(int r = Row(sq) + 1; r < 8; ++r)
+            PassedPawn[0][sq] |= files & ((Bitboard)0xFF << (8 * r));
+        for(int r = Row(sq) - 1; 0 <= r; --r)
+            PassedPawn[1][sq] |= files & ((Bitboard)0xFF << (8 * r));
+    }
+}
+
+
+END_NAMESPACE_GKCHESS1;
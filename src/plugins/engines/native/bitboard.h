@@ -0,0 +1,193 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_BITBOARD_H
+#define GKCHESS_NATIVE_BITBOARD_H
+
+#include <gkchess_common.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace GKChess{ namespace Native{
+
+
+/** A set of squares, one bit per square.  Square 0 is a1, 7 is h1 and 63 is h8, so the
+ *  square is 8 * row + col like in the Zobrist table.
+*/
+typedef GUINT64 Bitboard;
+
+inline int Column(int sq){ return sq & 7; }
+inline int Row(int sq){ return sq >> 3; }
+inline int MakeSquare(int col, int row){ return 8 * row + col; }
+inline Bitboard SquareBit(int sq){ return (Bitboard)1 << sq; }
+
+/** Returns the number of squares in the set.  The instruction is only used if the
+ *  build was configured for it (USE_POPCNT), because it's missing on older processors.
+*/
+inline int PopCount(Bitboard b){
+#if defined(_MSC_VER) && defined(USE_POPCNT)
+    return (int)__popcnt64(b);
+#elif defined(_MSC_VER)
+    b = b - ((b >> 1) & 0x5555555555555555ULL);
+    b = (b & 0x3333333333333333ULL) + ((b >> 2) & 0x3333333333333333ULL);
+    b = (b + (b >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((b * 0x0101010101010101ULL) >> 56);
+#else
+    return __builtin_popcountll(b);
+#endif
+}
+
+/** Returns the lowest square in the set, which must not be empty. */
+inline int LowestSquare(Bitboard b){
+#if defined(_MSC_VER)
+    unsigned long ret;
+    _BitScanForward64(&ret, b);
+    return (int)ret;
+#else
+    return __builtin_ctzll(b);
+#endif
+}
+
+/** Returns the highest square in the set, which must not be empty. */
+inline int HighestSquare(Bitboard b){
+#if defined(_MSC_VER)
+    unsigned long ret;
+    _BitScanReverse64(&ret, b);
+    return (int)ret;
+#else
+    return 63 ^ __builtin_clzll(b);
+#endif
+}
+
+/** Removes the lowest square from the set and returns it. */
+inline int PopSquare(Bitboard &b){
+    int ret = LowestSquare(b);
+    b &= b - 1;
+    return ret;
+}
+
+
+/** \name Set-wise operations
+ *  These move or spread all the squares of a set at once, so we can evaluate all the
+ *  pawns together instead of one at a time.  East is towards the H file.
+ *  \{
+*/
+#define FILE_A_BITS 0x0101010101010101ULL
+#define FILE_H_BITS 0x8080808080808080ULL
+
+inline Bitboard ShiftNorth(Bitboard b){ return b << 8; }
+inline Bitboard ShiftSouth(Bitboard b){ return b >> 8; }
+inline Bitboard ShiftEast(Bitboard b){ return (b & ~FILE_H_BITS) << 1; }
+inline Bitboard ShiftWest(Bitboard b){ return (b & ~FILE_A_BITS) >> 1; }
+
+/** Each square and all the squares north (or south) of it. */
+inline Bitboard FillNorth(Bitboard b){ b |= b << 8; b |= b << 16; b |= b << 32; return b; }
+inline Bitboard FillSouth(Bitboard b){ b |= b >> 8; b |= b >> 16; b |= b >> 32; return b; }
+
+/** Every file that has a square in the set. */
+inline Bitboard FillFiles(Bitboard b){ return FillNorth(b) | FillSouth(b); }
+
+/** The squares attacked by the pawns, which are white's if the color is 0. */
+inline Bitboard PawnAttacks(int color, Bitboard pawns){
+    Bitboard b = 0 == color ? ShiftNorth(pawns) : ShiftSouth(pawns);
+    return ShiftEast(b) | ShiftWest(b);
+}
+
+/** \} */
+
+
+/** Precomputed attack sets.  Sliding attacks are found by following the ray in each
+ *  direction to the first blocker, which is one bit scan per direction.
+*/
+class Attacks
+{
+public:
+
+    enum DirectionEnum
+    {
+        North, East, NorthEast, NorthWest,
+        South, West, SouthEast, SouthWest,
+
+        DirectionCount
+    };
+
+    static Bitboard Knight(int sq){ return m_tables.Knight[sq]; }
+    static Bitboard King(int sq){ return m_tables.King[sq]; }
+
+    /** The squares a pawn of the given color attacks from the square. */
+    static Bitboard Pawn(int color, int sq){ return m_tables.Pawn[color][sq]; }
+
+    static Bitboard Bishop(int sq, Bitboard occupied){
+        return _slide(sq, occupied, NorthEast) | _slide(sq, occupied, NorthWest) |
+                _slide(sq, occupied, SouthEast) | _slide(sq, occupied, SouthWest);
+    }
+
+    static Bitboard Rook(int sq, Bitboard occupied){
+        return _slide(sq, occupied, North) | _slide(sq, occupied, East) |
+                _slide(sq, occupied, South) | _slide(sq, occupied, West);
+    }
+
+    static Bitboard Queen(int sq, Bitboard occupied){
+        return Bishop(sq, occupied) | Rook(sq, occupied);
+    }
+
+    /** The squares strictly between the two, if they're on a line, otherwise empty. */
+    static Bitboard Between(int a, int b){ return m_tables.Between[a][b]; }
+
+    /** All the squares of the file, and the files next to it. */
+    static Bitboard File(int col){ return m_tables.File[col]; }
+    static Bitboard AdjacentFiles(int col){ return m_tables.AdjacentFiles[col]; }
+
+    /** The squares in front of the square from the color's point of view, on the same
+     *  file and the files next to it, which is where enemy pawns stop a passed pawn.
+    */
+    static Bitboard PassedPawnMask(int color, int sq){ return m_tables.PassedPawn[color][sq]; }
+
+
+private:
+
+    struct tables_t
+    {
+        Bitboard Knight[64];
+        Bitboard King[64];
+        Bitboard Pawn[2][64];
+        Bitboard Rays[DirectionCount][64];
+        Bitboard Between[64][64];
+        Bitboard File[8];
+        Bitboard AdjacentFiles[8];
+        Bitboard PassedPawn[2][64];
+
+        tables_t();
+    };
+    static tables_t const m_tables;
+
+    static Bitboard _slide(int sq, Bitboard occupied, int dir){
+        Bitboard ray = m_tables.Rays[dir][sq];
+        Bitboard blockers = ray & occupied;
+        if(blockers){
+            // The first four directions go up the board, so their first blocker is the lowest
+            int b = dir < South ? LowestSquare(blockers) : HighestSquare(blockers);
+            ray ^= m_tables.Rays[dir][b];
+        }
+        return ray;
+    }
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_BITBOARD_H
@@ -0,0 +1,169 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "evaluation.h"
+#include "material.h"
+
+NAMESPACE_GKCHESS1(Native);
+
+
+int const Evaluation::m_pieceValues[PieceTypeCount] = { 0, 1000, 500, 330, 320, 100 };
+
+namespace{
+
+// Indexed by how far the pawn has come, from its own side
+Score const passed_pawn[8] = {
+    MakeScore(0, 0), MakeScore(5, 10), MakeScore(10, 20), MakeScore(15, 35),
+    MakeScore(25, 60), MakeScore(40, 100), MakeScore(60, 150), MakeScore(0, 0)
+};
+
+Score const doubled_pawn = MakeScore(-10, -20);
+Score const isolated_pawn = MakeScore(-10, -15);
+Score const rook_open_file = MakeScore(20, 10);
+Score const rook_half_open_file = MakeScore(10, 5);
+int const tempo = 10;
+
+// The value of each square a piece can go to, and the number of squares it has on an
+//  average board, so a piece with average mobility scores nothing.  In the order of
+//  PieceTypeEnum.
+Score const mobility[PieceTypeCount] = {
+    0, MakeScore(1, 2), MakeScore(2, 4), MakeScore(5, 5), MakeScore(4, 4), 0
+};
+int const average_mobility[PieceTypeCount] = { 0, 13, 7, 6, 4, 0 };
+
+// How dangerous each piece is when it attacks a square next to the enemy king
+int const king_attack_units[PieceTypeCount] = { 0, 5, 3, 2, 2, 0 };
+
+// The king safety penalty is the square of the attack units over this, up to the maximum
+#define KING_ATTACK_DIVISOR 4
+#define MAX_KING_ATTACK_PENALTY 500
+
+// The bonus for each pawn in front of the king, up to three of them
+Score const pawn_shield = MakeScore(12, 0);
+
+}
+
+
+// The pawn structure of one color, from that color's point of view
+static Score __evaluate_pawns(const Position &pos, int color)
+{
+    Bitboard const pawns = pos.Pieces[color][Pawn];
+    Bitboard const their_pawns = pos.Pieces[color ^ 1][Pawn];
+    Score ret = 0;
+
+    // A pawn with another one of ours behind it is doubled, so only the extra ones count
+    Bitboard behind = White == color ? FillNorth(ShiftNorth(pawns)) : FillSouth(ShiftSouth(pawns));
+    ret += PopCount(pawns & behind) * doubled_pawn;
+
+    Bitboard files = FillFiles(pawns);
+    ret += PopCount(pawns & ~(ShiftEast(files) | ShiftWest(files))) * isolated_pawn;
+
+    // The enemy pawns stop our pawns on the squares in front of them, and beside those
+    Bitboard stopped = White == color ? FillSouth(ShiftSouth(their_pawns)) : FillNorth(ShiftNorth(their_pawns));
+    stopped |= ShiftEast(stopped) | ShiftWest(stopped);
+    for(Bitboard b = pawns & ~stopped; b;){
+        int row = Row(PopSquare(b));
+        ret += passed_pawn[White == color ? row : 7 - row];
+    }
+    return ret;
+}
+
+// The mobility and other piece terms of one color, from that color's point of view.
+//  It also adds up how much the pieces attack the enemy king, which is scored in one go.
+static Score __evaluate_pieces(const Position &pos, int color, Bitboard their_pawn_attacks)
+{
+    int const them = color ^ 1;
+    Bitboard const pawns = pos.Pieces[color][Pawn];
+    Bitboard const their_pawns = pos.Pieces[them][Pawn];
+    Bitboard const targets = ~(pos.Colors[color] | their_pawn_attacks);
+    Bitboard const king_zone = Attacks::King(pos.KingSquare(them));
+    Score ret = 0;
+    int attackers = 0;
+    int units = 0;
+
+    for(int type = Queen; type < Pawn; ++type)
+    {
+        for(Bitboard b = pos.Pieces[color][type]; b;)
+        {
+            int sq = PopSquare(b);
+            Bitboard a;
+            switch(type)
+            {
+            case Queen:
+                a = Attacks::Queen(sq, pos.Occupied);
+                break;
+            case Rook:
+                a = Attacks::Rook(sq, pos.Occupied);
+                if(0 == (Attacks::File(Column(sq)) & pawns))
+                    ret += 0 == (Attacks::File(Column(sq)) & their_pawns) ? rook_open_file : rook_half_open_file;
+                break;
+            case Bishop:
+                a = Attacks::Bishop(sq, pos.Occupied);
+                break;
+            default:
+                a = Attacks::Knight(sq);
+                break;
+            }
+
+            ret += (PopCount(a & targets) - average_mobility[type]) * mobility[type];
+            if(a & king_zone){
+                ++attackers;
+                units += king_attack_units[type] * PopCount(a & king_zone);
+            }
+        }
+    }
+
+    // One piece near the king isn't an attack yet
+    if(1 < attackers)
+        ret += MakeScore(qMin(MAX_KING_ATTACK_PENALTY, units * units / KING_ATTACK_DIVISOR), 0);
+
+    // Our own pawns in front of our king, on its file and the files next to it
+    Bitboard king = pos.Pieces[color][King];
+    king |= ShiftEast(king) | ShiftWest(king);
+    Bitboard shield = White == color ? ShiftNorth(king) | ShiftNorth(ShiftNorth(king)) :
+                                       ShiftSouth(king) | ShiftSouth(ShiftSouth(king));
+    ret += qMin(3, PopCount(shield & pawns)) * pawn_shield;
+    return ret;
+}
+
+int Evaluation::Evaluate(const Position &pos)
+{
+    MaterialTable::Entry const material = MaterialTable::Probe(pos);
+    if(material.IsKnownDraw())
+        return 0;
+
+    PawnTable::Entry *pawns = m_pawns.Find(pos.PawnKey);
+    if(pawns->Key != pos.PawnKey){
+        pawns->Key = pos.PawnKey;
+        pawns->Value = __evaluate_pawns(pos, White) - __evaluate_pawns(pos, Black);
+        pawns->Attacks[White] = PawnAttacks(White, pos.Pieces[White][Pawn]);
+        pawns->Attacks[Black] = PawnAttacks(Black, pos.Pieces[Black][Pawn]);
+    }
+
+    // The material and piece-square tables were added up as the pieces moved
+    Score s = pos.PSQ + material.Imbalance + pawns->Value;
+    s += __evaluate_pieces(pos, White, pawns->Attacks[Black]) -
+            __evaluate_pieces(pos, Black, pawns->Attacks[White]);
+
+    int const max_phase = PieceSquareTable::MaxPhase();
+    int phase = qMin(pos.Phase, max_phase);
+    int eg = EgValue(s);
+    eg = eg * material.ScaleFactor[0 < eg ? White : Black] / MaterialTable::NormalScale;
+
+    int ret = (MgValue(s) * phase + eg * (max_phase - phase)) / max_phase;
+    return (White == pos.Turn ? ret : -ret) + tempo;
+}
+
+
+END_NAMESPACE_GKCHESS1;
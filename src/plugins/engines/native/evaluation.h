@@ -0,0 +1,61 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_EVALUATION_H
+#define GKCHESS_NATIVE_EVALUATION_H
+
+#include "pawntable.h"
+#include "position.h"
+
+namespace GKChess{ namespace Native{
+
+
+/** The static evaluation of a position, in centipawns from the point of view of the
+ *  side to move.
+ *
+ *  Every term has a middlegame and an endgame value, packed into one Score, and they are
+ *  blended by how much material is left on the board (the game phase).  The material and
+ *  piece-square tables are kept up to date by the position as moves are made, and the
+ *  rest is computed a whole set of squares at a time with bitboards: pawn structure,
+ *  mobility, king safety and a few piece terms.
+ *
+ *  The pawn structure is cached in a pawn hash table, and the terms that only depend
+ *  on the piece counts come from the MaterialTable.  Each search thread needs its own
+ *  evaluation, because of the pawn table.
+*/
+class Evaluation
+{
+public:
+
+    /** The rough value of each piece type, for ordering moves and pruning. */
+    static int PieceValue(int type){ return m_pieceValues[type]; }
+
+    int Evaluate(const Position &);
+
+    /** Forgets the pawn structures we've seen. */
+    void Clear(){ m_pawns.Clear(); }
+
+
+private:
+
+    static int const m_pieceValues[PieceTypeCount];
+
+    PawnTable m_pawns;
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_EVALUATION_H
@@ -0,0 +1,150 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "material.h"
+#include "evaluation.h"
+
+NAMESPACE_GKCHESS1(Native);
+
+
+namespace{
+
+// The most of each piece type one side can have in the table, in the order of PieceTypeEnum
+int const max_count[PieceTypeCount] = { 1, 1, 2, 2, 2, 8 };
+
+// What one of each piece adds to the index, which counts up black's pawns first, like
+//  the digits of a number
+#define SIDE_COUNT (2 * 3 * 3 * 3 * 9)
+int const place_value[2][PieceTypeCount] = {
+    { 0, SIDE_COUNT * 3 * 3 * 3 * 9, SIDE_COUNT * 3 * 3 * 9, SIDE_COUNT * 3 * 9, SIDE_COUNT * 9, SIDE_COUNT },
+    { 0, 3 * 3 * 3 * 9, 3 * 3 * 9, 3 * 9, 9, 1 }
+};
+
+Score const bishop_pair = MakeScore(30, 50);
+
+// Knights get better and rooks worse with every pawn more than five, because there are
+//  more outposts and fewer open files
+Score const knight_pawn = MakeScore(4, 6);
+Score const rook_pawn = MakeScore(-6, -12);
+
+// Two rooks do some of the same work
+Score const rook_pair = MakeScore(-8, -16);
+
+// When the side that's ahead has one pawn and not much more material, it often can't
+//  win that pawn through
+#define ONE_PAWN_SCALE 48
+
+}
+
+
+// The value of the pieces other than pawns and the king
+static int __non_pawn_material(const int counts[PieceTypeCount])
+{
+    int ret = 0;
+    for(int type = Queen; type < Pawn; ++type)
+        ret += counts[type] * Evaluation::PieceValue(type);
+    return ret;
+}
+
+static Score __imbalance(const int counts[PieceTypeCount])
+{
+    Score ret = 0;
+    if(1 < counts[Bishop])
+        ret += bishop_pair;
+    if(1 < counts[Rook])
+        ret += rook_pair;
+    ret += counts[Knight] * (counts[Pawn] - 5) * knight_pawn;
+    ret += counts[Rook] * (counts[Pawn] - 5) * rook_pawn;
+    return ret;
+}
+
+
+MaterialTable::tables_t const MaterialTable::m_tables;
+
+MaterialTable::tables_t::tables_t()
+{
+    Q_STATIC_ASSERT(SIDE_COUNT == SideCount);
+
+    // Count through every combination, in the same order as the index
+    int counts[2][PieceTypeCount] = {};
+    for(int i = 0; i < SideCount * SideCount; ++i)
+    {
+        Entries[i] = Compute(counts);
+        for(int c = Black; c >= White; --c){
+            int type = Pawn;
+            while(Queen <= type && max_count[type] == counts[c][type])
+                counts[c][type--] = 0;
+            if(Queen <= type){
+                ++counts[c][type];
+                break;
+            }
+        }
+    }
+}
+
+MaterialTable::Entry MaterialTable::Compute(const int counts[2][PieceTypeCount])
+{
+    Entry ret;
+    ret.Imbalance = __imbalance(counts[White]) - __imbalance(counts[Black]);
+    ret.Flags = NoFlags;
+
+    int const npm[2] = { __non_pawn_material(counts[White]), __non_pawn_material(counts[Black]) };
+    for(int c = White; c <= Black; ++c)
+    {
+        int const them = c ^ 1;
+        int scale = NormalScale;
+
+        // Without pawns you need at least a rook, and more than a minor piece over the
+        //  other side, to mate
+        if(0 == counts[c][Pawn] && npm[c] - npm[them] <= Evaluation::PieceValue(Bishop)){
+            if(npm[c] < Evaluation::PieceValue(Rook))
+                scale = 0;
+            else
+                scale = npm[them] <= Evaluation::PieceValue(Bishop) ? 4 : 14;
+        }
+        else if(1 == counts[c][Pawn] && npm[c] - npm[them] <= Evaluation::PieceValue(Bishop))
+            scale = ONE_PAWN_SCALE;
+        ret.ScaleFactor[c] = scale;
+    }
+
+    // A minor piece or less each, and no pawns
+    if(0 == counts[White][Pawn] && 0 == counts[Black][Pawn] &&
+            npm[White] < Evaluation::PieceValue(Rook) && npm[Black] < Evaluation::PieceValue(Rook))
+        ret.Flags |= KnownDraw;
+    return ret;
+}
+
+MaterialTable::Entry MaterialTable::Probe(const Position &pos)
+{
+    int counts[2][PieceTypeCount];
+    int index = 0;
+    bool fits = true;
+    for(int c = White; c <= Black; ++c){
+        for(int type = Queen; type < PieceTypeCount; ++type){
+            counts[c][type] = PopCount(pos.Pieces[c][type]);
+            fits &= counts[c][type] <= max_count[type];
+
+            // These don't depend on each other, unlike going digit by digit
+            index += counts[c][type] * place_value[c][type];
+        }
+    }
+    if(!fits){
+        counts[White][King] = counts[Black][King] = 1;
+        return Compute(counts);
+    }
+    return m_tables.Entries[index];
+}
+
+
+END_NAMESPACE_GKCHESS1;
@@ -0,0 +1,87 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_MATERIAL_H
+#define GKCHESS_NATIVE_MATERIAL_H
+
+#include "position.h"
+
+namespace GKChess{ namespace Native{
+
+
+/** What the evaluation knows from the piece counts alone: how the pieces go together,
+ *  how drawish the endgame is and whether it's a known draw.
+ *
+ *  Every combination of up to one queen, two rooks, two bishops, two knights and eight
+ *  pawns on each side is worked out in advance and looked up by the counts.  Anything
+ *  else, which takes an underpromotion or two queens, is worked out on the spot.
+*/
+class MaterialTable
+{
+public:
+
+    /** The scale factor of an endgame we expect to win as usual. */
+    enum{ NormalScale = 64 };
+
+    enum FlagEnum
+    {
+        NoFlags = 0,
+
+        /** Neither side can win without the other's help. */
+        KnownDraw = 1
+    };
+
+    struct Entry
+    {
+        /** The bonuses and penalties for the mix of pieces, from white's point of view. */
+        Score Imbalance;
+
+        /** How much of the endgame score each color gets to keep when it's ahead, out of
+         *  NormalScale.  It's low when the extra material isn't enough to win.
+        */
+        GUINT8 ScaleFactor[2];
+
+        GUINT8 Flags;
+
+        bool IsKnownDraw() const{ return Flags & KnownDraw; }
+    };
+
+    /** Returns the entry for the material in the position. */
+    static Entry Probe(const Position &);
+
+    /** Works out the entry for the number of pieces of each color and type, which is
+     *  how the table is filled in.  The kings don't matter.
+    */
+    static Entry Compute(const int counts[2][PieceTypeCount]);
+
+
+private:
+
+    // The number of piece combinations of one side
+    enum{ SideCount = 2 * 3 * 3 * 3 * 9 };
+
+    struct tables_t
+    {
+        Entry Entries[SideCount * SideCount];
+
+        tables_t();
+    };
+    static tables_t const m_tables;
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_MATERIAL_H
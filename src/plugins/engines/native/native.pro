@@ -0,0 +1,62 @@
+#-------------------------------------------------
+#
+# The native engine, which searches in-process
+#
+#-------------------------------------------------
+
+QT       -= gui
+QT       += concurrent
+
+TARGET = nativeEnginePlugin
+TEMPLATE = lib
+CONFIG += plugin
+
+TOP_DIR = ../../../..
+
+DESTDIR = $$TOP_DIR/bin
+QMAKE_CXXFLAGS += -std=c++11
+
+CONFIG(debug, debug|release) {
+    #message(Preparing debug build)
+    DEFINES += DEBUG
+}
+else {
+    #message(Preparing release build)
+}
+
+# The evaluation counts a lot of bits, which is one instruction on most x86 processors.
+#  We can't tell from here what the build will run on, so build with CONFIG+=popcnt
+#  to use the instruction; without it the bits are counted in software.
+popcnt {
+    DEFINES += USE_POPCNT
+    !win32-msvc*:QMAKE_CXXFLAGS += -mpopcnt
+}
+
+INCLUDEPATH += $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/lib \
+    -L$$TOP_DIR/gutil/lib \
+    -lGUtil \
+    -lGKChess
+
+SOURCES += nativeengine.cpp \
+    bitboard.cpp \
+    psqt.cpp \
+    position.cpp \
+    evaluation.cpp \
+    pawntable.cpp \
+    material.cpp \
+    transpositiontable.cpp \
+    search.cpp \
+    parallelsearch.cpp
+
+HEADERS += nativeengine.h \
+    bitboard.h \
+    psqt.h \
+    position.h \
+    evaluation.h \
+    pawntable.h \
+    material.h \
+    transpositiontable.h \
+    search.h \
+    parallelsearch.h
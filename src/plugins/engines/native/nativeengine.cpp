@@ -0,0 +1,779 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "nativeengine.h"
+#include "parallelsearch.h"
+#include "gkchess_board.h"
+#include "gkchess_tablebases.h"
+#include "gkchess_searchinfomerger.h"
+#include <gkchess_common.h>
+#include <gutil/exception.h>
+#include <gutil/string.h>
+#include <QtPlugin>
+#include <QtConcurrentRun>
+#include <QVariant>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <cstring>
+USING_NAMESPACE_GUTIL;
+
+/** The hash table size we start with, in megabytes. */
+#define DEFAULT_HASH_SIZE 16
+#define MAX_HASH_SIZE 1024
+
+#define MAX_THREADS 64
+
+/** What UCI engines show for a string option with no value. */
+#define EMPTY_STRING_OPTION "<empty>"
+
+/** The time we keep in reserve on the clock for getting the move back to the game. */
+#define MOVE_OVERHEAD 50
+
+/** The number of moves we budget for when the time control doesn't say. */
+#define DEFAULT_MOVES_TO_GO 30
+
+
+namespace{
+
+// Something the search thread has for us
+struct event_t
+{
+    enum TypeEnum
+    {
+        Info,
+        BestMove
+    }
+    Type;
+
+    // The equivalent UCI line, for the message signals
+    QByteArray Line;
+
+    GKChess::IEngine::SearchInfo SearchInfo;
+    GKChess::GenericMove Best;
+    GKChess::GenericMove Ponder;
+
+    // When the search thread made it
+    qint64 Timestamp;
+};
+
+// Everything the search thread needs, which it gets its own copy of
+struct job_t
+{
+    GKChess::Native::Position Root;
+    QVector<GUINT64> History;
+    GKChess::Native::Search::Limits Limits;
+    bool Pondering;
+    bool Infinite;
+};
+
+struct d_t
+{
+    bool started;
+    bool thinking;
+    GKChess::IEngine::EngineInfo info;
+
+    // The hash table lives as long as we do, so each search benefits from the last one
+    //  until there's a new game.  It and the threads can't change while we're thinking,
+    //  so changes to them wait until the next search.
+    GKChess::Native::TranspositionTable tt;
+    bool hash_resize_pending;
+    bool hash_clear_pending;
+    bool threads_pending;
+    GKChess::Tablebases tablebases;
+    bool tablebases_pending;
+    GKChess::Native::ParallelSearch search;
+
+    // The position the next search starts from, and the hashes of the game before it
+    GKChess::Native::Position root;
+    QVector<GUINT64> history;
+    bool game_valid;
+    QByteArray game_start;
+
+    // The search runs on the thread pool.  The things below the lock are shared with it.
+    QFuture<void> future;
+    QMutex lock;
+    QWaitCondition wake;
+    bool stop_requested;
+    bool ponder_hit;
+    QQueue<event_t> events;
+
+    // The latest search info for each MultiPV line of the search
+    GKChess::SearchInfoMerger search_info;
+
+    // Measurements of the searches, in microseconds from the clock
+    QElapsedTimer clock;
+    GKChess::IEngine::Statistics stats;
+    qint64 stats_start;
+    qint64 go_sent;
+    bool go_timed;
+    int go_movetime;
+    bool first_info_seen;
+
+    d_t()
+        :started(false),
+          thinking(false),
+          hash_resize_pending(false),
+          hash_clear_pending(false),
+          threads_pending(false),
+          tablebases_pending(false),
+          search(tt),
+          game_valid(false),
+          stop_requested(false),
+          ponder_hit(false),
+          stats_start(0),
+          go_sent(-1),
+          go_timed(false),
+          go_movetime(0),
+          first_info_seen(false)
+    {
+        clock.start();
+    }
+};
+
+}
+
+
+
+NAMESPACE_GKCHESS;
+
+using namespace Native;
+
+
+static qint64 __now(d_t *d)
+{
+    return d->clock.nsecsElapsed() / 1000;
+}
+
+static QFuture<bool> __finished_future(bool result)
+{
+    QFutureInterface<bool> p;
+    p.reportStarted();
+    p.reportResult(result);
+    p.reportFinished();
+    return p.future();
+}
+
+static void __add_time(GUINT64 &total, GUINT64 &max, qint64 t)
+{
+    GUINT64 ut = qMax((qint64)0, t);
+    total += ut;
+    if(max < ut)
+        max = ut;
+}
+
+// Castles are given as the king moving two squares when that's possible, which is what
+//  engines do in standard chess.  Otherwise the king moves onto its rook.
+static GenericMove __to_generic_move(Move m)
+{
+    static const char promoted[] = { 0, 'q', 'r', 'b', 'n' };
+    int source = MoveSource(m);
+    int dest_col = Column(MoveDest(m));
+    if(CastleMove == MoveFlag(m) && 4 == Column(source) && (0 == dest_col || 7 == dest_col))
+        dest_col = 0 == dest_col ? 2 : 6;
+    return GenericMove(Column(source), Row(source), dest_col, Row(MoveDest(m)),
+                       IsPromotion(m) ? promoted[PromotedType(m)] : 0);
+}
+
+static Move __from_generic_move(const Position &pos, const GenericMove &gm)
+{
+    int promoted = NO_PIECE;
+    switch(gm.PromotedPiece)
+    {
+    case 'q': case 'Q': promoted = Queen; break;
+    case 'r': case 'R': promoted = Rook; break;
+    case 'b': case 'B': promoted = Bishop; break;
+    case 'n': case 'N': promoted = Knight; break;
+    default: break;
+    }
+
+    Move ret = NULL_MOVE;
+    if(gm.SourceCol < 8 && gm.SourceRow < 8 && gm.DestCol < 8 && gm.DestRow < 8)
+        ret = pos.FindMove(MakeSquare(gm.SourceCol, gm.SourceRow), MakeSquare(gm.DestCol, gm.DestRow), promoted);
+    if(NULL_MOVE == ret)
+        throw Exception<>(String::Format("Illegal move: %s", gm.ToString().ConstData()));
+    return ret;
+}
+
+// Sets up the position from the FEN and plays the moves from it
+static void __set_game(d_t *d, const char *fen, const QList<GenericMove> &moves)
+{
+    Board b;
+    b.FromFEN(fen);
+    Position pos = Position::FromBoard(b);
+
+    QVector<GUINT64> history;
+    history.reserve(moves.length());
+    for(GenericMove const &gm : moves){
+        Move m = __from_generic_move(pos, gm);
+        history.append(pos.Key);
+        pos.Make(m);
+    }
+    d->root = pos;
+    d->history.swap(history);
+}
+
+// Applies the changes to the hash table, threads and tablebases that had to wait until
+//  we weren't thinking
+static void __apply_pending_options(d_t *d)
+{
+    if(d->tablebases_pending){
+        IEngine::StringOption const *opt = static_cast<IEngine::StringOption const *>(d->info.Options["SyzygyPath"]);
+        IEngine::CheckOption const *probe = static_cast<IEngine::CheckOption const *>(d->info.Options["SyzygyProbe"]);
+        if(!probe->Value || opt->Value.isEmpty() || EMPTY_STRING_OPTION == opt->Value)
+            d->tablebases.Close();
+        else
+            d->tablebases.Open(opt->Value);
+        d->search.SetTablebases(0 < d->tablebases.GetMaxPieces() ? &d->tablebases : 0);
+        d->tablebases_pending = false;
+    }
+
+    if(d->threads_pending){
+        IEngine::SpinOption const *opt = static_cast<IEngine::SpinOption const *>(d->info.Options["Threads"]);
+        d->search.SetThreadCount(opt->Value);
+        d->threads_pending = false;
+    }
+
+    if(d->hash_resize_pending){
+        IEngine::SpinOption const *opt = static_cast<IEngine::SpinOption const *>(d->info.Options["Hash"]);
+        d->tt.Resize(opt->Value);
+    }
+    else if(d->hash_clear_pending)
+        d->tt.Clear();
+    d->hash_resize_pending = false;
+    d->hash_clear_pending = false;
+}
+
+// Gives the search a share of the clock
+static void __allocate_time(int time, int increment, int moves_to_go, Search::Limits &l)
+{
+    qint64 available = qMax(0, time - MOVE_OVERHEAD);
+    int moves = 0 < moves_to_go ? moves_to_go : DEFAULT_MOVES_TO_GO;
+    l.HardTime = qMin(available, 4 * (available / moves + increment));
+    l.SoftTime = qMin(l.HardTime, available / moves + 3 * increment / 4);
+}
+
+static IEngine::SearchInfo __make_search_info(d_t *d, const Search &s, int multipv, const Search::Line &l)
+{
+    IEngine::SearchInfo ret;
+    ret.Fields = IEngine::SearchInfo::HasDepth | IEngine::SearchInfo::HasSelDepth |
+            IEngine::SearchInfo::HasMultiPV | IEngine::SearchInfo::HasScore |
+            IEngine::SearchInfo::HasNodes | IEngine::SearchInfo::HasNPS |
+            IEngine::SearchInfo::HasHashFull | IEngine::SearchInfo::HasTBHits |
+            IEngine::SearchInfo::HasTime | IEngine::SearchInfo::HasPV;
+    ret.Depth = l.Depth;
+    ret.SelDepth = l.SelDepth;
+    ret.MultiPV = multipv;
+
+    int mate = Search::MateInMoves(l.Score);
+    ret.ScoreIsMate = 0 != mate;
+    ret.Score = ret.ScoreIsMate ? mate : l.Score;
+    if(TranspositionTable::LowerBound == l.Bound)
+        ret.ScoreBound = IEngine::SearchInfo::LowerBound;
+    else if(TranspositionTable::UpperBound == l.Bound)
+        ret.ScoreBound = IEngine::SearchInfo::UpperBound;
+
+    ret.Nodes = d->search.GetNodes();
+    ret.Time = s.GetElapsed();
+    ret.NPS = 0 == ret.Time ? 0 : ret.Nodes * 1000 / ret.Time;
+    ret.HashFull = d->tt.GetHashFull();
+    ret.TBHits = d->search.GetTBHits();
+
+    ret.PVLength = qMin(l.PV.size(), (int)IEngine::SearchInfo::MaxPVLength);
+    for(int i = 0; i < ret.PVLength; ++i)
+        ret.PV[i] = __to_generic_move(l.PV[i]).Pack();
+    return ret;
+}
+
+static QByteArray __format_search_info(const IEngine::SearchInfo &info)
+{
+    QByteArray ret = "info depth ";
+    ret.append(QByteArray::number(info.Depth))
+       .append(" seldepth ").append(QByteArray::number(info.SelDepth))
+       .append(" multipv ").append(QByteArray::number(info.MultiPV))
+       .append(info.ScoreIsMate ? " score mate " : " score cp ").append(QByteArray::number(info.Score));
+    if(IEngine::SearchInfo::LowerBound == info.ScoreBound)
+        ret.append(" lowerbound");
+    else if(IEngine::SearchInfo::UpperBound == info.ScoreBound)
+        ret.append(" upperbound");
+    ret.append(" nodes ").append(QByteArray::number(info.Nodes))
+       .append(" nps ").append(QByteArray::number(info.NPS))
+       .append(" hashfull ").append(QByteArray::number(info.HashFull))
+       .append(" tbhits ").append(QByteArray::number(info.TBHits))
+       .append(" time ").append(QByteArray::number(info.Time))
+       .append(" pv");
+    for(int i = 0; i < info.PVLength; ++i)
+        ret.append(' ').append(info.PVMove(i).ToString().ConstData());
+    return ret;
+}
+
+// Gives the event to the engine object on its own thread
+static void __post_event(d_t *d, QObject *engine, event_t &e)
+{
+    e.Timestamp = __now(d);
+    d->lock.lock();
+    bool was_empty = d->events.isEmpty();
+    d->events.enqueue(e);
+    d->lock.unlock();
+
+    if(was_empty)
+        QMetaObject::invokeMethod(engine, "_process_events", ::Qt::QueuedConnection);
+}
+
+
+namespace{
+
+class reporter_t :
+        public Search::IReporter
+{
+    d_t *d;
+    QObject *engine;
+public:
+
+    reporter_t(d_t *_d, QObject *_engine) :d(_d), engine(_engine) {}
+
+    void LineFinished(const Search &s, int multipv, const Search::Line &l){
+        event_t e;
+        e.Type = event_t::Info;
+        e.SearchInfo = __make_search_info(d, s, multipv, l);
+        e.Line = __format_search_info(e.SearchInfo);
+        __post_event(d, engine, e);
+    }
+};
+
+}
+
+
+// This runs on the thread pool
+static void __think(d_t *d, QObject *engine, job_t job)
+{
+    reporter_t reporter(d, engine);
+    QVector<Search::Line> lines = d->search.Run(job.Root, job.History, job.Limits, &reporter);
+
+    // The best move of an infinite or pondering search waits until we're told to stop
+    d->lock.lock();
+    while(!d->stop_requested && (job.Infinite || (job.Pondering && !d->ponder_hit)))
+        d->wake.wait(&d->lock);
+    d->lock.unlock();
+
+    event_t e;
+    e.Type = event_t::BestMove;
+    e.Line = "bestmove";
+    if(lines.isEmpty())
+        e.Line.append(" (none)");
+    else
+    {
+        QVector<Move> const &pv = lines[0].PV;
+        e.Best = __to_generic_move(pv[0]);
+        e.Line.append(' ').append(e.Best.ToString().ConstData());
+        if(1 < pv.size()){
+            e.Ponder = __to_generic_move(pv[1]);
+            e.Line.append(" ponder ").append(e.Ponder.ToString().ConstData());
+        }
+    }
+    __post_event(d, engine, e);
+}
+
+static void __measure_received(d_t *d, const event_t &e)
+{
+    IEngine::Statistics &s = d->stats;
+    ++s.LinesReceived;
+    s.BytesReceived += e.Line.length() + 1;
+    __add_time(s.ReceiveDelayTotal, s.ReceiveDelayMax, __now(d) - e.Timestamp);
+
+    if(-1 == d->go_sent)
+        return;
+    if(event_t::Info == e.Type && !d->first_info_seen)
+    {
+        d->first_info_seen = true;
+        __add_time(s.FirstInfoTimeTotal, s.FirstInfoTimeMax, e.Timestamp - d->go_sent);
+    }
+    else if(event_t::BestMove == e.Type)
+    {
+        qint64 t = e.Timestamp - d->go_sent;
+        if(d->go_timed){
+            ++s.TimedSearchCount;
+            __add_time(s.BestMoveTimeTotal, s.BestMoveTimeMax, t);
+            if(0 < d->go_movetime){
+                ++s.MoveTimeSearchCount;
+                __add_time(s.MoveTimeOverrunTotal, s.MoveTimeOverrunMax, t - 1000 * (qint64)d->go_movetime);
+            }
+        }
+        d->go_sent = -1;
+    }
+}
+
+
+NativeEngine::NativeEngine(QObject *parent)
+    :IEngine(parent)
+{
+    G_D_INIT();
+    G_D;
+    qRegisterMetaType<GKChess::IEngine::SearchInfo>();
+    connect(&d->search_info, SIGNAL(SearchInfoReady(const GKChess::IEngine::SearchInfo &)),
+            this, SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)));
+    d->stats_start = __now(d);
+}
+
+IEngine *NativeEngine::Create() const
+{
+    return new NativeEngine(parent());
+}
+
+NativeEngine::~NativeEngine()
+{
+    StopThinking();
+    _wait_for_search();
+    G_D_UNINIT();
+}
+
+void NativeEngine::_wait_for_search()
+{
+    G_D;
+    d->future.waitForFinished();
+}
+
+void NativeEngine::StartEngine(const QString &path, const QStringList &args)
+{
+    StartEngineAsync(path, args);
+}
+
+QFuture<bool> NativeEngine::StartEngineAsync(const QString &, const QStringList &)
+{
+    G_D;
+    if(d->started){
+        GDEBUG("Engine already started!");
+        return __finished_future(true);
+    }
+
+    if(d->info.Options.isEmpty())
+    {
+        d->info.Name = "GKChess Native";
+        d->info.Author = "George Karagoulis";
+        d->info.OptionNames << "Threads" << "Hash" << "Clear Hash" << "SyzygyPath" << "SyzygyProbe";
+        d->info.Options.insert("Threads", new SpinOption("Threads", 1, 1, MAX_THREADS));
+        d->info.Options.insert("Hash", new SpinOption("Hash", DEFAULT_HASH_SIZE, 1, MAX_HASH_SIZE));
+        d->info.Options.insert("Clear Hash", new ButtonOption("Clear Hash"));
+        d->info.Options.insert("SyzygyPath", new StringOption("SyzygyPath", EMPTY_STRING_OPTION));
+
+        // The search only uses the tablebases if you turn this on.  It's off until the
+        //  prober has been checked against real files with the tablebases test.
+        d->info.Options.insert("SyzygyProbe", new CheckOption("SyzygyProbe", false));
+    }
+
+    SpinOption const *hash = static_cast<SpinOption const *>(d->info.Options["Hash"]);
+    d->tt.Resize(hash->Value);
+    d->root = Position();
+    d->history.clear();
+    d->game_valid = false;
+    d->started = true;
+    return __finished_future(true);
+}
+
+void NativeEngine::StopEngine()
+{
+    G_D;
+    if(!d->started){
+        GDEBUG("Engine already stopped!");
+        return;
+    }
+
+    StopThinking();
+    _wait_for_search();
+
+    // Nobody's waiting for the rest of the search
+    d->lock.lock();
+    d->events.clear();
+    d->lock.unlock();
+    d->search_info.ClearPending();
+
+    d->started = false;
+    d->thinking = false;
+}
+
+bool NativeEngine::IsEngineStarted() const
+{
+    G_D;
+    return d->started;
+}
+
+const IEngine::EngineInfo &NativeEngine::GetEngineInfo() const
+{
+    G_D;
+    return d->info;
+}
+
+void NativeEngine::SetOption(const QString &name, const QVariant &value)
+{
+    G_D;
+    if(!d->started || !d->info.Options.contains(name))
+        return;
+
+    if("Threads" == name || "Hash" == name)
+    {
+        SpinOption *opt = static_cast<SpinOption *>(d->info.Options[name]);
+        opt->Value = value.isNull() ? opt->Default : qBound(opt->Min, value.toInt(), opt->Max);
+        if("Threads" == name)
+            d->threads_pending = true;
+        else
+            d->hash_resize_pending = true;
+    }
+    else if("Clear Hash" == name)
+        d->hash_clear_pending = true;
+    else if("SyzygyPath" == name)
+    {
+        StringOption *opt = static_cast<StringOption *>(d->info.Options[name]);
+        opt->Value = value.isNull() ? opt->Default : value.toString();
+        d->tablebases_pending = true;
+    }
+    else if("SyzygyProbe" == name)
+    {
+        CheckOption *opt = static_cast<CheckOption *>(d->info.Options[name]);
+        opt->Value = value.isNull() ? opt->Default : value.toBool();
+        d->tablebases_pending = true;
+    }
+
+    if(!d->thinking){
+        _wait_for_search();
+        __apply_pending_options(d);
+    }
+}
+
+bool NativeEngine::WaitForReady(int)
+{
+    G_D;
+    if(d->started)
+        ++d->stats.ReadyCount;
+    return d->started;
+}
+
+QFuture<bool> NativeEngine::WaitForReadyAsync()
+{
+    return __finished_future(WaitForReady(-1));
+}
+
+void NativeEngine::NewGame()
+{
+    G_D;
+    d->game_valid = false;
+    d->hash_clear_pending = true;
+    if(!d->thinking){
+        _wait_for_search();
+        __apply_pending_options(d);
+    }
+}
+
+void NativeEngine::SetPosition(const char *data)
+{
+    G_D;
+
+    // This is either "startpos" or a FEN, optionally followed by "moves" and the moves
+    QList<QByteArray> tokens = QByteArray(data).simplified().split(' ');
+    QByteArray fen;
+    int i = 0;
+    if(!tokens.isEmpty() && "startpos" == tokens[0]){
+        fen = FEN_STANDARD_CHESS_STARTING_POSITION;
+        i = 1;
+    }
+    else
+    {
+        if(!tokens.isEmpty() && "fen" == tokens[0])
+            i = 1;
+        for(; i < tokens.length() && "moves" != tokens[i]; ++i)
+            fen.append(tokens[i]).append(' ');
+        fen = fen.trimmed();
+    }
+
+    QList<GenericMove> moves;
+    if(i < tokens.length() && "moves" == tokens[i]){
+        for(++i; i < tokens.length(); ++i)
+            moves.append(GenericMove(tokens[i].constData()));
+    }
+
+    // We don't know what game this position is from
+    __set_game(d, fen.constData(), moves);
+    d->game_valid = false;
+}
+
+void NativeEngine::SetGamePosition(const char *start, const QList<GenericMove> &moves)
+{
+    G_D;
+    if(!d->game_valid || d->game_start != start)
+        NewGame();
+
+    __set_game(d, 0 == strcmp(start, "startpos") ? FEN_STANDARD_CHESS_STARTING_POSITION : start, moves);
+    d->game_start = start;
+    d->game_valid = true;
+}
+
+void NativeEngine::StartThinking(const IEngine::ThinkParams &p)
+{
+    G_D;
+    if(d->thinking)
+        return;
+    if(!d->started)
+        throw Exception<>("The engine is not started");
+
+    _wait_for_search();
+    __apply_pending_options(d);
+
+    job_t job;
+    job.Root = d->root;
+    job.History = d->history;
+    job.Pondering = p.Ponder;
+    job.Infinite = -1 == p.SearchTime;
+
+    Search::Limits &l = job.Limits;
+    l.Depth = p.Depth;
+    l.Nodes = qMax(0, p.Nodes);
+    l.Mate = p.Mate;
+    l.MultiPV = qMax(1, p.MultiPV);
+    for(GenericMove const &m : p.SearchMoves)
+        l.SearchMoves.append(__from_generic_move(d->root, m));
+
+    if(0 < p.SearchTime)
+        l.SoftTime = l.HardTime = p.SearchTime;
+    else if(0 == p.SearchTime)
+    {
+        int time = White == d->root.Turn ? p.WhiteTime : p.BlackTime;
+        int increment = White == d->root.Turn ? p.WhiteIncrement : p.BlackIncrement;
+        if(0 <= time)
+            __allocate_time(time, increment, p.MovesToGo, l);
+        else if(0 == l.Depth && 0 == l.Nodes && 0 == l.Mate)
+        {
+            // We have no time, so we just look one move ahead
+            l.Depth = 1;
+        }
+    }
+
+    // Forget the info from the last search
+    d->search_info.Clear();
+
+    ++d->stats.SearchCount;
+    d->go_sent = __now(d);
+    d->go_timed = !job.Infinite && !job.Pondering;
+    d->go_movetime = qMax(0, p.SearchTime);
+    d->first_info_seen = false;
+
+    d->stop_requested = false;
+    d->ponder_hit = false;
+    d->search.Reset(p.Ponder);
+    d->future = QtConcurrent::run(__think, d, (QObject *)this, job);
+
+    // We raise this when we start the search thread, and lower it when we process its
+    //  best move, so we don't need to protect this with a lock
+    d->thinking = true;
+}
+
+void NativeEngine::StopThinking()
+{
+    G_D;
+    if(!d->thinking)
+        return;
+
+    d->lock.lock();
+    d->stop_requested = true;
+    d->search.Stop();
+    d->wake.wakeAll();
+    d->lock.unlock();
+}
+
+void NativeEngine::PonderHit()
+{
+    G_D;
+    if(!d->thinking)
+        return;
+
+    d->lock.lock();
+    d->ponder_hit = true;
+    d->search.PonderHit();
+    d->wake.wakeAll();
+    d->lock.unlock();
+
+    // From here on it's a normal search, so it's timed from now
+    d->go_sent = __now(d);
+    d->go_timed = true;
+}
+
+bool NativeEngine::IsThinking() const
+{
+    G_D;
+    return d->thinking;
+}
+
+QList<IEngine::SearchInfo> NativeEngine::GetSearchLines() const
+{
+    G_D;
+    return d->search_info.GetLines();
+}
+
+void NativeEngine::_process_events()
+{
+    G_D;
+    QQueue<event_t> events;
+    d->lock.lock();
+    events.swap(d->events);
+    d->lock.unlock();
+
+    for(event_t const &e : events)
+    {
+        __measure_received(d, e);
+        emit MessageReceived(e.Line);
+        if(event_t::Info == e.Type)
+        {
+            d->search_info.Add(e.SearchInfo);
+        }
+        else
+        {
+            // Make sure they get the final search info before the best move
+            d->search_info.Flush();
+            d->thinking = false;
+            emit BestMove(e.Best, e.Ponder);
+        }
+    }
+}
+
+IEngine::Statistics NativeEngine::GetStatistics() const
+{
+    G_D;
+    Statistics ret = d->stats;
+    ret.ElapsedTime = __now(d) - d->stats_start;
+    return ret;
+}
+
+void NativeEngine::ResetStatistics()
+{
+    G_D;
+    d->stats = Statistics();
+    d->stats_start = __now(d);
+}
+
+void NativeEngine::SetTraceFile(const QString &)
+{}
+
+void NativeEngine::SetSearchInfoRate(int per_second)
+{
+    G_D;
+    d->search_info.SetRate(per_second);
+}
+
+int NativeEngine::GetSearchInfoRate() const
+{
+    G_D;
+    return d->search_info.GetRate();
+}
+
+
+END_NAMESPACE_GKCHESS;
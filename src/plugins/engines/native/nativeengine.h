@@ -0,0 +1,89 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_ENGINE_H
+#define GKCHESS_NATIVE_ENGINE_H
+
+#include "gkchess_iengine.h"
+
+namespace GKChess{
+
+
+/** An engine that searches in-process, on threads of its own, so there is no process
+ *  to start and nothing to parse.  Use it for quick evaluations where starting an
+ *  external engine is too heavy.
+ *
+ *  It behaves like a UCI engine: the search info and best move come as signals, and
+ *  the message signals carry the equivalent UCI lines so you can log them.  The hash
+ *  table is kept from one search to the next until you start a new game.
+*/
+class NativeEngine :
+        public IEngine
+{
+    Q_OBJECT
+    Q_INTERFACES(GKChess::IEngine)
+    Q_PLUGIN_METADATA(IID "GKChess.Native_Engine")
+    void *d;
+public:
+
+    NativeEngine(QObject *parent = 0);
+    ~NativeEngine();
+
+    IEngine *Create() const;
+
+    /** There is no executable, so the path and arguments are ignored. */
+    void StartEngine(const QString &, const QStringList &);
+    QFuture<bool> StartEngineAsync(const QString &, const QStringList &);
+    bool IsEngineStarted() const;
+    void StopEngine();
+
+    const EngineInfo &GetEngineInfo() const;
+    void SetPosition(const char *);
+    void SetGamePosition(const char *, const QList<GenericMove> &);
+    void SetOption(const QString &, const QVariant &);
+    bool WaitForReady(int);
+    QFuture<bool> WaitForReadyAsync();
+    void NewGame();
+
+    void StartThinking(const ThinkParams &);
+    bool IsThinking() const;
+    void StopThinking();
+    void PonderHit();
+    QList<SearchInfo> GetSearchLines() const;
+
+    Statistics GetStatistics() const;
+    void ResetStatistics();
+
+    /** There is no protocol to trace, so this does nothing. */
+    void SetTraceFile(const QString &);
+
+    void SetSearchInfoRate(int);
+    int GetSearchInfoRate() const;
+
+
+private slots:
+
+    void _process_events();
+
+
+private:
+
+    void _wait_for_search();
+
+};
+
+
+}
+
+#endif // GKCHESS_NATIVE_ENGINE_H
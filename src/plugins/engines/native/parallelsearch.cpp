@@ -0,0 +1,135 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "parallelsearch.h"
+#include <QRunnable>
+
+NAMESPACE_GKCHESS1(Native);
+
+
+namespace{
+
+// Runs a helper search on the thread pool.  Nobody wants its results; it only helps
+//  by filling the hash table.
+class helper_t :
+        public QRunnable
+{
+    Search &m_search;
+    Position const &m_root;
+    QVector<GUINT64> const &m_history;
+    Search::Limits const &m_limits;
+public:
+
+    helper_t(Search &s, const Position &root, const QVector<GUINT64> &history, const Search::Limits &l)
+        :m_search(s), m_root(root), m_history(history), m_limits(l) {}
+
+    void run(){ m_search.Run(m_root, m_history, m_limits); }
+};
+
+}
+
+
+ParallelSearch::ParallelSearch(TranspositionTable &tt, int threads)
+    :m_tt(tt),
+      m_tb(0)
+{
+    SetThreadCount(threads);
+}
+
+ParallelSearch::~ParallelSearch()
+{
+    Stop();
+    m_pool.waitForDone();
+    qDeleteAll(m_searches);
+}
+
+void ParallelSearch::SetThreadCount(int threads)
+{
+    threads = qMax(1, threads);
+    while(m_searches.size() < threads){
+        m_searches.append(new Search(m_tt, m_searches.size()));
+        m_searches.last()->SetTablebases(m_tb);
+    }
+    while(threads < m_searches.size())
+        delete m_searches.takeLast();
+
+    // The main search runs on the caller's thread
+    m_pool.setMaxThreadCount(qMax(1, threads - 1));
+}
+
+void ParallelSearch::SetTablebases(const Tablebases *tb)
+{
+    m_tb = tb;
+    for(Search *s : m_searches)
+        s->SetTablebases(tb);
+}
+
+void ParallelSearch::Reset(bool pondering)
+{
+    for(Search *s : m_searches)
+        s->Reset(pondering);
+}
+
+QVector<Search::Line> ParallelSearch::Run(const Position &root, const QVector<GUINT64> &history,
+                                          const Search::Limits &limits, Search::IReporter *reporter)
+{
+    m_tt.NewSearch();
+
+    // The helpers search until the main search stops them
+    Search::Limits helper_limits(limits);
+    helper_limits.SoftTime = -1;
+    helper_limits.HardTime = -1;
+    if(0 == limits.Nodes){
+        for(int i = 1; i < m_searches.size(); ++i)
+            m_pool.start(new helper_t(*m_searches[i], root, history, helper_limits));
+    }
+
+    QVector<Search::Line> ret = m_searches[0]->Run(root, history, limits, reporter);
+
+    for(int i = 1; i < m_searches.size(); ++i)
+        m_searches[i]->Stop();
+    m_pool.waitForDone();
+    return ret;
+}
+
+void ParallelSearch::Stop()
+{
+    for(Search *s : m_searches)
+        s->Stop();
+}
+
+void ParallelSearch::PonderHit()
+{
+    for(Search *s : m_searches)
+        s->PonderHit();
+}
+
+GUINT64 ParallelSearch::GetNodes() const
+{
+    GUINT64 ret = 0;
+    for(Search const *s : m_searches)
+        ret += s->GetNodes();
+    return ret;
+}
+
+GUINT64 ParallelSearch::GetTBHits() const
+{
+    GUINT64 ret = 0;
+    for(Search const *s : m_searches)
+        ret += s->GetTBHits();
+    return ret;
+}
+
+
+END_NAMESPACE_GKCHESS1;
@@ -0,0 +1,80 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_PARALLELSEARCH_H
+#define GKCHESS_NATIVE_PARALLELSEARCH_H
+
+#include "search.h"
+#include <QThreadPool>
+
+namespace GKChess{ namespace Native{
+
+
+/** Searches with several threads using Lazy SMP: every thread runs its own search of
+ *  the same position, and they help each other through the shared hash table.  The
+ *  main search runs on the calling thread and gives the results; the helpers skip
+ *  depths so they fill the table with the next iterations' results.
+ *
+ *  A search with a node limit only uses the main thread, so it's repeatable.
+*/
+class ParallelSearch
+{
+public:
+
+    explicit ParallelSearch(TranspositionTable &, int threads = 1);
+    ~ParallelSearch();
+
+    /** Sets the number of threads, including the calling one.  Don't call this while
+     *  a search is running.
+    */
+    void SetThreadCount(int);
+    int GetThreadCount() const{ return m_searches.size(); }
+
+    /** Like Search::SetTablebases(), for all the threads. */
+    void SetTablebases(const Tablebases *);
+
+    /** Like Search::Reset(), for all the threads. */
+    void Reset(bool pondering);
+
+    /** Searches like Search::Run(), on all the threads.  It starts a new search in the
+     *  hash table, and returns when the main search is done and the helpers have stopped.
+    */
+    QVector<Search::Line> Run(const Position &root, const QVector<GUINT64> &history,
+                              const Search::Limits &, Search::IReporter * = 0);
+
+    /** These can be called from any thread. */
+    void Stop();
+    void PonderHit();
+
+    /** The nodes searched so far by all the threads, which you can call from any thread. */
+    GUINT64 GetNodes() const;
+    GUINT64 GetTBHits() const;
+
+
+private:
+
+    TranspositionTable &m_tt;
+    Tablebases const *m_tb;
+    QVector<Search *> m_searches;
+    QThreadPool m_pool;
+
+    ParallelSearch(const ParallelSearch &);
+    ParallelSearch &operator = (const ParallelSearch &);
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_PARALLELSEARCH_H
@@ -0,0 +1,38 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "pawntable.h"
+#include <cstring>
+
+NAMESPACE_GKCHESS1(Native);
+
+
+PawnTable::PawnTable()
+    :m_entries(new Entry[EntryCount])
+{
+    Clear();
+}
+
+PawnTable::~PawnTable()
+{
+    delete[] m_entries;
+}
+
+void PawnTable::Clear()
+{
+    memset(m_entries, 0, EntryCount * sizeof(Entry));
+}
+
+
+END_NAMESPACE_GKCHESS1;
@@ -0,0 +1,71 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_PAWNTABLE_H
+#define GKCHESS_NATIVE_PAWNTABLE_H
+
+#include "psqt.h"
+
+namespace GKChess{ namespace Native{
+
+
+/** Remembers the pawn structure evaluation by the hash of just the pawns.  The pawns
+ *  move much less often than the pieces, so most positions in a search find their
+ *  pawns here and don't have to evaluate them again.
+ *
+ *  Each search thread has its own table, so it needs no locking.  An entry that was
+ *  never written has a key of 0 and a score of 0, which happens to be right for a
+ *  board with no pawns, so we don't need to tell empty entries apart.
+*/
+class PawnTable
+{
+public:
+
+    enum{ EntryCount = 1 << 13 };
+
+    struct Entry
+    {
+        GUINT64 Key;
+
+        /** The squares attacked by each color's pawns. */
+        Bitboard Attacks[2];
+
+        /** The pawn structure score, from white's point of view. */
+        Score Value;
+    };
+
+    PawnTable();
+    ~PawnTable();
+
+    /** Returns the entry where the pawns with this hash go.  If its key is different
+     *  you have to evaluate the pawns and fill it in.
+    */
+    Entry *Find(GUINT64 pawn_key){ return m_entries + (pawn_key & (EntryCount - 1)); }
+
+    void Clear();
+
+
+private:
+
+    Entry *m_entries;
+
+    PawnTable(const PawnTable &);
+    PawnTable &operator = (const PawnTable &);
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_PAWNTABLE_H
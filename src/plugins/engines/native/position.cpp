@@ -0,0 +1,452 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "position.h"
+#include "gkchess_zobrist.h"
+#include "gkchess_board.h"
+#include <gutil/exception.h>
+#include <cstring>
+#include <cstdlib>
+USING_NAMESPACE_GUTIL;
+
+// The castle index of the side, which we add to 2 * color
+#define CASTLE_A_SIDE 0
+#define CASTLE_H_SIDE 1
+
+NAMESPACE_GKCHESS1(Native);
+
+
+static GUINT64 const *__keys()
+{
+    static GUINT64 const *keys = Zobrist::GetKeys();
+    return keys;
+}
+
+static GUINT64 __piece_key(int kind, int sq)
+{
+    return __keys()[Zobrist::PieceKeys + 64 * kind + sq];
+}
+
+static GUINT64 __castle_key(int index, int col)
+{
+    return __keys()[Zobrist::CastleKeys + 8 * index + col];
+}
+
+static GUINT64 __en_passant_key(int sq)
+{
+    return __keys()[Zobrist::EnPassantKeys + Column(sq)];
+}
+
+
+Position::Position()
+{
+    Clear();
+}
+
+void Position::Clear()
+{
+    memset(Pieces, 0, sizeof(Pieces));
+    memset(Colors, 0, sizeof(Colors));
+    Occupied = 0;
+    memset(Squares, NO_PIECE, sizeof(Squares));
+    Turn = White;
+    for(int i = 0; i < 4; ++i)
+        CastleColumns[i] = -1;
+    EnPassant = -1;
+    HalfMoveClock = 0;
+    FullMoveNumber = 1;
+    Key = 0;
+    PawnKey = 0;
+    PSQ = 0;
+    Phase = 0;
+}
+
+void Position::PutPiece(int color, int type, int sq)
+{
+    _put(6 * color + type, sq);
+}
+
+void Position::SetCastleColumn(int index, int col)
+{
+    CastleColumns[index] = col;
+}
+
+void Position::FinishSetup(int en_passant)
+{
+    EnPassant = -1;
+    if(-1 != en_passant)
+        _set_en_passant(en_passant);
+    Key = ComputeKey();
+}
+
+Position Position::FromBoard(const Board &b)
+{
+    if(8 != b.ColumnCount() || 8 != b.RowCount())
+        throw Exception<>("The native engine only plays on an 8x8 board");
+
+    Position ret;
+    int kings[2] = {0, 0};
+    for(int c = 0; c < 8; ++c){
+        for(int r = 0; r < 8; ++r){
+            Piece const &p = b.SquareAt(c, r).GetPiece();
+            if(p.IsNull())
+                continue;
+            if(Piece::King == p.GetType())
+                ++kings[p.GetAllegience()];
+            ret.PutPiece(p.GetAllegience(), p.GetType(), MakeSquare(c, r));
+        }
+    }
+    if(1 != kings[White] || 1 != kings[Black])
+        throw Exception<>("Each side must have exactly one king");
+
+    ret.Turn = Piece::White == b.GetWhoseTurn() ? White : Black;
+    ret.SetCastleColumn(0, b.GetCastleWhiteA());
+    ret.SetCastleColumn(1, b.GetCastleWhiteH());
+    ret.SetCastleColumn(2, b.GetCastleBlackA());
+    ret.SetCastleColumn(3, b.GetCastleBlackH());
+    ret.HalfMoveClock = b.GetHalfMoveClock();
+    ret.FullMoveNumber = b.GetFullMoveNumber();
+
+    Square const *ep = b.GetEnPassantSquare();
+    ret.FinishSetup(ep ? MakeSquare(ep->GetColumn(), ep->GetRow()) : -1);
+    return ret;
+}
+
+GUINT64 Position::ComputeKey() const
+{
+    GUINT64 ret = 0;
+    for(int sq = 0; sq < 64; ++sq){
+        if(NO_PIECE != Squares[sq])
+            ret ^= __piece_key(Squares[sq], sq);
+    }
+    if(Black == Turn)
+        ret ^= __keys()[Zobrist::TurnKey];
+    for(int i = 0; i < 4; ++i){
+        if(-1 != CastleColumns[i])
+            ret ^= __castle_key(i, CastleColumns[i]);
+    }
+    if(-1 != EnPassant)
+        ret ^= __en_passant_key(EnPassant);
+    return ret;
+}
+
+void Position::_put(int kind, int sq)
+{
+    Bitboard b = SquareBit(sq);
+    Pieces[kind / 6][kind % 6] |= b;
+    Colors[kind / 6] |= b;
+    Occupied |= b;
+    Squares[sq] = kind;
+    Key ^= __piece_key(kind, sq);
+    if(Pawn == kind % 6)
+        PawnKey ^= __piece_key(kind, sq);
+    PSQ += PieceSquareTable::Get(kind, sq);
+    Phase += PieceSquareTable::PhaseWeight(kind % 6);
+}
+
+void Position::_remove(int sq)
+{
+    int kind = Squares[sq];
+    Bitboard b = ~SquareBit(sq);
+    Pieces[kind / 6][kind % 6] &= b;
+    Colors[kind / 6] &= b;
+    Occupied &= b;
+    Squares[sq] = NO_PIECE;
+    Key ^= __piece_key(kind, sq);
+    if(Pawn == kind % 6)
+        PawnKey ^= __piece_key(kind, sq);
+    PSQ -= PieceSquareTable::Get(kind, sq);
+    Phase -= PieceSquareTable::PhaseWeight(kind % 6);
+}
+
+void Position::_set_en_passant(int sq)
+{
+    // Only if the side to move has a pawn that can take it
+    if(Attacks::Pawn(Turn ^ 1, sq) & Pieces[Turn][Pawn]){
+        EnPassant = sq;
+        Key ^= __en_passant_key(sq);
+    }
+}
+
+void Position::_clear_castle(int index)
+{
+    if(-1 != CastleColumns[index]){
+        Key ^= __castle_key(index, CastleColumns[index]);
+        CastleColumns[index] = -1;
+    }
+}
+
+bool Position::IsAttacked(int sq, int by) const
+{
+    Bitboard const *p = Pieces[by];
+    return (Attacks::Pawn(by ^ 1, sq) & p[Pawn]) ||
+            (Attacks::Knight(sq) & p[Knight]) ||
+            (Attacks::King(sq) & p[King]) ||
+            (Attacks::Bishop(sq, Occupied) & (p[Bishop] | p[Queen])) ||
+            (Attacks::Rook(sq, Occupied) & (p[Rook] | p[Queen]));
+}
+
+bool Position::IsInsufficientMaterial() const
+{
+    // Only kings, and at most one minor piece between them
+    for(int c = White; c <= Black; ++c){
+        if(Pieces[c][Pawn] | Pieces[c][Rook] | Pieces[c][Queen])
+            return false;
+    }
+    return PopCount(Occupied) <= 3;
+}
+
+// Appends all the moves from the square to the destinations, with promotions for pawns
+static Move *__add_pawn_moves(Move *list, int from, Bitboard dests, bool captures_only)
+{
+    while(dests){
+        int to = PopSquare(dests);
+        int r = Row(to);
+        if(0 == r || 7 == r){
+            *list++ = MakeMove(from, to, PromoteQueen);
+            if(!captures_only){
+                *list++ = MakeMove(from, to, PromoteRook);
+                *list++ = MakeMove(from, to, PromoteBishop);
+                *list++ = MakeMove(from, to, PromoteKnight);
+            }
+        }
+        else
+            *list++ = MakeMove(from, to);
+    }
+    return list;
+}
+
+template<bool captures_only>
+int Position::_generate(Move *list) const
+{
+    Move *const start = list;
+    int const us = Turn, them = Turn ^ 1;
+    Bitboard const mine = Colors[us];
+    Bitboard const targets = captures_only ? Colors[them] : ~mine;
+
+    // Pawns
+    {
+        int const forward = White == us ? 8 : -8;
+        Bitboard const last_row = White == us ? 0xFF00000000000000ULL : 0xFFULL;
+        Bitboard const third_row = White == us ? 0xFF0000ULL : 0xFF0000000000ULL;
+        Bitboard pawns = Pieces[us][Pawn];
+        while(pawns)
+        {
+            int from = PopSquare(pawns);
+            Bitboard caps = Attacks::Pawn(us, from) & Colors[them];
+            list = __add_pawn_moves(list, from, caps, captures_only);
+
+            int to = from + forward;
+            if(NO_PIECE == Squares[to])
+            {
+                Bitboard b = SquareBit(to);
+                if(!captures_only || (b & last_row))
+                    list = __add_pawn_moves(list, from, b, captures_only);
+
+                // A pawn that reaches the third row from its first move can go again
+                if(!captures_only && (b & third_row) && NO_PIECE == Squares[to + forward])
+                    *list++ = MakeMove(from, to + forward, DoublePawnPush);
+            }
+        }
+        if(-1 != EnPassant)
+        {
+            Bitboard takers = Attacks::Pawn(them, EnPassant) & Pieces[us][Pawn];
+            while(takers)
+                *list++ = MakeMove(PopSquare(takers), EnPassant, EnPassantCapture);
+        }
+    }
+
+    // Pieces
+    for(int type = King; type < Pawn; ++type)
+    {
+        Bitboard pieces = Pieces[us][type];
+        while(pieces)
+        {
+            int from = PopSquare(pieces);
+            Bitboard dests;
+            switch(type)
+            {
+            case King:   dests = Attacks::King(from); break;
+            case Queen:  dests = Attacks::Queen(from, Occupied); break;
+            case Rook:   dests = Attacks::Rook(from, Occupied); break;
+            case Bishop: dests = Attacks::Bishop(from, Occupied); break;
+            default:     dests = Attacks::Knight(from); break;
+            }
+            dests &= targets;
+            while(dests)
+                *list++ = MakeMove(from, PopSquare(dests));
+        }
+    }
+
+    if(!captures_only)
+        list += _generate_castles(list);
+    return list - start;
+}
+
+int Position::_generate_castles(Move *list) const
+{
+    int ret = 0;
+    int const us = Turn, them = Turn ^ 1;
+    int const row = White == us ? 0 : 7;
+    int const king = KingSquare(us);
+    if(Row(king) != row)
+        return 0;
+
+    for(int side = CASTLE_A_SIDE; side <= CASTLE_H_SIDE; ++side)
+    {
+        int col = CastleColumns[2 * us + side];
+        if(-1 == col)
+            continue;
+
+        // The king and rook end up on the same squares as in standard chess, and every
+        //  square they cross must be empty except for the two of them
+        int rook = MakeSquare(col, row);
+        int king_dest = MakeSquare(CASTLE_H_SIDE == side ? 6 : 2, row);
+        int rook_dest = MakeSquare(CASTLE_H_SIDE == side ? 5 : 3, row);
+        Bitboard path = Attacks::Between(king, king_dest) | SquareBit(king_dest) |
+                Attacks::Between(rook, rook_dest) | SquareBit(rook_dest);
+        if(path & Occupied & ~SquareBit(king) & ~SquareBit(rook))
+            continue;
+
+        // The king may not castle out of or through check.  Whether it lands in check
+        //  is left to Make(), because only then has the rook moved out of the way.
+        bool attacked = IsAttacked(king, them);
+        Bitboard king_path = Attacks::Between(king, king_dest);
+        while(!attacked && king_path)
+            attacked = IsAttacked(PopSquare(king_path), them);
+        if(!attacked)
+            list[ret++] = MakeMove(king, rook, CastleMove);
+    }
+    return ret;
+}
+
+int Position::GenerateMoves(Move *list) const
+{
+    return _generate<false>(list);
+}
+
+int Position::GenerateCaptures(Move *list) const
+{
+    return _generate<true>(list);
+}
+
+bool Position::Make(Move m)
+{
+    int const us = Turn, them = Turn ^ 1;
+    int const from = MoveSource(m), to = MoveDest(m), flag = MoveFlag(m);
+    int const kind = Squares[from];
+    int const type = kind % 6;
+
+    if(-1 != EnPassant){
+        Key ^= __en_passant_key(EnPassant);
+        EnPassant = -1;
+    }
+    ++HalfMoveClock;
+
+    if(CastleMove == flag)
+    {
+        int row = Row(from);
+        bool h_side = Column(to) > Column(from);
+        _remove(from);
+        _remove(to);
+        _put(kind, MakeSquare(h_side ? 6 : 2, row));
+        _put(6 * us + Rook, MakeSquare(h_side ? 5 : 3, row));
+    }
+    else
+    {
+        if(EnPassantCapture == flag){
+            _remove(to + (White == us ? -8 : 8));
+            HalfMoveClock = 0;
+        }
+        else if(NO_PIECE != Squares[to]){
+            _remove(to);
+            HalfMoveClock = 0;
+        }
+
+        _remove(from);
+        _put(IsPromotion(m) ? 6 * us + PromotedType(m) : kind, to);
+
+        if(Pawn == type)
+            HalfMoveClock = 0;
+    }
+
+    // Moving the king or a rook, or capturing a rook, loses the right to castle with it
+    if(King == type){
+        _clear_castle(2 * us + CASTLE_A_SIDE);
+        _clear_castle(2 * us + CASTLE_H_SIDE);
+    }
+    for(int i = 0; i < 4; ++i){
+        if(-1 != CastleColumns[i]){
+            int rook = MakeSquare(CastleColumns[i], i < 2 ? 0 : 7);
+            if(rook == from || rook == to)
+                _clear_castle(i);
+        }
+    }
+
+    if(Black == us)
+        ++FullMoveNumber;
+    Turn = them;
+    Key ^= __keys()[Zobrist::TurnKey];
+
+    // This has to wait until the turn is switched, because it depends on who can capture
+    if(DoublePawnPush == flag)
+        _set_en_passant((from + to) / 2);
+
+    return !IsAttacked(KingSquare(us), them);
+}
+
+void Position::MakeNull()
+{
+    if(-1 != EnPassant){
+        Key ^= __en_passant_key(EnPassant);
+        EnPassant = -1;
+    }
+    ++HalfMoveClock;
+    Turn ^= 1;
+    Key ^= __keys()[Zobrist::TurnKey];
+}
+
+Move Position::FindMove(int source, int dest, int promoted_type) const
+{
+    Move moves[MAX_MOVES];
+    int count = GenerateMoves(moves);
+    for(int i = 0; i < count; ++i)
+    {
+        Move m = moves[i];
+        if(MoveSource(m) != source)
+            continue;
+
+        bool match;
+        if(CastleMove == MoveFlag(m)){
+            // Either onto the rook, or two squares towards it
+            int king_dest = MakeSquare(Column(MoveDest(m)) > Column(source) ? 6 : 2, Row(source));
+            match = dest == MoveDest(m) ||
+                    (dest == king_dest && 2 == abs(Column(dest) - Column(source)));
+        }
+        else{
+            match = dest == MoveDest(m) &&
+                    (IsPromotion(m) ? promoted_type == PromotedType(m) : NO_PIECE == promoted_type);
+        }
+
+        if(match){
+            Position p(*this);
+            if(p.Make(m))
+                return m;
+        }
+    }
+    return NULL_MOVE;
+}
+
+
+END_NAMESPACE_GKCHESS1;
@@ -0,0 +1,220 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_POSITION_H
+#define GKCHESS_NATIVE_POSITION_H
+
+#include "psqt.h"
+
+namespace GKChess{
+class Board;
+
+namespace Native{
+
+
+/** The colors and piece types have the same values as in GKChess::Piece, so a piece
+ *  kind (6 * color + type) indexes the Zobrist table.
+*/
+enum ColorEnum
+{
+    White = 0,
+    Black = 1
+};
+
+enum PieceTypeEnum
+{
+    King = 0,
+    Queen = 1,
+    Rook = 2,
+    Bishop = 3,
+    Knight = 4,
+    Pawn = 5,
+
+    PieceTypeCount
+};
+
+/** No piece on a square. */
+#define NO_PIECE -1
+
+
+/** A move packed in 16 bits: the source square, the destination square and a flag.
+ *  A castle is the king moving onto its own rook, like in GKChess::Board, so it works
+ *  the same way in Chess960.  0 is not a valid move.
+*/
+typedef GUINT16 Move;
+
+enum MoveFlagEnum
+{
+    NormalMove = 0,
+    DoublePawnPush = 1,
+    CastleMove = 2,
+    EnPassantCapture = 3,
+
+    // The promotions are in the order of PieceTypeEnum, from queen to knight
+    PromoteQueen = 4,
+    PromoteRook = 5,
+    PromoteBishop = 6,
+    PromoteKnight = 7
+};
+
+#define NULL_MOVE 0
+
+inline Move MakeMove(int from, int to, int flag = NormalMove){ return (Move)(from | to << 6 | flag << 12); }
+inline int MoveSource(Move m){ return m & 0x3F; }
+inline int MoveDest(Move m){ return (m >> 6) & 0x3F; }
+inline int MoveFlag(Move m){ return m >> 12; }
+inline bool IsPromotion(Move m){ return PromoteQueen <= MoveFlag(m); }
+
+/** Returns the type of piece the pawn promotes to.  Only valid for promotions. */
+inline int PromotedType(Move m){ return Queen + MoveFlag(m) - PromoteQueen; }
+
+/** The most moves a chess position can have is 218. */
+#define MAX_MOVES 256
+
+
+/** A chess position made for searching: the pieces are kept in bitboards and in a
+ *  square array, and the hash is updated as moves are made.  It's meant to be copied
+ *  to make a move, so it has no pointers and no history.
+*/
+class Position
+{
+public:
+
+    /** The pieces of each color and type. */
+    Bitboard Pieces[2][PieceTypeCount];
+
+    /** All the pieces of each color. */
+    Bitboard Colors[2];
+    Bitboard Occupied;
+
+    /** The piece kind (6 * color + type) on each square, or NO_PIECE. */
+    GINT8 Squares[64];
+
+    int Turn;
+
+    /** The columns of the rooks that can still castle, or -1.  They are in the same
+     *  order as the Zobrist keys: white's A and H sides, then black's.
+    */
+    int CastleColumns[4];
+
+    /** The square behind a pawn that just moved two squares, but only if an enemy pawn
+     *  can capture it, so positions that are the same hash the same.  -1 if there is none.
+    */
+    int EnPassant;
+
+    int HalfMoveClock;
+    int FullMoveNumber;
+
+    /** The Zobrist hash of the position, made from the same keys as GKChess::Zobrist. */
+    GUINT64 Key;
+
+    /** The hash of just the pawns, for the pawn hash table.  It's the same as
+     *  GKChess::Zobrist::PawnHash().
+    */
+    GUINT64 PawnKey;
+
+    /** The sum of the piece-square scores of all the pieces, from white's point of view,
+     *  and the game phase of the material on the board.  They're kept up to date as the
+     *  pieces move, so the evaluation starts from them.
+    */
+    Score PSQ;
+    int Phase;
+
+
+    /** Makes an empty board with white to move. */
+    Position();
+
+    /** \name Setting up a position
+     *  Use these to build a position from scratch, then call FinishSetup().
+     *  \{
+    */
+    void Clear();
+    void PutPiece(int color, int type, int sq);
+    void SetCastleColumn(int index, int col);
+
+    /** Sets the en passant square (or -1) and computes the hash. */
+    void FinishSetup(int en_passant);
+
+    /** \} */
+
+    /** Makes a position from the board, which must be a standard 8x8 board with one king
+     *  of each color.  Throws an exception if it isn't.
+    */
+    static Position FromBoard(const Board &);
+
+    int PieceType(int sq) const{ return NO_PIECE == Squares[sq] ? NO_PIECE : Squares[sq] % 6; }
+    int KingSquare(int color) const{ return LowestSquare(Pieces[color][King]); }
+
+    /** Returns true if any piece of the color attacks the square. */
+    bool IsAttacked(int sq, int by_color) const;
+
+    /** Returns true if the side to move is in check. */
+    bool InCheck() const{ return IsAttacked(KingSquare(Turn), Turn ^ 1); }
+
+    /** Returns true if the color has any pieces other than pawns and the king. */
+    bool HasNonPawnMaterial(int color) const{
+        return 0 != (Colors[color] & ~Pieces[color][Pawn] & ~Pieces[color][King]);
+    }
+
+    /** Returns true if neither side can possibly mate. */
+    bool IsInsufficientMaterial() const;
+
+    bool IsCapture(Move m) const{
+        return EnPassantCapture == MoveFlag(m) ||
+                (CastleMove != MoveFlag(m) && NO_PIECE != Squares[MoveDest(m)]);
+    }
+
+    /** Generates the moves of the side to move into the list and returns how many there
+     *  are.  The moves may leave the king in check; Make() tells you if they do.
+     *  Castles are only generated if they're legal.
+    */
+    int GenerateMoves(Move *list) const;
+
+    /** Generates only the captures and queen promotions, for the quiescence search. */
+    int GenerateCaptures(Move *list) const;
+
+    /** Makes the move, which must have come from one of the generators.  Returns false if
+     *  it left the king in check, in which case the position is no longer valid.
+    */
+    bool Make(Move);
+
+    /** Passes the turn to the other side. */
+    void MakeNull();
+
+    /** Returns the legal move with the given squares and promoted piece type, or NULL_MOVE.
+     *  A castle may be given as the king moving onto its rook, or as the king moving
+     *  two squares.
+    */
+    Move FindMove(int source, int dest, int promoted_type = NO_PIECE) const;
+
+    /** Computes the hash from scratch, which is only for checking. */
+    GUINT64 ComputeKey() const;
+
+
+private:
+
+    void _put(int kind, int sq);
+    void _remove(int sq);
+    void _set_en_passant(int sq);
+    void _clear_castle(int index);
+
+    template<bool captures_only> int _generate(Move *list) const;
+    int _generate_castles(Move *list) const;
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_POSITION_H
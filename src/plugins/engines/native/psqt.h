@@ -0,0 +1,71 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_PSQT_H
+#define GKCHESS_NATIVE_PSQT_H
+
+#include "bitboard.h"
+
+namespace GKChess{ namespace Native{
+
+
+/** A middlegame and an endgame score packed into one int, with the endgame score in the
+ *  upper 16 bits, so adding two scores adds both halves in one instruction.  The halves
+ *  must stay within 16 bits, which evaluation scores easily do.
+*/
+typedef int Score;
+
+inline Score MakeScore(int mg, int eg){ return (int)((unsigned)eg << 16) + mg; }
+inline int MgValue(Score s){ return (GINT16)(GUINT16)(unsigned)s; }
+
+/** The lower half borrows from the upper one when it's negative, so we round it back. */
+inline int EgValue(Score s){ return (GINT16)(GUINT16)((unsigned)(s + 0x8000) >> 16); }
+
+
+/** The material and piece-square values of every piece on every square, which the
+ *  position adds up as pieces move so the evaluation doesn't have to.
+*/
+class PieceSquareTable
+{
+public:
+
+    /** The score of the piece kind (6 * color + type) on the square, from white's point
+     *  of view, so black's pieces have negative scores.
+    */
+    static Score Get(int kind, int sq){ return m_tables.Scores[kind][sq]; }
+
+    /** How much each piece type counts towards the game phase. */
+    static int PhaseWeight(int type){ return m_tables.PhaseWeights[type]; }
+
+    /** The phase with all the pieces on the board. */
+    static int MaxPhase(){ return 24; }
+
+
+private:
+
+    struct tables_t
+    {
+        Score Scores[12][64];
+        int PhaseWeights[6];
+
+        tables_t();
+    };
+    static tables_t const m_tables;
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_PSQT_H
@@ -0,0 +1,698 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "search.h"
+#include "evaluation.h"
+#include "gkchess_tablebases.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/** The history scores are halved when one gets this big, so they don't overflow. */
+#define HISTORY_LIMIT (1 << 24)
+
+/** The size of the first aspiration window around the last iteration's score. */
+#define ASPIRATION_WINDOW 25
+
+NAMESPACE_GKCHESS1(Native);
+
+
+namespace{
+
+// The late move reduction by depth and move number
+struct reductions_t
+{
+    int R[64][64];
+
+    reductions_t(){
+        for(int d = 0; d < 64; ++d)
+            for(int m = 0; m < 64; ++m)
+                R[d][m] = 0 == d || 0 == m ? 0 : (int)(0.75 + log((double)d) * log((double)m) / 2.25);
+    }
+};
+reductions_t const reductions;
+
+// The move ordering scores
+enum
+{
+    TTMoveScore =       1 << 30,
+    CaptureScore =      1 << 28,
+    KillerScore =       1 << 27
+};
+
+}
+
+
+// Mate and tablebase scores are stored relative to the node, so they're right wherever
+//  we find them
+static int __score_to_tt(int score, int ply)
+{
+    if(TB_WIN_BOUND <= score)
+        return score + ply;
+    if(score <= -TB_WIN_BOUND)
+        return score - ply;
+    return score;
+}
+
+static int __score_from_tt(int score, int ply)
+{
+    if(TB_WIN_BOUND <= score)
+        return score - ply;
+    if(score <= -TB_WIN_BOUND)
+        return score + ply;
+    return score;
+}
+
+// The tablebases number the squares, colors and piece types the same way we do
+static Tablebases::Position __tb_position(const Position &pos)
+{
+    Q_STATIC_ASSERT(sizeof(Tablebases::Position().Pieces) == sizeof(pos.Pieces));
+    Tablebases::Position ret;
+    memcpy(ret.Pieces, pos.Pieces, sizeof(ret.Pieces));
+    ret.Turn = pos.Turn;
+    ret.EnPassant = pos.EnPassant;
+    ret.HalfMoveClock = pos.HalfMoveClock;
+    return ret;
+}
+
+// The helper threads skip depths in these patterns, so at any time they're spread
+//  over the next few depths instead of all searching the same one
+static int const __skip_size[] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+static int const __skip_phase[] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+static bool __skip_depth(int thread_index, int depth)
+{
+    if(0 == thread_index)
+        return false;
+    int i = (thread_index - 1) % 20;
+    return 0 != ((depth + __skip_phase[i]) / __skip_size[i]) % 2;
+}
+
+// Moves the best scored move from index i onwards to index i
+static void __pick_move(Move *moves, int *scores, int count, int i)
+{
+    int best = i;
+    for(int j = i + 1; j < count; ++j){
+        if(scores[best] < scores[j])
+            best = j;
+    }
+    if(best != i){
+        std::swap(moves[i], moves[best]);
+        std::swap(scores[i], scores[best]);
+    }
+}
+
+
+Search::Search(TranspositionTable &tt, int thread_index)
+    :m_tt(tt),
+      m_threadIndex(thread_index),
+      m_tb(0),
+      m_tbPieces(0),
+      m_aborted(false),
+      m_nodes(0),
+      m_tbHits(0),
+      m_sharedNodes(0),
+      m_sharedTBHits(0),
+      m_selDepth(0)
+{}
+
+int Search::MateInMoves(int score)
+{
+    if(MATE_BOUND <= score)
+        return (MATE_SCORE - score + 1) / 2;
+    if(score <= -MATE_BOUND)
+        return -(MATE_SCORE + score) / 2;
+    return 0;
+}
+
+void Search::PonderHit()
+{
+    m_timeStart.storeRelease((int)m_timer.elapsed());
+    m_pondering.storeRelease(0);
+}
+
+void Search::Reset(bool pondering)
+{
+    m_stop.storeRelease(0);
+    m_pondering.storeRelease(pondering ? 1 : 0);
+    m_timeStart.storeRelease(0);
+    m_timer.start();
+}
+
+QVector<Search::Line> Search::Run(const Position &root, const QVector<GUINT64> &history,
+                                  const Limits &limits, IReporter *reporter)
+{
+    m_limits = limits;
+    m_aborted = false;
+    m_nodes = 0;
+    m_tbHits = 0;
+    m_sharedNodes.store(0);
+    m_sharedTBHits.store(0);
+    m_tbPieces = m_tb ? m_tb->GetMaxPieces() : 0;
+    m_keys = history;
+    m_keys.append(root.Key);
+    memset(m_killers, 0, sizeof(m_killers));
+    memset(m_history, 0, sizeof(m_history));
+
+    m_rootMoves.clear();
+    Move moves[MAX_MOVES];
+    int count = root.GenerateMoves(moves);
+    for(int i = 0; i < count; ++i)
+    {
+        Position p(root);
+        if(!p.Make(moves[i]))
+            continue;
+        if(!limits.SearchMoves.isEmpty() && !limits.SearchMoves.contains(moves[i]))
+            continue;
+
+        RootMove rm;
+        rm.M = moves[i];
+        rm.Score = rm.PreviousScore = -INFINITE_SCORE;
+        rm.SelDepth = 0;
+        rm.PV.append(moves[i]);
+        m_rootMoves.append(rm);
+    }
+
+    QVector<Line> ret;
+    if(m_rootMoves.isEmpty())
+        return ret;
+    if(_can_probe(root))
+        _filter_root_moves(root);
+
+    int const lines = qBound(1, limits.MultiPV, m_rootMoves.size());
+    int const max_depth = 0 < limits.Depth ? qMin(limits.Depth, MAX_PLY - 1) : MAX_PLY - 1;
+    auto by_score = [](const RootMove &a, const RootMove &b){ return a.Score > b.Score; };
+
+    for(int depth = 1; depth <= max_depth && !m_aborted; ++depth)
+    {
+        if(__skip_depth(m_threadIndex, depth))
+            continue;
+
+        for(RootMove &rm : m_rootMoves)
+            rm.PreviousScore = rm.Score;
+
+        for(int pv_index = 0; pv_index < lines && !m_aborted; ++pv_index)
+        {
+            // Search with a narrow window around the last score, and widen it until the
+            //  score falls inside
+            int previous = m_rootMoves[pv_index].PreviousScore;
+            int delta = ASPIRATION_WINDOW;
+            int alpha = -INFINITE_SCORE, beta = INFINITE_SCORE;
+            if(5 <= depth && abs(previous) < MATE_BOUND){
+                alpha = qMax(previous - delta, -INFINITE_SCORE);
+                beta = qMin(previous + delta, (int)INFINITE_SCORE);
+            }
+
+            m_selDepth = 0;
+            forever
+            {
+                int score = _search_root(root, depth, alpha, beta, pv_index);
+                std::stable_sort(m_rootMoves.begin() + pv_index, m_rootMoves.end(), by_score);
+                if(m_aborted)
+                    break;
+
+                if(score <= alpha){
+                    beta = (alpha + beta) / 2;
+                    alpha = qMax(score - delta, -INFINITE_SCORE);
+                }
+                else if(score >= beta)
+                    beta = qMin(score + delta, (int)INFINITE_SCORE);
+                else
+                    break;
+                delta += delta / 2;
+            }
+            if(m_aborted)
+                break;
+
+            // The lines we've finished at this depth replace the ones from the last one
+            std::stable_sort(m_rootMoves.begin(), m_rootMoves.begin() + pv_index + 1, by_score);
+            ret.resize(qMax(ret.size(), pv_index + 1));
+            for(int i = 0; i <= pv_index; ++i){
+                RootMove const &rm = m_rootMoves[i];
+                ret[i].Depth = depth;
+                ret[i].SelDepth = rm.SelDepth;
+                ret[i].Score = rm.Score;
+                ret[i].Bound = TranspositionTable::ExactScore;
+                ret[i].PV = rm.PV;
+            }
+        }
+        if(m_aborted)
+            break;
+
+        m_sharedNodes.store(m_nodes);
+        m_sharedTBHits.store(m_tbHits);
+        if(reporter){
+            for(int i = 0; i < ret.size(); ++i)
+                reporter->LineFinished(*this, i + 1, ret[i]);
+        }
+
+        // Don't start an iteration we probably can't finish
+        qint64 elapsed = m_timer.elapsed() - m_timeStart.loadAcquire();
+        bool timed = 0 <= m_limits.SoftTime && !m_pondering.loadAcquire();
+        if(timed && (m_limits.SoftTime <= elapsed || 1 == m_rootMoves.size()))
+            break;
+
+        int mate = MateInMoves(ret[0].Score);
+        if(0 < m_limits.Mate && 0 < mate && mate <= m_limits.Mate)
+            break;
+    }
+
+    m_sharedNodes.store(m_nodes);
+    m_sharedTBHits.store(m_tbHits);
+
+    // If we were stopped before the first iteration finished, any legal move will do
+    if(ret.isEmpty()){
+        Line l;
+        l.PV.append(m_rootMoves[0].M);
+        ret.append(l);
+    }
+    return ret;
+}
+
+int Search::_search_root(const Position &root, int depth, int alpha, int beta, int pv_index)
+{
+    // The moves we don't search, or that fail low, go to the end when we sort
+    for(int i = pv_index; i < m_rootMoves.size(); ++i)
+        m_rootMoves[i].Score = -INFINITE_SCORE;
+
+    int best = -INFINITE_SCORE;
+    for(int i = pv_index; i < m_rootMoves.size(); ++i)
+    {
+        RootMove &rm = m_rootMoves[i];
+        Position p(root);
+        p.Make(rm.M);
+        m_keys.append(p.Key);
+
+        int score;
+        if(i == pv_index)
+            score = -_search(p, -beta, -alpha, depth - 1, 1, true);
+        else{
+            score = -_search(p, -alpha - 1, -alpha, depth - 1, 1, true);
+            if(alpha < score && score < beta)
+                score = -_search(p, -beta, -alpha, depth - 1, 1, true);
+        }
+        m_keys.removeLast();
+        if(m_aborted)
+            break;
+
+        if(i == pv_index || alpha < score)
+        {
+            rm.Score = score;
+            rm.SelDepth = m_selDepth;
+            rm.PV.resize(1);
+            for(int j = 1; j < m_pvLength[1]; ++j)
+                rm.PV.append(m_pv[1][j]);
+        }
+        best = qMax(best, score);
+        if(alpha < score){
+            alpha = score;
+            if(beta <= score)
+                break;
+        }
+    }
+    return best;
+}
+
+int Search::_search(const Position &pos, int alpha, int beta, int depth, int ply, bool allow_null)
+{
+    m_pvLength[ply] = ply;
+
+    // Never stop searching in check, so we always see mates
+    bool const in_check = pos.InCheck();
+    if(in_check)
+        ++depth;
+    if(depth <= 0)
+        return _quiesce(pos, alpha, beta, ply);
+
+    if(0 == (++m_nodes & 1023))
+        _check_limits();
+    if(m_aborted)
+        return 0;
+    m_selDepth = qMax(m_selDepth, ply);
+
+    if(100 <= pos.HalfMoveClock || pos.IsInsufficientMaterial() || _is_repetition(pos))
+        return 0;
+    if(MAX_PLY - 1 <= ply)
+        return in_check ? 0 : m_eval.Evaluate(pos);
+
+    // We can't do better than mating right away, or worse than being mated
+    alpha = qMax(alpha, -MATE_SCORE + ply);
+    beta = qMin(beta, MATE_SCORE - ply - 1);
+    if(beta <= alpha)
+        return alpha;
+
+    bool const pv_node = 1 < beta - alpha;
+    TranspositionTable::Entry e;
+    Move tt_move = NULL_MOVE;
+    bool const tt_hit = m_tt.Probe(pos.Key, e);
+    if(tt_hit)
+    {
+        tt_move = e.BestMove;
+        if(!pv_node && depth <= e.Depth)
+        {
+            int score = __score_from_tt(e.Score, ply);
+            int bound = e.GetBound();
+            if(TranspositionTable::ExactScore == bound ||
+                    (TranspositionTable::LowerBound == bound && beta <= score) ||
+                    (TranspositionTable::UpperBound == bound && score <= alpha))
+                return score;
+        }
+    }
+
+    // Right after a capture or pawn move the tablebases know the result, as long as the
+    //  fifty move rule doesn't get in the way
+    if(0 == pos.HalfMoveClock && _can_probe(pos))
+    {
+        Tablebases::WDLEnum wdl;
+        if(m_tb->ProbeWDL(__tb_position(pos), wdl))
+        {
+            ++m_tbHits;
+
+            // A cursed win is a draw, but we'd still rather have it than a plain draw
+            int score;
+            TranspositionTable::BoundEnum bound;
+            if(Tablebases::Win == wdl){
+                score = TB_WIN_SCORE - ply;
+                bound = TranspositionTable::LowerBound;
+            }
+            else if(Tablebases::Loss == wdl){
+                score = -TB_WIN_SCORE + ply;
+                bound = TranspositionTable::UpperBound;
+            }
+            else{
+                score = 2 * wdl;
+                bound = TranspositionTable::ExactScore;
+            }
+
+            if(TranspositionTable::ExactScore == bound ||
+                    (TranspositionTable::LowerBound == bound && beta <= score) ||
+                    (TranspositionTable::UpperBound == bound && score <= alpha))
+            {
+                m_tt.Store(pos.Key, NULL_MOVE, __score_to_tt(score, ply),
+                           in_check ? 0 : m_eval.Evaluate(pos), qMin(MAX_PLY - 1, depth + 6), bound);
+                return score;
+            }
+        }
+    }
+
+    int const eval = in_check ? -INFINITE_SCORE : (tt_hit ? e.Eval : m_eval.Evaluate(pos));
+    if(!pv_node && !in_check)
+    {
+        // If we're so far ahead that a shallow search can't lose it, don't bother
+        if(depth <= 6 && beta <= eval - 80 * depth && abs(beta) < MATE_BOUND)
+            return eval;
+
+        // If passing the turn still beats beta, then a real move would too.  This doesn't
+        //  work in zugzwang, which is mostly when there are only pawns left.
+        if(allow_null && 3 <= depth && beta <= eval && pos.HasNonPawnMaterial(pos.Turn))
+        {
+            int r = 3 + depth / 6;
+            Position child(pos);
+            child.MakeNull();
+            m_keys.append(child.Key);
+            int score = -_search(child, -beta, -beta + 1, depth - 1 - r, ply + 1, false);
+            m_keys.removeLast();
+            if(m_aborted)
+                return 0;
+            if(beta <= score)
+                return MATE_BOUND <= score ? beta : score;
+        }
+    }
+
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count = pos.GenerateMoves(moves);
+    _order_moves(pos, moves, scores, count, tt_move, ply);
+
+    int const original_alpha = alpha;
+    int best = -INFINITE_SCORE;
+    Move best_move = NULL_MOVE;
+    int legal = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        __pick_move(moves, scores, count, i);
+        Move m = moves[i];
+        Position child(pos);
+        if(!child.Make(m))
+            continue;
+        ++legal;
+
+        bool const quiet = !pos.IsCapture(m) && !IsPromotion(m);
+        bool const killer = m == m_killers[ply][0] || m == m_killers[ply][1];
+        int const new_depth = depth - 1;
+        m_keys.append(child.Key);
+
+        int score;
+        if(1 == legal)
+            score = -_search(child, -beta, -alpha, new_depth, ply + 1, true);
+        else
+        {
+            // Late quiet moves are probably bad, so we search them less deeply unless
+            //  they turn out to be good
+            int r = 0;
+            if(3 <= depth && 3 < legal && quiet && !in_check && !child.InCheck())
+            {
+                r = reductions.R[qMin(depth, 63)][qMin(legal, 63)];
+                if(pv_node)
+                    --r;
+                if(killer)
+                    --r;
+                r = qBound(0, r, new_depth - 1);
+            }
+
+            score = -_search(child, -alpha - 1, -alpha, new_depth - r, ply + 1, true);
+            if(alpha < score && 0 < r)
+                score = -_search(child, -alpha - 1, -alpha, new_depth, ply + 1, true);
+            if(alpha < score && score < beta)
+                score = -_search(child, -beta, -alpha, new_depth, ply + 1, true);
+        }
+        m_keys.removeLast();
+        if(m_aborted)
+            return 0;
+
+        if(best < score)
+        {
+            best = score;
+            best_move = m;
+            if(alpha < score)
+            {
+                alpha = score;
+                _update_pv(ply, m);
+                if(beta <= score)
+                {
+                    if(quiet)
+                    {
+                        if(!killer){
+                            m_killers[ply][1] = m_killers[ply][0];
+                            m_killers[ply][0] = m;
+                        }
+
+                        int &h = m_history[pos.Turn][MoveSource(m)][MoveDest(m)];
+                        h += depth * depth;
+                        if(HISTORY_LIMIT < h){
+                            int *p = &m_history[0][0][0];
+                            for(size_t j = 0; j < sizeof(m_history) / sizeof(int); ++j)
+                                p[j] /= 2;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    if(0 == legal)
+        return in_check ? -MATE_SCORE + ply : 0;
+
+    TranspositionTable::BoundEnum bound;
+    if(beta <= best)
+        bound = TranspositionTable::LowerBound;
+    else if(original_alpha < best)
+        bound = TranspositionTable::ExactScore;
+    else{
+        // None of the moves were any good, so we don't know which was best
+        bound = TranspositionTable::UpperBound;
+        best_move = NULL_MOVE;
+    }
+    m_tt.Store(pos.Key, best_move, __score_to_tt(best, ply), in_check ? 0 : eval, depth, bound);
+    return best;
+}
+
+int Search::_quiesce(const Position &pos, int alpha, int beta, int ply)
+{
+    m_pvLength[ply] = ply;
+    if(0 == (++m_nodes & 1023))
+        _check_limits();
+    if(m_aborted)
+        return 0;
+    m_selDepth = qMax(m_selDepth, ply);
+
+    bool const in_check = pos.InCheck();
+    if(MAX_PLY - 1 <= ply)
+        return in_check ? 0 : m_eval.Evaluate(pos);
+
+    // Unless we're in check we can stand pat, and only look at captures
+    Move moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int count;
+    int best, stand_pat = -INFINITE_SCORE;
+    if(in_check){
+        best = -INFINITE_SCORE;
+        count = pos.GenerateMoves(moves);
+    }
+    else{
+        best = stand_pat = m_eval.Evaluate(pos);
+        if(beta <= best)
+            return best;
+        alpha = qMax(alpha, best);
+        count = pos.GenerateCaptures(moves);
+    }
+    _order_moves(pos, moves, scores, count, NULL_MOVE, ply);
+
+    int legal = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        __pick_move(moves, scores, count, i);
+        Move m = moves[i];
+
+        // Don't bother with captures that can't bring us back up to alpha
+        if(!in_check && !IsPromotion(m)){
+            int victim = EnPassantCapture == MoveFlag(m) ? Pawn : pos.PieceType(MoveDest(m));
+            if(stand_pat + Evaluation::PieceValue(victim) + 200 < alpha)
+                continue;
+        }
+
+        Position child(pos);
+        if(!child.Make(m))
+            continue;
+        ++legal;
+
+        int score = -_quiesce(child, -beta, -alpha, ply + 1);
+        if(m_aborted)
+            return 0;
+
+        if(best < score)
+        {
+            best = score;
+            if(alpha < score)
+            {
+                alpha = score;
+                _update_pv(ply, m);
+                if(beta <= score)
+                    break;
+            }
+        }
+    }
+
+    if(in_check && 0 == legal)
+        return -MATE_SCORE + ply;
+    return best;
+}
+
+int Search::_order_moves(const Position &pos, Move *moves, int *scores, int count, Move tt_move, int ply) const
+{
+    for(int i = 0; i < count; ++i)
+    {
+        Move m = moves[i];
+        int flag = MoveFlag(m);
+        if(m == tt_move)
+            scores[i] = TTMoveScore;
+        else if(pos.IsCapture(m) || PromoteQueen == flag)
+        {
+            // Most valuable victim first, then least valuable attacker
+            int victim = EnPassantCapture == flag ? Pawn : pos.PieceType(MoveDest(m));
+            int ret = CaptureScore - Evaluation::PieceValue(pos.PieceType(MoveSource(m))) / 10;
+            if(NO_PIECE != victim)
+                ret += 10 * Evaluation::PieceValue(victim);
+            if(PromoteQueen == flag)
+                ret += 10 * Evaluation::PieceValue(Queen);
+            scores[i] = ret;
+        }
+        else if(IsPromotion(m))
+            scores[i] = -1;
+        else if(m == m_killers[ply][0])
+            scores[i] = KillerScore;
+        else if(m == m_killers[ply][1])
+            scores[i] = KillerScore - 1;
+        else
+            scores[i] = m_history[pos.Turn][MoveSource(m)][MoveDest(m)];
+    }
+    return count;
+}
+
+bool Search::_is_repetition(const Position &pos) const
+{
+    // The current position is the last key, and only the same side's turns can match
+    int const end = m_keys.size() - 1;
+    int const limit = qMax(0, end - pos.HalfMoveClock);
+    for(int i = end - 4; limit <= i; i -= 2){
+        if(m_keys[i] == pos.Key)
+            return true;
+    }
+    return false;
+}
+
+bool Search::_can_probe(const Position &pos) const
+{
+    return 0 < m_tbPieces && PopCount(pos.Occupied) <= m_tbPieces &&
+            -1 == pos.CastleColumns[0] && -1 == pos.CastleColumns[1] &&
+            -1 == pos.CastleColumns[2] && -1 == pos.CastleColumns[3];
+}
+
+void Search::_filter_root_moves(const Position &root)
+{
+    // Keep the moves that get the best result with the fewest plies to zero, which
+    //  always makes progress.  The search picks between them, so it still goes for
+    //  the quickest mate it can see.
+    Tablebases::Position pos = __tb_position(root);
+    QVector<Tablebases::MoveResult> results;
+    if(!m_tb->ProbeMoves(pos, results))
+        return;
+    m_tbHits += results.size();
+
+    QVector<RootMove> kept;
+    for(Tablebases::MoveResult const &r : Tablebases::BestMoves(pos, results)){
+        Move m = root.FindMove(r.Source, r.Dest, r.PromotedType);
+        for(RootMove const &rm : m_rootMoves){
+            if(rm.M == m)
+                kept.append(rm);
+        }
+    }
+    if(!kept.isEmpty())
+        m_rootMoves.swap(kept);
+}
+
+void Search::_check_limits()
+{
+    m_sharedNodes.store(m_nodes);
+    m_sharedTBHits.store(m_tbHits);
+    if(m_stop.loadAcquire())
+        m_aborted = true;
+    else if(0 < m_limits.Nodes && m_limits.Nodes <= m_nodes)
+        m_aborted = true;
+    else if(0 <= m_limits.HardTime && !m_pondering.loadAcquire() &&
+            m_limits.HardTime <= m_timer.elapsed() - m_timeStart.loadAcquire())
+        m_aborted = true;
+}
+
+void Search::_update_pv(int ply, Move m)
+{
+    m_pv[ply][ply] = m;
+    for(int i = ply + 1; i < m_pvLength[ply + 1]; ++i)
+        m_pv[ply][i] = m_pv[ply + 1][i];
+    m_pvLength[ply] = qMax(ply + 1, m_pvLength[ply + 1]);
+}
+
+
+END_NAMESPACE_GKCHESS1;
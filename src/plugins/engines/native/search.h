@@ -0,0 +1,225 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_SEARCH_H
+#define GKCHESS_NATIVE_SEARCH_H
+
+#include "transpositiontable.h"
+#include "evaluation.h"
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QVector>
+
+namespace GKChess{
+class Tablebases;
+
+namespace Native{
+
+
+/** The highest score, which is mate on the board. */
+#define MATE_SCORE 32000
+
+/** Scores beyond this are mates, and the distance to MATE_SCORE is the number of plies. */
+#define MATE_BOUND (MATE_SCORE - 1000)
+
+#define INFINITE_SCORE 32001
+
+/** The deepest we search, including extensions and the quiescence search. */
+#define MAX_PLY 128
+
+/** A win we know from the tablebases, which is worth less than any mate we find but
+ *  more than any evaluation.  Like mates, it's adjusted by the ply we find it at so we
+ *  go for the nearest one.
+*/
+#define TB_WIN_SCORE (MATE_BOUND - MAX_PLY)
+
+/** Scores beyond this are tablebase wins or mates. */
+#define TB_WIN_BOUND (TB_WIN_SCORE - MAX_PLY)
+
+
+/** An alpha-beta search with iterative deepening, principal variation search, null
+ *  move pruning, late move reductions and a quiescence search, on one thread.
+ *
+ *  You give it the position and limits and it reports each line as it finishes an
+ *  iteration.  It can be stopped from another thread.  Several of them can search
+ *  the same position at once with a shared hash table; see ParallelSearch.
+*/
+class Search
+{
+public:
+
+    /** The limits of a search.  Zero means unlimited. */
+    struct Limits
+    {
+        int Depth;
+        GUINT64 Nodes;
+
+        /** Stop when we find a mate in this many moves. */
+        int Mate;
+
+        /** We don't start another iteration after the soft time, and we stop in the middle
+         *  of one at the hard time.  In milliseconds, or -1 for no limit.
+        */
+        qint64 SoftTime;
+        qint64 HardTime;
+
+        /** The number of lines to find. */
+        int MultiPV;
+
+        /** Only search these moves at the root, if it's not empty. */
+        QVector<Move> SearchMoves;
+
+        Limits() :Depth(0), Nodes(0), Mate(0), SoftTime(-1), HardTime(-1), MultiPV(1) {}
+    };
+
+    /** One line of the result, from the root's point of view. */
+    struct Line
+    {
+        int Depth;
+        int SelDepth;
+        int Score;
+
+        /** Whether the score is exact or only a bound. */
+        TranspositionTable::BoundEnum Bound;
+        QVector<Move> PV;
+
+        Line() :Depth(0), SelDepth(0), Score(0), Bound(TranspositionTable::ExactScore) {}
+    };
+
+    /** Gets the results as the search goes. */
+    class IReporter
+    {
+    public:
+        /** Called for each line when the search finishes an iteration. */
+        virtual void LineFinished(const Search &, int multipv, const Line &) = 0;
+        virtual ~IReporter(){}
+    };
+
+    /** The thread index is 0 for the main search.  The helpers of a parallel search
+     *  have higher indexes, and skip some depths so they don't all do the same work.
+    */
+    explicit Search(TranspositionTable &, int thread_index = 0);
+
+    /** Probes the tablebases during the search, or not if it's null.  At the root the
+     *  moves that don't keep the tablebase result aren't searched.  Don't call this
+     *  while it's searching.
+    */
+    void SetTablebases(const Tablebases *tb){ m_tb = tb; }
+
+    /** Starts the clock and clears the stop flag, so call it on the thread that controls
+     *  the search before you give it to another thread to run.  That way a Stop() or
+     *  PonderHit() can't get lost if it comes before Run() starts.  If pondering, the
+     *  time limits don't count until PonderHit() is called.
+    */
+    void Reset(bool pondering);
+
+    /** Searches the position until it reaches a limit or it's stopped.  The history has
+     *  the hashes of the game's positions before the root, for detecting repetitions.
+     *  Call TranspositionTable::NewSearch() before you start it.
+     *
+     *  Returns the best lines, which are empty if there are no legal moves.
+    */
+    QVector<Line> Run(const Position &root, const QVector<GUINT64> &history,
+                      const Limits &, IReporter * = 0);
+
+    /** Stops the search as soon as possible.  You can call this from any thread. */
+    void Stop(){ m_stop.storeRelease(1); }
+
+    /** Starts the clock for a pondering search.  You can call this from any thread. */
+    void PonderHit();
+
+    /** The nodes searched so far, which is updated every thousand or so nodes.  You can
+     *  call this from any thread.
+    */
+    GUINT64 GetNodes() const{ return m_sharedNodes.load(); }
+
+    /** The positions found in the tablebases so far, which is updated like the nodes. */
+    GUINT64 GetTBHits() const{ return m_sharedTBHits.load(); }
+
+    /** The time since the search started, in milliseconds. */
+    qint64 GetElapsed() const{ return m_timer.elapsed(); }
+
+    /** Converts a search score to a mate distance in moves, as in UCI: positive if we
+     *  mate and negative if we get mated.  Returns 0 if it's not a mate score.
+    */
+    static int MateInMoves(int score);
+
+
+private:
+
+    struct RootMove
+    {
+        Move M;
+        int Score;
+        int PreviousScore;
+        int SelDepth;
+        QVector<Move> PV;
+    };
+
+    TranspositionTable &m_tt;
+    int const m_threadIndex;
+
+    // Our own, so its pawn hash table doesn't have to be shared
+    Evaluation m_eval;
+    Tablebases const *m_tb;
+    int m_tbPieces;
+    Limits m_limits;
+    QAtomicInt m_stop;
+    QAtomicInt m_pondering;
+    QElapsedTimer m_timer;
+
+    // When the time limits count from, which changes on a ponder hit
+    QAtomicInt m_timeStart;
+
+    bool m_aborted;
+    GUINT64 m_nodes;
+
+    GUINT64 m_tbHits;
+
+    // The counts for other threads to read, which we update now and then
+    QAtomicInteger<quint64> m_sharedNodes;
+    QAtomicInteger<quint64> m_sharedTBHits;
+    int m_selDepth;
+
+    // The hashes of the positions from the start of the game to the current node
+    QVector<GUINT64> m_keys;
+
+    QVector<RootMove> m_rootMoves;
+
+    // The principal variation found at each ply
+    Move m_pv[MAX_PLY][MAX_PLY];
+    int m_pvLength[MAX_PLY];
+
+    // Quiet moves that caused a cutoff at each ply, and how often each move has
+    Move m_killers[MAX_PLY][2];
+    int m_history[2][64][64];
+
+    int _search_root(const Position &, int depth, int alpha, int beta, int pv_index);
+    int _search(const Position &, int alpha, int beta, int depth, int ply, bool allow_null);
+    int _quiesce(const Position &, int alpha, int beta, int ply);
+
+    int _order_moves(const Position &, Move *, int *scores, int count, Move tt_move, int ply) const;
+    bool _is_repetition(const Position &) const;
+    bool _can_probe(const Position &) const;
+    void _filter_root_moves(const Position &);
+    void _check_limits();
+    void _update_pv(int ply, Move);
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_SEARCH_H
@@ -0,0 +1,186 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+/** Benchmarks the native engine on a fixed set of positions.
+ *
+ *  Usage: native_bench [depth] [max_threads]
+ *  First it measures how many positions per second the static evaluation gets through,
+ *  on the positions and the ones a couple of moves after them.  Then it searches every
+ *  position to the depth with 1, 2, 4... threads up to the maximum, starting with an
+ *  empty hash table each time, and prints the time to reach the depth and the speedup
+ *  over one thread.
+*/
+
+#include "gkchess_iengine.h"
+#include "gkchess_board.h"
+#include "evaluation.h"
+#include <gutil/pluginutils.h>
+#include <gutil/consolelogger.h>
+#include <gutil/exception.h>
+#include <QCoreApplication>
+#include <QPluginLoader>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QEventLoop>
+#include <QThread>
+#include <cstdio>
+#include <cstdlib>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GUTIL1(Qt);
+USING_NAMESPACE_GKCHESS;
+USING_NAMESPACE_GKCHESS1(Native);
+
+#define DEFAULT_DEPTH   12
+#define BENCH_HASH_SIZE 64
+
+/** How long we keep evaluating, in milliseconds. */
+#define EVAL_BENCH_TIME 1000
+
+
+// Openings, middlegames and endgames, with tactics and quiet positions
+static char const *__positions[] =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP1B1PPP/R2QKB1R w KQ - 0 8",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r2q1rk1/pp1bbppp/2nppn2/8/3NP3/2N1BP2/PPPQ2PP/2KR1B1R w - - 0 10",
+    "2rq1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1PN1PN2/PB2BPPP/2RQ1RK1 w - - 0 12",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 7 19",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/1p1r1k2/p1pPN1p1/P3KnP1/1P6/8/3R4 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+};
+
+#define POSITION_COUNT (int)(sizeof(__positions) / sizeof(__positions[0]))
+
+
+// Adds the position and the positions up to the depth after it
+static void __add_positions(QVector<Position> &list, const Position &pos, int depth)
+{
+    list.append(pos);
+    if(0 == depth)
+        return;
+
+    Move moves[MAX_MOVES];
+    int count = pos.GenerateMoves(moves);
+    for(int i = 0; i < count; ++i){
+        Position child(pos);
+        if(child.Make(moves[i]))
+            __add_positions(list, child, depth - 1);
+    }
+}
+
+// Evaluates the positions over and over, and prints how fast it went
+static void __bench_evaluation()
+{
+    QVector<Position> positions;
+    for(int i = 0; i < POSITION_COUNT; ++i){
+        Board b;
+        b.FromFEN(__positions[i]);
+        __add_positions(positions, Position::FromBoard(b), 2);
+    }
+
+    // We add up the scores so the compiler can't leave out the evaluation.  After the
+    //  first pass all the pawn structures are in the pawn table, like in a search.
+    Evaluation eval;
+    GUINT64 evals = 0;
+    int sum = 0;
+    QElapsedTimer t;
+    t.start();
+    while(t.elapsed() < EVAL_BENCH_TIME){
+        for(Position const &p : positions)
+            sum += eval.Evaluate(p);
+        evals += positions.size();
+    }
+    double secs = t.nsecsElapsed() / 1e9;
+
+    printf("Evaluated %d positions %llu times in %.2f s (checksum %d):\n",
+           positions.size(), (unsigned long long)(evals / positions.size()), secs, sum);
+    printf("  %.0f evals/s, %.1f ns/eval\n\n", evals / secs, secs * 1e9 / evals);
+}
+
+
+// Searches the position to the depth, and returns the time it took in milliseconds
+static double __search(IEngine &e, const char *fen, int depth, GUINT64 &nodes)
+{
+    e.NewGame();
+    e.SetPosition(fen);
+
+    IEngine::ThinkParams p;
+    p.SearchTime = 0;
+    p.Depth = depth;
+
+    QEventLoop loop;
+    QObject::connect(&e, SIGNAL(BestMove(const GenericMove &, const GenericMove &)), &loop, SLOT(quit()));
+    QElapsedTimer t;
+    t.start();
+    e.StartThinking(p);
+    if(e.IsThinking())
+        loop.exec();
+    double ret = t.nsecsElapsed() / 1e6;
+
+    QList<IEngine::SearchInfo> lines = e.GetSearchLines();
+    if(!lines.isEmpty())
+        nodes += lines[0].Nodes;
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int depth = 1 < argc ? atoi(argv[1]) : DEFAULT_DEPTH;
+    int max_threads = 2 < argc ? atoi(argv[2]) : QThread::idealThreadCount();
+
+    QPluginLoader pl;
+    try
+    {
+        __bench_evaluation();
+
+        IEngine *plugin = PluginUtils::LoadPlugin<IEngine>(pl, "nativeEnginePlugin");
+        QScopedPointer<IEngine> e(plugin->Create());
+        e->StartEngine(QString());
+        e->SetOption("Hash", BENCH_HASH_SIZE);
+
+        printf("%d positions to depth %d, %d MB hash:\n", POSITION_COUNT, depth, BENCH_HASH_SIZE);
+        printf("  threads   time (s)      nodes     knps  speedup\n");
+
+        double base_time = 0;
+        for(int threads = 1; threads <= max_threads; threads = threads < max_threads ? qMin(2 * threads, max_threads) : threads + 1)
+        {
+            e->SetOption("Threads", threads);
+
+            double time = 0;
+            GUINT64 nodes = 0;
+            for(int i = 0; i < POSITION_COUNT; ++i)
+                time += __search(*e, __positions[i], depth, nodes);
+            if(1 == threads)
+                base_time = time;
+
+            printf("  %7d %10.2f %10llu %8.0f %8.2f\n",
+                   threads, time / 1000, (unsigned long long)nodes,
+                   0 == time ? 0 : nodes / time, 0 == time ? 0 : base_time / time);
+        }
+        e->StopEngine();
+    }
+    catch(const Exception<> &ex)
+    {
+        ConsoleLogger().LogException(ex);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+#-------------------------------------------------
+#
+# Benchmarks the native engine plugin, which is
+#  built in the bin directory.  The evaluation is
+#  benchmarked directly, so we compile it in too.
+#
+#-------------------------------------------------
+
+TOP_DIR = ../../../../../..
+
+DESTDIR = $$TOP_DIR/bin
+QMAKE_CXXFLAGS += -std=c++11
+
+# Build the evaluation the same way as the plugin, so use CONFIG+=popcnt for both
+popcnt {
+    DEFINES += USE_POPCNT
+    !win32-msvc*:QMAKE_CXXFLAGS += -mpopcnt
+}
+
+INCLUDEPATH += ../.. $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/gutil/lib \
+    -L$$TOP_DIR/lib \
+    -lGUtil \
+    -lGUtilQt \
+    -lGKChess
+
+QT       += core
+
+QT       -= gui
+
+TARGET = native_bench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../bitboard.cpp \
+    ../../psqt.cpp \
+    ../../position.cpp \
+    ../../evaluation.cpp \
+    ../../pawntable.cpp \
+    ../../material.cpp
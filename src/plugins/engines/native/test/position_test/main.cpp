@@ -0,0 +1,220 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+/** Checks the native engine's positions.
+ *
+ *  Usage: position_test
+ *  First it counts the moves to a fixed depth from standard and Chess960 positions,
+ *  and compares them with the published perft counts.  At every node the hash and
+ *  the pawn hash it updated as it made the move have to be the same as the ones it
+ *  computes from scratch.
+ *
+ *  Then it checks that the hash of a position after a double pawn push is the same
+ *  whether the engine updates it as it makes the move, computes it from scratch or
+ *  gets it from GKChess::Zobrist, and that the en passant square only counts if it
+ *  can be captured.
+ *
+ *  Returns the number of failures.
+*/
+
+#include "position.h"
+#include "gkchess_board.h"
+#include "gkchess_zobrist.h"
+#include <gutil/consolelogger.h>
+#include <gutil/exception.h>
+#include <QByteArray>
+#include <QList>
+#include <cstdio>
+#include <cstring>
+USING_NAMESPACE_GUTIL;
+USING_NAMESPACE_GKCHESS;
+USING_NAMESPACE_GKCHESS1(Native);
+
+
+struct perft_t
+{
+    char const *FEN;
+    int Depth;
+    GUINT64 Nodes;
+};
+
+static perft_t const __perfts[] =
+{
+    // Castling, en passant, promotions and checks
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281 },
+    { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862 },
+    { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+    { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 3, 9467 },
+    { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379 },
+
+    // Chess960, with the castling rooks given by their columns
+    { "bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9", 4, 326672 },
+    { "2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9", 4, 667366 },
+    { "b1q1rrkb/pppppppp/3nn3/8/P7/1PPP4/4PPPP/BQNNRKRB w GE - 1 9", 4, 273318 },
+};
+
+#define PERFT_COUNT (int)(sizeof(__perfts) / sizeof(__perfts[0]))
+
+
+struct double_push_t
+{
+    char const *Before;
+    char const *Source;
+    char const *Dest;
+    char const *After;
+
+    // If a pawn of the side to move can capture en passant after the push
+    bool Capturable;
+};
+
+static double_push_t const __double_pushes[] =
+{
+    // Nothing next to the pawn
+    { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e2", "e4",
+      "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", false },
+
+    // A pawn of the side that pushed is next to it
+    { "rnbqkbnr/pppppppp/8/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 0 1", "e2", "e4",
+      "rnbqkbnr/pppppppp/8/8/3PP3/8/PPP2PPP/RNBQKBNR b KQkq e3 0 1", false },
+
+    // An enemy pawn two columns away
+    { "rnbqkbnr/ppp1pppp/8/8/3p4/8/PPPPPPPP/RNBQKBNR w KQkq - 0 2", "b2", "b4",
+      "rnbqkbnr/ppp1pppp/8/8/1P1p4/8/P1PPPPPP/RNBQKBNR b KQkq b3 0 2", false },
+
+    // Enemy pawns next to it, for each color
+    { "rnbqkbnr/pppp1ppp/8/8/4p3/8/PPPPPPPP/RNBQKBNR w KQkq - 0 2", "d2", "d4",
+      "rnbqkbnr/pppp1ppp/8/8/3Pp3/8/PPP1PPPP/RNBQKBNR b KQkq d3 0 2", true },
+    { "rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", "f7", "f5",
+      "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", true },
+};
+
+#define DOUBLE_PUSH_COUNT (int)(sizeof(__double_pushes) / sizeof(__double_pushes[0]))
+
+
+static int __square(const char *s)
+{
+    return MakeSquare(s[0] - 'a', s[1] - '1');
+}
+
+static GUINT64 __zobrist(const char *fen)
+{
+    Board b;
+    b.FromFEN(fen);
+    return Zobrist::Hash(b);
+}
+
+// The FEN with the en passant square taken out
+static QByteArray __without_en_passant(const char *fen)
+{
+    QList<QByteArray> fields = QByteArray(fen).split(' ');
+    fields[3] = "-";
+    return fields.join(' ');
+}
+
+static GUINT64 __pawn_key(const Position &pos)
+{
+    GUINT64 ret = 0;
+    for(int sq = 0; sq < 64; ++sq){
+        if(NO_PIECE != pos.Squares[sq] && Pawn == pos.Squares[sq] % 6)
+            ret ^= Zobrist::GetKeys()[Zobrist::PieceKeys + 64 * pos.Squares[sq] + sq];
+    }
+    return ret;
+}
+
+// Counts the nodes at the depth, and the ones where the hashes were wrong
+static GUINT64 __perft(const Position &pos, int depth, int &bad_keys)
+{
+    Move moves[MAX_MOVES];
+    int const count = pos.GenerateMoves(moves);
+    GUINT64 ret = 0;
+    for(int i = 0; i < count; ++i)
+    {
+        Position child(pos);
+        if(!child.Make(moves[i]))
+            continue;
+        if(child.Key != child.ComputeKey() || child.PawnKey != __pawn_key(child))
+            ++bad_keys;
+        ret += 1 == depth ? 1 : __perft(child, depth - 1, bad_keys);
+    }
+    return ret;
+}
+
+// Returns the number of failures
+static int __test_perft()
+{
+    int ret = 0;
+    for(int i = 0; i < PERFT_COUNT; ++i)
+    {
+        perft_t const &t = __perfts[i];
+        Board b;
+        b.FromFEN(t.FEN);
+        Position pos = Position::FromBoard(b);
+
+        int bad_keys = 0;
+        GUINT64 const nodes = __perft(pos, t.Depth, bad_keys);
+        bool const ok = t.Nodes == nodes && 0 == bad_keys && Zobrist::Hash(b) == pos.Key;
+        if(!ok)
+            ++ret;
+        printf("%s perft %d: %llu nodes, expected %llu, %d wrong hashes: %s\n",
+               ok ? "ok  " : "FAIL", t.Depth, (unsigned long long)nodes,
+               (unsigned long long)t.Nodes, bad_keys, t.FEN);
+    }
+    return ret;
+}
+
+// Returns the number of failures
+static int __test_double_pushes()
+{
+    int ret = 0;
+    for(int i = 0; i < DOUBLE_PUSH_COUNT; ++i)
+    {
+        double_push_t const &t = __double_pushes[i];
+        Board before;
+        before.FromFEN(t.Before);
+        Position pos = Position::FromBoard(before);
+        pos.Make(pos.FindMove(__square(t.Source), __square(t.Dest)));
+
+        GUINT64 const expected = __zobrist(t.After);
+        bool const counted = expected != __zobrist(__without_en_passant(t.After).constData());
+        bool const ok = expected == pos.Key &&
+                expected == pos.ComputeKey() &&
+                t.Capturable == counted &&
+                t.Capturable == (-1 != pos.EnPassant);
+        if(!ok)
+            ++ret;
+        printf("%s %s%s: key %016llx, Zobrist %016llx, en passant %s\n",
+               ok ? "ok  " : "FAIL", t.Source, t.Dest,
+               (unsigned long long)pos.Key, (unsigned long long)expected,
+               counted ? "counted" : "not counted");
+    }
+    return ret;
+}
+
+
+int main(int, char *[])
+{
+    int failures = 0;
+    try
+    {
+        failures += __test_perft();
+        failures += __test_double_pushes();
+    }
+    catch(const Exception<> &ex)
+    {
+        ConsoleLogger().LogException(ex);
+        return -1;
+    }
+    printf("%d failures\n", failures);
+    return failures;
+}
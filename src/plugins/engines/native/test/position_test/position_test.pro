@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Checks the native engine's move generator
+#  with perft, and its hashes against
+#  GKChess::Zobrist.
+#
+#-------------------------------------------------
+
+TOP_DIR = ../../../../../..
+
+QMAKE_CXXFLAGS += -std=c++11
+
+INCLUDEPATH += ../.. $$TOP_DIR/include $$TOP_DIR/gutil/include
+LIBS += \
+    -L$$TOP_DIR/gutil/lib \
+    -L$$TOP_DIR/lib \
+    -lGUtil \
+    -lGKChess
+
+QT       += core
+
+QT       -= gui
+
+TARGET = position_test
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+
+SOURCES += main.cpp \
+    ../../bitboard.cpp \
+    ../../psqt.cpp \
+    ../../position.cpp
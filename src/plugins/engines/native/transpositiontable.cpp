@@ -0,0 +1,183 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "transpositiontable.h"
+#include <new>
+
+/** The size of a cache line, which is the size of a bucket. */
+#define CACHE_LINE_SIZE 64
+
+NAMESPACE_GKCHESS1(Native);
+
+
+// The entry data is packed into 64 bits: the move, the score, the static eval, the depth
+//  and the flags, from the low bits up.
+static GUINT64 __pack(Move m, int score, int eval, int depth, int flags)
+{
+    return (GUINT64)m |
+            (GUINT64)(GUINT16)score << 16 |
+            (GUINT64)(GUINT16)eval << 32 |
+            (GUINT64)(GUINT8)depth << 48 |
+            (GUINT64)(GUINT8)flags << 56;
+}
+
+static void __unpack(GUINT64 key, GUINT64 data, TranspositionTable::Entry &e)
+{
+    e.Key = key;
+    e.BestMove = (Move)data;
+    e.Score = (GINT16)(data >> 16);
+    e.Eval = (GINT16)(data >> 32);
+    e.Depth = (GUINT8)(data >> 48);
+    e.Flags = (GUINT8)(data >> 56);
+}
+
+static int __bound(GUINT64 data)
+{
+    return (data >> 56) & 0x3;
+}
+
+static int __generation(GUINT64 data)
+{
+    return (data >> 58) & 0x3F;
+}
+
+
+TranspositionTable::TranspositionTable(int megabytes)
+    :m_memory(0),
+      m_buckets(0),
+      m_mask(0),
+      m_megabytes(0),
+      m_generation(0)
+{
+    Q_STATIC_ASSERT(sizeof(Bucket) == CACHE_LINE_SIZE);
+    Resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable()
+{
+    _free();
+}
+
+void TranspositionTable::_free()
+{
+    for(GUINT64 i = 0; m_buckets && i <= m_mask; ++i)
+        m_buckets[i].~Bucket();
+    delete[] m_memory;
+    m_memory = 0;
+    m_buckets = 0;
+    m_mask = 0;
+}
+
+void TranspositionTable::Resize(int megabytes)
+{
+    if(megabytes < 1)
+        megabytes = 1;
+
+    // Round down to a power of two, so we can find a bucket with a mask
+    GUINT64 count = 1;
+    while(2 * count * sizeof(Bucket) <= (GUINT64)megabytes * 1024 * 1024)
+        count *= 2;
+
+    // Allocate an extra cache line so we can align the buckets to one, then construct
+    //  the buckets in place so the atomics have begun their lifetime
+    _free();
+    m_memory = new char[count * sizeof(Bucket) + CACHE_LINE_SIZE];
+    m_buckets = reinterpret_cast<Bucket *>(((quintptr)m_memory + CACHE_LINE_SIZE - 1) & ~(quintptr)(CACHE_LINE_SIZE - 1));
+    for(GUINT64 i = 0; i < count; ++i)
+        new(m_buckets + i) Bucket;
+    m_mask = count - 1;
+    m_megabytes = megabytes;
+    Clear();
+}
+
+void TranspositionTable::Clear()
+{
+    for(GUINT64 i = 0; i <= m_mask; ++i){
+        for(Slot &s : m_buckets[i].Slots){
+            s.KeyXorData.store(0);
+            s.Data.store(0);
+        }
+    }
+    m_generation = 0;
+}
+
+bool TranspositionTable::Probe(GUINT64 key, Entry &e) const
+{
+    Bucket const &b = _bucket(key);
+    for(int i = 0; i < 4; ++i){
+        GUINT64 data = b.Slots[i].Data.load();
+        if((b.Slots[i].KeyXorData.load() ^ data) == key && NoBound != __bound(data)){
+            __unpack(key, data, e);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::Store(GUINT64 key, Move m, int score, int eval, int depth, BoundEnum bound)
+{
+    Bucket &b = _bucket(key);
+
+    // Use the position's own entry if it has one, otherwise the least valuable one.
+    //  We only read each slot once, because other threads may be changing it.
+    Slot *target = &b.Slots[0];
+    GUINT64 target_data = 0;
+    bool same_key = false;
+    int worst = 0x7FFFFFFF;
+    for(int i = 0; i < 4; ++i)
+    {
+        Slot &s = b.Slots[i];
+        GUINT64 data = s.Data.load();
+        GUINT64 slot_key = s.KeyXorData.load() ^ data;
+        if(slot_key == key || NoBound == __bound(data)){
+            target = &s;
+            target_data = data;
+            same_key = slot_key == key;
+            break;
+        }
+
+        int age = (m_generation - __generation(data)) & 0x3F;
+        int value = (int)(GUINT8)(data >> 48) - 8 * age;
+        if(value < worst){
+            worst = value;
+            target = &s;
+            target_data = data;
+        }
+    }
+
+    // Keep the best move we knew if this search didn't find one
+    if(NULL_MOVE == m && same_key)
+        m = (Move)target_data;
+
+    GUINT64 data = __pack(m, score, eval, qBound(0, depth, 255), bound | m_generation << 2);
+    target->KeyXorData.store(key ^ data);
+    target->Data.store(data);
+}
+
+int TranspositionTable::GetHashFull() const
+{
+    int ret = 0;
+    int count = (int)qMin((GUINT64)250, m_mask + 1);
+    for(int i = 0; i < count; ++i){
+        for(int j = 0; j < 4; ++j){
+            GUINT64 data = m_buckets[i].Slots[j].Data.load();
+            if(NoBound != __bound(data) && m_generation == __generation(data))
+                ++ret;
+        }
+    }
+    return 0 == count ? 0 : ret * 1000 / (4 * count);
+}
+
+
+END_NAMESPACE_GKCHESS1;
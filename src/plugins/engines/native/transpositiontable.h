@@ -0,0 +1,128 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_NATIVE_TRANSPOSITIONTABLE_H
+#define GKCHESS_NATIVE_TRANSPOSITIONTABLE_H
+
+#include "position.h"
+#include <QAtomicInteger>
+
+namespace GKChess{ namespace Native{
+
+
+/** Remembers search results by position hash, so the search doesn't have to repeat
+ *  work it already did in another branch, another iteration or an earlier search.
+ *
+ *  The entries are grouped in buckets of four that fill a cache line.  When a bucket
+ *  is full we replace the entry that is shallowest and from the oldest search.
+ *
+ *  All the search threads share one table without locking it.  Each entry is two
+ *  64-bit words, the data and the key xor'd with the data, so if two threads write
+ *  the same entry at once and we read half of each, the key won't match and we
+ *  treat it as a miss.
+*/
+class TranspositionTable
+{
+public:
+
+    enum BoundEnum
+    {
+        NoBound = 0,
+
+        /** The score is at most this. */
+        UpperBound = 1,
+
+        /** The score is at least this. */
+        LowerBound = 2,
+
+        ExactScore = UpperBound | LowerBound
+    };
+
+    /** An entry unpacked from the table. */
+    struct Entry
+    {
+        GUINT64 Key;
+        Move BestMove;
+        GINT16 Score;
+        GINT16 Eval;
+        GUINT8 Depth;
+
+        /** The bound in the low 2 bits, and the search generation in the rest. */
+        GUINT8 Flags;
+
+        int GetBound() const{ return Flags & 0x3; }
+        int GetGeneration() const{ return Flags >> 2; }
+    };
+
+    explicit TranspositionTable(int megabytes = 16);
+    ~TranspositionTable();
+
+    /** Resizes the table to the nearest power of two buckets, which clears it.
+     *  Don't call this while a search is using the table.
+    */
+    void Resize(int megabytes);
+    int GetSize() const{ return m_megabytes; }
+
+    /** Don't call this while a search is using the table. */
+    void Clear();
+
+    /** Call this once at the start of every search, before the threads start, so we
+     *  can tell old entries from new ones.
+    */
+    void NewSearch(){ m_generation = (m_generation + 1) & 0x3F; }
+
+    /** Looks up the position and returns true if it was found.  Any thread may call this. */
+    bool Probe(GUINT64 key, Entry &) const;
+
+    /** Any thread may call this. */
+    void Store(GUINT64 key, Move, int score, int eval, int depth, BoundEnum);
+
+    /** Returns how full the table is with entries from this search, in permill. */
+    int GetHashFull() const;
+
+
+private:
+
+    struct Slot
+    {
+        QAtomicInteger<quint64> KeyXorData;
+        QAtomicInteger<quint64> Data;
+    };
+
+    struct Bucket
+    {
+        Slot Slots[4];
+    };
+
+    // The buckets start on a cache line boundary inside the memory we allocated
+    char *m_memory;
+    Bucket *m_buckets;
+    GUINT64 m_mask;
+    int m_megabytes;
+    int m_generation;
+
+    void _free();
+
+    Bucket &_bucket(GUINT64 key){ return m_buckets[key & m_mask]; }
+    Bucket const &_bucket(GUINT64 key) const{ return m_buckets[key & m_mask]; }
+
+    TranspositionTable(const TranspositionTable &);
+    TranspositionTable &operator = (const TranspositionTable &);
+
+};
+
+
+}}
+
+#endif // GKCHESS_NATIVE_TRANSPOSITIONTABLE_H
@@ -0,0 +1,88 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_SPSC_QUEUE_H
+#define GKCHESS_SPSC_QUEUE_H
+
+#include <QAtomicPointer>
+
+namespace GKChess{
+
+
+/** An unbounded lock-free queue for exactly one producer thread and one consumer thread.
+ *
+ *  The queue is a linked list that always holds one dummy node at the head.  The producer
+ *  only touches the tail and the consumer only touches the head, and the two meet at the
+ *  Next pointer of the last node, which is published with release/acquire ordering.
+*/
+template<class T>
+class SPSC_Queue
+{
+    struct node_t
+    {
+        T Value;
+        QAtomicPointer<node_t> Next;
+        node_t() :Next(0) {}
+    };
+
+    // Only used by the consumer
+    node_t *m_head;
+
+    // Only used by the producer
+    node_t *m_tail;
+
+    SPSC_Queue(const SPSC_Queue &);
+    SPSC_Queue &operator = (const SPSC_Queue &);
+public:
+
+    SPSC_Queue() :m_head(new node_t), m_tail(m_head) {}
+
+    ~SPSC_Queue(){
+        while(m_head){
+            node_t *next = m_head->Next.load();
+            delete m_head;
+            m_head = next;
+        }
+    }
+
+    /** Adds an item to the back of the queue.  Only call this from the producer thread. */
+    void Push(const T &item){
+        node_t *n = new node_t;
+        n->Value = item;
+        m_tail->Next.storeRelease(n);
+        m_tail = n;
+    }
+
+    /** Takes the item at the front of the queue and returns true, or returns false if the
+     *  queue is empty.  Only call this from the consumer thread.
+    */
+    bool Pop(T &item){
+        node_t *next = m_head->Next.loadAcquire();
+        if(!next)
+            return false;
+
+        // The next node becomes the new dummy, so we take its value out
+        item = next->Value;
+        next->Value = T();
+        delete m_head;
+        m_head = next;
+        return true;
+    }
+
+};
+
+
+}
+
+#endif // GKCHESS_SPSC_QUEUE_H
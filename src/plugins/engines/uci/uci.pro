@@ -30,6 +30,11 @@ LIBS += \
     -lGUtil \
     -lGKChess
 
-SOURCES += uci_client.cpp
-
-HEADERS += uci_client.h
+SOURCES += uci_client.cpp \
+    uci_info.cpp \
+    uci_io.cpp
+
+HEADERS += uci_client.h \
+    uci_info.h \
+    uci_io.h \
+    spsc_queue.h
@@ -13,12 +13,18 @@ See the License for the specific language governing permissions and
 limitations under the License.*/
 
 #include "uci_client.h"
+#include "uci_io.h"
+#include "gkchess_searchinfomerger.h"
 #include <gutil/string.h>
 #include <gkchess_common.h>
 #include <gutil/consolelogger.h>
-#include <QFile>
 #include <QtPlugin>
 #include <QVariant>
+#include <QThread>
+#include <QQueue>
+#include <QFile>
+#include <QVector>
+#include <cstring>
 USING_NAMESPACE_GUTIL;
 
 
@@ -28,13 +34,64 @@ struct d_t
 {
     QString engine;
     QStringList arguments;
+
+    // This is raised as soon as we ask the I/O thread to start the engine, and
+    //  info_valid is raised when the handshake has finished
+    bool started;
+    bool info_valid;
     bool thinking;
+    QByteArray start_error;
+
+    // All communication with the engine happens on this thread
+    QThread thread;
+    GKChess::UCI_IO *io;
 
-    QProcess process;
     GKChess::UCI_Client::EngineInfo info;
 
+    // Options that were set before we knew what options the engine has
+    QVariantMap early_options;
+
+    // All the options we sent, so we can restore them if the engine crashes
+    QVariantMap option_values;
+
+    // The latest search info for each MultiPV line of the search
+    GKChess::SearchInfoMerger search_info;
+
+    // The game the engine is working on, so we can tell when a position continues it.
+    //  The position command is kept with the length it had after each move, so when
+    //  the game changes we only have to format the moves that are different.
+    bool game_valid;
+    bool new_game_sent;
+    QByteArray game_start;
+    QList<GKChess::GenericMove> game_moves;
+    QByteArray game_command;
+    QVector<int> game_command_lengths;
+
+    // Measurements of the engine I/O, and what we need to keep track of for them.
+    //  The times are from UCI_IO::Now().
+    GKChess::IEngine::Statistics stats;
+    qint64 stats_start;
+    qint64 uci_sent;
+    QQueue<qint64> ready_sent;
+    qint64 go_sent;
+    bool go_timed;
+    int go_movetime;
+    bool first_info_seen;
+    QFile trace;
+
     d_t()
-        :thinking(false)
+        :started(false),
+          info_valid(false),
+          thinking(false),
+          io(0),
+          game_valid(false),
+          new_game_sent(false),
+          stats_start(GKChess::UCI_IO::Now()),
+          uci_sent(-1),
+          go_sent(-1),
+          go_timed(false),
+          go_movetime(0),
+          first_info_seen(false)
     {}
 };
 
@@ -45,195 +102,64 @@ struct d_t
 NAMESPACE_GKCHESS;
 
 
-static QByteArray __get_next_token(const QByteArray &ba, int indx)
+static QFuture<bool> __finished_future(bool result)
 {
-    QByteArray ret;
-    bool first_chars_seen = false;
-    for(int i = indx; i < ba.length(); ++i)
-    {
-        if(String::IsWhitespace(ba[i])){
-            if(first_chars_seen)
-                break;
-        }
-        else
-        {
-            first_chars_seen = true;
-            ret.append(ba[i]);
-        }
-    }
-    return ret;
+    QFutureInterface<bool> p;
+    p.reportStarted();
+    p.reportResult(result);
+    p.reportFinished();
+    return p.future();
 }
 
-static QByteArray __get_option_name(const QByteArray &ba, int indx, const char *terminator)
+// Applies the value to our in-memory copy of the option
+static void __apply_option_value(IEngine::Option_t *opt, const QVariant &value)
 {
-    QByteArray ret;
-    int i = indx;
-    int term_len = strlen(terminator);
-    while(i < ba.length() &&
-          0 != memcmp(terminator, ba.constData() + i, term_len))
+    switch(opt->GetType())
     {
-        ret.append(ba[i]);
-        ++i;
+    case IEngine::Option_t::Check:
+    {
+        IEngine::CheckOption *co = static_cast<IEngine::CheckOption *>(opt);
+        co->Value = value.toInt();
     }
-    return ret.trimmed();
-}
-
-static QByteArray __get_option_value(const QByteArray &ba, int indx)
-{
-    QByteArray ret;
-    int i = indx;
-    while(i < ba.length())
+        break;
+    case IEngine::Option_t::Spin:
     {
-        char c = ba[i];
-        if(String::IsWhitespace(c)){
-            break;
-        }
-        else{
-            ret.append(c);
-        }
-        ++i;
+        IEngine::SpinOption *so = static_cast<IEngine::SpinOption *>(opt);
+        so->Value = value.toInt();
     }
-    return ret.trimmed();
-}
-
-void UCI_Client::_start_and_validate_engine(bool populate_data)
-{
-    G_D;
-    if(!QFile(d->engine).exists())
-        throw Exception<>("File does not exist");
-
-    d->process.setReadChannel(QProcess::StandardOutput);
-    d->process.start(d->engine, d->arguments);
-    if(!d->process.waitForStarted())
-        throw Exception<>("Engine unable to start");
-
-    // Ignore the first bit of junk the engine sends
-    d->process.waitForReadyRead(-1);
-    d->process.readAllStandardOutput();
-
-    if(d->process.state() != QProcess::Running)
-        throw Exception<>("Engine crashed immediately after starting");
-
-    bool valid = true;
-    QString name;
-
-    d->process.write("uci\n");
-    d->process.waitForReadyRead(-1);
-    QByteArray output = d->process.readAllStandardOutput();
-
-    if(populate_data)
+        break;
+    case IEngine::Option_t::String:
     {
-        valid = false;
-        int cur_idx = 0;
-        while(cur_idx < output.length())
-        {
-            int nl_idx = output.indexOf('\n', cur_idx);
-            QByteArray line;
-            if(-1 != nl_idx){
-                line = output.left(nl_idx).right(nl_idx - cur_idx);
-                cur_idx = nl_idx + 1;
-            }
-
-            if(line.startsWith("id"))
-            {
-                int name_idx = line.indexOf("name");
-                int author_idx = line.indexOf("author");
-
-                if(-1 != name_idx){
-                    name = line.right(line.length() - (name_idx + 5));
-                    d->info.Name = name;
-                }
-                if(-1 != author_idx){
-                    d->info.Author = line.right(line.length() - (author_idx + 7));
-                }
-            }
-            else if(line.startsWith("option"))
-            {
-                int name_idx = line.indexOf("name");
-                int type_idx = line.indexOf("type");
-
-                // Must have a name and type
-                if(-1 == name_idx || -1 == type_idx)
-                    break;
-
-                QString opt_name = __get_option_name(line, name_idx + 5, "type");
-                QString opt_type = __get_option_value(line, type_idx + 5);
-                UCI_Client::Option_t *opt = 0;
-
-                if(opt_type == "spin")
-                {
-                    int default_idx = line.indexOf("default");
-                    int min_idx = line.indexOf("min");
-                    int max_idx = line.indexOf("max");
-                    if(-1 == default_idx || -1 == min_idx || -1 == max_idx)
-                        break;
-
-                    QString default_str = __get_option_value(line, default_idx + 8);
-                    QString min_str = __get_option_value(line, min_idx + 4);
-                    QString max_str = __get_option_value(line, max_idx + 4);
-                    opt = new IEngine::SpinOption(opt_name, default_str.toInt(), min_str.toInt(), max_str.toInt());
-                }
-                else if(opt_type == "string")
-                {
-                    int default_idx = line.indexOf("default");
-                    if(-1 == default_idx)
-                        break;
-
-                    QString val = __get_option_value(line, default_idx + 8);
-                    opt = new IEngine::StringOption(opt_name, val);
-
-                }
-                else if(opt_type == "check")
-                {
-                    int default_idx = line.indexOf("default");
-                    if(-1 == default_idx)
-                        break;
-
-                    QString val_str = __get_option_value(line, default_idx + 8);
-                    bool checked = val_str.toLower() == "true";
-                    opt = new IEngine::CheckOption(opt_name, checked);
-                }
-                else if(opt_type == "combo")
-                {
-                    opt = new IEngine::ComboOption(opt_name, QStringList(), QString());
-                }
-                else if(opt_type == "button")
-                {
-                    opt = new IEngine::ButtonOption(opt_name);
-                }
-                else
-                {
-                    // Unrecognized option
-                    break;
-                }
-
-                if(opt){
-                    d->info.OptionNames.append(opt_name);
-                    d->info.Options.insert(opt_name, opt);
-                }
-            }
-            else if(line.startsWith("uciok"))
-            {
-                if(!name.isEmpty())
-                    valid = true;
-                break;
-            }
-        }
+        IEngine::StringOption *so = static_cast<IEngine::StringOption *>(opt);
+        so->Value = value.toString();
+    }
+        break;
+    case IEngine::Option_t::Combo:
+    {
+        IEngine::ComboOption *co = static_cast<IEngine::ComboOption *>(opt);
+        co->Value = value.toString();
+    }
+        break;
+    default:
+        break;
     }
-
-    if(!valid)
-        throw Exception<>("The engine is not UCI compatible");
 }
 
 
-
 UCI_Client::UCI_Client(QObject *parent)
     :IEngine(parent)
 {
     G_D_INIT();
+    G_D;
 
     connect(this, SIGNAL(BestMove(const GenericMove &, const GenericMove &)), this, SLOT(_best_move_received()));
-    //qRegisterMetaType<QProcess::ProcessError>("QProcess::ProcessError");
+    qRegisterMetaType<GKChess::IEngine::SearchInfo>();
+    connect(&d->search_info, SIGNAL(SearchInfoReady(const GKChess::IEngine::SearchInfo &)),
+            this, SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)));
+
+    d->io = new UCI_IO(this, "_process_events");
+    d->io->moveToThread(&d->thread);
+    d->thread.start();
 }
 
 IEngine *UCI_Client::Create() const
@@ -243,8 +169,19 @@ IEngine *UCI_Client::Create() const
 
 UCI_Client::~UCI_Client()
 {
-    if(IsEngineStarted())
-        StopEngine();
+    G_D;
+
+    // Quit the engine on the I/O thread, then stop the thread
+    QMetaObject::invokeMethod(d->io, "Shutdown", ::Qt::BlockingQueuedConnection);
+    d->thread.quit();
+    d->thread.wait();
+
+    // Don't leak anything that was still on its way to us
+    UCI_IO::Event e;
+    while(d->io->TakeEvent(e))
+        delete e.EngineInfo;
+    delete d->io;
+
     G_D_UNINIT();
 }
 
@@ -256,26 +193,43 @@ void UCI_Client::StartEngine(const QString &path_to_engine, const QStringList &a
     }
 
     G_D;
+    QFuture<bool> f = StartEngineAsync(path_to_engine, args);
+    f.waitForFinished();
 
-    d->engine = path_to_engine;
-    d->arguments = args;
-
-    try{
-        _start_and_validate_engine(true);
-    } catch(...){
-        d->engine.clear();
-        d->arguments.clear();
-        throw;
-    }
+    // Handle the events now, so the engine info is populated when we return
+    _process_events();
 
-    connect(&d->process, SIGNAL(error(QProcess::ProcessError)),
-            this, SLOT(_engine_error(QProcess::ProcessError)));
-    connect(&d->process, SIGNAL(finished(int)), this, SLOT(_engine_stopped(int)));
+    if(!f.result())
+        throw Exception<>(d->start_error.constData());
+}
 
-    NewGame();
-    _wait_for_ready(-1);
+QFuture<bool> UCI_Client::StartEngineAsync(const QString &path_to_engine, const QStringList &args)
+{
+    if(IsEngineStarted()){
+        GDEBUG("Engine already started!");
+        return WaitForReadyAsync();
+    }
 
-    connect(&d->process, SIGNAL(readyRead()), this, SLOT(_read_from_engine()));
+    G_D;
+    d->engine = path_to_engine;
+    d->arguments = args;
+    d->started = true;
+    d->info_valid = false;
+    d->thinking = false;
+    d->start_error.clear();
+    d->early_options.clear();
+    d->option_values.clear();
+
+    // The engine gets a new game as part of the handshake
+    d->game_valid = false;
+    d->new_game_sent = true;
+
+    UCI_IO::Command c(UCI_IO::Command::Start);
+    c.Path = path_to_engine;
+    c.Arguments = args;
+    c.Promise.reportStarted();
+    d->io->PostCommand(c);
+    return c.Promise.future();
 }
 
 void UCI_Client::StopEngine()
@@ -286,45 +240,18 @@ void UCI_Client::StopEngine()
     }
 
     G_D;
-
-    _disconnect_from_process();
-
-    _write_to_engine("quit");
-
-    // Give the process time to exit gracefully
-    if(!d->process.waitForFinished(5000))
-    {
-        // If it doesn't exit, then kill it
-        d->process.kill();
-        d->process.waitForFinished();
-    }
-}
-
-void UCI_Client::_disconnect_from_process()
-{
-    G_D;
-
-    // Disconnect all signals from the process
-    disconnect(&d->process, SIGNAL(readyRead()), this, SLOT(_read_from_engine()));
-    disconnect(&d->process, SIGNAL(error(QProcess::ProcessError)),
-               this, SLOT(_engine_error(QProcess::ProcessError)));
-    disconnect(&d->process, SIGNAL(finished(int)), this, SLOT(_engine_stopped(int)));
+    d->io->PostCommand(UCI_IO::Command(UCI_IO::Command::Stop));
 
     d->engine.clear();
     d->arguments.clear();
+    d->started = false;
     d->thinking = false;
 }
 
 bool UCI_Client::IsEngineStarted() const
 {
     G_D;
-    return !d->engine.isEmpty();
-}
-
-UCI_Client::EngineInfo::~EngineInfo()
-{
-    for(Option_t *o : Options)
-        delete o;
+    return d->started;
 }
 
 const UCI_Client::EngineInfo &UCI_Client::GetEngineInfo() const
@@ -333,113 +260,238 @@ const UCI_Client::EngineInfo &UCI_Client::GetEngineInfo() const
     return d->info;
 }
 
-void UCI_Client::_engine_error(QProcess::ProcessError err)
+static void __add_time(GUINT64 &total, GUINT64 &max, qint64 t)
 {
-    G_D;
-    switch(err)
-    {
-    case QProcess::WriteError:
-    case QProcess::ReadError:
-    case QProcess::Timedout:
-        // kill the process if it's timing out
-        d->process.kill();
-    default:break;
-    }
+    GUINT64 ut = qMax((qint64)0, t);
+    total += ut;
+    if(max < ut)
+        max = ut;
 }
 
-void UCI_Client::_engine_stopped(int ec)
+// Writes one line of the trace.  Lines may have commas and quotes in them, so we quote them.
+static void __trace(d_t *d, const char *direction, qint64 posted, qint64 io, qint64 delivered, const QByteArray &line)
 {
-    G_D;
-    GUTIL_UNUSED(ec);
-
-    emit NotifyEngineCrashed();
-
-    QString engine = d->engine;
-    QStringList args = d->arguments;
+    if(!d->trace.isOpen())
+        return;
 
-    _disconnect_from_process();
-    StartEngine(engine, args);
+    QByteArray quoted = line;
+    quoted.replace('"', "\"\"");
+    QByteArray row = direction;
+    row.append(',').append(-1 == posted ? QByteArray() : QByteArray::number(posted))
+       .append(',').append(QByteArray::number(io))
+       .append(',').append(QByteArray::number(delivered))
+       .append(",\"").append(quoted).append("\"\n");
+    d->trace.write(row);
 }
 
-void UCI_Client::_read_from_engine()
+static void __measure_sent(d_t *d, const UCI_IO::Event &e, qint64 now)
 {
-    G_D;
-    QByteArray ba = d->process.readLine();
-    while(0 < ba.length())
+    IEngine::Statistics &s = d->stats;
+    ++s.LinesSent;
+    s.BytesSent += e.Line.length() + 1;
+    __add_time(s.SendDelayTotal, s.SendDelayMax, e.Timestamp - e.Posted);
+
+    if(e.Line == "uci")
+        d->uci_sent = e.Timestamp;
+    else if(e.Line == "isready")
+        d->ready_sent.enqueue(e.Timestamp);
+    else if(e.Line.startsWith("go"))
     {
-        _process_line_received(ba);
-        ba = d->process.readLine();
+        d->go_sent = e.Timestamp;
+        d->first_info_seen = false;
+        d->go_timed = !e.Line.contains(" infinite") && !e.Line.contains(" ponder");
+        d->go_movetime = 0;
+        int indx = e.Line.indexOf(" movetime ");
+        if(-1 != indx)
+            d->go_movetime = e.Line.mid(indx + 10).split(' ').first().toInt();
+        ++s.SearchCount;
+    }
+    else if(e.Line == "ponderhit")
+    {
+        // From here on it's a normal search, so it's timed from now
+        d->go_sent = e.Timestamp;
+        d->go_timed = true;
     }
+    __trace(d, "tx", e.Posted, e.Timestamp, now, e.Line);
 }
 
-void UCI_Client::_write_to_engine(const QByteArray &ba)
+static void __measure_received(d_t *d, const UCI_IO::Event &e, qint64 now)
 {
-    G_D;
-    QByteArray line = ba + '\n';
-    qint64 len = d->process.write(line);
-    if(len == line.length())
-        emit MessageSent(ba);
+    IEngine::Statistics &s = d->stats;
+    ++s.LinesReceived;
+    s.BytesReceived += e.Line.length() + 1;
+    __add_time(s.ReceiveDelayTotal, s.ReceiveDelayMax, now - e.Timestamp);
+
+    if(e.Line == "readyok" && !d->ready_sent.isEmpty())
+    {
+        qint64 sent = d->ready_sent.dequeue();
+        ++s.ReadyCount;
+        __add_time(s.ReadyTimeTotal, s.ReadyTimeMax, e.Timestamp - sent);
+
+        // The first readyok finishes the handshake
+        if(-1 != d->uci_sent){
+            s.HandshakeTime = e.Timestamp - d->uci_sent;
+            d->uci_sent = -1;
+        }
+    }
+    else if(-1 != d->go_sent && UCI_IO::Event::SearchInfoParsed == e.Parsed && !d->first_info_seen)
+    {
+        d->first_info_seen = true;
+        __add_time(s.FirstInfoTimeTotal, s.FirstInfoTimeMax, e.Timestamp - d->go_sent);
+    }
+    else if(-1 != d->go_sent && UCI_IO::Event::BestMoveParsed == e.Parsed)
+    {
+        qint64 t = e.Timestamp - d->go_sent;
+        if(d->go_timed){
+            ++s.TimedSearchCount;
+            __add_time(s.BestMoveTimeTotal, s.BestMoveTimeMax, t);
+            if(0 < d->go_movetime){
+                ++s.MoveTimeSearchCount;
+                __add_time(s.MoveTimeOverrunTotal, s.MoveTimeOverrunMax, t - 1000 * (qint64)d->go_movetime);
+            }
+        }
+        d->go_sent = -1;
+    }
+    __trace(d, "rx", -1, e.Timestamp, now, e.Line);
 }
 
-void UCI_Client::_process_line_received(QByteArray &ba)
+void UCI_Client::_process_events()
 {
-    // Remove the newline
-    ba.chop(ba.length() - ba.indexOf('\n', ba.length() - 2));
-    emit MessageReceived(ba);
-
-    if(ba.contains("bestmove"))
+    G_D;
+    UCI_IO::Event e;
+    while(d->io->TakeEvent(e))
     {
-        int indx = ba.indexOf("bestmove");
-        QByteArray move = __get_next_token(ba, indx + 9);
-
-        QByteArray ponder;
-        indx = ba.indexOf("ponder");
-        if(-1 != indx)
-            ponder = __get_next_token(ba, indx + 7);
-
-        if(ponder == "(none)")
-            ponder = QByteArray();
-
-        emit BestMove(GenericMove(move), GenericMove(ponder));
+        switch(e.Type)
+        {
+        case UCI_IO::Event::Started:
+            if(e.EngineInfo)
+            {
+                // Take over the engine info
+                for(Option_t *o : d->info.Options)
+                    delete o;
+                d->info.clear();
+                d->info.Name = e.EngineInfo->Name;
+                d->info.Author = e.EngineInfo->Author;
+                d->info.OptionNames.swap(e.EngineInfo->OptionNames);
+                d->info.Options.swap(e.EngineInfo->Options);
+                delete e.EngineInfo;
+
+                // These were already sent to the engine, we only need to remember them
+                for(auto iter = d->early_options.begin(); iter != d->early_options.end(); ++iter){
+                    if(d->info.Options.contains(iter.key()))
+                        __apply_option_value(d->info.Options[iter.key()], iter.value());
+                }
+                d->early_options.clear();
+                d->info_valid = true;
+            }
+            else if(d->started && !d->info_valid)
+            {
+                d->start_error = e.Line;
+                d->engine.clear();
+                d->arguments.clear();
+                d->started = false;
+            }
+            break;
+        case UCI_IO::Event::LineSent:
+            __measure_sent(d, e, UCI_IO::Now());
+            emit MessageSent(e.Line);
+            break;
+        case UCI_IO::Event::LineReceived:
+            __measure_received(d, e, UCI_IO::Now());
+            emit MessageReceived(e.Line);
+            if(UCI_IO::Event::SearchInfoParsed == e.Parsed)
+            {
+                d->search_info.Add(e.SearchInfo);
+            }
+            else if(UCI_IO::Event::BestMoveParsed == e.Parsed)
+            {
+                // Make sure they get the final search info before the best move
+                d->search_info.Flush();
+                emit BestMove(e.BestMove, e.Ponder);
+            }
+            break;
+        case UCI_IO::Event::Crashed:
+        {
+            emit NotifyEngineCrashed();
+
+            QString engine = d->engine;
+            QStringList args = d->arguments;
+            QVariantMap options = d->option_values;
+            d->started = false;
+            d->thinking = false;
+            d->ready_sent.clear();
+            d->go_sent = -1;
+            if(!engine.isEmpty())
+            {
+                // Restart it with the same options it had
+                StartEngineAsync(engine, args);
+                for(auto iter = options.begin(); iter != options.end(); ++iter)
+                    SetOption(iter.key(), iter.value());
+            }
+        }
+            break;
+        default:
+            break;
+        }
     }
 }
 
-bool UCI_Client::WaitForReady(int timeout_ms)
+void UCI_Client::_write_to_engine(const QByteArray &ba)
 {
     G_D;
-    disconnect(&d->process, SIGNAL(readyRead()), this, SLOT(_read_from_engine()));
-
-    bool ret = _wait_for_ready(timeout_ms);
+    UCI_IO::Command c(UCI_IO::Command::Write);
+    c.Line = ba;
+    d->io->PostCommand(c);
+}
 
-    connect(&d->process, SIGNAL(readyRead()), this, SLOT(_read_from_engine()));
+bool UCI_Client::WaitForReady(int timeout_ms)
+{
+    G_D;
+    if(!IsEngineStarted())
+        return false;
+
+    // The I/O thread releases the semaphore when "readyok" comes back, so we don't run
+    //  an event loop here, which would let our caller's slots re-enter while it waits.
+    //  The command shares the semaphore, so it's still there if we time out first.
+    UCI_IO::Command c(UCI_IO::Command::IsReady);
+    c.Resolved = QSharedPointer<QSemaphore>(new QSemaphore);
+    c.Promise.reportStarted();
+    d->io->PostCommand(c);
+    bool ret = c.Resolved->tryAcquire(1, timeout_ms) && c.Promise.future().result();
+
+    // Handle everything the engine said before it was ready
+    _process_events();
     return ret;
 }
 
-bool UCI_Client::_wait_for_ready(int timeout_ms)
+QFuture<bool> UCI_Client::WaitForReadyAsync()
 {
     G_D;
-    bool ret = false;
-    _write_to_engine("isready");
-
-    // keep reading until we get the readyok
-    while(d->process.waitForReadyRead(timeout_ms)){
-        QByteArray ba = d->process.readLine();
-        _process_line_received(ba);
-        if(ba == "readyok"){
-            ret = true;
-            break;
-        }
-    }
-    return ret;
+    if(!IsEngineStarted())
+        return __finished_future(false);
+
+    UCI_IO::Command c(UCI_IO::Command::IsReady);
+    c.Promise.reportStarted();
+    d->io->PostCommand(c);
+    return c.Promise.future();
 }
 
 void UCI_Client::NewGame()
 {
+    G_D;
     _write_to_engine("ucinewgame");
+    d->game_valid = false;
+    d->new_game_sent = true;
 }
 
 void UCI_Client::SetPosition(const char *data)
 {
+    G_D;
+
+    // We don't know what game this position is from
+    d->game_valid = false;
+    d->new_game_sent = false;
+
     QByteArray ba;
     if(GUINT32_MAX != String(data).IndexOf("startpos"))
         ba = String::Format("position %s", data).ConstData();
@@ -448,45 +500,64 @@ void UCI_Client::SetPosition(const char *data)
     _write_to_engine(ba);
 }
 
-void UCI_Client::SetOption(const QString &name, const QVariant &value)
+void UCI_Client::SetGamePosition(const char *start, const QList<GenericMove> &moves)
 {
     G_D;
-    if(!d->info.Options.contains(name))
-        return;
-
-    // Apply the change to our in-memory struct
-    IEngine::Option_t *opt = d->info.Options[name];
-    switch(opt->GetType())
-    {
-    case IEngine::Option_t::Check:
+    int same_moves = 0;
+    if(d->game_valid && d->game_start == start)
     {
-        IEngine::CheckOption *co = static_cast<IEngine::CheckOption *>(opt);
-        co->Value = value.toInt();
+        while(same_moves < moves.length() && same_moves < d->game_moves.length() &&
+              moves[same_moves].Pack() == d->game_moves[same_moves].Pack())
+            ++same_moves;
     }
-        break;
-    case IEngine::Option_t::Spin:
-    {
-        IEngine::SpinOption *so = static_cast<IEngine::SpinOption *>(opt);
-        so->Value = value.toInt();
-    }
-        break;
-    case IEngine::Option_t::String:
-    {
-        IEngine::StringOption *so = static_cast<IEngine::StringOption *>(opt);
-        so->Value = value.toString();
-    }
-        break;
-    case IEngine::Option_t::Combo:
+    else
     {
-        IEngine::ComboOption *co = static_cast<IEngine::ComboOption *>(opt);
-        co->Value = value.toString();
+        if(!d->new_game_sent)
+            _write_to_engine("ucinewgame");
+
+        d->game_start = start;
+        d->game_command = 0 == strcmp(start, "startpos") ?
+                    QByteArray("position startpos moves") :
+                    QByteArray("position fen ").append(start).append(" moves");
+        d->game_command_lengths.resize(1);
+        d->game_command_lengths[0] = d->game_command.length();
+        d->game_valid = true;
     }
-        break;
-    default:
-        break;
+    d->new_game_sent = false;
+
+    // Only the moves after the ones we have in common need to be formatted
+    d->game_command.truncate(d->game_command_lengths[same_moves]);
+    d->game_command_lengths.resize(same_moves + 1);
+    d->game_moves = moves;
+    for(int i = same_moves; i < moves.length(); ++i){
+        d->game_command.append(' ').append(moves[i].ToString().ConstData());
+        d->game_command_lengths.append(d->game_command.length());
     }
 
+    // The moves keyword is only sent if there are moves
+    if(moves.isEmpty())
+        _write_to_engine(d->game_command.left(d->game_command.length() - 6));
+    else
+        _write_to_engine(d->game_command);
+}
+
+void UCI_Client::SetOption(const QString &name, const QVariant &value)
+{
+    G_D;
+    if(!IsEngineStarted())
+        return;
+
+    // Apply the change to our in-memory struct.  If the handshake hasn't finished we
+    //  don't know the engine's options yet, so we remember the value for later.
+    if(!d->info_valid)
+        d->early_options.insert(name, value);
+    else if(d->info.Options.contains(name))
+        __apply_option_value(d->info.Options[name], value);
+    else
+        return;
+
     // Write the change to the engine
+    d->option_values.insert(name, value);
     QByteArray data = QString("setoption name %1 value %2")
             .arg(name)
             .arg(value.toString()).toLatin1();
@@ -499,12 +570,37 @@ void UCI_Client::StartThinking(const IEngine::ThinkParams &p)
     if(d->thinking)
         return;
 
+    // MultiPV is an option in UCI, so we only send it when it changes
+    if(d->info.Options.contains("MultiPV") &&
+            IEngine::Option_t::Spin == d->info.Options["MultiPV"]->GetType())
+    {
+        SpinOption const *opt = static_cast<SpinOption const *>(d->info.Options["MultiPV"]);
+        int multipv = qBound(qMax(1, opt->Min), p.MultiPV, opt->Max);
+        if(multipv != opt->Value)
+            SetOption("MultiPV", multipv);
+    }
+
     QByteArray str = "go";
+    if(p.Ponder)
+        str.append(" ponder");
+
     if(-1 == p.SearchTime)
         str.append(" infinite");
     else if(0 < p.SearchTime)
         str.append(QString(" movetime %1").arg(p.SearchTime));
 
+    // The clocks are only sent if they were given
+    if(0 <= p.WhiteTime)
+        str.append(QString(" wtime %1").arg(p.WhiteTime));
+    if(0 <= p.BlackTime)
+        str.append(QString(" btime %1").arg(p.BlackTime));
+    if(0 <= p.WhiteTime && 0 < p.WhiteIncrement)
+        str.append(QString(" winc %1").arg(p.WhiteIncrement));
+    if(0 <= p.BlackTime && 0 < p.BlackIncrement)
+        str.append(QString(" binc %1").arg(p.BlackIncrement));
+    if(0 < p.MovesToGo)
+        str.append(QString(" movestogo %1").arg(p.MovesToGo));
+
     if(0 < p.Depth)
         str.append(QString(" depth %1").arg(p.Depth));
 
@@ -514,11 +610,18 @@ void UCI_Client::StartThinking(const IEngine::ThinkParams &p)
     if(0 < p.Mate)
         str.append(QString(" mate %1").arg(p.Mate));
 
-//    if(0 < p.SearchMoves.size())
-//        str.append(QString(" searchmoves %1").arg(p.SearchMoves.join(" ")));
+    // This goes last because it takes all the tokens after it
+    if(0 < p.SearchMoves.size()){
+        str.append(" searchmoves");
+        for(GenericMove const &m : p.SearchMoves)
+            str.append(' ').append(m.ToString().ConstData());
+    }
 
     _write_to_engine(str);
 
+    // Forget the info from the last search
+    d->search_info.Clear();
+
     // We raise this when we tell the background thread to start thinking, and lower it
     //  when we receive the best move signal, so we don't need to protect this with a lock
     d->thinking = true;
@@ -532,12 +635,66 @@ void UCI_Client::StopThinking()
     _write_to_engine("stop");
 }
 
+void UCI_Client::PonderHit()
+{
+    G_D;
+    if(!d->thinking)
+        return;
+    _write_to_engine("ponderhit");
+}
+
+QList<IEngine::SearchInfo> UCI_Client::GetSearchLines() const
+{
+    G_D;
+    return d->search_info.GetLines();
+}
+
+IEngine::Statistics UCI_Client::GetStatistics() const
+{
+    G_D;
+    Statistics ret = d->stats;
+    ret.ElapsedTime = UCI_IO::Now() - d->stats_start;
+    return ret;
+}
+
+void UCI_Client::ResetStatistics()
+{
+    G_D;
+    d->stats = Statistics();
+    d->stats_start = UCI_IO::Now();
+}
+
+void UCI_Client::SetTraceFile(const QString &filename)
+{
+    G_D;
+    d->trace.close();
+    if(filename.isEmpty())
+        return;
+
+    d->trace.setFileName(filename);
+    if(!d->trace.open(QFile::WriteOnly | QFile::Truncate))
+        throw Exception<>(QString("Unable to open %1: %2").arg(filename).arg(d->trace.errorString()).toUtf8().constData());
+    d->trace.write("direction,posted_us,io_us,delivered_us,line\n");
+}
+
 void UCI_Client::_best_move_received()
 {
     G_D;
     d->thinking = false;
 }
 
+void UCI_Client::SetSearchInfoRate(int per_second)
+{
+    G_D;
+    d->search_info.SetRate(per_second);
+}
+
+int UCI_Client::GetSearchInfoRate() const
+{
+    G_D;
+    return d->search_info.GetRate();
+}
+
 bool UCI_Client::IsThinking() const
 {
     G_D;
@@ -16,7 +16,6 @@ limitations under the License.*/
 #define GKCHESS_UCI_CLIENT_H
 
 #include "gkchess_iengine.h"
-#include <QProcess>
 
 namespace GKChess{
 
@@ -42,39 +41,42 @@ public:
     IEngine *Create() const;
 
     void StartEngine(const QString &, const QStringList &);
+    QFuture<bool> StartEngineAsync(const QString &, const QStringList &);
     bool IsEngineStarted() const;
     void StopEngine();
 
     const EngineInfo &GetEngineInfo() const;
     void SetPosition(const char *);
+    void SetGamePosition(const char *, const QList<GenericMove> &);
     void SetOption(const QString &, const QVariant &);
     bool WaitForReady(int);
+    QFuture<bool> WaitForReadyAsync();
     void NewGame();
 
     void StartThinking(const ThinkParams &);
     bool IsThinking() const;
     void StopThinking();
+    void PonderHit();
+    QList<SearchInfo> GetSearchLines() const;
+
+    Statistics GetStatistics() const;
+    void ResetStatistics();
+    void SetTraceFile(const QString &);
+
+    void SetSearchInfoRate(int);
+    int GetSearchInfoRate() const;
 
 
 private slots:
 
-    void _read_from_engine();
+    void _process_events();
 
     void _best_move_received();
 
-    void _engine_error(QProcess::ProcessError err);
-    void _engine_stopped(int);
-
 
 private:
 
-    void _start_and_validate_engine(bool populate_data);
-
     void _write_to_engine(const QByteArray &);
-    void _process_line_received(QByteArray &);
-
-    bool _wait_for_ready(int);
-    void _disconnect_from_process();
 
 };
 
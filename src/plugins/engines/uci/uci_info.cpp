@@ -0,0 +1,211 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "uci_info.h"
+#include <cstring>
+
+
+namespace{
+
+/** A view of one token in a line.  It points into the line, so it's only valid as long
+ *  as the line is.
+*/
+struct token_t
+{
+    const char *Data;
+    int Length;
+
+    bool Is(const char *s) const{
+        return (int)strlen(s) == Length && 0 == memcmp(s, Data, Length);
+    }
+};
+
+/** Splits a line into tokens separated by whitespace. */
+class tokenizer_t
+{
+    const char *m_cur;
+    const char *const m_end;
+public:
+
+    tokenizer_t(const char *line, int length) :m_cur(line), m_end(line + length) {}
+
+    /** Puts the next token in t and returns true, or returns false at the end of the line. */
+    bool Next(token_t &t){
+        while(m_cur < m_end && __is_whitespace(*m_cur))
+            ++m_cur;
+        if(m_cur == m_end)
+            return false;
+
+        t.Data = m_cur;
+        while(m_cur < m_end && !__is_whitespace(*m_cur))
+            ++m_cur;
+        t.Length = m_cur - t.Data;
+        return true;
+    }
+
+    /** Returns the next token without consuming it. */
+    bool Peek(token_t &t) const{
+        tokenizer_t cpy(*this);
+        return cpy.Next(t);
+    }
+
+private:
+    static bool __is_whitespace(char c){ return ' ' == c || '\t' == c || '\r' == c || '\n' == c; }
+};
+
+}
+
+
+NAMESPACE_GKCHESS;
+
+
+static bool __to_uint64(const token_t &t, GUINT64 &ret)
+{
+    if(0 == t.Length)
+        return false;
+
+    GUINT64 val = 0;
+    for(int i = 0; i < t.Length; ++i){
+        if(t.Data[i] < '0' || '9' < t.Data[i])
+            return false;
+        val = val * 10 + (t.Data[i] - '0');
+    }
+    ret = val;
+    return true;
+}
+
+static bool __to_int(const token_t &t, int &ret)
+{
+    GUINT64 val;
+    bool negative = 0 < t.Length && '-' == t.Data[0];
+    token_t digits = t;
+    if(negative || (0 < t.Length && '+' == t.Data[0])){
+        ++digits.Data;
+        --digits.Length;
+    }
+    if(!__to_uint64(digits, val))
+        return false;
+    ret = negative ? -(int)val : (int)val;
+    return true;
+}
+
+// Parses a move in coordinate notation (i.e. e2e4 or a7a8q)
+static bool __to_packed_move(const token_t &t, GUINT16 &ret)
+{
+    if(t.Length < 4 || 5 < t.Length ||
+            t.Data[0] < 'a' || 'h' < t.Data[0] || t.Data[1] < '1' || '8' < t.Data[1] ||
+            t.Data[2] < 'a' || 'h' < t.Data[2] || t.Data[3] < '1' || '8' < t.Data[3])
+        return false;
+
+    ret = GenericMove(t.Data[0] - 'a', t.Data[1] - '1',
+                      t.Data[2] - 'a', t.Data[3] - '1',
+                      5 == t.Length ? t.Data[4] : 0).Pack();
+    return true;
+}
+
+// Reads the next token as a number and sets the field flag if it was valid
+template<class T>static void __read_number(tokenizer_t &tk, T &val, int &fields, int flag)
+{
+    token_t t;
+    GUINT64 tmp;
+    if(tk.Next(t) && __to_uint64(t, tmp)){
+        val = (T)tmp;
+        fields |= flag;
+    }
+}
+
+bool ParseUCIInfoLine(const char *line, int length, IEngine::SearchInfo &info)
+{
+    tokenizer_t tk(line, length);
+    token_t t;
+    info = IEngine::SearchInfo();
+
+    if(!tk.Next(t) || !t.Is("info"))
+        return false;
+
+    while(tk.Next(t))
+    {
+        if(t.Is("depth"))
+            __read_number(tk, info.Depth, info.Fields, IEngine::SearchInfo::HasDepth);
+        else if(t.Is("seldepth"))
+            __read_number(tk, info.SelDepth, info.Fields, IEngine::SearchInfo::HasSelDepth);
+        else if(t.Is("multipv"))
+            __read_number(tk, info.MultiPV, info.Fields, IEngine::SearchInfo::HasMultiPV);
+        else if(t.Is("nodes"))
+            __read_number(tk, info.Nodes, info.Fields, IEngine::SearchInfo::HasNodes);
+        else if(t.Is("nps"))
+            __read_number(tk, info.NPS, info.Fields, IEngine::SearchInfo::HasNPS);
+        else if(t.Is("hashfull"))
+            __read_number(tk, info.HashFull, info.Fields, IEngine::SearchInfo::HasHashFull);
+        else if(t.Is("tbhits"))
+            __read_number(tk, info.TBHits, info.Fields, IEngine::SearchInfo::HasTBHits);
+        else if(t.Is("time"))
+            __read_number(tk, info.Time, info.Fields, IEngine::SearchInfo::HasTime);
+        else if(t.Is("score"))
+        {
+            // score [cp <x> | mate <y>] [lowerbound | upperbound]
+            token_t type, val;
+            if(!tk.Next(type) || !tk.Next(val) || !__to_int(val, info.Score))
+                continue;
+            if(type.Is("cp"))
+                info.ScoreIsMate = false;
+            else if(type.Is("mate"))
+                info.ScoreIsMate = true;
+            else
+                continue;
+            info.Fields |= IEngine::SearchInfo::HasScore;
+
+            token_t bound;
+            if(tk.Peek(bound)){
+                if(bound.Is("lowerbound")){
+                    info.ScoreBound = IEngine::SearchInfo::LowerBound;
+                    tk.Next(bound);
+                }
+                else if(bound.Is("upperbound")){
+                    info.ScoreBound = IEngine::SearchInfo::UpperBound;
+                    tk.Next(bound);
+                }
+            }
+        }
+        else if(t.Is("pv"))
+        {
+            // The pv goes until the first token that isn't a move
+            token_t mv;
+            while(tk.Peek(mv) && info.PVLength < IEngine::SearchInfo::MaxPVLength &&
+                  __to_packed_move(mv, info.PV[info.PVLength]))
+            {
+                ++info.PVLength;
+                tk.Next(mv);
+            }
+
+            // Skip whatever is left of a very long pv
+            while(tk.Peek(mv)){
+                GUINT16 tmp;
+                if(!__to_packed_move(mv, tmp))
+                    break;
+                tk.Next(mv);
+            }
+            info.Fields |= IEngine::SearchInfo::HasPV;
+        }
+        else if(t.Is("string"))
+        {
+            // The rest of the line is free text
+            break;
+        }
+    }
+    return 0 != info.Fields;
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,37 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_UCI_INFO_H
+#define GKCHESS_UCI_INFO_H
+
+#include "gkchess_iengine.h"
+
+namespace GKChess{
+
+
+/** Parses a UCI "info" line into the search info struct.
+ *
+ *  The line is tokenized in place, so this never copies or allocates memory.  Tokens
+ *  that we don't know about (like "currmove" or "string") are skipped.
+ *
+ *  \param line The line of text, which must start with "info"
+ *  \param length The length of the line
+ *  \returns True if the line had any search info in it
+*/
+bool ParseUCIInfoLine(const char *line, int length, IEngine::SearchInfo &);
+
+
+}
+
+#endif // GKCHESS_UCI_INFO_H
@@ -0,0 +1,471 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "uci_io.h"
+#include "uci_info.h"
+#include <gutil/string.h>
+#include <gkchess_common.h>
+#include <QFile>
+#include <QElapsedTimer>
+USING_NAMESPACE_GUTIL;
+
+/** How long we wait for each response of the engine during the handshake. */
+#define HANDSHAKE_TIMEOUT 10000
+
+/** How long we give the engine to quit before we kill it. */
+#define QUIT_TIMEOUT 5000
+
+NAMESPACE_GKCHESS;
+
+
+static QByteArray __get_next_token(const QByteArray &ba, int indx)
+{
+    QByteArray ret;
+    bool first_chars_seen = false;
+    for(int i = indx; i < ba.length(); ++i)
+    {
+        if(String::IsWhitespace(ba[i])){
+            if(first_chars_seen)
+                break;
+        }
+        else
+        {
+            first_chars_seen = true;
+            ret.append(ba[i]);
+        }
+    }
+    return ret;
+}
+
+static QByteArray __get_option_name(const QByteArray &ba, int indx, const char *terminator)
+{
+    QByteArray ret;
+    int i = indx;
+    int term_len = strlen(terminator);
+    while(i < ba.length() &&
+          0 != memcmp(terminator, ba.constData() + i, term_len))
+    {
+        ret.append(ba[i]);
+        ++i;
+    }
+    return ret.trimmed();
+}
+
+static QByteArray __get_option_value(const QByteArray &ba, int indx)
+{
+    QByteArray ret;
+    int i = indx;
+    while(i < ba.length())
+    {
+        char c = ba[i];
+        if(String::IsWhitespace(c)){
+            break;
+        }
+        else{
+            ret.append(c);
+        }
+        ++i;
+    }
+    return ret.trimmed();
+}
+
+// Parses an "option" line from the handshake, or returns null if we don't understand it
+static IEngine::Option_t *__parse_option(const QByteArray &line, QString &opt_name)
+{
+    int name_idx = line.indexOf("name");
+    int type_idx = line.indexOf("type");
+
+    // Must have a name and type
+    if(-1 == name_idx || -1 == type_idx)
+        return 0;
+
+    opt_name = __get_option_name(line, name_idx + 5, "type");
+    QString opt_type = __get_option_value(line, type_idx + 5);
+    IEngine::Option_t *opt = 0;
+
+    if(opt_type == "spin")
+    {
+        int default_idx = line.indexOf("default");
+        int min_idx = line.indexOf("min");
+        int max_idx = line.indexOf("max");
+        if(-1 == default_idx || -1 == min_idx || -1 == max_idx)
+            return 0;
+
+        QString default_str = __get_option_value(line, default_idx + 8);
+        QString min_str = __get_option_value(line, min_idx + 4);
+        QString max_str = __get_option_value(line, max_idx + 4);
+        opt = new IEngine::SpinOption(opt_name, default_str.toInt(), min_str.toInt(), max_str.toInt());
+    }
+    else if(opt_type == "string")
+    {
+        int default_idx = line.indexOf("default");
+        if(-1 == default_idx)
+            return 0;
+
+        QString val = __get_option_value(line, default_idx + 8);
+        opt = new IEngine::StringOption(opt_name, val);
+
+    }
+    else if(opt_type == "check")
+    {
+        int default_idx = line.indexOf("default");
+        if(-1 == default_idx)
+            return 0;
+
+        QString val_str = __get_option_value(line, default_idx + 8);
+        bool checked = val_str.toLower() == "true";
+        opt = new IEngine::CheckOption(opt_name, checked);
+    }
+    else if(opt_type == "combo")
+    {
+        opt = new IEngine::ComboOption(opt_name, QStringList(), QString());
+    }
+    else if(opt_type == "button")
+    {
+        opt = new IEngine::ButtonOption(opt_name);
+    }
+    return opt;
+}
+
+
+void UCI_IO::Command::Resolve(bool result)
+{
+    Promise.reportResult(result);
+    Promise.reportFinished();
+    if(Resolved)
+        Resolved->release();
+}
+
+
+UCI_IO::UCI_IO(QObject *receiver, const char *slot)
+    :m_commandsPosted(0),
+      m_eventsPosted(0),
+      m_receiver(receiver),
+      m_slot(slot),
+      m_process(new QProcess(this)),
+      m_running(false)
+{
+    m_process->setReadChannel(QProcess::StandardOutput);
+    connect(m_process, SIGNAL(readyRead()), this, SLOT(_read_from_engine()));
+    connect(m_process, SIGNAL(finished(int)), this, SLOT(_engine_finished()));
+}
+
+UCI_IO::~UCI_IO()
+{
+    _stop_engine();
+}
+
+static QElapsedTimer __started_timer()
+{
+    QElapsedTimer ret;
+    ret.start();
+    return ret;
+}
+
+qint64 UCI_IO::Now()
+{
+    static const QElapsedTimer timer = __started_timer();
+    return timer.nsecsElapsed() / 1000;
+}
+
+void UCI_IO::PostCommand(const Command &command)
+{
+    Command c = command;
+    c.Posted = Now();
+    m_commands.Push(c);
+    if(m_commandsPosted.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "ProcessCommands", ::Qt::QueuedConnection);
+}
+
+bool UCI_IO::TakeEvent(Event &e)
+{
+    if(m_events.Pop(e))
+        return true;
+
+    // The queue looks empty, so we let the I/O thread wake us up again, then we look
+    //  once more in case it posted something in the meantime
+    m_eventsPosted.fetchAndStoreOrdered(0);
+    return m_events.Pop(e);
+}
+
+void UCI_IO::_post_event(const Event &e)
+{
+    m_events.Push(e);
+    if(m_eventsPosted.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(m_receiver, m_slot, ::Qt::QueuedConnection);
+}
+
+void UCI_IO::ProcessCommands()
+{
+    Command c;
+    while(1)
+    {
+        if(!m_commands.Pop(c)){
+            // Same as in TakeEvent()
+            m_commandsPosted.fetchAndStoreOrdered(0);
+            if(!m_commands.Pop(c))
+                break;
+        }
+
+        switch(c.Type)
+        {
+        case Command::Start:
+        {
+            _stop_engine();
+
+            Event e(Event::Started);
+            e.EngineInfo = _start_engine(c.Path, c.Arguments, e.Line);
+            _post_event(e);
+
+            c.Resolve(0 != e.EngineInfo);
+        }
+            break;
+        case Command::Write:
+            if(m_running)
+                _write(c.Line, c.Posted);
+            break;
+        case Command::IsReady:
+            if(m_running){
+                m_readyCommands.append(c);
+                _write("isready", c.Posted);
+            }
+            else{
+                c.Resolve(false);
+            }
+            break;
+        case Command::Stop:
+            _stop_engine();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void UCI_IO::Shutdown()
+{
+    // Nobody is going to process these anymore, but we don't want anyone waiting forever
+    Command c;
+    while(m_commands.Pop(c)){
+        if(Command::Start == c.Type || Command::IsReady == c.Type)
+            c.Resolve(false);
+    }
+    _stop_engine();
+}
+
+void UCI_IO::_write(const QByteArray &ba, qint64 posted)
+{
+    QByteArray line = ba + '\n';
+    qint64 len = m_process->write(line);
+    if(len == line.length()){
+        Event e(Event::LineSent);
+        e.Line = ba;
+        e.Timestamp = Now();
+        e.Posted = -1 == posted ? e.Timestamp : posted;
+        _post_event(e);
+    }
+}
+
+void UCI_IO::_stop_engine()
+{
+    if(!m_running)
+        return;
+
+    // Lower this first so we don't report a crash when it finishes
+    m_running = false;
+    _write("quit");
+
+    // Give the process time to exit gracefully
+    if(!m_process->waitForFinished(QUIT_TIMEOUT))
+    {
+        // If it doesn't exit, then kill it
+        m_process->kill();
+        m_process->waitForFinished();
+    }
+    _resolve_ready_commands(false);
+}
+
+void UCI_IO::_resolve_ready_commands(bool result)
+{
+    for(Command &c : m_readyCommands)
+        c.Resolve(result);
+    m_readyCommands.clear();
+}
+
+void UCI_IO::_engine_finished()
+{
+    if(!m_running)
+        return;
+
+    m_running = false;
+    _resolve_ready_commands(false);
+    _post_event(Event(Event::Crashed));
+}
+
+bool UCI_IO::_read_line(QByteArray &line, int timeout_ms)
+{
+    while(!m_process->canReadLine()){
+        if(!m_process->waitForReadyRead(timeout_ms))
+            return false;
+    }
+
+    line = m_process->readLine();
+    while(line.endsWith('\n') || line.endsWith('\r'))
+        line.chop(1);
+    return true;
+}
+
+IEngine::EngineInfo *UCI_IO::_start_engine(const QString &path, const QStringList &args, QByteArray &error)
+{
+    if(!QFile(path).exists()){
+        error = "File does not exist";
+        return 0;
+    }
+
+    m_process->start(path, args);
+    if(!m_process->waitForStarted()){
+        error = "Engine unable to start";
+        return 0;
+    }
+
+    // We're on the I/O thread, so it's fine to block here while we do the handshake
+    IEngine::EngineInfo *info = new IEngine::EngineInfo;
+    bool valid = false;
+    QByteArray line;
+    _write("uci");
+    while(_read_line(line, HANDSHAKE_TIMEOUT))
+    {
+        Event e;
+        e.Line = line;
+        e.Timestamp = Now();
+        _post_event(e);
+
+        if(line.startsWith("id"))
+        {
+            int name_idx = line.indexOf("name");
+            int author_idx = line.indexOf("author");
+
+            if(-1 != name_idx)
+                info->Name = line.right(line.length() - (name_idx + 5));
+            if(-1 != author_idx)
+                info->Author = line.right(line.length() - (author_idx + 7));
+        }
+        else if(line.startsWith("option"))
+        {
+            // Skip options we don't understand
+            QString opt_name;
+            IEngine::Option_t *opt = __parse_option(line, opt_name);
+            if(opt){
+                info->OptionNames.append(opt_name);
+                info->Options.insert(opt_name, opt);
+            }
+        }
+        else if(line.startsWith("uciok"))
+        {
+            valid = !info->Name.isEmpty();
+            break;
+        }
+    }
+
+    if(valid)
+    {
+        // Start with a new game, and make sure the engine is ready before we say it started
+        valid = false;
+        _write("ucinewgame");
+        _write("isready");
+        while(_read_line(line, HANDSHAKE_TIMEOUT))
+        {
+            Event e;
+            e.Line = line;
+            e.Timestamp = Now();
+            _post_event(e);
+            if(line == "readyok"){
+                valid = true;
+                break;
+            }
+        }
+        if(!valid)
+            error = "The engine did not respond to isready";
+    }
+    else
+        error = "The engine is not UCI compatible";
+
+    if(!valid)
+    {
+        delete info;
+        m_process->kill();
+        m_process->waitForFinished();
+        return 0;
+    }
+
+    m_running = true;
+
+    // The engine may have said more after it was ready
+    _read_from_engine();
+    return info;
+}
+
+void UCI_IO::_read_from_engine()
+{
+    // During the handshake we read the lines ourselves
+    if(!m_running)
+        return;
+
+    while(m_process->canReadLine())
+    {
+        QByteArray ba = m_process->readLine();
+        while(ba.endsWith('\n') || ba.endsWith('\r'))
+            ba.chop(1);
+        _process_line(ba);
+    }
+}
+
+void UCI_IO::_process_line(QByteArray &ba)
+{
+    Event e;
+    e.Line = ba;
+    e.Timestamp = Now();
+
+    if(ba.startsWith("info"))
+    {
+        if(ParseUCIInfoLine(ba.constData(), ba.length(), e.SearchInfo))
+            e.Parsed = Event::SearchInfoParsed;
+    }
+    else if(ba.startsWith("bestmove"))
+    {
+        QByteArray move = __get_next_token(ba, 9);
+
+        QByteArray ponder;
+        int indx = ba.indexOf("ponder");
+        if(-1 != indx)
+            ponder = __get_next_token(ba, indx + 7);
+
+        if(ponder == "(none)")
+            ponder = QByteArray();
+
+        e.BestMove = GenericMove(move);
+        e.Ponder = GenericMove(ponder);
+        e.Parsed = Event::BestMoveParsed;
+    }
+    else if(ba == "readyok")
+    {
+        if(!m_readyCommands.isEmpty())
+            m_readyCommands.takeFirst().Resolve(true);
+    }
+
+    _post_event(e);
+}
+
+
+END_NAMESPACE_GKCHESS;
@@ -0,0 +1,193 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_UCI_IO_H
+#define GKCHESS_UCI_IO_H
+
+#include "gkchess_iengine.h"
+#include "spsc_queue.h"
+#include <QFutureInterface>
+#include <QSharedPointer>
+#include <QSemaphore>
+#include <QProcess>
+#include <QAtomicInt>
+
+namespace GKChess{
+
+
+/** Does all the communication with a UCI engine process on its own thread.
+ *
+ *  The owner posts commands from its thread, and the I/O thread posts back events,
+ *  each through a lock-free queue.  Whenever something is posted to an empty queue, the
+ *  other side is woken up with a queued call to its processing slot, so a burst of
+ *  engine output costs one wake-up instead of one per line.
+ *
+ *  This is an implementation detail of UCI_Client.
+*/
+class UCI_IO :
+        public QObject
+{
+    Q_OBJECT
+public:
+
+    /** Something for the I/O thread to do. */
+    struct Command
+    {
+        enum TypeEnum
+        {
+            /** Start the engine and do the UCI handshake. */
+            Start,
+
+            /** Write a line to the engine. */
+            Write,
+
+            /** Send "isready" and resolve the promise when "readyok" comes back. */
+            IsReady,
+
+            /** Quit the engine. */
+            Stop
+        }
+        Type;
+
+        QByteArray Line;
+        QString Path;
+        QStringList Arguments;
+        QFutureInterface<bool> Promise;
+
+        /** If set, this is released after the promise is resolved, so a thread can wait
+         *  for it with a timeout.
+        */
+        QSharedPointer<QSemaphore> Resolved;
+
+        /** When the command was posted, from Now(). */
+        qint64 Posted;
+
+        Command(TypeEnum t = Write) :Type(t), Posted(0) {}
+
+        /** Resolves the promise with the result and wakes up whoever is waiting for it. */
+        void Resolve(bool result);
+    };
+
+    /** Something that happened on the I/O thread. */
+    struct Event
+    {
+        enum TypeEnum
+        {
+            /** The handshake finished.  If it succeeded, EngineInfo holds the engine's info
+             *  and the receiver takes ownership of it, otherwise it is null.
+            */
+            Started,
+
+            /** A line was written to the engine. */
+            LineSent,
+
+            /** A line was received from the engine, and maybe parsed. */
+            LineReceived,
+
+            /** The engine stopped without being told to. */
+            Crashed
+        }
+        Type;
+
+        QByteArray Line;
+        IEngine::EngineInfo *EngineInfo;
+
+        /** Says which of the following members were parsed from a received line. */
+        enum ParsedEnum
+        {
+            NothingParsed,
+            SearchInfoParsed,
+            BestMoveParsed
+        }
+        Parsed;
+
+        IEngine::SearchInfo SearchInfo;
+        GenericMove BestMove;
+        GenericMove Ponder;
+
+        /** When the line was written or read on the I/O thread, from Now(). */
+        qint64 Timestamp;
+
+        /** When the command for a sent line was posted, from Now(). */
+        qint64 Posted;
+
+        Event(TypeEnum t = LineReceived) :Type(t), EngineInfo(0), Parsed(NothingParsed), Timestamp(0), Posted(0) {}
+    };
+
+
+    /** Constructs the I/O object.  It wakes up the receiver by invoking the slot with the
+     *  given name through a queued connection.  You should move this to its own thread.
+    */
+    UCI_IO(QObject *receiver, const char *slot);
+    ~UCI_IO();
+
+    /** Returns the time in microseconds from a monotonic clock that's shared by all threads. */
+    static qint64 Now();
+
+    /** Posts a command for the I/O thread.  Only call this from the owner's thread. */
+    void PostCommand(const Command &);
+
+    /** Takes the next event from the I/O thread, or returns false if there are none.
+     *  Only call this from the owner's thread.
+    */
+    bool TakeEvent(Event &);
+
+
+public slots:
+
+    /** Does all the commands that were posted.  This runs on the I/O thread. */
+    void ProcessCommands();
+
+    /** Stops the engine and resolves all promises.  The owner calls this through a
+     *  blocking queued connection before it stops the thread.
+    */
+    void Shutdown();
+
+
+private slots:
+
+    void _read_from_engine();
+    void _engine_finished();
+
+
+private:
+
+    SPSC_Queue<Command> m_commands;
+    SPSC_Queue<Event> m_events;
+    QAtomicInt m_commandsPosted;
+    QAtomicInt m_eventsPosted;
+
+    QObject *m_receiver;
+    const char *m_slot;
+
+    // These members are only used on the I/O thread
+    QProcess *m_process;
+    bool m_running;
+    QList<Command> m_readyCommands;
+
+    void _post_event(const Event &);
+    void _write(const QByteArray &, qint64 posted = -1);
+    void _stop_engine();
+    void _resolve_ready_commands(bool);
+
+    IEngine::EngineInfo *_start_engine(const QString &, const QStringList &, QByteArray &error);
+    bool _read_line(QByteArray &, int timeout_ms);
+    void _process_line(QByteArray &);
+
+};
+
+
+}
+
+#endif // GKCHESS_UCI_IO_H
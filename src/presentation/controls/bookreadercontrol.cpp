@@ -26,6 +26,14 @@ USING_NAMESPACE_GUTIL;
 USING_NAMESPACE_GUTIL1(Qt);
 
 #define SETTING_LAST_BOOK "bookreader_last_open_book"
+#define SETTING_TABLEBASE_PATH "bookreader_tablebase_path"
+#define SETTING_TABLEBASE_PROBE "bookreader_tablebase_probe"
+
+#if defined(Q_OS_WIN)
+#define PATH_SEPARATOR ";"
+#else
+#define PATH_SEPARATOR ":"
+#endif
 
 NAMESPACE_GKCHESS1(UI);
 
@@ -39,6 +47,12 @@ BookReaderControl::BookReaderControl(ObservableBoard &b, GUtil::Qt::Settings *pd
 {
     ui->setupUi(this);
     ui->treeView->setModel(&m_bookModel);
+    ui->lbl_tablebaseResult->hide();
+
+    connect(&b, SIGNAL(NotifyPieceMoved(const GKChess::MoveData &)),
+            this, SLOT(update_tablebase_result()));
+    connect(&b, SIGNAL(NotifyBoardReset()),
+            this, SLOT(update_tablebase_result()));
 
 //    new ModelTest(&m_bookModel);
 
@@ -46,6 +60,13 @@ BookReaderControl::BookReaderControl(ObservableBoard &b, GUtil::Qt::Settings *pd
         ui->lineEdit->setText(m_settings->Value(SETTING_LAST_BOOK).toString());
         file_selected();
     }
+    if(m_settings && m_settings->Contains(SETTING_TABLEBASE_PATH)){
+        ui->lineEdit_tablebases->setText(m_settings->Value(SETTING_TABLEBASE_PATH).toString());
+
+        // Checking the box probes the tablebases, through the signal from the form
+        if(m_settings->Value(SETTING_TABLEBASE_PROBE).toBool())
+            ui->checkBox_tablebases->setChecked(true);
+    }
 }
 
 BookReaderControl::~BookReaderControl()
@@ -65,6 +86,16 @@ void BookReaderControl::CloseFile()
     m_bookModel.SetBookFile("");
 }
 
+void BookReaderControl::SelectTablebases()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, "Select Tablebase Directory");
+    if(!dir.isEmpty()){
+        QString paths = ui->lineEdit_tablebases->text().trimmed();
+        ui->lineEdit_tablebases->setText(paths.isEmpty() ? dir : paths + PATH_SEPARATOR + dir);
+        tablebases_selected();
+    }
+}
+
 void BookReaderControl::file_selected()
 {
     QString filename = ui->lineEdit->text().trimmed();
@@ -87,6 +118,45 @@ void BookReaderControl::move_doubleClicked(const QModelIndex &ind)
     }
 }
 
+void BookReaderControl::tablebases_selected()
+{
+    // The results are only shown if you ask for them, until the prober has been
+    //  checked against real files
+    QString paths = ui->lineEdit_tablebases->text().trimmed();
+    bool const probe = ui->checkBox_tablebases->isChecked();
+    if(paths.isEmpty() || !probe)
+        m_tablebases.Close();
+    else
+        m_tablebases.Open(paths);
+
+    if(m_settings){
+        m_settings->SetValue(SETTING_TABLEBASE_PATH, paths);
+        m_settings->SetValue(SETTING_TABLEBASE_PROBE, probe);
+    }
+    update_tablebase_result();
+}
+
+void BookReaderControl::update_tablebase_result()
+{
+    QString text;
+    if(0 < m_tablebases.GetMaxPieces())
+    {
+        // Without the distance to zero table we still know the result
+        Tablebases::WDLEnum wdl;
+        int dtz;
+        if(m_tablebases.ProbeWDL(m_board, wdl)){
+            if(!m_tablebases.ProbeDTZ(m_board, dtz))
+                dtz = 0;
+            text = QString(Piece::White == m_board.GetWhoseTurn() ? "White" : "Black") +
+                    " to move: " + Tablebases::ToString(wdl, dtz);
+        }
+        else
+            text = "Not in the tablebases";
+    }
+    ui->lbl_tablebaseResult->setText(text);
+    ui->lbl_tablebaseResult->setVisible(!text.isEmpty());
+}
+
 void BookReaderControl::OnValidationProgressUpdate(int p)
 {
     GUTIL_UNUSED(p);
@@ -18,6 +18,7 @@ limitations under the License.*/
 #include <gutil/smartpointer.h>
 #include "gkchess_ibookreader.h"
 #include "gkchess_bookmodel.h"
+#include "gkchess_tablebases.h"
 #include <QWidget>
 #include <QPluginLoader>
 
@@ -45,10 +46,13 @@ class BookReaderControl :
     Board &m_board;
     GUtil::Qt::Settings *m_settings;
     GKChess::UI::BookModel m_bookModel;
+    GKChess::Tablebases m_tablebases;
 
 public:
 
-    /** If you pass a persistent data object, then we will be able to remember the last book you had open. */
+    /** If you pass a persistent data object, then we will be able to remember the last book
+     *  and tablebases you had open.
+    */
     explicit BookReaderControl(GKChess::ObservableBoard &, GUtil::Qt::Settings * = 0, QWidget *parent = 0);
     ~BookReaderControl();
 
@@ -58,11 +62,18 @@ public slots:
     void SelectFile();
     void CloseFile();
 
+    /** Adds a tablebase directory.  If you check the box next to it, the result of the
+     *  board's position is shown under the book as long as the tablebases know it.
+    */
+    void SelectTablebases();
+
 
 private slots:
 
     void file_selected();
     void move_doubleClicked(const QModelIndex &);
+    void tablebases_selected();
+    void update_tablebase_result();
 
 
 private:
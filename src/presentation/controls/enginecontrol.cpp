@@ -19,25 +19,68 @@ limitations under the License.*/
 #include "gkchess_uci_client.h"
 #include "gkchess_enginesettings.h"
 #include "gkchess_uiglobals.h"
+#include "gkchess_zobrist.h"
+#include <QColor>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QStandardPaths>
+#include <QDir>
 USING_NAMESPACE_GKCHESS;
 USING_NAMESPACE_GUTIL1(Qt);
 USING_NAMESPACE_GUTIL;
 
 #define NO_ENGINE_TEXT "(none)"
 
+/** The number of lines we keep in the engine log. */
+#define ENGINE_LOG_CAPACITY 1000
+
+/** How often we render the engine log, in milliseconds. */
+#define ENGINE_LOG_REFRESH_INTERVAL 250
+
+/** How many times per second the engine delivers search info for each line. */
+#define ENGINE_INFO_RATE 10
+
+/** The file we keep analysis results in, in the cache directory. */
+#define ANALYSIS_CACHE_FILENAME "analysis.cache"
+
 NAMESPACE_GKCHESS1(UI);
 
 
-EngineControl::EngineControl(Board &b, EngineSettings *settings, GUtil::Qt::Settings *appSettings, QWidget *parent)
+EngineControl::EngineControl(ObservableBoard &b, EngineSettings *settings, GUtil::Qt::Settings *appSettings, QWidget *parent)
     :QWidget(parent),
       m_board(b),
       m_settings(settings),
       m_appSettings(appSettings),
       m_suppressUpdate(false),
+      m_log(ENGINE_LOG_CAPACITY),
+      m_logStart(0),
+      m_logSize(0),
+      m_searchPosition(0),
+      m_searchEngine(0),
+      m_searching(false),
       ui(new Ui::EngineControl)
 {
     ui->setupUi(this);
 
+    ui->pte_engineLog->setMaximumBlockCount(ENGINE_LOG_CAPACITY);
+    m_logTimer.setSingleShot(true);
+    connect(&m_logTimer, SIGNAL(timeout()), this, SLOT(_refresh_log()));
+    connect(ui->btn_showLog, SIGNAL(toggled(bool)), this, SLOT(_log_visibility_changed(bool)));
+    ui->tv_lines->setModel(&m_lines);
+
+    connect(&b, SIGNAL(NotifyPieceMoved(GKChess::MoveData)), this, SLOT(_piece_moved(GKChess::MoveData)));
+    connect(&b, SIGNAL(NotifyBoardReset()), this, SLOT(_board_reset()));
+    _board_reset();
+
+    // If we can't open the cache file then results are only cached in memory
+    QString cache_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    try{
+        QDir().mkpath(cache_dir);
+        m_analysisCache.Open(QDir(cache_dir).filePath(ANALYSIS_CACHE_FILENAME));
+    }
+    catch(...) {}
+
     _engines_updated();
 
     if(settings->GetEngineList().size() > 0)
@@ -100,20 +143,79 @@ void EngineControl::_engines_updated()
 
 void EngineControl::Go()
 {
-    // Since this engine is for analysis only, every position should be from a new game
-    m_engineMan->GetEngine().NewGame();
-    m_engineMan->GetEngine().WaitForReady();
-
-    m_engineMan->GetEngine().SetPosition(m_board.ToFEN());
-
     IEngine::ThinkParams p;
     p.SearchTime = ui->spin_thinkTime->value();
     p.Nodes = ui->spin_nodes->value();
     p.Depth = ui->spin_depth->value();
     p.Mate = ui->spin_mate->value();
+    p.MultiPV = ui->spin_multiPV->value();
+    m_lines.StartSearch(m_board, p.MultiPV);
+
+    // Show what we already know about the position right away.  If it's as good as
+    //  what the search would give then we don't search at all.
+    QString engine_name = m_engineMan->GetEngineName();
+    m_searchPosition = Zobrist::Hash(m_board);
+    m_searchEngine = AnalysisCache::ComputeEngineKey(m_settings->GetEnginePath(engine_name),
+                                                     m_settings->GetOptionsForEngine(engine_name));
+    if(m_analysisCache.Lookup(m_searchPosition, m_searchEngine, m_searchResult)){
+        m_lines.UpdateLine(m_searchResult.Info);
+        if(m_searchResult.Satisfies(p)){
+            // We're in the middle of the button's toggle, so release it afterwards
+            m_searching = false;
+            QMetaObject::invokeMethod(this, "_serve_cached_result", ::Qt::QueuedConnection);
+            return;
+        }
+        _log_cached_result();
+    }
+    m_searchResult = AnalysisCache::Entry();
+    m_searching = true;
+
+    // The engine only starts a new game if this position isn't from the one it has
+    if(m_gamePositions.last() != m_board.ToFEN().ConstData())
+        _board_reset();
+    m_engineMan->GetEngine().SetGamePosition(m_gameStart.constData(), m_gameMoves);
     m_engineMan->GetEngine().StartThinking(p);
 }
 
+void EngineControl::_piece_moved(const MoveData &md)
+{
+    // If the move was made from a position in the game then it continues the game
+    //  from there, otherwise it starts a new one
+    int indx = m_gamePositions.lastIndexOf(md.Position.ConstData());
+    if(-1 == indx){
+        m_gameStart = md.Position.ConstData();
+        m_gameMoves.clear();
+        m_gamePositions.clear();
+        m_gamePositions.append(m_gameStart);
+        if(FEN_STANDARD_CHESS_STARTING_POSITION == m_gameStart)
+            m_gameStart = "startpos";
+    }
+    else{
+        m_gameMoves = m_gameMoves.mid(0, indx);
+        m_gamePositions = m_gamePositions.mid(0, indx + 1);
+    }
+
+    m_gameMoves.append(m_board.GenerateGenericMove(md));
+    m_gamePositions.append(m_board.ToFEN().ConstData());
+}
+
+void EngineControl::_board_reset()
+{
+    // Going back to a position in the game doesn't start a new one
+    QByteArray fen = m_board.ToFEN().ConstData();
+    int indx = m_gamePositions.lastIndexOf(fen);
+    if(-1 == indx){
+        m_gameStart = FEN_STANDARD_CHESS_STARTING_POSITION == fen ? QByteArray("startpos") : fen;
+        m_gameMoves.clear();
+        m_gamePositions.clear();
+        m_gamePositions.append(fen);
+    }
+    else{
+        m_gameMoves = m_gameMoves.mid(0, indx);
+        m_gamePositions = m_gamePositions.mid(0, indx + 1);
+    }
+}
+
 void EngineControl::Stop()
 {
     m_engineMan->GetEngine().StopThinking();
@@ -121,25 +223,129 @@ void EngineControl::Stop()
 
 void EngineControl::_msg_tx(const QByteArray &line)
 {
-    ui->tb_engineLog->setTextColor(::Qt::blue);
-    ui->tb_engineLog->append(line);
+    _append_log(line, ::Qt::blue);
 }
 
 void EngineControl::_msg_rx(const QByteArray &line)
 {
-    ui->tb_engineLog->setTextColor(::Qt::black);
-    ui->tb_engineLog->append(line);
+    _append_log(line, ::Qt::black);
 }
 
-void EngineControl::_best_move_received(const GenericMove &, const GenericMove &)
+void EngineControl::_append_log(const QByteArray &line, int color)
 {
+    // Overwrite the oldest line if the buffer is full
+    int indx = (m_logStart + m_logSize) % ENGINE_LOG_CAPACITY;
+    if(ENGINE_LOG_CAPACITY == m_logSize)
+        m_logStart = (m_logStart + 1) % ENGINE_LOG_CAPACITY;
+    else
+        ++m_logSize;
+
+    m_log[indx].Text = line;
+    m_log[indx].Color = color;
+
+    if(ui->pte_engineLog->isVisible() && !m_logTimer.isActive())
+        m_logTimer.start(ENGINE_LOG_REFRESH_INTERVAL);
+}
+
+void EngineControl::_refresh_log()
+{
+    QPlainTextEdit *log = ui->pte_engineLog;
+    if(0 == m_logSize || !log->isVisible())
+        return;
+
+    // Only follow the new lines if the user hasn't scrolled up to read something
+    QScrollBar *sb = log->verticalScrollBar();
+    const bool at_bottom = sb->value() == sb->maximum();
+
+    QTextCursor c(log->document());
+    c.movePosition(QTextCursor::End);
+    c.beginEditBlock();
+    for(int i = 0; i < m_logSize; ++i)
+    {
+        LogLine const &l = m_log[(m_logStart + i) % ENGINE_LOG_CAPACITY];
+        if(!log->document()->isEmpty())
+            c.insertBlock();
+
+        QTextCharFormat f;
+        f.setForeground(QColor((::Qt::GlobalColor)l.Color));
+        c.insertText(QString::fromUtf8(l.Text), f);
+    }
+    c.endEditBlock();
+    m_logStart = 0;
+    m_logSize = 0;
+
+    if(at_bottom)
+        sb->setValue(sb->maximum());
+}
+
+void EngineControl::_log_visibility_changed(bool visible)
+{
+    // The log is not rendered while it's hidden, so catch up now
+    if(visible)
+        _refresh_log();
+}
+
+void EngineControl::_search_info_received(const IEngine::SearchInfo &info)
+{
+    // We only cache the main line
+    if(m_searching && 1 == info.MultiPV)
+        m_searchResult.Info.Merge(info);
+}
+
+void EngineControl::_best_move_received(const GenericMove &best, const GenericMove &ponder)
+{
+    if(m_searching){
+        m_searchResult.BestMove = best;
+        m_searchResult.Ponder = ponder;
+        m_analysisCache.Store(m_searchPosition, m_searchEngine, m_searchResult);
+        m_searching = false;
+    }
     ui->btn_gostop->setChecked(false);
 }
 
+void EngineControl::_serve_cached_result()
+{
+    _log_cached_result();
+    ui->btn_gostop->setChecked(false);
+}
+
+void EngineControl::_log_cached_result()
+{
+    IEngine::SearchInfo const &i = m_searchResult.Info;
+    QByteArray line = "(cached) info";
+    if(i.Has(IEngine::SearchInfo::HasDepth))
+        line.append(" depth ").append(QByteArray::number(i.Depth));
+    if(i.Has(IEngine::SearchInfo::HasSelDepth))
+        line.append(" seldepth ").append(QByteArray::number(i.SelDepth));
+    if(i.Has(IEngine::SearchInfo::HasScore)){
+        line.append(i.ScoreIsMate ? " score mate " : " score cp ").append(QByteArray::number(i.Score));
+        if(IEngine::SearchInfo::LowerBound == i.ScoreBound)
+            line.append(" lowerbound");
+        else if(IEngine::SearchInfo::UpperBound == i.ScoreBound)
+            line.append(" upperbound");
+    }
+    if(i.Has(IEngine::SearchInfo::HasNodes))
+        line.append(" nodes ").append(QByteArray::number(i.Nodes));
+    if(i.Has(IEngine::SearchInfo::HasTime))
+        line.append(" time ").append(QByteArray::number(i.Time));
+    if(i.Has(IEngine::SearchInfo::HasPV)){
+        line.append(" pv");
+        for(int j = 0; j < i.PVLength; ++j)
+            line.append(' ').append(i.PVMove(j).ToString().ConstData());
+    }
+    _append_log(line, ::Qt::darkGreen);
+
+    line = "(cached) bestmove ";
+    line.append(m_searchResult.BestMove.ToString().ConstData());
+    if(!m_searchResult.Ponder.IsNull())
+        line.append(" ponder ").append(m_searchResult.Ponder.ToString().ConstData());
+    _append_log(line, ::Qt::darkGreen);
+}
+
 void EngineControl::_engine_crashed()
 {
-    ui->tb_engineLog->setTextColor(::Qt::red);
-    ui->tb_engineLog->append(tr("*** ENGINE CRASHED ***"));
+    m_searching = false;
+    _append_log(tr("*** ENGINE CRASHED ***").toUtf8(), ::Qt::red);
     ui->btn_gostop->setChecked(false);
 }
 
@@ -177,13 +383,22 @@ void EngineControl::_engine_selection_changed(const QString &engine_name)
         return;
 
     if(!m_engineMan || m_engineMan->GetEngineName() != engine_name){
-        m_engineMan = new EngineManager(ui->cmb_engine->currentText(), m_settings);
+        // Start the engine in the background so we don't freeze the GUI
+        m_engineMan = new EngineManager(ui->cmb_engine->currentText(), m_settings, false);
         connect(&m_engineMan->GetEngine(), SIGNAL(MessageSent(QByteArray)), this, SLOT(_msg_tx(QByteArray)));
         connect(&m_engineMan->GetEngine(), SIGNAL(MessageReceived(QByteArray)), this, SLOT(_msg_rx(QByteArray)));
         connect(&m_engineMan->GetEngine(), SIGNAL(NotifyEngineCrashed()), this, SLOT(_engine_crashed()));
+        connect(&m_engineMan->GetEngine(), SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)),
+                this, SLOT(_search_info_received(const GKChess::IEngine::SearchInfo &)));
+        connect(&m_engineMan->GetEngine(), SIGNAL(SearchInfoReceived(const GKChess::IEngine::SearchInfo &)),
+                &m_lines, SLOT(UpdateLine(const GKChess::IEngine::SearchInfo &)));
         connect(&m_engineMan->GetEngine(), SIGNAL(BestMove(const GenericMove &, const GenericMove &)),
                 this, SLOT(_best_move_received(const GenericMove &, const GenericMove &)));
 
+        // The lines view doesn't need every update, so let the engine merge them
+        m_engineMan->GetEngine().SetSearchInfoRate(ENGINE_INFO_RATE);
+        m_lines.Clear();
+
         // Whenever we switch engines, remember the last one we used
         m_appSettings->SetValue(GKCHESS_SETTING_LAST_ENGINE_USED, engine_name);
     }
@@ -16,9 +16,13 @@ limitations under the License.*/
 #define GKCHESS_ENGINECONTROL_H
 
 #include "gkchess_enginemanager.h"
+#include "gkchess_analysiscache.h"
+#include "gkchess_searchlinesmodel.h"
 #include <gutil/smartpointer.h>
 #include <gutil/qt_settings.h>
 #include <QWidget>
+#include <QTimer>
+#include <QVector>
 
 namespace Ui {
 class EngineControl;
@@ -27,6 +31,8 @@ class EngineControl;
 namespace GKChess{
 class IEngine;
 class Board;
+class ObservableBoard;
+struct MoveData;
 class EngineSettings;
 class GenericMove;
 
@@ -45,10 +51,42 @@ class EngineControl : public QWidget
     QStringList m_engineList;
     bool m_suppressUpdate;
 
+    /** One line of the engine log. */
+    struct LogLine
+    {
+        QByteArray Text;
+        int Color;
+    };
+
+    // Engines can send thousands of lines per second, so new lines wait in a bounded
+    //  ring buffer and are only appended to the view every so often, and only when
+    //  it's visible.  The view drops its oldest lines by itself.
+    QVector<LogLine> m_log;
+    int m_logStart;
+    int m_logSize;
+    QTimer m_logTimer;
+
+    // Search results are cached, so we don't search a position again if we already know it
+    AnalysisCache m_analysisCache;
+    GUINT64 m_searchPosition;
+    GUINT64 m_searchEngine;
+    bool m_searching;
+    AnalysisCache::Entry m_searchResult;
+
+    // We follow the game on the board, so the engine sees each position as a continuation
+    //  of the game and keeps its hash table.  The positions are the FEN after each move,
+    //  starting with the starting position.
+    QByteArray m_gameStart;
+    QList<GenericMove> m_gameMoves;
+    QList<QByteArray> m_gamePositions;
+
+    // The best lines of the current search
+    SearchLinesModel m_lines;
+
     Ui::EngineControl *ui;
 public:
 
-    explicit EngineControl(Board &, EngineSettings *engine_settings, GUtil::Qt::Settings *app_settings, QWidget *parent = 0);
+    explicit EngineControl(ObservableBoard &, EngineSettings *engine_settings, GUtil::Qt::Settings *app_settings, QWidget *parent = 0);
     ~EngineControl();
 
 
@@ -65,7 +103,12 @@ private slots:
 
     void _msg_tx(const QByteArray &);
     void _msg_rx(const QByteArray &);
+    void _search_info_received(const GKChess::IEngine::SearchInfo &);
     void _best_move_received(const GenericMove &, const GenericMove &);
+    void _serve_cached_result();
+
+    void _piece_moved(const GKChess::MoveData &);
+    void _board_reset();
 
     void _engine_crashed();
 
@@ -76,10 +119,15 @@ private slots:
 
     void _engines_updated();
 
+    void _refresh_log();
+    void _log_visibility_changed(bool);
+
 
 private:
 
     void _update_go_stop_text(bool);
+    void _append_log(const QByteArray &, int color);
+    void _log_cached_result();
 
 };
 
@@ -15,6 +15,7 @@ limitations under the License.*/
 #include "editengine.h"
 #include "ui_editengine.h"
 #include <gkchess_common.h>
+#include "gkchess_enginesettings.h"
 #include <QFileDialog>
 
 NAMESPACE_GKCHESS1(UI);
@@ -59,7 +60,7 @@ void EditEngine::_path_changed()
 {
     QString fn = ui->line_path->text();
     QFile f(fn);
-    if(f.exists()){
+    if(GKCHESS_NATIVE_ENGINE_PATH == fn || f.exists()){
         ui->lbl_warning->clear();
         path = fn;
     }
@@ -48,6 +48,7 @@ ManageEngines::ManageEngines(EngineSettings *settings, GUtil::Qt::Settings *app_
 
     connect(ui->lst_engines, SIGNAL(currentRowChanged(int)),
             this, SLOT(_current_changed(int)));
+    connect(&m_engineReady, SIGNAL(finished()), this, SLOT(_engine_ready()));
 
     const QString last_engine = app_settings->Value(GKCHESS_SETTING_LAST_ENGINE_USED).toString();
     QList<QListWidgetItem *> lst = ui->lst_engines->findItems(last_engine,::Qt::MatchExactly);
@@ -95,14 +96,34 @@ void ManageEngines::_current_changed(int r)
 
     _clear_options_panel();
 
-    // This starts up the engine
-    m_engineManager = new EngineManager(m_engineList[r], m_settings);
+    // Start the engine in the background so we don't freeze the GUI, and fill
+    //  in the options when it's ready
+    m_engineManager = new EngineManager(m_engineList[r], m_settings, false);
 
-    // Then we can read the options and populate the form
+    QGridLayout *gl = static_cast<QGridLayout *>(ui->pnl_options->layout());
+    QLabel *starting = new QLabel(tr("Starting the engine..."), this);
+    gl->addWidget(starting, 0, 0);
+    m_optionItems.append(starting);
+
+    m_engineReady.setFuture(m_engineManager->GetEngine().WaitForReadyAsync());
+}
+
+void ManageEngines::_engine_ready()
+{
+    _clear_options_panel();
+
+    QGridLayout *gl = static_cast<QGridLayout *>(ui->pnl_options->layout());
+    if(!m_engineReady.result()){
+        QLabel *failed = new QLabel(tr("The engine failed to start"), this);
+        gl->addWidget(failed, 0, 0);
+        m_optionItems.append(failed);
+        return;
+    }
+
+    // Now we can read the options and populate the form
     IEngine &e = m_engineManager->GetEngine();
     const IEngine::EngineInfo &info = e.GetEngineInfo();
 
-    QGridLayout *gl = static_cast<QGridLayout *>(ui->pnl_options->layout());
     {
         QLabel *name, *name_value, *author, *author_value;
         gl->addWidget(name = new QLabel(tr("Name:"), this), 0, 0);
@@ -18,6 +18,7 @@ limitations under the License.*/
 #include <gutil/smartpointer.h>
 #include <gutil/qt_settings.h>
 #include <QDialog>
+#include <QFutureWatcher>
 
 namespace Ui{
 class ManageEngines;
@@ -38,6 +39,9 @@ class ManageEngines : public QDialog
     QStringList m_engineList;
     GUtil::SmartPointer<EngineManager> m_engineManager;
 
+    // Tells us when the engine has started, so we can show its options
+    QFutureWatcher<bool> m_engineReady;
+
     QWidgetList m_optionItems;
 
 public:
@@ -56,6 +60,7 @@ private slots:
 
     void _engine_list_updated();
     void _current_changed(int);
+    void _engine_ready();
     void _add();
     void _edit();
     void _delete();
@@ -17,6 +17,7 @@ limitations under the License.*/
 #include <gutil/pluginutils.h>
 #include <gutil/string.h>
 #include <QColor>
+#include <QtConcurrentRun>
 USING_NAMESPACE_GKCHESS;
 USING_NAMESPACE_GUTIL;
 USING_NAMESPACE_GUTIL1(Qt);
@@ -24,32 +25,82 @@ USING_NAMESPACE_GUTIL1(Qt);
 NAMESPACE_GKCHESS1(UI);
 
 
+/** Everything the background thread needs to fetch the children of one node,
+ *  and the results it produces.
+*/
+struct BookModel::Fetch
+{
+    GUINT32 Generation;
+    int Node;
+
+    // The board position at the root of the tree, and the moves to get to the node
+    Board Start;
+    QList<MoveData> Ancestors;
+
+    // Filled in by the background thread
+    QList<BookMove> Moves;
+    QList<MoveData> Data;
+
+    Fetch(const Board &b) :Start(b) {}
+};
+
+
 BookModel::BookModel(ObservableBoard &b, QObject *parent)
     :QAbstractItemModel(parent),
       m_board(b),
-      i_bookReader(PluginUtils::LoadPlugin<IBookReader>(m_pl, "polyglotReaderPlugin"))
+      i_bookReader(PluginUtils::LoadPlugin<IBookReader>(m_pl, "polyglotReaderPlugin")),
+      m_book(*i_bookReader),
+      m_nodes(1),
+      m_moveInProgress(false),
+      m_generation(0),
+      m_pendingFetches(0),
+      m_shuttingDown(false)
 {
+    connect(this, SIGNAL(NotifyFetchFinished()), this, SLOT(_apply_fetch_results()),
+            ::Qt::QueuedConnection);
+    connect(&b, SIGNAL(NotifyPieceAboutToBeMoved(const GKChess::MoveData &)),
+            this, SLOT(_piece_about_to_move()));
     connect(&b, SIGNAL(NotifyPieceMoved(const GKChess::MoveData &)),
-            this, SLOT(_board_position_changed()));
+            this, SLOT(_piece_moved(const GKChess::MoveData &)));
     connect(&b, SIGNAL(NotifySquareUpdated(const GKChess::Square &)),
-            this, SLOT(_board_position_changed()));
+            this, SLOT(_square_updated()));
     connect(&b, SIGNAL(NotifyBoardReset()),
             this, SLOT(_board_position_changed()));
+
+    // Start up the background thread
+    m_workerPool.setMaxThreadCount(1);
+    m_workerRef = QtConcurrent::run(&m_workerPool, this, &BookModel::_worker_thread);
+}
+
+BookModel::~BookModel()
+{
+    // Take down the background thread
+    QMutexLocker lkr(&m_lock);
+    m_shuttingDown = true;
+    lkr.unlock();
+    m_somethingToDo.wakeOne();
+    m_workerRef.waitForFinished();
+
+    qDeleteAll(m_requests);
+    qDeleteAll(m_results);
 }
 
 bool BookModel::SetBookFile(const QString &filename)
 {
     // If the filename didn't change, then return
-    if(filename == i_bookReader->GetBookFilename())
+    if(filename == m_book.GetBookFilename())
         return false;
 
-    i_bookReader->CloseBook();
     _board_position_changed();
 
+    // Make sure the background thread isn't using the book while we change it
+    QMutexLocker lkr(&m_bookLock);
+    m_book.CloseBook();
+
     if(!filename.isEmpty())
     {
         try{
-            i_bookReader->OpenBook(filename.toUtf8().constData());
+            m_book.OpenBook(filename.toUtf8().constData());
         } catch(...) {
             return false;
         }
@@ -59,39 +110,33 @@ bool BookModel::SetBookFile(const QString &filename)
 
 QString BookModel::GetBookFile() const
 {
-    return i_bookReader->GetBookFilename();
+    return m_book.GetBookFilename();
 }
 
 QModelIndexList BookModel::GetAncestry(const QModelIndex &ind) const
 {
     QModelIndexList ret;
-    _get_ancestry_helper(ret, ind);
+    for(int id = _get_node_id(ind); 0 < id; id = m_nodes[id].Parent)
+        ret.prepend(_get_index_of_node(id));
     return ret;
 }
 
-void BookModel::_get_ancestry_helper(QModelIndexList &l, const QModelIndex &i) const
-{
-    if(!i.isValid())
-        return;
-
-    _get_ancestry_helper(l, i.parent());
-    l.append(i);
-}
-
 const MoveData *BookModel::ConvertIndexToMoveData(const QModelIndex &i) const
 {
     MoveData const *ret = 0;
-    if(i.isValid())
-        ret = &_get_data_from_index(i)->Data;
+    if(i.isValid()){
+        Node const &n = m_nodes[_get_node_id(i)];
+        if(!n.Placeholder)
+            ret = &n.Data;
+    }
     return ret;
 }
 
 bool BookModel::hasChildren(const QModelIndex &i) const
 {
     bool ret = false;
-    MoveDataContainer const *c = _get_children_of_index(i);
-    //if(!i.isValid() || 0 == i.column())
-    if(!c->Loaded || 0 < c->Moves.size())
+    Node const &n = m_nodes[_get_node_id(i)];
+    if(!n.Loaded || 0 < n.Children.size())
         ret = true;
     return ret;
 }
@@ -100,7 +145,7 @@ int BookModel::rowCount(const QModelIndex &parent) const
 {
     int ret = 0;
     if(!parent.isValid() || 0 == parent.column()){
-        ret = _get_children_of_index(parent)->Moves.size();
+        ret = m_nodes[_get_node_id(parent)].Children.size();
     }
     return ret;
 }
@@ -116,18 +161,22 @@ QVariant BookModel::data(const QModelIndex &index, int role) const
     if(index.isValid())
     {
         int col = index.column();
-        MoveDataCache *d = _get_data_from_index(index);
+        Node const &d = m_nodes[_get_node_id(index)];
         switch((::Qt::ItemDataRole)role)
         {
         case ::Qt::DisplayRole:
-            if(0 == col)
-                ret = d->Data.PGNData.ToString().ToQString();
+            if(d.Placeholder){
+                if(0 == col)
+                    ret = tr("Loading...");
+            }
+            else if(0 == col)
+                ret = d.Data.PGNData.ToString().ToQString();
             else if(1 == col)
-                ret = d->BookData.Weight;
+                ret = d.BookData.Weight;
             break;
         case ::Qt::BackgroundRole:
         {
-            int n = 0x1 & GetAncestry(index).length();
+            int n = 0x1 & (d.Depth + 1);
             Piece::AllegienceEnum a = m_board.GetWhoseTurn();
             if((n && a == Piece::White) || (!n && a == Piece::Black))
                 ret = QColor(::Qt::white);
@@ -177,7 +226,7 @@ QModelIndex BookModel::index(int row, int column, const QModelIndex &parent) con
     if(0 <= row && row < rowCount(parent) &&
             0 <= column && column < columnCount(parent))
     {
-        ret = createIndex(row, column, (void *)&_get_children_of_index(parent)->Moves[row]);
+        ret = createIndex(row, column, (quintptr)m_nodes[_get_node_id(parent)].Children[row]);
     }
     return ret;
 }
@@ -185,97 +234,264 @@ QModelIndex BookModel::index(int row, int column, const QModelIndex &parent) con
 QModelIndex BookModel::parent(const QModelIndex &child) const
 {
     QModelIndex ret;
-    MoveDataCache *d = _get_data_from_index(child);
-    if(d && d->Parent){
-        int parent_row;
-        if(d->Parent->Parent)
-            parent_row = d->Parent->Parent->Moves.indexOf(*d->Parent);
-        else
-            parent_row = m_rootContainer.Moves.indexOf(*d->Parent);
-        ret = createIndex(parent_row, 0, d->Parent);
-    }
+    if(child.isValid())
+        ret = _get_index_of_node(m_nodes[_get_node_id(child)].Parent);
+    return ret;
+}
+
+int BookModel::_get_node_id(const QModelIndex &i)
+{
+    return i.isValid() ? (int)i.internalId() : 0;
+}
+
+QModelIndex BookModel::_get_index_of_node(int id, int column) const
+{
+    QModelIndex ret;
+    if(0 < id)
+        ret = createIndex(m_nodes[id].Row, column, (quintptr)id);
+    return ret;
+}
+
+int BookModel::_append_node(int parent)
+{
+    int ret = m_nodes.size();
+
+    // Careful not to hold a reference into the vector while it grows
+    Node n(parent, m_nodes[parent].Children.size(), m_nodes[parent].Depth + 1);
+    m_nodes.append(n);
+    m_nodes[parent].Children.append(ret);
     return ret;
 }
 
 void BookModel::fetchMore(const QModelIndex &parent)
 {
-    MoveDataContainer *lst = _get_children_of_index(parent);
-    MoveDataCache *d = _get_data_from_index(parent);
-    if(lst->Loaded)
+    int id = _get_node_id(parent);
+    if(m_nodes[id].Loaded || m_nodes[id].Loading)
         return;
 
-    // Need to simulate all parents' moves
-    Board cpy = m_board;
-    QModelIndexList parents = GetAncestry(parent);
-    for(int i = 0; i < parents.length(); ++i){
-        cpy.Move(_get_data_from_index(parents[i])->Data);
+    // Replaying the moves and looking up the book can be slow, so we let the
+    //  background thread do it and show a placeholder in the meantime
+    Fetch *f = new Fetch(m_board);
+    f->Generation = m_generation;
+    f->Node = id;
+    for(int cur = id; 0 < cur; cur = m_nodes[cur].Parent)
+        f->Ancestors.prepend(m_nodes[cur].Data);
+
+    m_nodes[id].Loading = true;
+    beginInsertRows(parent, 0, 0);
+    {
+        int placeholder = _append_node(id);
+        m_nodes[placeholder].Placeholder = true;
+        m_nodes[placeholder].Loaded = true;
     }
+    endInsertRows();
 
-    String s = cpy.ToFEN();
-    QList<BookMove> moves = i_bookReader->LookupMoves(s);
-    lst->Loaded = true;
+    ++m_pendingFetches;
+    QMutexLocker lkr(&m_lock);
+    m_requests.append(f);
+    m_somethingToDo.wakeOne();
+}
 
-    if(0 < moves.size())
+void BookModel::_worker_thread()
+{
+    QMutexLocker lkr(&m_lock);
+
+    // Loop until we are shut down
+    while(!m_shuttingDown)
     {
-        beginInsertRows(parent, 0, moves.size() - 1);
-        for(BookMove const &m : moves){
-            lst->Moves.append(MoveDataCache(d));
-            lst->Moves.back().BookData = m;
-            lst->Moves.back().Data = cpy.GenerateMoveData(cpy.SquareAt(m.SourceCol, m.SourceRow),
-                                                          cpy.SquareAt(m.DestCol, m.DestRow),
-                                                          0, true);
+        // Wait here for something to do
+        while(!m_shuttingDown && m_requests.isEmpty())
+            m_somethingToDo.wait(&m_lock);
+
+        if(m_shuttingDown)
+            break;
+
+        Fetch *f = m_requests.takeFirst();
+
+        // Unlock while we do the fetch
+        lkr.unlock();
+        {
+            // Need to simulate all parents' moves
+            for(MoveData const &md : f->Ancestors)
+                f->Start.Move(md);
+
+            QMutexLocker book_lkr(&m_bookLock);
+            try{
+                f->Moves = m_book.LookupMoves(f->Start.ToFEN());
+            } catch(...) {
+                // If the lookup failed then we show no moves
+            }
+            book_lkr.unlock();
+
+            // This way the book's promoted piece is used, instead of always a queen
+            for(BookMove const &m : f->Moves)
+                f->Data.append(f->Start.GenerateMoveData(m, true));
         }
-        endInsertRows();
+        lkr.relock();
+
+        m_results.append(f);
+        emit NotifyFetchFinished();
     }
-    else
+}
+
+void BookModel::_apply_fetch_results()
+{
+    QList<Fetch *> results;
     {
-        // Now we know that the parent has no children,
-        //  so we notify that it has changed so the view can remove the expander
-        emit dataChanged(parent, parent);
+        QMutexLocker lkr(&m_lock);
+        results.swap(m_results);
     }
+
+    for(Fetch *f : results)
+    {
+        // Ignore fetches for nodes that have since been thrown away
+        if(f->Generation == m_generation)
+        {
+            --m_pendingFetches;
+
+            int id = f->Node;
+            QModelIndex parent = _get_index_of_node(id);
+            m_nodes[id].Loading = false;
+            m_nodes[id].Loaded = true;
+
+            if(0 < f->Moves.size())
+            {
+                // Reuse the placeholder's node for the first move
+                int placeholder = m_nodes[id].Children[0];
+                m_nodes[placeholder].Placeholder = false;
+                m_nodes[placeholder].Loaded = false;
+                m_nodes[placeholder].BookData = f->Moves[0];
+                m_nodes[placeholder].Data = f->Data[0];
+                emit dataChanged(_get_index_of_node(placeholder, 0), _get_index_of_node(placeholder, 1));
+
+                if(1 < f->Moves.size())
+                {
+                    beginInsertRows(parent, 1, f->Moves.size() - 1);
+                    for(int i = 1; i < f->Moves.size(); ++i){
+                        int child = _append_node(id);
+                        m_nodes[child].BookData = f->Moves[i];
+                        m_nodes[child].Data = f->Data[i];
+                    }
+                    endInsertRows();
+                }
+            }
+            else
+            {
+                // Remove the placeholder.  Its node stays in the array until the next reset.
+                beginRemoveRows(parent, 0, 0);
+                m_nodes[id].Children.clear();
+                endRemoveRows();
+
+                // Now we know that the parent has no children,
+                //  so we notify that it has changed so the view can remove the expander
+                emit dataChanged(parent, parent);
+            }
+        }
+        delete f;
+    }
+}
+
+void BookModel::_clear_fetches()
+{
+    ++m_generation;
+    m_pendingFetches = 0;
+
+    // Any fetch the background thread is already doing will be ignored when it's finished
+    QMutexLocker lkr(&m_lock);
+    qDeleteAll(m_requests);
+    m_requests.clear();
 }
 
 bool BookModel::canFetchMore(const QModelIndex &parent) const
 {
-    MoveDataContainer const *d = _get_children_of_index(parent);
-    return !d->Loaded;
+    Node const &n = m_nodes[_get_node_id(parent)];
+    return !n.Loaded && !n.Loading;
 }
 
-BookModel::MoveDataCache *BookModel::_get_data_from_index(const QModelIndex &i) const
+void BookModel::_piece_about_to_move()
 {
-    MoveDataCache *ret = 0;
-    if(i.isValid()){
-        ret = reinterpret_cast<MoveDataCache *>(i.internalPointer());
-    }
-    return ret;
+    // The board updates squares one at a time while it moves a piece, but we
+    //  only care about the finished move
+    m_moveInProgress = true;
 }
 
-BookModel::MoveDataContainer const *BookModel::_get_children_of_index(const QModelIndex &i) const
+void BookModel::_square_updated()
 {
-    MoveDataContainer const *ret;
-    if(i.isValid())
-        ret = reinterpret_cast<MoveDataCache *>(i.internalPointer());
-    else
-        ret = &m_rootContainer;
-    return ret;
+    if(!m_moveInProgress)
+        _board_position_changed();
 }
 
-BookModel::MoveDataContainer *BookModel::_get_children_of_index(const QModelIndex &i)
+void BookModel::_piece_moved(const MoveData &md)
 {
-    MoveDataContainer *ret;
-    if(i.isValid())
-        ret = reinterpret_cast<MoveDataCache *>(i.internalPointer());
-    else
-        ret = &m_rootContainer;
-    return ret;
+    m_moveInProgress = false;
+
+    // If we already loaded the move that was made, its subtree becomes the new root
+    //  so we don't have to look up anything we've already seen.
+    int found = -1;
+    for(int child : m_nodes[0].Children){
+        Node const &c = m_nodes[child];
+        if(!c.Placeholder &&
+                c.Data.Source == md.Source &&
+                c.Data.Destination == md.Destination &&
+                c.Data.PiecePromoted.GetType() == md.PiecePromoted.GetType())
+        {
+            found = child;
+            break;
+        }
+    }
+
+    // Fetches in progress may be for nodes we're about to throw away, so in that
+    //  case we start over
+    if(-1 == found || !m_nodes[found].Loaded || 0 < m_pendingFetches){
+        _board_position_changed();
+        return;
+    }
+
+    _clear_fetches();
+    beginResetModel();
+    _promote_node(found);
+    endResetModel();
+}
+
+void BookModel::_promote_node(int id)
+{
+    // Copy the subtree breadth-first into a new array, which also drops
+    //  any nodes that are no longer reachable
+    QVector<Node> nodes;
+    QVector<int> old_ids;
+    nodes.append(Node());
+    nodes[0].Loaded = m_nodes[id].Loaded;
+    old_ids.append(id);
+
+    for(int i = 0; i < nodes.size(); ++i)
+    {
+        QVector<int> old_children = m_nodes[old_ids[i]].Children;
+        for(int old_child : old_children)
+        {
+            Node n = m_nodes[old_child];
+            n.Parent = i;
+            n.Row = nodes[i].Children.size();
+            n.Depth = nodes[i].Depth + 1;
+            n.Children.clear();
+
+            nodes[i].Children.append(nodes.size());
+            nodes.append(n);
+            old_ids.append(old_child);
+        }
+    }
+    m_nodes.swap(nodes);
 }
 
 void BookModel::_board_position_changed()
 {
+    // This is also how we hear that a move failed, so we may never get its NotifyPieceMoved
+    m_moveInProgress = false;
+    _clear_fetches();
+
     beginResetModel();
     {
-        m_rootContainer.Loaded = false;
-        m_rootContainer.Moves.clear();
+        m_nodes.clear();
+        m_nodes.append(Node());
     }
     endResetModel();
 }
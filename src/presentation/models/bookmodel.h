@@ -17,8 +17,13 @@ limitations under the License.*/
 
 #include "gkchess_ibookreader.h"
 #include "gkchess_board_movedata.h"
+#include "gkchess_bookreadercache.h"
 #include <QAbstractItemModel>
 #include <QPluginLoader>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QFuture>
 
 namespace GKChess{
 class ObservableBoard;
@@ -26,31 +31,45 @@ namespace UI{
 
 
 /** A model for navigating an opening book in a tree view.
- *  It lazy-loads each node.
+ *  It lazy-loads each node on a background thread, showing a placeholder
+ *  row until the book lookup is finished.
+ *
+ *  Book lookups go through an LRU cache, and when a move is made on the board that
+ *  we already loaded, the subtree under that move is kept as the new root.
 */
 class BookModel :
         public QAbstractItemModel
 {
     Q_OBJECT
 
-    struct MoveDataCache;
-
-    /** Contains a list of moves. */
-    struct MoveDataContainer
+    /** One node of the tree.  The nodes are stored in a flat array and refer to each
+     *  other by their position in it, so we can find a node's parent, row and depth
+     *  in constant time.  Node 0 is the root, which represents the board's position.
+    */
+    struct Node
     {
-        QList<MoveDataCache> Moves;
+        /** The index of my parent node, or -1 if I am the root. */
+        int Parent;
+
+        /** My row under my parent. */
+        int Row;
+
+        /** How many moves from the board's position I am, so the root's children have depth 0. */
+        int Depth;
+
+        /** The indexes of my child nodes, in row order. */
+        QVector<int> Children;
+
+        /** True when the children have been fetched from the book. */
         bool Loaded;
-        MoveDataContainer() :Loaded(false) {}
-    };
 
-    /** One cached move consists of the actual move data, a reference to
-        the parent index and a list of other moves.
-    */
-    struct MoveDataCache :
-        public MoveDataContainer
-    {
-        /** A reference to my parent index. */
-        MoveDataCache *Parent;
+        /** True while the children are being fetched in the background.  During this
+         *  time the only child is a placeholder.
+        */
+        bool Loading;
+
+        /** True if this is the "loading" row shown while the siblings are fetched. */
+        bool Placeholder;
 
         /** The data held within an index. */
         MoveData Data;
@@ -58,18 +77,42 @@ class BookModel :
         /** Stores the data from the book. */
         BookMove BookData;
 
-        bool operator == (const MoveDataCache &o) const{ return this == &o; }
-
-        explicit MoveDataCache(MoveDataCache *parent = 0) :Parent(parent){}
+        Node(int parent = -1, int row = 0, int depth = -1)
+            :Parent(parent), Row(row), Depth(depth),
+              Loaded(false), Loading(false), Placeholder(false) {}
     };
 
     Board &m_board;
     QPluginLoader m_pl;
     IBookReader *i_bookReader;
-    MoveDataContainer m_rootContainer;
+    BookReaderCache m_book;
+    QVector<Node> m_nodes;
+    bool m_moveInProgress;
+
+    // Incremented every time the nodes are thrown away or renumbered, so we can ignore stale fetches
+    GUINT32 m_generation;
+    int m_pendingFetches;
+
+    // Shared members between main and background thread, protected by m_lock
+    struct Fetch;
+    QList<Fetch *> m_requests;
+    QList<Fetch *> m_results;
+    bool m_shuttingDown;
+    QMutex m_lock;
+    QWaitCondition m_somethingToDo;
+
+    // Held by the background thread while it's using the book, so we can safely change books
+    QMutex m_bookLock;
+
+    // The background thread runs for as long as we live, so it gets a pool of its own
+    //  instead of tying up one of the global pool's threads
+    QThreadPool m_workerPool;
+    QFuture<void> m_workerRef;
+
 public:
 
     explicit BookModel(ObservableBoard &, QObject *parent = 0);
+    ~BookModel();
 
     /** Opens the book file at the given file path. */
     bool SetBookFile(const QString &filename);
@@ -77,6 +120,10 @@ public:
     /** Returns the current book file. */
     QString GetBookFile() const;
 
+    /** Returns the cache in front of the book reader, so you can inspect its statistics. */
+    BookReaderCache &GetBookCache(){ return m_book; }
+    BookReaderCache const &GetBookCache() const{ return m_book; }
+
     /** Returns all ancestors of the given index, including the index */
     QModelIndexList GetAncestry(const QModelIndex &) const;
 
@@ -104,18 +151,37 @@ public:
     /** \} */
 
 
+signals:
+
+    /** Emitted by the background thread when a fetch is finished.  The results are
+     *  applied to the model on the GUI thread through a queued connection.
+    */
+    void NotifyFetchFinished();
+
+
 private slots:
 
+    void _apply_fetch_results();
     void _board_position_changed();
+    void _piece_about_to_move();
+    void _piece_moved(const GKChess::MoveData &);
+    void _square_updated();
 
 
 private:
 
-    MoveDataCache *_get_data_from_index(const QModelIndex &) const;
-    MoveDataContainer const *_get_children_of_index(const QModelIndex &) const;
-    MoveDataContainer *_get_children_of_index(const QModelIndex &);
+    // Returns the node id of the index, which is 0 for the root (invalid) index
+    static int _get_node_id(const QModelIndex &);
+    QModelIndex _get_index_of_node(int id, int column = 0) const;
+
+    // Appends a node under the given parent and returns its id
+    int _append_node(int parent);
+
+    // Makes the given node the new root, keeping only its subtree
+    void _promote_node(int id);
 
-    void _get_ancestry_helper(QModelIndexList &, const QModelIndex &) const;
+    void _worker_thread();
+    void _clear_fetches();
 
 };
 
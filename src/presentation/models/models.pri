@@ -1,7 +1,9 @@
 HEADERS += \
     models/movedatamodel.h \
-    models/bookmodel.h
+    models/bookmodel.h \
+    models/searchlinesmodel.h
 
 SOURCES += \
     models/movedatamodel.cpp \
-    models/bookmodel.cpp
+    models/bookmodel.cpp \
+    models/searchlinesmodel.cpp
@@ -19,7 +19,8 @@ NAMESPACE_GKCHESS1(UI);
 
 
 MoveDataModel::MoveDataModel(QObject *parent)
-    :QAbstractItemModel(parent)
+    :QAbstractItemModel(parent),
+      m_nodes(1)
 {}
 
 void MoveDataModel::InitFromPGN(const QList<PGN_MoveData> &)
@@ -29,7 +30,7 @@ void MoveDataModel::InitFromPGN(const QList<PGN_MoveData> &)
 
 int MoveDataModel::rowCount(const QModelIndex &i) const
 {
-    return _get_container_from_index(i)->Moves.size();
+    return m_nodes[_get_node_id(i)].Children.size();
 }
 
 int MoveDataModel::columnCount(const QModelIndex &) const
@@ -40,8 +41,7 @@ int MoveDataModel::columnCount(const QModelIndex &) const
 QVariant MoveDataModel::data(const QModelIndex &i, int role) const
 {
     QVariant ret;
-    MoveDataCache *md = _get_data_from_index(i);
-    if(md)
+    if(i.isValid())
     {
         switch((::Qt::ItemDataRole)role)
         {
@@ -57,38 +57,23 @@ QVariant MoveDataModel::data(const QModelIndex &i, int role) const
 
 QModelIndex MoveDataModel::index(int r, int c, const QModelIndex &i) const
 {
-    return createIndex(r, c, _get_container_from_index(i)->Moves[r]);
+    return createIndex(r, c, (quintptr)m_nodes[_get_node_id(i)].Children[r]);
 }
 
 QModelIndex MoveDataModel::parent(const QModelIndex &i) const
 {
     QModelIndex ret;
-    MoveDataCache *mc = _get_data_from_index(i);
-    if(mc){
-        if(mc->Parent){
-            MoveDataCache *grandparent = mc->Parent->Parent;
-            int row = mc->Parent->Data.PlyNumber - 1;
-            if(grandparent)
-                row -= grandparent->Data.PlyNumber;
-            ret = createIndex(row, 0, mc->Parent);
-        }
+    if(i.isValid()){
+        int p = m_nodes[_get_node_id(i)].Parent;
+        if(0 < p)
+            ret = createIndex(m_nodes[p].Row, 0, (quintptr)p);
     }
     return ret;
 }
 
-MoveDataModel::MoveDataContainer *MoveDataModel::_get_container_from_index(const QModelIndex &i)
-{
-    return i.isValid() ? _get_data_from_index(i) : &m_rootContainer;
-}
-
-MoveDataModel::MoveDataContainer const *MoveDataModel::_get_container_from_index(const QModelIndex &i) const
-{
-    return i.isValid() ? _get_data_from_index(i) : &m_rootContainer;
-}
-
-MoveDataModel::MoveDataCache *MoveDataModel::_get_data_from_index(const QModelIndex &i)
+int MoveDataModel::_get_node_id(const QModelIndex &i)
 {
-    return i.isValid() ? reinterpret_cast<MoveDataCache *>(i.internalPointer()) : 0;
+    return i.isValid() ? (int)i.internalId() : 0;
 }
 
 
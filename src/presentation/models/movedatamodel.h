@@ -19,6 +19,7 @@ limitations under the License.*/
 #include "gkchess_board.h"
 #include "gkchess_board_movedata.h"
 #include <QAbstractItemModel>
+#include <QVector>
 
 namespace GKChess{ namespace UI{
 
@@ -29,31 +30,32 @@ class MoveDataModel :
 {
     Q_OBJECT
 
-    struct MoveDataCache;
-
-    /** Contains a list of moves. */
-    struct MoveDataContainer
-    {
-        QList<MoveDataCache *> Moves;
-    };
-
-    /** One cached move consists of the actual move data, a reference to
-        the parent index and a list of other moves.
+    /** One node of the tree.  The nodes are stored in a flat array and refer to each
+     *  other by their position in it, so parent and index lookups are constant time.
+     *  Node 0 is the root.
     */
-    struct MoveDataCache :
-        public MoveDataContainer
+    struct Node
     {
-        /** A reference to my parent index. */
-        MoveDataCache *Parent;
+        /** The index of my parent node, or -1 if I am the root. */
+        int Parent;
+
+        /** My row under my parent. */
+        int Row;
+
+        /** My distance from the root's children, which have depth 0. */
+        int Depth;
+
+        /** The indexes of my child nodes, in row order. */
+        QVector<int> Children;
 
         /** The data held within an index. */
         MoveData Data;
 
-        MoveDataCache(MoveDataCache *parent = 0) :Parent(parent){}
-        virtual ~MoveDataCache() {}
+        Node(int parent = -1, int row = 0, int depth = -1)
+            :Parent(parent), Row(row), Depth(depth) {}
     };
 
-    MoveDataContainer m_rootContainer;
+    QVector<Node> m_nodes;
 
 public:
 
@@ -77,12 +79,8 @@ public:
 
 private:
 
-    // This will always return a value, because even the root is a container
-    MoveDataContainer *_get_container_from_index(const QModelIndex &);
-    MoveDataContainer const *_get_container_from_index(const QModelIndex &) const;
-
-    // This will always return a value except when the root index is passed
-    static MoveDataCache *_get_data_from_index(const QModelIndex &);
+    // Returns the node id of the index, which is 0 for the root (invalid) index
+    static int _get_node_id(const QModelIndex &);
 
 };
 
@@ -0,0 +1,215 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#include "searchlinesmodel.h"
+#include <gutil/string.h>
+USING_NAMESPACE_GKCHESS;
+USING_NAMESPACE_GUTIL;
+
+NAMESPACE_GKCHESS1(UI);
+
+
+SearchLinesModel::SearchLinesModel(QObject *parent)
+    :QAbstractTableModel(parent),
+      m_maxLines(1)
+{}
+
+void SearchLinesModel::StartSearch(const Board &b, int max_lines)
+{
+    beginResetModel();
+    m_board = b;
+    m_maxLines = qMax(1, max_lines);
+    m_lines.clear();
+    endResetModel();
+}
+
+void SearchLinesModel::Clear()
+{
+    beginResetModel();
+    m_lines.clear();
+    endResetModel();
+}
+
+IEngine::SearchInfo const *SearchLinesModel::GetLine(int row) const
+{
+    IEngine::SearchInfo const *ret = 0;
+    if(0 <= row && row < m_lines.size())
+        ret = &m_lines[row].Info;
+    return ret;
+}
+
+QString SearchLinesModel::GetLineSAN(int row) const
+{
+    QString ret;
+    if(0 <= row && row < m_lines.size())
+    {
+        Line const &l = m_lines[row];
+        if(!l.SANValid){
+            l.SAN = _render_san(l.Info);
+            l.SANValid = true;
+        }
+        ret = l.SAN;
+    }
+    return ret;
+}
+
+void SearchLinesModel::UpdateLine(const IEngine::SearchInfo &info)
+{
+    int row = info.MultiPV - 1;
+    if(row < 0 || m_maxLines <= row)
+        return;
+
+    // The row is always the line's MultiPV index, so if a line comes before the ones
+    //  above it we add those too, and they fill in when their info comes
+    if(m_lines.size() <= row){
+        beginInsertRows(QModelIndex(), m_lines.size(), row);
+        m_lines.resize(row + 1);
+        endInsertRows();
+    }
+
+    // Most updates only change the score or node count, so we only throw away the
+    //  SAN when the moves are different
+    Line &l = m_lines[row];
+    if(info.Has(IEngine::SearchInfo::HasPV) &&
+            (info.PVLength != l.Info.PVLength ||
+             0 != memcmp(info.PV, l.Info.PV, info.PVLength * sizeof(GUINT16))))
+    {
+        l.SAN.clear();
+        l.SANValid = false;
+    }
+    l.Info.Merge(info);
+    emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+}
+
+QString SearchLinesModel::_render_san(const IEngine::SearchInfo &info) const
+{
+    QString ret;
+    Board b(m_board);
+    for(int i = 0; i < info.PVLength; ++i)
+    {
+        MoveData md = b.GenerateMoveData(info.PVMove(i));
+        if(md.IsNull())
+            break;
+
+        QString move_number;
+        if(Piece::White == b.GetWhoseTurn())
+            move_number = QString("%1. ").arg(b.GetFullMoveNumber());
+        else if(0 == i)
+            move_number = QString("%1... ").arg(b.GetFullMoveNumber());
+
+        // Stop at the first move we don't understand, rather than show nonsense after it
+        if(Board::ValidMove != b.Move(md))
+            break;
+
+        if(0 < i)
+            ret.append(' ');
+        ret.append(move_number).append(md.PGNData.ToString().ToQString());
+    }
+    return ret;
+}
+
+QString SearchLinesModel::_format_score(const IEngine::SearchInfo &info)
+{
+    QString ret;
+    if(!info.Has(IEngine::SearchInfo::HasScore))
+        return ret;
+
+    if(IEngine::SearchInfo::LowerBound == info.ScoreBound)
+        ret = ">=";
+    else if(IEngine::SearchInfo::UpperBound == info.ScoreBound)
+        ret = "<=";
+
+    if(info.ScoreIsMate)
+        ret.append(info.Score < 0 ? QString("-#%1").arg(-info.Score) : QString("#%1").arg(info.Score));
+    else
+        ret.append(QString("%1%2").arg(info.Score < 0 ? "" : "+").arg(info.Score / 100.0, 0, 'f', 2));
+    return ret;
+}
+
+int SearchLinesModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_lines.size();
+}
+
+int SearchLinesModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant SearchLinesModel::data(const QModelIndex &index, int role) const
+{
+    QVariant ret;
+    if(!index.isValid())
+        return ret;
+
+    IEngine::SearchInfo const &info = m_lines[index.row()].Info;
+    switch((::Qt::ItemDataRole)role)
+    {
+    case ::Qt::DisplayRole:
+        switch(index.column())
+        {
+        case ScoreColumn:
+            ret = _format_score(info);
+            break;
+        case DepthColumn:
+            if(info.Has(IEngine::SearchInfo::HasSelDepth))
+                ret = QString("%1/%2").arg(info.Depth).arg(info.SelDepth);
+            else if(info.Has(IEngine::SearchInfo::HasDepth))
+                ret = info.Depth;
+            break;
+        case LineColumn:
+            // Views only ask for the rows they show, so this is where we render the SAN
+            ret = GetLineSAN(index.row());
+            break;
+        default:
+            break;
+        }
+        break;
+    case ::Qt::TextAlignmentRole:
+        if(LineColumn == index.column())
+            ret = (int)(::Qt::AlignLeft | ::Qt::AlignVCenter);
+        else
+            ret = (int)(::Qt::AlignRight | ::Qt::AlignVCenter);
+        break;
+    default:
+        break;
+    }
+    return ret;
+}
+
+QVariant SearchLinesModel::headerData(int section, ::Qt::Orientation orientation, int role) const
+{
+    QVariant ret;
+    if(::Qt::Horizontal == orientation && ::Qt::DisplayRole == role)
+    {
+        switch(section)
+        {
+        case ScoreColumn:
+            ret = tr("Score");
+            break;
+        case DepthColumn:
+            ret = tr("Depth");
+            break;
+        case LineColumn:
+            ret = tr("Line");
+            break;
+        default:
+            break;
+        }
+    }
+    return ret;
+}
+
+
+END_NAMESPACE_GKCHESS1;
@@ -0,0 +1,116 @@
+/*Copyright 2014 George Karagoulis
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.*/
+
+#ifndef GKCHESS_SEARCHLINESMODEL_H
+#define GKCHESS_SEARCHLINESMODEL_H
+
+#include "gkchess_iengine.h"
+#include "gkchess_board.h"
+#include <QAbstractTableModel>
+#include <QVector>
+
+namespace GKChess{
+namespace UI{
+
+
+/** A model of the best lines of a MultiPV search, one row per line, with the score,
+ *  the depth and the principal variation.
+ *
+ *  Engines update the lines many times per second, so the principal variations are
+ *  kept as packed moves and only converted to SAN when a view asks for them, which
+ *  only happens for rows that are visible.  The SAN is cached until the line changes.
+*/
+class SearchLinesModel :
+        public QAbstractTableModel
+{
+    Q_OBJECT
+
+    struct Line
+    {
+        IEngine::SearchInfo Info;
+
+        /** The principal variation in SAN, which is only valid if SANValid is true. */
+        mutable QString SAN;
+        mutable bool SANValid;
+
+        Line() :SANValid(false) {}
+    };
+
+    // The position the search started from, which we play the lines out on
+    Board m_board;
+    int m_maxLines;
+    QVector<Line> m_lines;
+
+public:
+
+    enum ColumnEnum
+    {
+        ScoreColumn,
+        DepthColumn,
+        LineColumn,
+
+        ColumnCount
+    };
+
+    explicit SearchLinesModel(QObject *parent = 0);
+
+    /** Clears the lines for a new search from the given position.  Lines with a MultiPV
+     *  value greater than max_lines are ignored.
+    */
+    void StartSearch(const Board &, int max_lines);
+
+    /** Removes all the lines. */
+    void Clear();
+
+    /** Returns the search info for the line at the given row, or a null pointer if
+     *  the row is out of range.
+    */
+    IEngine::SearchInfo const *GetLine(int row) const;
+
+    /** Returns the principal variation of the line at the given row in SAN, with
+     *  move numbers.
+    */
+    QString GetLineSAN(int row) const;
+
+    /** \name QAbstractItemModel interface
+     *  \{
+    */
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const;
+
+    /** \} */
+
+
+public slots:
+
+    /** Merges the search info into its line.  Connect this to the engine's
+     *  SearchInfoReceived() signal.
+    */
+    void UpdateLine(const GKChess::IEngine::SearchInfo &);
+
+
+private:
+
+    QString _render_san(const IEngine::SearchInfo &) const;
+    static QString _format_score(const IEngine::SearchInfo &);
+
+};
+
+
+}}
+
+#endif // GKCHESS_SEARCHLINESMODEL_H
@@ -2,13 +2,19 @@
 #include "book.h"
 #include "error_p.h"
 #include "file_object.h"
+#include "book_p.h"
 #include "board.h"
 #include "hash.h"
 #include <stdio.h>
 #include <assert.h>
 #include <string.h>
+#include <stdlib.h>
 
-#define MAX_MOVES 50
+/** The number of moves we make room for before we know how many a position has. */
+#define INITIAL_MOVES 16
+
+/** Returns a pointer to the i'th entry of a memory-mapped book. */
+#define MAPPED_ENTRY(f, i) ((f)->data + (i) * POLYGLOT_ENTRY_SIZE)
 
 #define OFFSET_MOVE 8
 #define OFFSET_WEIGHT 10
@@ -40,13 +46,13 @@ static void byte_array_from_int64(uint64 i, uint8 *buf)
     buf[7] = (i) & 0x0FF;
 }
 
-//static uint32 int32_from_byte_array(uint8 *buf)
-//{
-//    return ((uint32)buf[0]) << 24 |
-//           ((uint32)buf[1]) << 16 |
-//           ((uint32)buf[2]) << 8 |
-//           ((uint32)buf[3]);
-//}
+static uint32 int32_from_byte_array(uint8 *buf)
+{
+    return ((uint32)buf[0]) << 24 |
+           ((uint32)buf[1]) << 16 |
+           ((uint32)buf[2]) << 8 |
+           ((uint32)buf[3]);
+}
 
 //static void byte_array_from_int32(uint32 i, uint8 *buf)
 //{
@@ -106,9 +112,9 @@ static uint16 get_weight(entry_t *e){
 //    byte_array_from_int16(wt, &e->data[OFFSET_WEIGHT]);
 //}
 
-//static uint32 get_learn(entry_t *e){
-//    return int32_from_byte_array(&e->data[OFFSET_LEARN]);
-//}
+static uint32 get_learn(entry_t *e){
+    return int32_from_byte_array(&e->data[OFFSET_LEARN]);
+}
 //static void set_learn(entry_t *e, uint32 learn){
 //    byte_array_from_int32(learn, &e->data[OFFSET_LEARN]);
 //}
@@ -124,6 +130,84 @@ entry_t entry_from_file(FILE *h)
     return ret;
 }
 
+// Returns the index of the first entry in a memory-mapped book whose key is
+//  not less than the given key, or the entry count if there is none.
+static long int lower_bound_mapped(file_object_t const *f, uint64 key)
+{
+    long int first = 0, last = f->entry_count, middle;
+
+    if(f->index)
+    {
+        // Find the first page whose first key is not less than the key.  The
+        //  first matching entry is either on the page before it or is its first entry.
+        long int lo = 0, hi = f->index_length;
+        while(lo < hi)
+        {
+            middle = lo + (hi - lo) / 2;
+            if(f->index[middle] < key)
+                lo = middle + 1;
+            else
+                hi = middle;
+        }
+
+        if(0 < lo)
+            first = (lo - 1) * INDEX_PAGE_ENTRIES;
+        if(lo < f->index_length)
+            last = lo * INDEX_PAGE_ENTRIES;
+    }
+
+    // Binary search directly on the mapped memory, so there are no system calls
+    while(first < last)
+    {
+        middle = first + (last - first) / 2;
+        if(int64_from_byte_array((uint8 *)MAPPED_ENTRY(f, middle)) < key)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first;
+}
+
+int build_key_index(file_object_t *f)
+{
+    long int i;
+
+    f->index_length = (f->entry_count + INDEX_PAGE_ENTRIES - 1) / INDEX_PAGE_ENTRIES;
+    if(0 == f->index_length)
+        return 0;
+
+    f->index = (uint64 *)malloc(f->index_length * sizeof(uint64));
+    if(!f->index){
+        f->index_length = 0;
+        set_error_string("Out of memory");
+        return 1;
+    }
+
+    for(i = 0; i < f->index_length; ++i)
+        f->index[i] = int64_from_byte_array((uint8 *)MAPPED_ENTRY(f, i * INDEX_PAGE_ENTRIES));
+    return 0;
+}
+
+// Returns the entry at the given index and advances the index, or a null entry
+//  if we're at the end of the book.  For streamed books you must seek to the
+//  index before the first call.
+static entry_t next_entry(file_object_t *f, long int *i)
+{
+    entry_t ret = entry_none;
+    if(f->data){
+        if(*i < f->entry_count){
+            memcpy(ret.data, MAPPED_ENTRY(f, *i), POLYGLOT_ENTRY_SIZE);
+            ret.offset = *i;
+        }
+    }
+    else{
+        ret = entry_from_file(f->handle);
+        ret.offset = *i;
+    }
+    ++*i;
+    return ret;
+}
+
 // Finds the first instance of the key in the book.
 //  Returns a null entry on failure (check key against 0)
 entry_t find_entry(file_object_t *f, uint64 key)
@@ -133,6 +217,18 @@ entry_t find_entry(file_object_t *f, uint64 key)
     uint64 last_key, middle_key;
     uint8 tmpbuf[8];
 
+    if(f->data)
+    {
+        first = lower_bound_mapped(f, key);
+        if(first < f->entry_count &&
+                key == int64_from_byte_array((uint8 *)MAPPED_ENTRY(f, first)))
+        {
+            memcpy(ret.data, MAPPED_ENTRY(f, first), POLYGLOT_ENTRY_SIZE);
+            ret.offset = first;
+        }
+        return ret;
+    }
+
     first = -1;
     if(0 == fseek(f->handle, -POLYGLOT_ENTRY_SIZE, SEEK_END))
     {
@@ -188,58 +284,252 @@ PG_EXPORT uint64 pg_compute_key(char const *fen)
     board_t board;
     if(0 == board_from_fen(&board,fen))
         ret = hash(&board);
-    set_error_string(0 == ret ? 0 : "Invalid FEN");
+    set_error_string(0 == ret ? "Invalid FEN" : 0);
     return ret;
 }
 
 
-PG_EXPORT unsigned int pg_lookup_moves(void *f, uint64 key, pg_move_t *array, unsigned int max_array_length)
+// Reads all the entries with the same key as the given entry, which must be the first
+//  entry with its key, and converts them to moves.  At most max_array_length moves are
+//  written, but the total number of moves for the position is returned, so the caller can
+//  tell if the array was too small.
+static unsigned int read_moves(file_object_t *fo, entry_t entry, pg_move_t *array, unsigned int max_array_length)
 {
-    file_object_t *fo = (file_object_t *)f;
-    int ret_length = 0;
     unsigned int i;
-    entry_t entry = find_entry(fo, key);
-    if(key == get_key(&entry))
-    {
-        entry_t entries[MAX_MOVES];
-        entries[0]=entry;
-        unsigned int count=0;
+    uint64 key = get_key(&entry);
+    unsigned int count=0;
+    uint32 total_weight=0;
+    long int cur = entry.offset;
+    if(!fo->data)
         fseek(fo->handle, POLYGLOT_ENTRY_SIZE*entry.offset, SEEK_SET);
-        while(1){
-            entry = entry_from_file(fo->handle);
-            uint64 cur_key = get_key(&entry);
-            if(cur_key != key){
-                break;
-            }
-            if(count==MAX_MOVES){
-                break;
-            }
-            entries[count++] = entry;
+    while(1){
+        entry = next_entry(fo, &cur);
+        uint64 cur_key = get_key(&entry);
+        if(cur_key != key){
+            break;
         }
 
-        int total_weight=0;
-        for(i = 0;i<count;i++)
-            total_weight += get_weight(&entries[i]);
-
-        pg_move_t *cur_move = array;
-        entry_t *cur_entry = entries;
-        for(i = 0; i < count && i < max_array_length; ++i, ++cur_move, ++cur_entry)
+        total_weight += get_weight(&entry);
+        if(count < max_array_length)
         {
-            uint16 move_data = get_move(cur_entry);
+            pg_move_t *cur_move = &array[count];
+            uint16 move_data = get_move(&entry);
             cur_move->dest_col = 0x7 & move_data;
             cur_move->dest_row = 0x7 & (move_data >> 3);
             cur_move->source_col = 0x7 & (move_data >> 6);
             cur_move->source_row = 0x7 & (move_data >> 9);
             cur_move->promoted_piece = 0x7 & (move_data >> 12);
-            cur_move->weight = (float) get_weight(cur_entry) / total_weight * 100;
+            cur_move->raw_weight = get_weight(&entry);
+            cur_move->learn = get_learn(&entry);
         }
+        ++count;
+    }
+
+    for(i = 0; i < count && i < max_array_length; ++i)
+        array[i].weight = 0 == total_weight ? 0 : (float) array[i].raw_weight / total_weight * 100;
+    return count;
+}
 
-        ret_length = count;
+// Reads all the moves for the position into an array that grows as needed.
+//  The array is reallocated if it's too small, and its new capacity is returned through
+//  the capacity parameter.  Returns the number of moves, or -1 if we ran out of memory.
+static int read_all_moves(file_object_t *fo, entry_t entry, pg_move_t **array, unsigned int *capacity)
+{
+    unsigned int count = read_moves(fo, entry, *array, *capacity);
+    if(count > *capacity)
+    {
+        pg_move_t *tmp = (pg_move_t *)realloc(*array, count * sizeof(pg_move_t));
+        if(!tmp)
+            return -1;
+        *array = tmp;
+        *capacity = count;
+        read_moves(fo, entry, *array, *capacity);
+    }
+    return count;
+}
+
+PG_EXPORT unsigned int pg_lookup_moves(void *f, uint64 key, pg_move_t *array, unsigned int max_array_length)
+{
+    file_object_t *fo = (file_object_t *)f;
+    unsigned int ret_length = 0;
+    entry_t entry = find_entry(fo, key);
+    if(key == get_key(&entry)){
+        ret_length = read_moves(fo, entry, array, max_array_length);
+        if(ret_length > max_array_length)
+            ret_length = max_array_length;
     }
     set_error_string(0);
     return ret_length;
 }
 
+PG_EXPORT pg_move_t *pg_lookup_all_moves(void *f, uint64 key, unsigned int *length)
+{
+    file_object_t *fo = (file_object_t *)f;
+    pg_move_t *ret = 0;
+    unsigned int capacity = INITIAL_MOVES;
+    int count = 0;
+    entry_t entry = find_entry(fo, key);
+    *length = 0;
+    if(key == get_key(&entry))
+    {
+        // Most positions only have a few moves, so we start small and only
+        //  read the entries again if there were more
+        ret = (pg_move_t *)malloc(capacity * sizeof(pg_move_t));
+        if(ret)
+            count = read_all_moves(fo, entry, &ret, &capacity);
+        if(!ret || -1 == count){
+            free(ret);
+            set_error_string("Out of memory");
+            return 0;
+        }
+        *length = count;
+    }
+    set_error_string(0);
+    return ret;
+}
+
+PG_EXPORT void pg_cleanup_moves(pg_move_t *array)
+{
+    free(array);
+}
+
+
+typedef struct
+{
+    uint64 key;
+    unsigned int index;
+}
+batch_key_t;
+
+static int compare_batch_keys(const void *a, const void *b)
+{
+    uint64 ka = ((batch_key_t const *)a)->key;
+    uint64 kb = ((batch_key_t const *)b)->key;
+    return ka < kb ? -1 : (kb < ka ? 1 : 0);
+}
+
+// Returns the key of the i'th entry in the book
+static uint64 key_at(file_object_t *f, long int i)
+{
+    uint8 tmpbuf[POLYGLOT_KEY_SIZE];
+    if(f->data)
+        return int64_from_byte_array((uint8 *)MAPPED_ENTRY(f, i));
+
+    fseek(f->handle, POLYGLOT_ENTRY_SIZE*i, SEEK_SET);
+    if(1 != fread(tmpbuf, POLYGLOT_KEY_SIZE, 1, f->handle))
+        return 0;
+    return int64_from_byte_array(tmpbuf);
+}
+
+// Returns the index of the first entry at or after 'first' whose key is not less
+//  than the given key.  It gallops forward from 'first' and then does a binary search in the
+//  last gap, so the cost only depends on how far we travel through the book.
+static long int gallop(file_object_t *f, long int first, long int entry_count, uint64 key)
+{
+    long int step = 1, last, middle;
+
+    if(first >= entry_count || key <= key_at(f, first))
+        return first;
+
+    // Invariant: the key at 'first' is less than the key we're looking for
+    while(1)
+    {
+        last = first + step;
+        if(last >= entry_count){
+            last = entry_count;
+            break;
+        }
+        if(key <= key_at(f, last))
+            break;
+        first = last;
+        step <<= 1;
+    }
+
+    // Now the answer lies in (first, last]
+    ++first;
+    while(first < last)
+    {
+        middle = first + (last - first) / 2;
+        if(key_at(f, middle) < key)
+            first = middle + 1;
+        else
+            last = middle;
+    }
+    return first;
+}
+
+PG_EXPORT int pg_lookup_moves_batch(void *f,
+                                    uint64 const *keys,
+                                    unsigned int key_count,
+                                    void (*on_moves_found)(unsigned int, pg_move_t const *, unsigned int, void *),
+                                    void *context)
+{
+    file_object_t *fo = (file_object_t *)f;
+    unsigned int moves_capacity = INITIAL_MOVES;
+    pg_move_t *moves;
+    unsigned int i;
+    int move_count = 0;
+    long int cur = 0, entry_count;
+    uint64 last_key = 0;
+    entry_t entry;
+
+    if(fo->data){
+        entry_count = fo->entry_count;
+    }
+    else{
+        fseek(fo->handle, 0L, SEEK_END);
+        entry_count = ftell(fo->handle) / POLYGLOT_ENTRY_SIZE;
+    }
+
+    // Sort the keys (remembering where they came from) so we can sweep the book once
+    batch_key_t *sorted = (batch_key_t *)malloc(key_count * sizeof(batch_key_t));
+    moves = (pg_move_t *)malloc(moves_capacity * sizeof(pg_move_t));
+    if((0 < key_count && !sorted) || !moves){
+        free(sorted);
+        free(moves);
+        set_error_string("Out of memory");
+        return 1;
+    }
+    for(i = 0; i < key_count; ++i){
+        sorted[i].key = keys[i];
+        sorted[i].index = i;
+    }
+    qsort(sorted, key_count, sizeof(batch_key_t), compare_batch_keys);
+
+    for(i = 0; i < key_count; ++i)
+    {
+        // Duplicate keys get the same moves without touching the book again
+        if(0 == i || sorted[i].key != last_key)
+        {
+            last_key = sorted[i].key;
+            move_count = 0;
+
+            cur = gallop(fo, cur, entry_count, last_key);
+            if(cur < entry_count && last_key == key_at(fo, cur))
+            {
+                entry = entry_none;
+                set_key(&entry, last_key);
+                entry.offset = cur;
+                move_count = read_all_moves(fo, entry, &moves, &moves_capacity);
+                if(-1 == move_count){
+                    free(sorted);
+                    free(moves);
+                    set_error_string("Out of memory");
+                    return 1;
+                }
+            }
+        }
+
+        if(0 < move_count)
+            on_moves_found(sorted[i].index, moves, move_count, context);
+    }
+
+    free(sorted);
+    free(moves);
+    set_error_string(0);
+    return 0;
+}
+
 PG_EXPORT void pg_move_to_string(pg_move_t *m, char *s)
 {
     s[0] = 'a' + m->source_col;
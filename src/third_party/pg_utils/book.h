@@ -38,6 +38,9 @@ typedef struct
     
     // The weight is between 0 and 100%
     float weight;
+
+    // The weight exactly as it is stored in the book
+    uint16 raw_weight;
     
     // The learn value only means something to the application that's using it
     uint32 learn;
@@ -60,12 +63,52 @@ uint64 pg_compute_key(char const *fen);
     the results will be truncated.
     \param max_array_length An input that gives the length of the return array
     \returns The number of items in the return array (can be 0)
+    \sa pg_lookup_all_moves() if you don't want to guess how many moves there could be
 */
 unsigned int pg_lookup_moves(void *handle,
                                 uint64 key,
                                 pg_move_t *array,
                                 unsigned int max_array_length);
 
+
+/** Looks up the position in the book and returns every move it found, however many
+    there are.
+    \param handle The handle created by calling open_file()
+    \param key The position key, acquired from pg_compute_key()
+    \param length Returns the number of moves in the array
+    \returns An array of moves, which you must free with pg_cleanup_moves().  It is null
+    if the position is not in the book, or if there was an error (in which case the
+    error string will be set).
+*/
+pg_move_t *pg_lookup_all_moves(void *handle, uint64 key, unsigned int *length);
+
+
+/** Frees the array returned by pg_lookup_all_moves().  It is safe to pass null. */
+void pg_cleanup_moves(pg_move_t *array);
+
+
+/** Looks up many positions at once.  The keys are sorted and the book is swept in a single
+    pass, galloping forward from one key to the next, so looking up a whole game or
+    repertoire costs about one sequential scan instead of one binary search per key.
+    \param handle The handle created by calling open_file()
+    \param keys An array of position keys, acquired from pg_compute_key().  They do not
+    need to be sorted, and may contain duplicates.
+    \param key_count The length of the keys array
+    \param on_moves_found A callback that is called once for every key that is in the book,
+    with the index of the key in the keys array, the moves found for it, the number of moves,
+    and the context pointer.  The moves are only valid for the duration of the call.
+    \param context An arbitrary pointer that is passed back to the callback.
+    \returns 0 on success, 1 otherwise (in which case the error string will be set)
+*/
+int pg_lookup_moves_batch(void *handle,
+                          uint64 const *keys,
+                          unsigned int key_count,
+                          void (*on_moves_found)(unsigned int key_index,
+                                                 pg_move_t const *moves,
+                                                 unsigned int length,
+                                                 void *context),
+                          void *context);
+
                                 
 /** Converts the move to a string.
     \param s An array of memory to fill with the string.  It must be
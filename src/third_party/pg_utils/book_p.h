@@ -0,0 +1,13 @@
+#ifndef PG_BOOK_P_H
+#define PG_BOOK_P_H
+
+#include "file_object.h"
+
+
+/** Builds the sparse key index of a memory-mapped book, one key per page.
+ *  \returns 0 on success, 1 otherwise (in which case the error string will be set)
+*/
+int build_key_index(file_object_t *);
+
+
+#endif // PG_BOOK_P_H
@@ -16,14 +16,32 @@ limitations under the License.*/
 #include "error_p.h"
 #include "pg_utils.h"
 
-static char const *__err_str = 0;
+#if defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
+// Each thread has its own error, so the library can be used from several threads at once
+static THREAD_LOCAL char const *__err_str = 0;
 
 PG_EXPORT char const *pg_error_string()
 {
     return __err_str;
 }
 
+PG_EXPORT char const *pg_file_error_string(void *h)
+{
+    return ((file_object_t *)h)->error;
+}
+
 void set_error_string(const char *s)
 {
     __err_str = s;
 }
+
+void set_file_error_string(file_object_t *f, const char *s)
+{
+    __err_str = s;
+    f->error = s;
+}
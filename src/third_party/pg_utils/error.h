@@ -20,11 +20,19 @@ extern "C" {
 #endif // __cplusplus
 
 
-/** Returns the last error, if there was one with the last library operation.  Otherwise
- *  returns null.
+/** Returns the last error, if there was one with the last library operation on the
+ *  calling thread.  Otherwise returns null.
+ *
+ *  The error state is kept per thread, so errors from other threads never show up here.
 */
 char const *pg_error_string();
 
+/** Returns the error of the last failed operation on the given file handle, or null if
+ *  the last operation that could fail was successful.  Use this instead of pg_error_string()
+ *  when you need the error of a specific book, for example after validating it.
+*/
+char const *pg_file_error_string(void *handle);
+
 
 #ifdef __cplusplus
 }
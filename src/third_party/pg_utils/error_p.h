@@ -15,11 +15,16 @@ limitations under the License.*/
 #ifndef ERROR_P_H
 #define ERROR_P_H
 
+#include "file_object.h"
+
 
 /** The library uses this to set the error string.  You should manually set it to
  *  0 when the last operation was successful.
 */
 void set_error_string(const char *);
 
+/** Sets the error string of the calling thread and also of the file object. */
+void set_file_error_string(file_object_t *, const char *);
+
 
 #endif // ERROR_P_H
@@ -6,17 +6,97 @@
 #include "board.h"
 #include "hash.h"
 #include "error_p.h"
+#include "book_p.h"
+#include "file_p.h"
 #include <malloc.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
 
+#if defined(WIN32)
+    #include <windows.h>
+    #include <io.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+
+int map_file(file_object_t *f)
+{
+    long int len;
+
+    fseek(f->handle, 0L, SEEK_END);
+    len = ftell(f->handle);
+    if(0 != (0x0F & len)){
+        set_error_string("The book size must be a multiple of 16 bytes");
+        return 1;
+    }
+
+    // An empty book has nothing to map, so we leave the data null and lookups
+    //  will simply not find anything
+    f->entry_count = len / POLYGLOT_ENTRY_SIZE;
+    if(0 == len)
+        return 0;
+
+#if defined(WIN32)
+    f->mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f->handle)),
+                                   NULL, PAGE_READONLY, 0, 0, NULL);
+    if(!f->mapping){
+        set_error_string("Unable to map the file into memory");
+        return 1;
+    }
+    f->data = (uint8 const *)MapViewOfFile(f->mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!f->data){
+        CloseHandle(f->mapping);
+        f->mapping = NULL;
+        set_error_string("Unable to map the file into memory");
+        return 1;
+    }
+#else
+    void *p = mmap(NULL, len, PROT_READ, MAP_SHARED, fileno(f->handle), 0);
+    if(MAP_FAILED == p){
+        set_error_string(strerror(errno));
+        return 1;
+    }
+
+    // Lookups are binary searches, so read-ahead would only waste memory
+    madvise(p, len, MADV_RANDOM);
+    f->data = (uint8 const *)p;
+#endif
+    return 0;
+}
+
+void unmap_file(file_object_t *f)
+{
+    free(f->index);
+    f->index = NULL;
+    f->index_length = 0;
+
+    if(f->data){
+#if defined(WIN32)
+        UnmapViewOfFile(f->data);
+        CloseHandle(f->mapping);
+        f->mapping = NULL;
+#else
+        munmap((void *)f->data, f->entry_count * POLYGLOT_ENTRY_SIZE);
+#endif
+        f->data = NULL;
+    }
+    f->entry_count = 0;
+}
+
 
 PG_EXPORT void *pg_open_file(const char *filename, int om)
 {
     char mode[] = {'r', '\0', '\0', '\0'};
     int b_ind = 1;
+    int flags = om & (PG_OPEN_MMAP | PG_OPEN_INDEX);
+    om &= ~flags;
+    if(om == 1 && (flags & PG_OPEN_MMAP)){
+        set_error_string("Only read-only books can be memory mapped");
+        return NULL;
+    }
     if(om == 1){
         mode[1] = '+';
         b_ind = 2;
@@ -37,7 +117,21 @@ PG_EXPORT void *pg_open_file(const char *filename, int om)
         return NULL;
     }
 
+    memset(ret, 0, sizeof(file_object_t));
     ret->handle = f;
+
+    if(flags & PG_OPEN_MMAP){
+        if(0 != map_file(ret) ||
+                ((flags & PG_OPEN_INDEX) && 0 != build_key_index(ret)))
+        {
+            // The error string was set by the function that failed
+            unmap_file(ret);
+            fclose(f);
+            free(ret);
+            return NULL;
+        }
+    }
+
     set_error_string(0);
     return ret;
 }
@@ -45,66 +139,9 @@ PG_EXPORT void *pg_open_file(const char *filename, int om)
 PG_EXPORT void pg_close_file(void *h)
 {
     file_object_t *f = (file_object_t *)h;
+    unmap_file(f);
     fclose(f->handle);
     free(f);
     set_error_string(0);
 }
 
-
-PG_EXPORT int pg_validate_file(void *h, void (*progress_cb)(int))
-{
-    file_object_t *f = (file_object_t *)h;
-    long int i, len, entry_cnt;
-    long int progress_inc, progress_cnt = 0;
-    int progress = 0;
-    uint8 key[POLYGLOT_KEY_SIZE];
-    uint8 last_key[POLYGLOT_KEY_SIZE];
-
-    // Get the length of the file
-    fseek(f->handle, 0L, SEEK_END);
-    len = ftell(f->handle);
-
-    if(0 != (0x0F & len)){
-        set_error_string("The book size must be a multiple of 16 bytes");
-        return 1;
-    }
-
-    // Iterate through each entry and make sure the keys are in ascending order,
-    //  and populate the index
-    entry_cnt = len / POLYGLOT_ENTRY_SIZE;
-
-    // Only update every so often
-    progress_inc = entry_cnt / 100;
-
-    for(i = 0; i < entry_cnt; ++i)
-    {
-        if(0 != fseek(f->handle, i * POLYGLOT_ENTRY_SIZE, SEEK_SET)){
-            set_error_string("Error seeking file");
-            return 1;
-        }
-
-        if(1 != fread(key, POLYGLOT_KEY_SIZE, 1, f->handle)){
-            set_error_string("Error reading file");
-            return 1;
-        }
-
-        if(0 < i && 0 < memcmp(last_key, key, POLYGLOT_KEY_SIZE)){
-            set_error_string("Keys in the book must be in ascending order");
-            return 1;
-        }
-
-        // Remember the last key
-        memcpy(last_key, key, POLYGLOT_KEY_SIZE);
-
-        if(progress_cb){
-            // Notify of progress update
-            ++progress_cnt;
-            if(progress_cnt == progress_inc){
-                progress_cnt = 0;
-                progress_cb(++progress);
-            }
-        }
-    }
-    return 0;
-}
-
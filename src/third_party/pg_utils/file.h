@@ -1,34 +1,82 @@
 #ifndef PG_FILE_H
 #define PG_FILE_H
 
+#include "pg_utils.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
 
+/* Thread safety:  Every function in the library is reentrant, so different handles can be
+    used from different threads at the same time.  A single handle may only be used by one
+    thread at a time, except that a handle opened with PG_OPEN_MMAP can be queried with
+    pg_lookup_moves() from any number of threads at once.
+*/
+
+
+/** Open mode flag: Maps the whole book into memory, so lookups are done without any
+    file system calls.  This is only valid for read-only books.
+*/
+#define PG_OPEN_MMAP    0x02
+
+/** Open mode flag: Builds a sparse index of the keys at open time, which narrows down
+    the binary search of every lookup.  This only has an effect with PG_OPEN_MMAP, and
+    only pays off for big books.
+*/
+#define PG_OPEN_INDEX   0x04
+
 
 /** Opens the file given by the filename.
     This does not validate the file.  To do that, call pg_validate_file().
     \returns A handle for the file, or NULL if the file could not be opened or was an invalid
     polyglot book.  You can get the last error with pg_last_error()
     \param open_mode The file mode.  0 = Read only   1 = Read/Write
+    You can OR the read-only mode with PG_OPEN_MMAP and PG_OPEN_INDEX.
 */
 void *pg_open_file(char const *filename, int open_mode);
 
 /** Closes the file given by handle. */
 void pg_close_file(void *handle);
 
+/** Statistics about the entries of a book, gathered during validation. */
+typedef struct
+{
+    /** The number of entries in the book. */
+    uint64 entry_count;
+
+    /** The number of entries with the same key and move as another entry before them. */
+    uint64 duplicate_count;
+
+    /** The number of entries with zero weight. */
+    uint64 zero_weight_count;
+}
+pg_validation_report_t;
+
+
 /** Validates the file and returns 0 if it is a valid polyglot book.  This
     operation can take a while on big books, so you can pass a callback
     function to receive progress updates.
+
+    The book is memory mapped for the duration, scanned with SIMD instructions
+    if the processor has them, and big books are split across several threads.
+    Progress updates are still delivered on the calling thread.
     
     \param handle The file handle returned by pg_open_file()
     \param on_progress_update An optional callback function to receive progress
     notifications, since this can be a long operation.  Pass 0 to ignore updates.
+    It is called with the progress percentage and the context pointer.
+    \param context An arbitrary pointer that is passed back to the callback, so you
+    can tell which validation the update belongs to.
+    \param report An optional structure to receive statistics about the book.  Duplicate
+    and zero-weight entries do not make a book invalid.  Pass 0 if you don't need it.
     \returns 0 if a valid PG book, 1 otherwise (in which case the error string
-    will be set)
+    of the file will be set)
 */
-int pg_validate_file(void *handle, void (*on_progress_update)(int));
+int pg_validate_file(void *handle,
+                     void (*on_progress_update)(int, void *),
+                     void *context,
+                     pg_validation_report_t *report);
 
 
 
@@ -1,15 +1,38 @@
 #ifndef PG_FILEOBJECT_H
 #define PG_FILEOBJECT_H
 
+#include "pg_utils.h"
 #include <stdio.h>
 
 #define INDEX_VALUE_COUNT 16
 
+/** The number of entries covered by one key in the sparse index (one 4KB page). */
+#define INDEX_PAGE_ENTRIES (4096 / POLYGLOT_ENTRY_SIZE)
+
 
 /** Let's make this a struct so we can expand it if necessary. */
 typedef struct
 {
     FILE *handle;
+
+    // The error of the last failed operation on this file, or null
+    char const *error;
+
+    // If the file was opened with PG_OPEN_MMAP this points to the whole book in memory,
+    //  otherwise it is null and we go through the file handle.
+    uint8 const *data;
+
+    // The number of entries in the book (only set if the file is mapped)
+    long int entry_count;
+
+    // An optional sparse index holding the first key of every page of the mapped book.
+    //  It is null if the index was not requested.
+    uint64 *index;
+    long int index_length;
+
+#if defined(WIN32)
+    void *mapping;
+#endif
 }
 file_object_t;
 
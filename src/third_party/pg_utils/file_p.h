@@ -0,0 +1,16 @@
+#ifndef PG_FILE_P_H
+#define PG_FILE_P_H
+
+#include "file_object.h"
+
+
+/** Maps the whole book into memory.
+ *  \returns 0 on success, 1 otherwise (in which case the error string will be set)
+*/
+int map_file(file_object_t *);
+
+/** Releases the memory map and the key index, if there are any. */
+void unmap_file(file_object_t *);
+
+
+#endif // PG_FILE_P_H
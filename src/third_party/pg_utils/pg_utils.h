@@ -13,13 +13,14 @@
  *
  *  The basic api is like this, to look up a position given in FEN:
  *
- *  // Open a valid book
+ *  // Open a valid book (pass PG_OPEN_MMAP to search it in memory instead of
+ *  //  through the file system)
  *  void *file_handle = pg_open_file("valid_polyglot_book.bin", 0);
  *  if(!file_handle)
  *      return 1;   // error
  *
  *  unsigned int length;
- *  pg_move_t *move_array = pg_lookup_moves(file_handle, fen, &length);
+ *  pg_move_t *move_array = pg_lookup_all_moves(file_handle, pg_compute_key(fen), &length);
  *  for(int i = 0; i < length; ++i)
  *      move_array[i];  // Access all the moves
  *
@@ -17,11 +17,15 @@ else {
 
 unix{
 QMAKE_CFLAGS += -fvisibility=hidden
+LIBS += -lpthread
 }
 
 HEADERS += \
     board.h \
     book.h \
+    book_p.h \
+    file_object.h \
+    file_p.h \
     hash.h \
     move.h \
     file.h \
@@ -31,6 +35,7 @@ HEADERS += \
 
 SOURCES += \
     file.c \
+    validate.c \
     hash.c \
     board.c \
     book.c \
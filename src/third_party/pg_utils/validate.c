@@ -0,0 +1,451 @@
+#include "file.h"
+#include "file_object.h"
+#include "file_p.h"
+#include "pg_utils.h"
+#include "error_p.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32)
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    #include <time.h>
+#endif
+
+// We only have vectorized scanners for gcc-compatible compilers on x86, because we
+//  pick them at runtime with the compiler's cpu detection.  Everything else is scalar.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define PG_VALIDATE_SIMD
+    #include <immintrin.h>
+#endif
+
+#define OFFSET_MOVE 8
+#define OFFSET_WEIGHT 10
+
+/** The number of entries we scan at a time, small enough to stay in the cache
+    for the duplicate check that follows. */
+#define BLOCK_ENTRIES 4096
+
+/** We don't start another thread for less than this many entries. */
+#define MIN_THREAD_ENTRIES (1024 * 1024)
+
+#define MAX_THREADS 64
+
+#if defined(WIN32)
+    #define ATOMIC_ADD(p, v) InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v))
+#else
+    #define ATOMIC_ADD(p, v) __sync_fetch_and_add((p), (v))
+#endif
+
+
+// Returns the big-endian key at the start of an entry
+static uint64 load_key(uint8 const *e)
+{
+    return ((uint64)e[0]) << 56 |
+           ((uint64)e[1]) << 48 |
+           ((uint64)e[2]) << 40 |
+           ((uint64)e[3]) << 32 |
+           ((uint64)e[4]) << 24 |
+           ((uint64)e[5]) << 16 |
+           ((uint64)e[6]) << 8 |
+           ((uint64)e[7]);
+}
+
+
+// The block scanners check that the keys of n consecutive entries are in ascending order,
+//  and add the number of zero-weight entries to *zero_weights.
+//  They return 0 if the keys are ordered, 1 otherwise.
+typedef int (*scan_block_fn)(uint8 const *, long int, uint64 *);
+
+static int scan_block_scalar(uint8 const *p, long int n, uint64 *zero_weights)
+{
+    long int i;
+    uint64 prev = 0, cur;
+    for(i = 0; i < n; ++i, p += POLYGLOT_ENTRY_SIZE)
+    {
+        cur = load_key(p);
+        if(0 < i && cur < prev)
+            return 1;
+        if(0 == p[OFFSET_WEIGHT] && 0 == p[OFFSET_WEIGHT + 1])
+            ++*zero_weights;
+        prev = cur;
+    }
+    return 0;
+}
+
+#ifdef PG_VALIDATE_SIMD
+
+// Checks 4 entries (and the pair that straddles into the 5th) per iteration.  We load the
+//  keys of entries i..i+3 and i+1..i+4 in the same lane order, byte-swap them, and compare
+//  them as signed integers after flipping the sign bit, since there is no unsigned compare.
+__attribute__((target("avx2")))
+static int scan_block_avx2(uint8 const *p, long int n, uint64 *zero_weights)
+{
+    const __m256i bswap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                           7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i sign = _mm256_set1_epi64x((long long)0x8000000000000000ULL);
+    const __m256i weight_mask = _mm256_set1_epi64x(0xFFFF0000LL);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i bad = _mm256_setzero_si256();
+    long int i = 0;
+
+    for(; i + 5 <= n; i += 4)
+    {
+        uint8 const *e = p + i * POLYGLOT_ENTRY_SIZE;
+        __m256i a0 = _mm256_loadu_si256((__m256i const *)e);          // entries i, i+1
+        __m256i a1 = _mm256_loadu_si256((__m256i const *)(e + 32));   // entries i+2, i+3
+        __m256i b0 = _mm256_loadu_si256((__m256i const *)(e + 16));   // entries i+1, i+2
+        __m256i b1 = _mm256_loadu_si256((__m256i const *)(e + 48));   // entries i+3, i+4
+
+        // Keys of entries (i, i+2, i+1, i+3) and (i+1, i+3, i+2, i+4)
+        __m256i ka = _mm256_xor_si256(_mm256_shuffle_epi8(_mm256_unpacklo_epi64(a0, a1), bswap), sign);
+        __m256i kb = _mm256_xor_si256(_mm256_shuffle_epi8(_mm256_unpacklo_epi64(b0, b1), bswap), sign);
+        bad = _mm256_or_si256(bad, _mm256_cmpgt_epi64(ka, kb));
+
+        // The second half of each entry holds the move, weight and learn values
+        __m256i zw = _mm256_cmpeq_epi64(_mm256_and_si256(_mm256_unpackhi_epi64(a0, a1), weight_mask), zero);
+        *zero_weights += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(zw)));
+    }
+
+    if(!_mm256_testz_si256(bad, bad))
+        return 1;
+
+    // The pair between the last vectorized entry and entry i was already checked
+    return scan_block_scalar(p + i * POLYGLOT_ENTRY_SIZE, n - i, zero_weights);
+}
+
+// The same as the AVX2 version, but two entries per register
+__attribute__((target("sse4.2")))
+static int scan_block_sse42(uint8 const *p, long int n, uint64 *zero_weights)
+{
+    const __m128i bswap = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m128i sign = _mm_set1_epi64x((long long)0x8000000000000000ULL);
+    const __m128i weight_mask = _mm_set1_epi64x(0xFFFF0000LL);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bad = _mm_setzero_si128();
+    long int i = 0;
+
+    for(; i + 5 <= n; i += 4)
+    {
+        uint8 const *e = p + i * POLYGLOT_ENTRY_SIZE;
+        __m128i e0 = _mm_loadu_si128((__m128i const *)e);
+        __m128i e1 = _mm_loadu_si128((__m128i const *)(e + 16));
+        __m128i e2 = _mm_loadu_si128((__m128i const *)(e + 32));
+        __m128i e3 = _mm_loadu_si128((__m128i const *)(e + 48));
+        __m128i e4 = _mm_loadu_si128((__m128i const *)(e + 64));
+
+        __m128i ka = _mm_xor_si128(_mm_shuffle_epi8(_mm_unpacklo_epi64(e0, e1), bswap), sign);
+        __m128i kb = _mm_xor_si128(_mm_shuffle_epi8(_mm_unpacklo_epi64(e1, e2), bswap), sign);
+        __m128i kc = _mm_xor_si128(_mm_shuffle_epi8(_mm_unpacklo_epi64(e2, e3), bswap), sign);
+        __m128i kd = _mm_xor_si128(_mm_shuffle_epi8(_mm_unpacklo_epi64(e3, e4), bswap), sign);
+        bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmpgt_epi64(ka, kb), _mm_cmpgt_epi64(kc, kd)));
+
+        __m128i zw01 = _mm_cmpeq_epi64(_mm_and_si128(_mm_unpackhi_epi64(e0, e1), weight_mask), zero);
+        __m128i zw23 = _mm_cmpeq_epi64(_mm_and_si128(_mm_unpackhi_epi64(e2, e3), weight_mask), zero);
+        *zero_weights += __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(zw01))) +
+                         __builtin_popcount(_mm_movemask_pd(_mm_castsi128_pd(zw23)));
+    }
+
+    if(!_mm_testz_si128(bad, bad))
+        return 1;
+    return scan_block_scalar(p + i * POLYGLOT_ENTRY_SIZE, n - i, zero_weights);
+}
+
+#endif // PG_VALIDATE_SIMD
+
+
+static scan_block_fn select_scanner()
+{
+#ifdef PG_VALIDATE_SIMD
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return &scan_block_avx2;
+    if(__builtin_cpu_supports("sse4.2"))
+        return &scan_block_sse42;
+#endif
+    return &scan_block_scalar;
+}
+
+
+/** The work of validating one chunk of the book.  Chunks start on a new key, so
+    entries with the same key are never split between chunks. */
+typedef struct
+{
+    uint8 const *data;
+    long int first, last;
+    scan_block_fn scan_block;
+
+    // Shared between all the chunks
+    volatile long int *processed;
+    volatile long int *finished;
+    volatile long int *failed;
+
+    // Set when the chunk is validated on the calling thread, so it can report progress directly
+    void (*progress_cb)(int, void *);
+    void *context;
+    long int entry_count;
+    int *progress;
+
+    // Results
+    int result;
+    uint64 duplicate_count;
+    uint64 zero_weight_count;
+}
+chunk_t;
+
+static void report_progress(chunk_t *c, long int processed)
+{
+    int p = (int)((double)processed * 100 / c->entry_count);
+    while(*c->progress < p)
+        c->progress_cb(++*c->progress, c->context);
+}
+
+static void validate_chunk(chunk_t *c)
+{
+    long int i, n;
+    uint8 const *e, *group_start;
+    uint16 mv;
+
+    // One bit for every possible move, set for the moves of the current key
+    uint8 *seen = (uint8 *)calloc(65536 / 8, 1);
+    if(!seen){
+        c->result = 2;
+        ATOMIC_ADD(c->failed, 1);
+        ATOMIC_ADD(c->finished, 1);
+        return;
+    }
+
+    group_start = c->data + c->first * POLYGLOT_ENTRY_SIZE;
+    for(i = c->first; i < c->last && 0 == ATOMIC_ADD(c->failed, 0); i += n)
+    {
+        n = c->last - i < BLOCK_ENTRIES ? c->last - i : BLOCK_ENTRIES;
+        e = c->data + i * POLYGLOT_ENTRY_SIZE;
+
+        // Include the last entry of the previous block, so we check the pair between blocks.
+        //  It was already counted, so take it back out of the zero weights.
+        if(c->first < i){
+            if(0 != c->scan_block(e - POLYGLOT_ENTRY_SIZE, n + 1, &c->zero_weight_count))
+                c->result = 1;
+            if(0 == e[-POLYGLOT_ENTRY_SIZE + OFFSET_WEIGHT] && 0 == e[-POLYGLOT_ENTRY_SIZE + OFFSET_WEIGHT + 1])
+                --c->zero_weight_count;
+        }
+        else if(0 != c->scan_block(e, n, &c->zero_weight_count)){
+            c->result = 1;
+        }
+
+        if(0 != c->result){
+            ATOMIC_ADD(c->failed, 1);
+            break;
+        }
+
+        // Look for duplicate moves while the block is still in the cache
+        for(; e < c->data + (i + n) * POLYGLOT_ENTRY_SIZE; e += POLYGLOT_ENTRY_SIZE)
+        {
+            if(e != group_start && 0 != memcmp(e, e - POLYGLOT_ENTRY_SIZE, POLYGLOT_KEY_SIZE))
+            {
+                // A new key, so forget the moves of the last one
+                for(; group_start < e; group_start += POLYGLOT_ENTRY_SIZE){
+                    mv = ((uint16)group_start[OFFSET_MOVE] << 8) | group_start[OFFSET_MOVE + 1];
+                    seen[mv >> 3] = 0;
+                }
+            }
+
+            mv = ((uint16)e[OFFSET_MOVE] << 8) | e[OFFSET_MOVE + 1];
+            if(seen[mv >> 3] & (1 << (mv & 0x7)))
+                ++c->duplicate_count;
+            else
+                seen[mv >> 3] |= (1 << (mv & 0x7));
+        }
+
+        if(c->progress_cb)
+            report_progress(c, i + n);
+        else
+            ATOMIC_ADD(c->processed, n);
+    }
+
+    free(seen);
+    ATOMIC_ADD(c->finished, 1);
+}
+
+
+#if defined(WIN32)
+static DWORD WINAPI chunk_thread(LPVOID c)
+{
+    validate_chunk((chunk_t *)c);
+    return 0;
+}
+#else
+static void *chunk_thread(void *c)
+{
+    validate_chunk((chunk_t *)c);
+    return NULL;
+}
+#endif
+
+static int cpu_count()
+{
+#if defined(WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return 0 < n ? (int)n : 1;
+#endif
+}
+
+static void sleep_ms(int ms)
+{
+#if defined(WIN32)
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = ms * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+
+PG_EXPORT int pg_validate_file(void *h,
+                               void (*progress_cb)(int, void *),
+                               void *context,
+                               pg_validation_report_t *report)
+{
+    file_object_t *f = (file_object_t *)h;
+    chunk_t chunks[MAX_THREADS];
+#if defined(WIN32)
+    HANDLE threads[MAX_THREADS];
+#else
+    pthread_t threads[MAX_THREADS];
+#endif
+    int started[MAX_THREADS];
+    volatile long int processed = 0, finished = 0, failed = 0;
+    int i, thread_cnt, progress = 0, result = 0;
+    long int entry_cnt, boundary;
+    int mapped_here = 0;
+    scan_block_fn scan_block = select_scanner();
+
+    // We validate the mapped book, so map it for the duration if it isn't already
+    if(!f->data){
+        if(0 != map_file(f)){
+            f->error = pg_error_string();
+            return 1;
+        }
+        mapped_here = 1;
+    }
+    entry_cnt = f->entry_count;
+
+    thread_cnt = cpu_count();
+    if(entry_cnt / MIN_THREAD_ENTRIES < thread_cnt)
+        thread_cnt = (int)(entry_cnt / MIN_THREAD_ENTRIES);
+    if(MAX_THREADS < thread_cnt)
+        thread_cnt = MAX_THREADS;
+    if(thread_cnt < 1)
+        thread_cnt = 1;
+
+    // Divide the book into chunks, moving each boundary forward to the start of a new key
+    memset(chunks, 0, sizeof(chunks));
+    boundary = 0;
+    for(i = 0; i < thread_cnt; ++i)
+    {
+        chunks[i].data = f->data;
+        chunks[i].first = boundary;
+        boundary = (i == thread_cnt - 1) ? entry_cnt : entry_cnt / thread_cnt * (i + 1);
+        if(boundary < chunks[i].first)
+            boundary = chunks[i].first;
+        while(0 < boundary && boundary < entry_cnt &&
+              0 == memcmp(f->data + boundary * POLYGLOT_ENTRY_SIZE,
+                          f->data + (boundary - 1) * POLYGLOT_ENTRY_SIZE,
+                          POLYGLOT_KEY_SIZE))
+            ++boundary;
+        chunks[i].last = boundary;
+        chunks[i].scan_block = scan_block;
+        chunks[i].processed = &processed;
+        chunks[i].finished = &finished;
+        chunks[i].failed = &failed;
+        chunks[i].entry_count = entry_cnt;
+        chunks[i].progress = &progress;
+    }
+
+    if(1 == thread_cnt)
+    {
+        chunks[0].progress_cb = progress_cb;
+        chunks[0].context = context;
+        validate_chunk(&chunks[0]);
+    }
+    else
+    {
+        for(i = 0; i < thread_cnt; ++i)
+        {
+#if defined(WIN32)
+            threads[i] = CreateThread(NULL, 0, &chunk_thread, &chunks[i], 0, NULL);
+            started[i] = NULL != threads[i];
+#else
+            started[i] = 0 == pthread_create(&threads[i], NULL, &chunk_thread, &chunks[i]);
+#endif
+            // If we can't start a thread we just do the work ourselves
+            if(!started[i])
+                validate_chunk(&chunks[i]);
+        }
+
+        // Report progress on the calling thread while the workers run
+        while(ATOMIC_ADD(&finished, 0) < thread_cnt)
+        {
+            if(progress_cb){
+                int p = (int)((double)ATOMIC_ADD(&processed, 0) * 100 / entry_cnt);
+                while(progress < p)
+                    progress_cb(++progress, context);
+            }
+            sleep_ms(10);
+        }
+
+        for(i = 0; i < thread_cnt; ++i)
+        {
+            if(!started[i])
+                continue;
+#if defined(WIN32)
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+#else
+            pthread_join(threads[i], NULL);
+#endif
+        }
+    }
+
+    // Gather the results and check the order at the chunk boundaries
+    if(report)
+        memset(report, 0, sizeof(pg_validation_report_t));
+    for(i = 0; i < thread_cnt; ++i)
+    {
+        if(result < chunks[i].result)
+            result = chunks[i].result;
+        if(0 < i && chunks[i].first < chunks[i].last && 0 < chunks[i].first &&
+                load_key(f->data + chunks[i].first * POLYGLOT_ENTRY_SIZE) <
+                load_key(f->data + (chunks[i].first - 1) * POLYGLOT_ENTRY_SIZE))
+            result = 1;
+
+        if(report){
+            report->duplicate_count += chunks[i].duplicate_count;
+            report->zero_weight_count += chunks[i].zero_weight_count;
+        }
+    }
+    if(report)
+        report->entry_count = entry_cnt;
+
+    if(mapped_here)
+        unmap_file(f);
+
+    if(0 == result){
+        if(progress_cb)
+            while(progress < 100)
+                progress_cb(++progress, context);
+        set_file_error_string(f, 0);
+    }
+    else{
+        set_file_error_string(f, 1 == result ? "Keys in the book must be in ascending order" : "Out of memory");
+    }
+    return 0 == result ? 0 : 1;
+}